@@ -0,0 +1,65 @@
+# Build a benchmark (lf_bench by default) in Release mode once for each scheduler in SCHEDULERS,
+# run it, and merge the JSON outputs into ${BENCH_DIR}/results.json. The scheduler is chosen at
+# compile time, hence the separate builds. The runs after the first get LATER_ARGS, which by
+# default restrict lf_bench to the benchmarks that depend on the scheduler.
+#
+# Usage: cmake -DSOURCE_DIR=<repo> -DBENCH_DIR=<dir> [-DSCHEDULERS=NP,GEDF_NP,ADAPTIVE]
+#              [-DARGS="--repetitions 30"] [-DTARGET=lf_bench] [-DPROGRAM=bench/lf_bench]
+#              [-DLATER_ARGS="--filter sched/"] -P RunBench.cmake
+
+if(NOT SCHEDULERS)
+    set(SCHEDULERS NP GEDF_NP ADAPTIVE)
+endif()
+if(NOT BENCH_TARGET)
+    set(BENCH_TARGET lf_bench)
+endif()
+if(NOT BENCH_PROGRAM)
+    set(BENCH_PROGRAM bench/lf_bench)
+endif()
+if(NOT DEFINED LATER_ARGS)
+    set(LATER_ARGS "--filter sched/")
+endif()
+string(REPLACE "," ";" SCHEDULERS "${SCHEDULERS}")
+separate_arguments(ARGS)
+
+set(PARTS "")
+set(FIRST TRUE)
+foreach(S ${SCHEDULERS})
+    set(BUILD_DIR ${BENCH_DIR}/${S})
+    message(STATUS "Building ${BENCH_TARGET} with SCHEDULER=SCHED_${S} in ${BUILD_DIR}")
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BUILD_DIR} -DCMAKE_BUILD_TYPE=Release -DSCHEDULER=SCHED_${S}
+        RESULT_VARIABLE RESULT
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Configuring ${BUILD_DIR} failed.")
+    endif()
+    execute_process(COMMAND ${CMAKE_COMMAND} --build ${BUILD_DIR} --target ${BENCH_TARGET} RESULT_VARIABLE RESULT)
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Building ${BENCH_TARGET} in ${BUILD_DIR} failed.")
+    endif()
+
+    set(FILTER "")
+    if(NOT FIRST)
+        separate_arguments(FILTER UNIX_COMMAND "${LATER_ARGS}")
+    endif()
+    set(OUTPUT ${BUILD_DIR}/results.json)
+    message(STATUS "Running ${BENCH_TARGET} with SCHEDULER=SCHED_${S}")
+    execute_process(
+        COMMAND ${BUILD_DIR}/${BENCH_PROGRAM} --output ${OUTPUT} ${FILTER} ${ARGS}
+        RESULT_VARIABLE RESULT
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "${BENCH_TARGET} with SCHEDULER=SCHED_${S} failed.")
+    endif()
+    file(READ ${OUTPUT} PART)
+    if(FIRST)
+        set(PARTS "${PART}")
+    else()
+        set(PARTS "${PARTS},\n${PART}")
+    endif()
+    set(FIRST FALSE)
+endforeach()
+
+file(WRITE ${BENCH_DIR}/results.json "{\"runs\": [\n${PARTS}]}\n")
+message(STATUS "Wrote ${BENCH_DIR}/results.json")
@@ -0,0 +1,785 @@
+/**
+ * @file lf_bench.c
+ * @brief Microbenchmarks of the primitives of the runtime.
+ *
+ * Each benchmark repeats a batch of operations. The size of the batch is calibrated so that one
+ * batch takes about `--batch-ms` milliseconds, one batch is run to warm up, and then
+ * `--repetitions` batches are timed. The time per operation of each batch is one sample. For each
+ * benchmark, the median, mean, standard deviation, minimum, maximum, and the half width of the 95%
+ * confidence interval of the mean (Student's t) are written as JSON to `--output` (default: stdout).
+ *
+ * The scheduler benchmarks run every repetition in a child process because the schedulers keep
+ * state in static variables that cannot be reset. A repetition executes `--sched-tags` tags, at each
+ * of which a grid of reactions of `--sched-levels` levels by `--sched-width` reactions is executed.
+ * A reaction triggers the reaction at the same position on the next level. Reactions do no work, so
+ * the time per reaction is the cost of one trigger and get-ready-reaction round trip through the
+ * scheduler, including the tag advances. The scheduler is the one this program is compiled with
+ * (`-DSCHEDULER=...`), so run `bench/RunBench.cmake` (the `bench` target) to compare schedulers.
+ * Likewise, the `pqueue_tag` benchmarks measure the binary heap, or the calendar queue if this
+ * program is compiled with `-DLF_CALENDAR_QUEUE`.
+ *
+ * Usage: lf_bench [--output FILE] [--filter PREFIX] [--repetitions N] [--batch-ms MS]
+ *                 [--max-workers N] [--sched-tags N] [--sched-levels N] [--sched-width N]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if !defined(LF_SINGLE_THREADED)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "environment.h"
+#include "hashset/hashset.h"
+#include "impl/pointer_hashmap.h"
+#include "lf_token.h"
+#include "low_level_platform.h"
+#include "pqueue.h"
+#include "pqueue_tag.h"
+#include "reaction_heap.h"
+#include "reactor_common.h"
+#include "util.h"
+
+#if !defined(LF_SINGLE_THREADED)
+#include "lf_semaphore.h"
+#include "scheduler.h"
+#endif
+
+#define MAX_REPETITIONS 1000
+#define MAX_BATCH_OPERATIONS ((size_t)1 << 30)
+
+//////////////////
+// Stubs of the functions that the code generator would emit for a program.
+
+static environment_t env;
+
+void lf_create_environments(void) {}
+void _lf_initialize_trigger_objects(void) {}
+void lf_terminate_execution(environment_t* e) { (void)e; }
+void lf_set_default_command_line_options(void) {}
+void logical_tag_complete(tag_t tag_to_send) { (void)tag_to_send; }
+int _lf_get_environments(environment_t** envs) {
+  *envs = &env;
+  return 1;
+}
+
+/** Command-line options. */
+static struct {
+  const char* output;
+  const char* filter;
+  int repetitions;
+  double batch_ms;
+  int max_workers;
+  int sched_tags;
+  int sched_levels;
+  int sched_width;
+} options = {NULL, "", 15, 10.0, 64, 200, 8, 16};
+
+/** Keeps the compiler from optimizing away the results of benchmarked operations. */
+static volatile uintptr_t sink;
+
+static uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+
+/** Return a pseudo-random number (xorshift64). */
+static uint64_t next_random(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return random_state;
+}
+
+static long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//////////////////
+// Statistics and output.
+
+static FILE* out;
+static bool first_result = true;
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/** Return the two-sided 95% quantile of Student's t distribution with the given degrees of freedom. */
+static double t_quantile_95(int df) {
+  static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                 2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                 2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df < 1) {
+    return NAN;
+  }
+  if (df <= (int)(sizeof(table) / sizeof(table[0]))) {
+    return table[df - 1];
+  }
+  return df <= 60 ? 2.000 : (df <= 120 ? 1.980 : 1.960);
+}
+
+/**
+ * @brief Write the statistics of the samples of one benchmark, in nanoseconds per operation.
+ * @param name The name of the benchmark.
+ * @param param_name The name of its parameter, or NULL if it has none.
+ * @param param The value of the parameter.
+ * @param operations The number of operations in each sample.
+ * @param samples The samples, which are sorted in place.
+ * @param count The number of samples.
+ */
+static void report(const char* name, const char* param_name, size_t param, size_t operations, double* samples,
+                   int count) {
+  qsort(samples, (size_t)count, sizeof(double), compare_doubles);
+  double sum = 0.0;
+  for (int i = 0; i < count; i++) {
+    sum += samples[i];
+  }
+  double mean = sum / count;
+  double squares = 0.0;
+  for (int i = 0; i < count; i++) {
+    squares += (samples[i] - mean) * (samples[i] - mean);
+  }
+  double stddev = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+  double median = count % 2 == 1 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+  double ci95 = count > 1 ? t_quantile_95(count - 1) * stddev / sqrt((double)count) : 0.0;
+
+  fprintf(out, "%s\n    {\"name\": \"%s\", ", first_result ? "" : ",", name);
+  if (param_name != NULL) {
+    fprintf(out, "\"%s\": %zu, ", param_name, param);
+  }
+  fprintf(out,
+          "\"unit\": \"ns/op\", \"repetitions\": %d, \"operations_per_repetition\": %zu, "
+          "\"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"max\": %.3f, \"ci95\": %.3f}",
+          count, operations, median, mean, stddev, samples[0], samples[count - 1], ci95);
+  fflush(out);
+  first_result = false;
+
+  fprintf(stderr, "%-32s", name);
+  if (param_name != NULL) {
+    fprintf(stderr, " %s=%-6zu", param_name, param);
+  } else {
+    fprintf(stderr, "%15s", "");
+  }
+  fprintf(stderr, " median %10.1f ns/op  mean %10.1f +- %.1f\n", median, mean, ci95);
+}
+
+//////////////////
+// In-process benchmarks.
+
+/** A benchmark whose operations run in this process. */
+typedef struct benchmark_t {
+  const char* name;
+  const char* param_name; // NULL if the benchmark has no parameter.
+  size_t param;
+  void* (*setup)(size_t param);
+  void (*run)(void* state, size_t operations);
+  void (*teardown)(void* state);
+} benchmark_t;
+
+static bool selected(const char* name) { return strncmp(name, options.filter, strlen(options.filter)) == 0; }
+
+static long long time_batch(const benchmark_t* benchmark, void* state, size_t operations) {
+  long long start = now_ns();
+  benchmark->run(state, operations);
+  return now_ns() - start;
+}
+
+static void run_benchmark(const benchmark_t* benchmark) {
+  if (!selected(benchmark->name)) {
+    return;
+  }
+  void* state = benchmark->setup(benchmark->param);
+  long long target = (long long)(options.batch_ms * 1e6);
+  size_t operations = 1;
+  long long elapsed;
+  while ((elapsed = time_batch(benchmark, state, operations)) < target && operations < MAX_BATCH_OPERATIONS) {
+    // Grow geometrically, but aim directly at the target once the time of a batch is measurable.
+    size_t estimate = elapsed > 1000 ? (size_t)((double)operations * (double)target / (double)elapsed) : 0;
+    operations = estimate > operations * 2 ? estimate : operations * 2;
+  }
+  time_batch(benchmark, state, operations); // Warm-up.
+
+  double samples[MAX_REPETITIONS];
+  for (int i = 0; i < options.repetitions; i++) {
+    samples[i] = (double)time_batch(benchmark, state, operations) / (double)operations;
+  }
+  benchmark->teardown(state);
+  report(benchmark->name, benchmark->param_name, benchmark->param, operations, samples, options.repetitions);
+}
+
+/////////
+// The reaction queues: hold model, i.e. pop the first reaction and insert it again later.
+
+typedef struct reaction_queue_state_t {
+  reaction_t* reactions;
+  pqueue_t* pqueue;
+  reaction_heap_t heap;
+} reaction_queue_state_t;
+
+static void* reaction_queue_setup(size_t size) {
+  reaction_queue_state_t* state = (reaction_queue_state_t*)calloc(1, sizeof(reaction_queue_state_t));
+  state->reactions = (reaction_t*)calloc(size, sizeof(reaction_t));
+  LF_ASSERT_NON_NULL(state->reactions);
+  state->pqueue = pqueue_init(size, in_reverse_order, get_reaction_index, get_reaction_position,
+                              set_reaction_position, reaction_matches, print_reaction);
+  state->heap = reaction_heap_new(size);
+  for (size_t i = 0; i < size; i++) {
+    state->reactions[i].index = next_random() % (4 * size);
+    pqueue_insert(state->pqueue, &state->reactions[i]);
+    reaction_heap_insert(&state->heap, &state->reactions[i], state->reactions[i].index);
+  }
+  return state;
+}
+
+static void reaction_queue_teardown(void* state) {
+  reaction_queue_state_t* s = (reaction_queue_state_t*)state;
+  pqueue_free(s->pqueue);
+  reaction_heap_free(&s->heap);
+  free(s->reactions);
+  free(s);
+}
+
+static void pqueue_hold(void* state, size_t operations) {
+  pqueue_t* q = ((reaction_queue_state_t*)state)->pqueue;
+  for (size_t i = 0; i < operations; i++) {
+    reaction_t* reaction = (reaction_t*)pqueue_pop(q);
+    reaction->index += 1 + next_random() % 64;
+    pqueue_insert(q, reaction);
+  }
+}
+
+static void reaction_heap_hold(void* state, size_t operations) {
+  reaction_heap_t* heap = &((reaction_queue_state_t*)state)->heap;
+  for (size_t i = 0; i < operations; i++) {
+    reaction_t* reaction = reaction_heap_pop(heap);
+    reaction->index += 1 + next_random() % 64;
+    reaction_heap_insert(heap, reaction, reaction->index);
+  }
+}
+
+/////////
+// The tag-sorted queue of events.
+
+typedef struct tag_queue_state_t {
+  pqueue_tag_element_t* elements;
+  size_t size;
+  pqueue_tag_t* q;
+} tag_queue_state_t;
+
+static void* tag_queue_setup(size_t size) {
+  tag_queue_state_t* state = (tag_queue_state_t*)calloc(1, sizeof(tag_queue_state_t));
+  state->elements = (pqueue_tag_element_t*)calloc(size, sizeof(pqueue_tag_element_t));
+  LF_ASSERT_NON_NULL(state->elements);
+  state->size = size;
+  state->q = pqueue_tag_init(size);
+  for (size_t i = 0; i < size; i++) {
+    // Distinct tags, so that lookups by tag find exactly one element.
+    state->elements[i].tag = (tag_t){.time = (instant_t)i * USEC(1), .microstep = (microstep_t)(i % 2)};
+    pqueue_tag_insert(state->q, &state->elements[i]);
+  }
+  return state;
+}
+
+static void tag_queue_teardown(void* state) {
+  tag_queue_state_t* s = (tag_queue_state_t*)state;
+  pqueue_tag_free(s->q);
+  free(s->elements);
+  free(s);
+}
+
+static void pqueue_tag_hold(void* state, size_t operations) {
+  pqueue_tag_t* q = ((tag_queue_state_t*)state)->q;
+  for (size_t i = 0; i < operations; i++) {
+    pqueue_tag_element_t* e = pqueue_tag_pop(q);
+    e->tag.time += (instant_t)(1 + next_random() % 1000) * USEC(1);
+    pqueue_tag_insert(q, e);
+  }
+}
+
+// Timers of mixed periods, each rescheduled one period after it fires, as in a program with many timers.
+static const interval_t timer_periods[] = {MSEC(1), MSEC(2), MSEC(5), MSEC(10), MSEC(20), MSEC(50), MSEC(100)};
+#define TIMER_PERIODS (sizeof(timer_periods) / sizeof(timer_periods[0]))
+
+static void* timer_queue_setup(size_t size) {
+  tag_queue_state_t* state = (tag_queue_state_t*)calloc(1, sizeof(tag_queue_state_t));
+  state->elements = (pqueue_tag_element_t*)calloc(size, sizeof(pqueue_tag_element_t));
+  LF_ASSERT_NON_NULL(state->elements);
+  state->size = size;
+  state->q = pqueue_tag_init(size);
+  for (size_t i = 0; i < size; i++) {
+    // Offsets within the first period.
+    interval_t period = timer_periods[i % TIMER_PERIODS];
+    state->elements[i].tag = (tag_t){.time = (instant_t)(next_random() % 1000) * (period / 1000), .microstep = 0};
+    pqueue_tag_insert(state->q, &state->elements[i]);
+  }
+  return state;
+}
+
+static void pqueue_tag_hold_timers(void* state, size_t operations) {
+  tag_queue_state_t* s = (tag_queue_state_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    pqueue_tag_element_t* e = pqueue_tag_pop(s->q);
+    e->tag.time += timer_periods[(size_t)(e - s->elements) % TIMER_PERIODS];
+    pqueue_tag_insert(s->q, e);
+  }
+}
+
+static void pqueue_tag_find(void* state, size_t operations) {
+  tag_queue_state_t* s = (tag_queue_state_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    tag_t tag = s->elements[next_random() % s->size].tag;
+    sink = (uintptr_t)pqueue_tag_find_with_tag(s->q, tag);
+  }
+}
+
+static void pqueue_tag_insert_match(void* state, size_t operations) {
+  tag_queue_state_t* s = (tag_queue_state_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    // The tag is on the queue already, so nothing is inserted.
+    sink = (uintptr_t)pqueue_tag_insert_if_no_match(s->q, s->elements[next_random() % s->size].tag);
+  }
+}
+
+/////////
+// Tokens.
+
+static token_type_t int_type = {.element_size = sizeof(int), .destructor = NULL, .copy_constructor = NULL};
+
+static void* no_setup(size_t param) {
+  (void)param;
+  return NULL;
+}
+
+static void no_teardown(void* state) { (void)state; }
+
+static void token_new_free(void* state, size_t operations) {
+  (void)state;
+  for (size_t i = 0; i < operations; i++) {
+    int* value = (int*)malloc(sizeof(int));
+    *value = (int)i;
+    lf_token_t* token = _lf_new_token(&int_type, value, 1);
+    token->ref_count = 1;
+    sink = (uintptr_t)_lf_done_using(token);
+  }
+}
+
+/////////
+// Hash sets and hash maps of pointers.
+
+typedef struct hash_state_t {
+  size_t size;
+  hashset_t set;
+  hashmap_object2int_t* map;
+} hash_state_t;
+
+/** Return the pointer-like key number i. Keys are aligned like real pointers, and never NULL. */
+static void* key(size_t i) { return (void*)(uintptr_t)((i + 1) * 16); }
+
+static void* hash_setup(size_t size) {
+  hash_state_t* state = (hash_state_t*)calloc(1, sizeof(hash_state_t));
+  state->size = size;
+  unsigned short nbits = 1;
+  while (((size_t)1 << nbits) < 2 * size) {
+    nbits++;
+  }
+  state->set = hashset_create(nbits);
+  state->map = hashmap_object2int_new(2 * size, NULL);
+  for (size_t i = 0; i < size; i++) {
+    hashset_add(state->set, key(i));
+    hashmap_object2int_put(state->map, key(i), (int)i);
+  }
+  return state;
+}
+
+static void hash_teardown(void* state) {
+  hash_state_t* s = (hash_state_t*)state;
+  hashset_destroy(s->set);
+  hashmap_object2int_free(s->map);
+  free(s);
+}
+
+static void hashset_add_remove(void* state, size_t operations) {
+  hash_state_t* s = (hash_state_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    void* item = key(s->size + next_random() % s->size);
+    hashset_add(s->set, item);
+    hashset_remove(s->set, item);
+  }
+}
+
+static void hashset_member(void* state, size_t operations) {
+  hash_state_t* s = (hash_state_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    sink = (uintptr_t)hashset_is_member(s->set, key(next_random() % (2 * s->size)));
+  }
+}
+
+static void hashmap_put_get(void* state, size_t operations) {
+  hash_state_t* s = (hash_state_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    void* k = key(next_random() % s->size);
+    hashmap_object2int_put(s->map, k, (int)i);
+    sink = (uintptr_t)hashmap_object2int_get(s->map, k);
+  }
+}
+
+#if !defined(LF_SINGLE_THREADED)
+/////////
+// Synchronization primitives.
+
+static void* semaphore_setup(size_t param) {
+  (void)param;
+  return lf_semaphore_new(0);
+}
+
+static void semaphore_teardown(void* state) { lf_semaphore_destroy((lf_semaphore_t*)state); }
+
+static void semaphore_release_acquire(void* state, size_t operations) {
+  lf_semaphore_t* semaphore = (lf_semaphore_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    lf_semaphore_release(semaphore, 1);
+    lf_semaphore_acquire(semaphore);
+  }
+}
+
+/**
+ * Two threads that take turns. An operation is a round trip, i.e. two wake-ups of a waiting
+ * thread. The partner thread lives as long as the benchmark, so it is not created per batch.
+ */
+typedef struct ping_pong_state_t {
+  lf_mutex_t mutex;
+  lf_cond_t cond;
+  lf_semaphore_t* ping;
+  lf_semaphore_t* pong;
+  int turn; // 1 if it is the turn of the partner.
+  bool stop;
+  bool use_cond;
+  lf_thread_t partner;
+} ping_pong_state_t;
+
+static void* ping_pong_partner(void* arg) {
+  ping_pong_state_t* s = (ping_pong_state_t*)arg;
+  if (!s->use_cond) {
+    while (true) {
+      lf_semaphore_acquire(s->ping);
+      if (s->stop) {
+        return NULL;
+      }
+      lf_semaphore_release(s->pong, 1);
+    }
+  }
+  LF_MUTEX_LOCK(&s->mutex);
+  while (true) {
+    while (s->turn != 1) {
+      LF_COND_WAIT(&s->cond);
+    }
+    if (s->stop) {
+      break;
+    }
+    s->turn = 0;
+    LF_COND_SIGNAL(&s->cond);
+  }
+  LF_MUTEX_UNLOCK(&s->mutex);
+  return NULL;
+}
+
+static void* ping_pong_setup(size_t use_cond) {
+  ping_pong_state_t* state = (ping_pong_state_t*)calloc(1, sizeof(ping_pong_state_t));
+  state->use_cond = use_cond != 0;
+  LF_MUTEX_INIT(&state->mutex);
+  LF_COND_INIT(&state->cond, &state->mutex);
+  state->ping = lf_semaphore_new(0);
+  state->pong = lf_semaphore_new(0);
+  lf_thread_create(&state->partner, ping_pong_partner, state);
+  return state;
+}
+
+static void ping_pong_teardown(void* state) {
+  ping_pong_state_t* s = (ping_pong_state_t*)state;
+  s->stop = true;
+  if (s->use_cond) {
+    LF_MUTEX_LOCK(&s->mutex);
+    s->turn = 1;
+    LF_COND_SIGNAL(&s->cond);
+    LF_MUTEX_UNLOCK(&s->mutex);
+  } else {
+    lf_semaphore_release(s->ping, 1);
+  }
+  lf_thread_join(s->partner, NULL);
+  lf_semaphore_destroy(s->ping);
+  lf_semaphore_destroy(s->pong);
+  free(s);
+}
+
+static void semaphore_ping_pong(void* state, size_t operations) {
+  ping_pong_state_t* s = (ping_pong_state_t*)state;
+  for (size_t i = 0; i < operations; i++) {
+    lf_semaphore_release(s->ping, 1);
+    lf_semaphore_acquire(s->pong);
+  }
+}
+
+static void cond_ping_pong(void* state, size_t operations) {
+  ping_pong_state_t* s = (ping_pong_state_t*)state;
+  LF_MUTEX_LOCK(&s->mutex);
+  for (size_t i = 0; i < operations; i++) {
+    s->turn = 1;
+    LF_COND_SIGNAL(&s->cond);
+    while (s->turn != 0) {
+      LF_COND_WAIT(&s->cond);
+    }
+  }
+  LF_MUTEX_UNLOCK(&s->mutex);
+}
+
+//////////////////
+// Scheduler benchmarks.
+
+#if SCHEDULER == SCHED_ADAPTIVE
+#define SCHEDULER_NAME "ADAPTIVE"
+#elif SCHEDULER == SCHED_GEDF_NP
+#define SCHEDULER_NAME "GEDF_NP"
+#elif SCHEDULER == SCHED_GEDF_LEVELED
+#define SCHEDULER_NAME "GEDF_LEVELED"
+#elif SCHEDULER == SCHED_NP_WORK_STEALING
+#define SCHEDULER_NAME "NP_WORK_STEALING"
+#else
+#define SCHEDULER_NAME "NP"
+#endif
+
+static reaction_t* grid;            // Reaction number level * width + i.
+static reaction_t** first_level;    // The reactions triggered by the event at each tag.
+static size_t grid_size;            // Number of reactions in the grid.
+
+static void* sched_worker(void* arg) {
+  int worker = (int)(intptr_t)arg;
+  lf_scheduler_t* scheduler = env.scheduler;
+  size_t width = (size_t)options.sched_width;
+  reaction_t* reaction;
+  while ((reaction = lf_sched_get_ready_reaction(scheduler, worker)) != NULL) {
+    size_t number = (size_t)(reaction - grid);
+    if (number + width < grid_size) {
+      lf_scheduler_trigger_reaction(scheduler, &grid[number + width], worker);
+    }
+    lf_sched_done_with_reaction((size_t)worker, reaction);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Execute the workload of one repetition with the given number of workers.
+ * @return The time per reaction in nanoseconds.
+ */
+static double sched_repetition(int workers) {
+  size_t levels = (size_t)options.sched_levels;
+  size_t width = (size_t)options.sched_width;
+  grid_size = levels * width;
+  grid = (reaction_t*)calloc(grid_size, sizeof(reaction_t));
+  first_level = (reaction_t**)calloc(width, sizeof(reaction_t*));
+  LF_ASSERT_NON_NULL(grid);
+  LF_ASSERT_NON_NULL(first_level);
+  for (size_t i = 0; i < grid_size; i++) {
+    grid[i].name = "lf_bench";
+    grid[i].status = inactive;
+    grid[i].index = i / width; // No deadline, and the level in the least significant bits.
+  }
+  for (size_t i = 0; i < width; i++) {
+    first_level[i] = &grid[i];
+  }
+  trigger_t trigger = {.reactions = first_level, .number_of_reactions = (int)width};
+
+  environment_init(&env, "lf_bench", 0, workers, 0, 0, 0, 0, 0, 0, 0, 0, NULL);
+  env.current_tag = (tag_t){.time = 0, .microstep = 0};
+  env.execution_started = true;
+  for (int t = 1; t <= options.sched_tags; t++) {
+    event_t* event = lf_get_new_event(&env);
+    event->trigger = &trigger;
+    event->base.tag = (tag_t){.time = t, .microstep = 0};
+    pqueue_tag_insert(env.event_q, (pqueue_tag_element_t*)event);
+  }
+  size_t* reactions_per_level = (size_t*)calloc(levels, sizeof(size_t));
+  LF_ASSERT_NON_NULL(reactions_per_level);
+  for (size_t i = 0; i < levels; i++) {
+    reactions_per_level[i] = width;
+  }
+  sched_params_t params = {.num_reactions_per_level = reactions_per_level, .num_reactions_per_level_size = levels};
+  lf_sched_init(&env, (size_t)workers, &params);
+
+  long long start = now_ns();
+  for (int i = 0; i < workers; i++) {
+    lf_thread_create(&env.thread_ids[i], sched_worker, (void*)(intptr_t)i);
+  }
+  for (int i = 0; i < workers; i++) {
+    lf_thread_join(env.thread_ids[i], NULL);
+  }
+  long long elapsed = now_ns() - start;
+  // Processes are discarded after a repetition, so nothing is freed.
+  return (double)elapsed / (double)((size_t)options.sched_tags * grid_size);
+}
+
+/** Run one repetition in a child process and return its time per reaction, or a negative number on failure. */
+static double sched_forked_repetition(int workers) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    lf_print_error_and_exit("Failed to create a pipe.");
+  }
+  fflush(NULL);
+  pid_t pid = fork();
+  if (pid < 0) {
+    lf_print_error_and_exit("Failed to fork.");
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    double result = sched_repetition(workers);
+    ssize_t written = write(fds[1], &result, sizeof(result));
+    _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+  }
+  close(fds[1]);
+  double result = -1.0;
+  if (read(fds[0], &result, sizeof(result)) != (ssize_t)sizeof(result)) {
+    result = -1.0;
+  }
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    result = -1.0;
+  }
+  return result;
+}
+
+static void run_sched_benchmarks(void) {
+  const char* name = "sched/" SCHEDULER_NAME "/round_trip";
+  if (!selected(name)) {
+    return;
+  }
+#if defined(LF_TRACE)
+  // Tracepoints of the schedulers need the trace buffers of a program that has started tracing.
+  lf_print_warning("Skipping %s, which does not support LF_TRACE.", name);
+  return;
+#endif
+  size_t operations = (size_t)options.sched_tags * (size_t)options.sched_levels * (size_t)options.sched_width;
+  for (int workers = 1; workers <= options.max_workers; workers *= 2) {
+    if (sched_forked_repetition(workers) < 0) { // Warm-up.
+      lf_print_error("Scheduler benchmark with %d workers failed.", workers);
+      continue;
+    }
+    double samples[MAX_REPETITIONS];
+    int count = 0;
+    for (int i = 0; i < options.repetitions; i++) {
+      double sample = sched_forked_repetition(workers);
+      if (sample >= 0) {
+        samples[count++] = sample;
+      }
+    }
+    if (count > 0) {
+      report(name, "workers", (size_t)workers, operations, samples, count);
+    }
+  }
+}
+#endif // !LF_SINGLE_THREADED
+
+static const benchmark_t benchmarks[] = {
+    {"pqueue/hold", "size", 16, reaction_queue_setup, pqueue_hold, reaction_queue_teardown},
+    {"pqueue/hold", "size", 1024, reaction_queue_setup, pqueue_hold, reaction_queue_teardown},
+    {"pqueue/hold", "size", 65536, reaction_queue_setup, pqueue_hold, reaction_queue_teardown},
+    {"reaction_heap/hold", "size", 16, reaction_queue_setup, reaction_heap_hold, reaction_queue_teardown},
+    {"reaction_heap/hold", "size", 1024, reaction_queue_setup, reaction_heap_hold, reaction_queue_teardown},
+    {"reaction_heap/hold", "size", 65536, reaction_queue_setup, reaction_heap_hold, reaction_queue_teardown},
+    {"pqueue_tag/hold", "size", 64, tag_queue_setup, pqueue_tag_hold, tag_queue_teardown},
+    {"pqueue_tag/hold", "size", 4096, tag_queue_setup, pqueue_tag_hold, tag_queue_teardown},
+    {"pqueue_tag/hold", "size", 65536, tag_queue_setup, pqueue_tag_hold, tag_queue_teardown},
+    {"pqueue_tag/hold_timers", "size", 4096, timer_queue_setup, pqueue_tag_hold_timers, tag_queue_teardown},
+    {"pqueue_tag/hold_timers", "size", 100000, timer_queue_setup, pqueue_tag_hold_timers, tag_queue_teardown},
+    {"pqueue_tag/find_with_tag", "size", 64, tag_queue_setup, pqueue_tag_find, tag_queue_teardown},
+    {"pqueue_tag/find_with_tag", "size", 4096, tag_queue_setup, pqueue_tag_find, tag_queue_teardown},
+    {"pqueue_tag/insert_if_no_match", "size", 64, tag_queue_setup, pqueue_tag_insert_match, tag_queue_teardown},
+    {"pqueue_tag/insert_if_no_match", "size", 4096, tag_queue_setup, pqueue_tag_insert_match, tag_queue_teardown},
+    {"token/new_free", NULL, 0, no_setup, token_new_free, no_teardown},
+    {"hashset/add_remove", "size", 1024, hash_setup, hashset_add_remove, hash_teardown},
+    {"hashset/is_member", "size", 1024, hash_setup, hashset_member, hash_teardown},
+    {"hashmap/put_get", "size", 1024, hash_setup, hashmap_put_get, hash_teardown},
+#if !defined(LF_SINGLE_THREADED)
+    {"semaphore/release_acquire", NULL, 0, semaphore_setup, semaphore_release_acquire, semaphore_teardown},
+    {"semaphore/ping_pong", NULL, 0, ping_pong_setup, semaphore_ping_pong, ping_pong_teardown},
+    {"cond/ping_pong", NULL, 1, ping_pong_setup, cond_ping_pong, ping_pong_teardown},
+#endif
+};
+
+static int int_option(const char* name, const char* value, int min) {
+  char* end;
+  long result = strtol(value, &end, 10);
+  if (*end != '\0' || result < min || result > 1000000000L) {
+    lf_print_error_and_exit("Invalid value for %s: %s", name, value);
+  }
+  return (int)result;
+}
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      lf_print_error_and_exit("Missing value for %s.", argv[i]);
+    }
+    const char* value = argv[++i];
+    if (strcmp(argv[i - 1], "--output") == 0) {
+      options.output = value;
+    } else if (strcmp(argv[i - 1], "--filter") == 0) {
+      options.filter = value;
+    } else if (strcmp(argv[i - 1], "--repetitions") == 0) {
+      options.repetitions = int_option("--repetitions", value, 2);
+    } else if (strcmp(argv[i - 1], "--batch-ms") == 0) {
+      options.batch_ms = atof(value);
+    } else if (strcmp(argv[i - 1], "--max-workers") == 0) {
+      options.max_workers = int_option("--max-workers", value, 1);
+    } else if (strcmp(argv[i - 1], "--sched-tags") == 0) {
+      options.sched_tags = int_option("--sched-tags", value, 1);
+    } else if (strcmp(argv[i - 1], "--sched-levels") == 0) {
+      options.sched_levels = int_option("--sched-levels", value, 1);
+    } else if (strcmp(argv[i - 1], "--sched-width") == 0) {
+      options.sched_width = int_option("--sched-width", value, 1);
+    } else {
+      lf_print_error_and_exit("Unknown option %s.", argv[i - 1]);
+    }
+  }
+  if (options.repetitions > MAX_REPETITIONS) {
+    lf_print_error_and_exit("At most %d repetitions are supported.", MAX_REPETITIONS);
+  }
+
+  out = stdout;
+  if (options.output != NULL && (out = fopen(options.output, "w")) == NULL) {
+    lf_print_error_and_exit("Cannot open %s.", options.output);
+  }
+  fprintf(out, "{\n  \"threaded\": %s,\n  \"scheduler\": \"%s\",\n  \"event_queue\": \"%s\",\n  \"results\": [",
+#if defined(LF_SINGLE_THREADED)
+          "false", "none",
+#else
+          "true", SCHEDULER_NAME,
+#endif
+#if defined(LF_CALENDAR_QUEUE)
+          "calendar"
+#else
+          "heap"
+#endif
+  );
+
+  for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    run_benchmark(&benchmarks[i]);
+  }
+#if !defined(LF_SINGLE_THREADED)
+  run_sched_benchmarks();
+#endif
+
+  fprintf(out, "\n  ]\n}\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
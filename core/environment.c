@@ -12,6 +12,7 @@
 #include "lf_types.h"
 #include <string.h>
 #include "tracepoint.h"
+#include "timer_group.h"
 #if !defined(LF_SINGLE_THREADED)
 #include "scheduler.h"
 #endif
@@ -21,7 +22,7 @@
 
 /**
  * @brief Callback function to determine whether two events have the same trigger.
- * This function is used by event queue and recycle.
+ * This function is used by the event queue.
  * Return 1 if the triggers are identical, 0 otherwise.
  * @param event1 A pointer to an event.
  * @param event2 A pointer to an event.
@@ -32,7 +33,7 @@ static int event_matches(void* event1, void* event2) {
 
 /**
  * @brief Callback function to print information about an event.
- * This function is used by event queue and recycle.
+ * This function is used by the event queue.
  * @param element A pointer to an event.
  */
 static void print_event(void* event) {
@@ -51,6 +52,9 @@ static void environment_init_threaded(environment_t* env, int num_workers) {
   LF_ASSERT_NON_NULL(env->thread_ids);
   env->barrier.requestors = 0;
   env->barrier.horizon = FOREVER_TAG;
+  env->deadline_misses = 0;
+  env->last_report_lag = NEVER;
+  env->ptdv = 0;
 
   // Initialize synchronization objects.
   LF_MUTEX_INIT(&env->mutex);
@@ -70,8 +74,7 @@ static void environment_init_single_threaded(environment_t* env) {
   // Reaction queue ordered first by deadline, then by level.
   // The index of the reaction holds the deadline in the 48 most significant bits,
   // the level in the 16 least significant bits.
-  env->reaction_q = pqueue_init(INITIAL_REACT_QUEUE_SIZE, in_reverse_order, get_reaction_index, get_reaction_position,
-                                set_reaction_position, reaction_matches, print_reaction);
+  env->reaction_q = reaction_heap_new(INITIAL_REACT_QUEUE_SIZE);
 
 #else
   (void)env;
@@ -145,7 +148,7 @@ static void environment_free_threaded(environment_t* env) {
 
 static void environment_free_single_threaded(environment_t* env) {
 #ifdef LF_SINGLE_THREADED
-  pqueue_free(env->reaction_q);
+  reaction_heap_free(&env->reaction_q);
 #else
   (void)env;
 #endif
@@ -184,12 +187,15 @@ void environment_free(environment_t* env) {
   free(env->is_present_fields_abbreviated);
   pqueue_tag_free(env->event_q);
 
-  // Free the recycle queue.
-  while (pqueue_tag_size(env->recycle_q) > 0) {
-    event_t* event = (event_t*)pqueue_tag_pop(env->recycle_q);
+  vector_free(&env->popped_events);
+
+  // Free the recycled events.
+  while (env->free_events != NULL) {
+    event_t* event = env->free_events;
+    env->free_events = event->next;
     free(event);
   }
-  pqueue_tag_free(env->recycle_q);
+  _lf_timer_groups_free(env);
 
   environment_free_threaded(env);
   environment_free_single_threaded(env);
@@ -286,8 +292,9 @@ int environment_init(environment_t* env, const char* name, int id, int num_worke
 
   // Initialize our priority queues.
   env->event_q = pqueue_tag_init_customize(INITIAL_EVENT_QUEUE_SIZE, pqueue_tag_compare, event_matches, print_event);
-  env->recycle_q =
-      pqueue_tag_init_customize(INITIAL_EVENT_QUEUE_SIZE, in_no_particular_order, event_matches, print_event);
+  env->free_events = NULL;
+  env->popped_events = vector_new(INITIAL_EVENT_QUEUE_SIZE);
+  env->timer_groups = NULL;
 
   // Initialize functionality depending on target properties.
   environment_init_threaded(env, num_workers);
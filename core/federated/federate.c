@@ -483,19 +483,21 @@ static int handle_message(int* socket, int fed_id) {
   // Get the triggering action for the corresponding port
   lf_action_base_t* action = action_for_port(port_id);
 
-  // Read the payload.
-  // Allocate memory for the message contents.
-  unsigned char* message_contents = (unsigned char*)malloc(length);
-  if (read_from_socket_close_on_error(socket, length, message_contents)) {
-    free(message_contents);
+  // Read the payload directly into a buffer owned by the token that will carry it.
+  lf_token_t* message_token = _lf_new_token_with_buffer((token_type_t*)action, length, length);
+  if (message_token == NULL) {
+    lf_print_error_system_failure("Failed to allocate a buffer for a message of length %zu.", length);
+  }
+  if (read_from_socket_close_on_error(socket, length, (unsigned char*)message_token->value)) {
+    _lf_free_token(message_token);
     return -1;
   }
   // Trace the event when tracing is enabled
   tracepoint_federate_from_federate(receive_P2P_MSG, _lf_my_fed_id, federate_id, NULL);
-  LF_PRINT_LOG("Message received by federate: %s. Length: %zu.", message_contents, length);
+  LF_PRINT_LOG("Message received by federate. Length: %zu.", length);
 
   LF_PRINT_DEBUG("Calling schedule for message received on a physical connection.");
-  lf_schedule_value(action, 0, message_contents, length);
+  lf_schedule_token(action, 0, message_token);
   return 0;
 }
 
@@ -570,27 +572,27 @@ static int handle_tagged_message(int* socket, int fed_id) {
                intended_tag.time - start_time, intended_tag.microstep, lf_time_logical_elapsed(env),
                env->current_tag.microstep);
 
-  // Read the payload.
-  // Allocate memory for the message contents.
-  unsigned char* message_contents = (unsigned char*)malloc(length);
-  if (read_from_socket_close_on_error(socket, length, message_contents)) {
+  // Read the payload directly into a buffer owned by the token that will carry it,
+  // which is pooled if the action has a payload pool.
+  lf_token_t* message_token = _lf_new_token_with_buffer((token_type_t*)action, length, length);
+  if (message_token == NULL) {
+    lf_print_error_system_failure("Failed to allocate a buffer for a message of length %zu.", length);
+  }
+  if (read_from_socket_close_on_error(socket, length, (unsigned char*)message_token->value)) {
 #ifdef FEDERATED_DECENTRALIZED
     _lf_decrement_tag_barrier_locked(env);
 #endif
-    free(message_contents);
+    _lf_free_token(message_token);
     return -1; // Read failed.
   }
 
   // The following is only valid for string messages.
-  // LF_PRINT_DEBUG("Message received: %s.", message_contents);
+  // LF_PRINT_DEBUG("Message received: %s.", (char*)message_token->value);
 
   LF_MUTEX_LOCK(&env->mutex);
 
   action->trigger->physical_time_of_arrival = time_of_arrival;
 
-  // Create a token for the message
-  lf_token_t* message_token = _lf_new_token((token_type_t*)action, message_contents, length);
-
   if (handle_message_now(env, action->trigger, intended_tag)) {
     // Since the message is intended for the current tag and a port absent reaction
     // was waiting for the message, trigger the corresponding reactions for this message.
@@ -2201,11 +2203,8 @@ int lf_send_message(int message_type, unsigned short port, unsigned short federa
   // Trace the event when tracing is enabled
   tracepoint_federate_to_federate(send_P2P_MSG, _lf_my_fed_id, federate, NULL);
 
-  int result = write_to_socket_close_on_error(socket, header_length, header_buffer);
-  if (result == 0) {
-    // Header sent successfully. Send the body.
-    result = write_to_socket_close_on_error(socket, length, message);
-  }
+  // Send the header and the body with one system call.
+  int result = write_to_socket_with_payload_close_on_error(socket, header_length, header_buffer, length, message);
   if (result != 0) {
     // Message did not send. Since this is used for physical connections, this is not critical.
     lf_print_warning("Failed to send message to %s. Dropping the message.", next_destination_str);
@@ -2519,11 +2518,8 @@ int lf_send_tagged_message(environment_t* env, interval_t additional_delay, int
     _fed.last_DNET = current_message_intended_tag;
   }
 
-  int result = write_to_socket_close_on_error(socket, header_length, header_buffer);
-  if (result == 0) {
-    // Header sent successfully. Send the body.
-    result = write_to_socket_close_on_error(socket, length, message);
-  }
+  // Send the header and the body with one system call.
+  int result = write_to_socket_with_payload_close_on_error(socket, header_length, header_buffer, length, message);
   if (result != 0) {
     // Message did not send. Handling depends on message type.
     if (message_type == MSG_TYPE_P2P_TAGGED_MESSAGE) {
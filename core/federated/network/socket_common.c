@@ -6,6 +6,7 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h> // writev()
 #include <netdb.h>
 #include <stdarg.h> //va_list
 #include <string.h> // strerror
@@ -382,6 +383,61 @@ int write_to_socket_close_on_error(int* socket, size_t num_bytes, unsigned char*
   return -1;
 }
 
+int write_to_socket_with_payload(int socket, size_t header_length, unsigned char* header, size_t payload_length,
+                                 unsigned char* payload) {
+  if (socket < 0) {
+    // Socket is not open.
+    errno = EBADF;
+    return -1;
+  }
+  struct iovec chunks[2] = {{.iov_base = header, .iov_len = header_length},
+                            {.iov_base = payload, .iov_len = payload_length}};
+  struct iovec* next = chunks;
+  int count = payload_length > 0 ? 2 : 1;
+  while (count > 0) {
+    ssize_t more = writev(socket, next, count);
+    if (more <= 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      // See write_to_socket().
+      LF_PRINT_DEBUG("Writing to socket %d was blocked. Will try again.", socket);
+      lf_sleep(DELAY_BETWEEN_SOCKET_RETRIES);
+      continue;
+    } else if (more < 0) {
+      // A more serious error occurred.
+      lf_print_error("Writing to socket %d failed. With error: `%s`", socket, strerror(errno));
+      return -1;
+    }
+    // Skip what was written, which may end in the middle of a chunk.
+    while (count > 0 && (size_t)more >= next->iov_len) {
+      more -= (ssize_t)next->iov_len;
+      next++;
+      count--;
+    }
+    if (count > 0) {
+      next->iov_base = (unsigned char*)next->iov_base + more;
+      next->iov_len -= (size_t)more;
+    }
+  }
+  return 0;
+}
+
+int write_to_socket_with_payload_close_on_error(int* socket, size_t header_length, unsigned char* header,
+                                                size_t payload_length, unsigned char* payload) {
+  assert(socket);
+  int socket_id = *socket; // Assume atomic read so we don't pass -1 to write_to_socket_with_payload.
+  if (socket_id >= 0) {
+    if (write_to_socket_with_payload(socket_id, header_length, header, payload_length, payload)) {
+      // Write failed.
+      // Socket has probably been closed from the other side.
+      // Shut down and close the socket from this side.
+      shutdown_socket(socket, false);
+      return -1;
+    }
+    return 0;
+  }
+  lf_print_warning("Socket is no longer connected. Write failed.");
+  return -1;
+}
+
 void write_to_socket_fail_on_error(int* socket, size_t num_bytes, unsigned char* buffer, lf_mutex_t* mutex,
                                    char* format, ...) {
   va_list args;
@@ -17,6 +17,8 @@ int _lf_count_token_allocations;
 #endif
 
 #include <stdbool.h>
+#include <stddef.h> // Defines max_align_t
+#include <stdint.h>
 #include <assert.h>
 #include <string.h> // Defines memcpy
 #include "lf_token.h"
@@ -25,7 +27,11 @@ int _lf_count_token_allocations;
 #include "hashset/hashset_itr.h"
 #include "util.h"
 #include "platform.h" // Enter/exit critical sections
+#include "low_level_platform.h" // thread_local, atomics
 #include "port.h"     // Defines lf_port_base_t.
+#if !defined(LF_SINGLE_THREADED)
+#include <pthread.h> // Thread-exit hook for token caches.
+#endif
 
 /**
  * @brief List of tokens created within reactions that must be freed.
@@ -47,15 +53,50 @@ static lf_token_t* _lf_tokens_allocated_in_reactions = NULL;
 
 /**
  * Tokens always have the same size in memory so they are easily recycled.
- * When a token is freed, it is inserted into this recycling bin.
+ * Each thread keeps the tokens it frees in its own cache, a list linked through
+ * the tokens' next fields, and takes new tokens from there without a lock.
+ * Caches exchange tokens with a global pool only in batches of
+ * _LF_TOKEN_BATCH_SIZE, so the global critical section is entered at most once
+ * per batch.
+ */
+typedef struct lf_token_cache_t {
+  lf_token_t* tokens;
+  size_t count;
+} lf_token_cache_t;
+
+#define _LF_TOKEN_BATCH_SIZE 32
+
+/**
+ * A cache that grows beyond this many tokens hands a batch to the global pool.
  */
-static hashset_t _lf_token_recycling_bin = NULL;
+#define _LF_TOKEN_CACHE_SIZE_LIMIT (2 * _LF_TOKEN_BATCH_SIZE)
 
 /**
- * To allow a system to recover from burst of activity, the token recycling
- * bin has a limited size. When it becomes full, token are freed using free().
+ * To allow a system to recover from burst of activity, the global pool has a
+ * limited size. When it becomes full, batches are freed using free().
  */
 #define _LF_TOKEN_RECYCLING_BIN_SIZE_LIMIT 512
+#define _LF_TOKEN_POOL_BATCHES (_LF_TOKEN_RECYCLING_BIN_SIZE_LIMIT / _LF_TOKEN_BATCH_SIZE)
+
+#if defined(LF_SINGLE_THREADED)
+static lf_token_cache_t* _lf_token_cache = NULL;
+#else
+static thread_local lf_token_cache_t* _lf_token_cache = NULL;
+
+/**
+ * Key whose destructor releases a thread's cache when the thread exits.
+ */
+static pthread_key_t _lf_token_cache_key;
+static pthread_once_t _lf_token_cache_key_once = PTHREAD_ONCE_INIT;
+static void _lf_token_cache_key_create(void);
+#endif
+
+/**
+ * The global pool: a stack of batches, each a list of exactly
+ * _LF_TOKEN_BATCH_SIZE tokens, guarded by the global critical section.
+ */
+static lf_token_t* _lf_token_pool[_LF_TOKEN_POOL_BATCHES];
+static size_t _lf_token_pool_batches = 0;
 
 /**
  * Set of token templates (trigger_t or port_base_t objects) that
@@ -64,6 +105,96 @@ static hashset_t _lf_token_recycling_bin = NULL;
  */
 static hashset_t _lf_token_templates = NULL;
 
+/**
+ * Payload pools. A payload taken from a pool is preceded by a header that
+ * records where it goes back when freed: a size class of the pool of a
+ * token type, or a chunk of the tag arena. Size class c holds buffers of
+ * (1 << (c + _LF_PAYLOAD_MIN_SHIFT)) bytes. A free buffer is linked into
+ * its class through the owner field of its header.
+ */
+typedef union lf_payload_header_t {
+  struct {
+    void* owner; // The lf_payload_pool_t or lf_payload_chunk_t.
+    int size_class;
+  } h;
+  max_align_t align;
+} lf_payload_header_t;
+
+#define _LF_PAYLOAD_MIN_SHIFT 4 // 16 bytes
+#define _LF_PAYLOAD_CLASSES 13  // Up to 64 KiB
+#define _LF_PAYLOAD_ARENA -1    // Size class of payloads in the tag arena
+
+/**
+ * A size class keeps at most this many bytes of free buffers, but at least
+ * _LF_PAYLOAD_MIN_FREE buffers. Any more are freed using free().
+ */
+#define _LF_PAYLOAD_CLASS_BYTES (64 * 1024)
+#define _LF_PAYLOAD_MIN_FREE 4
+
+typedef struct lf_payload_pool_t {
+  lf_payload_header_t* free_buffers[_LF_PAYLOAD_CLASSES];
+  size_t counts[_LF_PAYLOAD_CLASSES];
+#if !defined(LF_SINGLE_THREADED)
+  lf_mutex_t mutex; // Guards the free lists of this pool only.
+#endif
+} lf_payload_pool_t;
+
+/**
+ * Pools belong to token types, which are the first field of every port and
+ * action. Because those structs are laid out by generated code, the pools
+ * live in this open-addressed table keyed by the type rather than in the
+ * type itself.
+ */
+#define _LF_PAYLOAD_POOL_TABLE_SIZE 1024
+
+typedef struct lf_payload_pool_entry_t {
+  token_type_t* type;
+  lf_payload_pool_t* pool;
+} lf_payload_pool_entry_t;
+
+/**
+ * Writable copies of mutable inputs are released at the start of the next
+ * tag, so they are carved out of a bump arena. Each chunk counts its live
+ * payloads. A chunk is reset when its count drops to zero, which in the
+ * steady state happens at every tag. Copies that outlive their tag (for
+ * example because they were sent to an output) only keep their chunk alive,
+ * and the arena moves on to a fresh one. One emptied chunk is kept as a spare.
+ */
+#define _LF_PAYLOAD_CHUNK_SIZE (64 * 1024)
+#define _LF_PAYLOAD_ARENA_LIMIT (_LF_PAYLOAD_CHUNK_SIZE / 8) // Larger copies use the size classes.
+
+typedef struct lf_payload_chunk_t {
+  size_t used;
+  int live;
+  lf_payload_header_t data[];
+} lf_payload_chunk_t;
+
+/**
+ * Entries are added to the pool table within the global critical section and
+ * never removed while the program runs. An entry's type is published last, so
+ * lookups read the table without a lock. Each pool's free lists are guarded
+ * by the pool's own mutex and the arena by _lf_payload_arena_mutex. Allocation
+ * and release thus never enter the global critical section, which matters
+ * because writable copies are allocated while holding an environment mutex.
+ * Without threads, the global critical section guards them all.
+ * _lf_payload_pool_count is read atomically so that programs without pools
+ * never look them up.
+ */
+static lf_payload_pool_entry_t _lf_payload_pools[_LF_PAYLOAD_POOL_TABLE_SIZE];
+static int _lf_payload_pool_count = 0;
+static lf_payload_chunk_t* _lf_payload_arena = NULL;
+static lf_payload_chunk_t* _lf_payload_spare_chunk = NULL;
+
+#if defined(LF_SINGLE_THREADED)
+#define _LF_PAYLOAD_LOCK(mutex) LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT)
+#define _LF_PAYLOAD_UNLOCK(mutex) LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT)
+#else
+static lf_mutex_t _lf_payload_arena_mutex;
+static bool _lf_payload_arena_mutex_initialized = false;
+#define _LF_PAYLOAD_LOCK(mutex) LF_MUTEX_LOCK(mutex)
+#define _LF_PAYLOAD_UNLOCK(mutex) LF_MUTEX_UNLOCK(mutex)
+#endif
+
 // Forward declarations
 static lf_token_t* _lf_writable_copy_locked(lf_port_base_t* port);
 
@@ -81,9 +212,236 @@ lf_token_t* lf_writable_copy(lf_port_base_t* port) {
   return token;
 }
 
+bool lf_enable_payload_pool(void* port_or_action) {
+#ifdef _PYTHON_TARGET_ENABLED
+  // Python payloads are reference-counted objects, not buffers.
+  (void)port_or_action;
+  return false;
+#else
+  token_type_t* type = (token_type_t*)port_or_action;
+  lf_payload_pool_t* pool = (lf_payload_pool_t*)calloc(1, sizeof(lf_payload_pool_t));
+#if !defined(LF_SINGLE_THREADED)
+  if (pool != NULL) {
+    LF_MUTEX_INIT(&pool->mutex);
+  }
+#endif
+  bool result = false;
+  LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT);
+#if !defined(LF_SINGLE_THREADED)
+  if (!_lf_payload_arena_mutex_initialized) {
+    LF_MUTEX_INIT(&_lf_payload_arena_mutex);
+    _lf_payload_arena_mutex_initialized = true;
+  }
+#endif
+  size_t index = ((uintptr_t)type / sizeof(void*)) % _LF_PAYLOAD_POOL_TABLE_SIZE;
+  for (int i = 0; i < _LF_PAYLOAD_POOL_TABLE_SIZE; i++) {
+    lf_payload_pool_entry_t* entry = &_lf_payload_pools[index];
+    if (entry->type == type) {
+      result = true;
+      break;
+    }
+    if (entry->type == NULL) {
+      if (pool != NULL) {
+        entry->pool = pool;
+        // Publish the entry to lookups, which take no lock.
+        __atomic_store_n(&entry->type, type, __ATOMIC_RELEASE);
+        pool = NULL;
+        lf_atomic_fetch_add(&_lf_payload_pool_count, 1);
+        result = true;
+      }
+      break;
+    }
+    index = (index + 1) % _LF_PAYLOAD_POOL_TABLE_SIZE;
+  }
+  LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
+  if (!result) {
+    lf_print_warning("lf_enable_payload_pool: No room for another payload pool. Using malloc().");
+  }
+  // Unused if the type already had a pool.
+  free(pool);
+  return result;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////
 //// Internal functions.
 
+/**
+ * @brief Return the pool of 'type', or NULL if it has none.
+ * This takes no lock.
+ */
+static lf_payload_pool_t* _lf_payload_pool_find(token_type_t* type) {
+  size_t index = ((uintptr_t)type / sizeof(void*)) % _LF_PAYLOAD_POOL_TABLE_SIZE;
+  for (int i = 0; i < _LF_PAYLOAD_POOL_TABLE_SIZE; i++) {
+    lf_payload_pool_entry_t* entry = &_lf_payload_pools[index];
+    token_type_t* entry_type = __atomic_load_n(&entry->type, __ATOMIC_ACQUIRE);
+    if (entry_type == type)
+      return entry->pool;
+    if (entry_type == NULL)
+      return NULL;
+    index = (index + 1) % _LF_PAYLOAD_POOL_TABLE_SIZE;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Return the smallest size class holding 'size' bytes, or -1 if none does.
+ */
+static int _lf_payload_size_class(size_t size) {
+  int size_class = 0;
+  while (((size_t)1 << (size_class + _LF_PAYLOAD_MIN_SHIFT)) < size) {
+    if (++size_class == _LF_PAYLOAD_CLASSES)
+      return -1;
+  }
+  return size_class;
+}
+
+/**
+ * @brief Return a bump allocation of 'bytes' (a multiple of the header size) from the tag arena.
+ * Must be called holding the arena lock.
+ * @return The header of the allocation, or NULL if no chunk could be allocated.
+ */
+static lf_payload_header_t* _lf_payload_arena_alloc(size_t bytes) {
+  lf_payload_chunk_t* chunk = _lf_payload_arena;
+  if (chunk == NULL || chunk->used + bytes > _LF_PAYLOAD_CHUNK_SIZE) {
+    // A full chunk still has live payloads. The last of them to be released retires it.
+    chunk = _lf_payload_spare_chunk;
+    _lf_payload_spare_chunk = NULL;
+    if (chunk == NULL) {
+      chunk = (lf_payload_chunk_t*)malloc(sizeof(lf_payload_chunk_t) + _LF_PAYLOAD_CHUNK_SIZE);
+      if (chunk == NULL)
+        return NULL;
+    }
+    chunk->used = 0;
+    chunk->live = 0;
+    _lf_payload_arena = chunk;
+  }
+  lf_payload_header_t* header = (lf_payload_header_t*)((char*)chunk->data + chunk->used);
+  chunk->used += bytes;
+  chunk->live++;
+  header->h.owner = chunk;
+  header->h.size_class = _LF_PAYLOAD_ARENA;
+  return header;
+}
+
+/**
+ * @brief Allocate a payload of 'size' bytes from the pool of 'type'.
+ * @param type The token type.
+ * @param size The payload size in bytes.
+ * @param in_arena True to use the tag arena for a payload expected to die at the end of the tag.
+ * @return The payload, or NULL if the type has no usable pool, in which case the caller uses malloc().
+ */
+static void* _lf_payload_alloc(token_type_t* type, size_t size, bool in_arena) {
+  // An atomic read of the count, so that programs without pools take no lock.
+  if (size == 0 || lf_atomic_add_fetch(&_lf_payload_pool_count, 0) == 0)
+    return NULL;
+  if (type->destructor != NULL || type->copy_constructor != NULL)
+    return NULL;
+  int size_class = _lf_payload_size_class(size);
+  if (size_class < 0)
+    return NULL;
+  lf_payload_pool_t* pool = _lf_payload_pool_find(type);
+  if (pool == NULL)
+    return NULL;
+  lf_payload_header_t* header = NULL;
+  size_t bytes = sizeof(lf_payload_header_t) +
+                 (size + sizeof(lf_payload_header_t) - 1) / sizeof(lf_payload_header_t) * sizeof(lf_payload_header_t);
+  if (in_arena && bytes <= _LF_PAYLOAD_ARENA_LIMIT) {
+    _LF_PAYLOAD_LOCK(&_lf_payload_arena_mutex);
+    header = _lf_payload_arena_alloc(bytes);
+    _LF_PAYLOAD_UNLOCK(&_lf_payload_arena_mutex);
+  }
+  if (header == NULL) {
+    _LF_PAYLOAD_LOCK(&pool->mutex);
+    header = pool->free_buffers[size_class];
+    if (header != NULL) {
+      pool->free_buffers[size_class] = (lf_payload_header_t*)header->h.owner;
+      pool->counts[size_class]--;
+      header->h.owner = pool;
+    }
+    _LF_PAYLOAD_UNLOCK(&pool->mutex);
+  }
+  if (header == NULL) {
+    // The class is empty. Grow it.
+    header = (lf_payload_header_t*)malloc(sizeof(lf_payload_header_t) +
+                                          ((size_t)1 << (size_class + _LF_PAYLOAD_MIN_SHIFT)));
+    if (header == NULL)
+      return NULL;
+    header->h.owner = pool;
+    header->h.size_class = size_class;
+  }
+  LF_PRINT_DEBUG("_lf_payload_alloc: Allocated pooled payload %p.", (void*)(header + 1));
+  return header + 1;
+}
+
+/**
+ * @brief Return a payload allocated by _lf_payload_alloc to its size class or arena chunk.
+ */
+static void _lf_payload_release(void* value) {
+  lf_payload_header_t* header = (lf_payload_header_t*)value - 1;
+  void* to_free = NULL;
+  if (header->h.size_class == _LF_PAYLOAD_ARENA) {
+    _LF_PAYLOAD_LOCK(&_lf_payload_arena_mutex);
+    lf_payload_chunk_t* chunk = (lf_payload_chunk_t*)header->h.owner;
+    if (--chunk->live == 0) {
+      chunk->used = 0;
+      if (chunk != _lf_payload_arena) {
+        // A retired chunk has emptied.
+        if (_lf_payload_spare_chunk == NULL) {
+          _lf_payload_spare_chunk = chunk;
+        } else {
+          to_free = chunk;
+        }
+      }
+    }
+    _LF_PAYLOAD_UNLOCK(&_lf_payload_arena_mutex);
+  } else {
+    lf_payload_pool_t* pool = (lf_payload_pool_t*)header->h.owner;
+    int size_class = header->h.size_class;
+    _LF_PAYLOAD_LOCK(&pool->mutex);
+    size_t limit = _LF_PAYLOAD_CLASS_BYTES >> (size_class + _LF_PAYLOAD_MIN_SHIFT);
+    if (pool->counts[size_class] < limit || pool->counts[size_class] < _LF_PAYLOAD_MIN_FREE) {
+      header->h.owner = pool->free_buffers[size_class];
+      pool->free_buffers[size_class] = header;
+      pool->counts[size_class]++;
+    } else {
+      to_free = header;
+    }
+    _LF_PAYLOAD_UNLOCK(&pool->mutex);
+  }
+  free(to_free);
+}
+
+/**
+ * @brief Free all pools, their free buffers and the arena.
+ * Must be called within the global critical section after all pooled payloads have been released.
+ */
+static void _lf_payload_free_all(void) {
+  for (int i = 0; i < _LF_PAYLOAD_POOL_TABLE_SIZE; i++) {
+    lf_payload_pool_t* pool = _lf_payload_pools[i].pool;
+    if (pool == NULL)
+      continue;
+    for (int c = 0; c < _LF_PAYLOAD_CLASSES; c++) {
+      while (pool->free_buffers[c] != NULL) {
+        lf_payload_header_t* header = pool->free_buffers[c];
+        pool->free_buffers[c] = (lf_payload_header_t*)header->h.owner;
+        free(header);
+      }
+    }
+    free(pool);
+    _lf_payload_pools[i].type = NULL;
+    _lf_payload_pools[i].pool = NULL;
+    lf_atomic_fetch_add(&_lf_payload_pool_count, -1);
+  }
+  free(_lf_payload_spare_chunk);
+  _lf_payload_spare_chunk = NULL;
+  // A chunk with live payloads indicates a leak, which the allocation counters report.
+  if (_lf_payload_arena != NULL && _lf_payload_arena->live == 0) {
+    free(_lf_payload_arena);
+  }
+  _lf_payload_arena = NULL;
+}
+
 static lf_token_t* _lf_writable_copy_locked(lf_port_base_t* port) {
   assert(port != NULL);
 
@@ -101,13 +459,19 @@ static lf_token_t* _lf_writable_copy_locked(lf_port_base_t* port) {
   LF_PRINT_DEBUG("lf_writable_copy: Copying value. Reference count is %zu.", token->ref_count);
   // Copy the payload.
   void* copy;
+  bool pooled = false;
   if (port->tmplt.type.copy_constructor == NULL) {
     LF_PRINT_DEBUG("lf_writable_copy: Copy constructor is NULL. Using default strategy.");
     size_t size = port->tmplt.type.element_size * token->length;
     if (size == 0) {
       return token;
     }
-    copy = malloc(size);
+    // The copy is released at the start of the next tag, so it belongs in the tag arena.
+    copy = _lf_payload_alloc(&port->tmplt.type, size, true);
+    pooled = copy != NULL;
+    if (!pooled) {
+      copy = malloc(size);
+    }
     LF_PRINT_DEBUG("Allocating memory for writable copy %p.", copy);
     memcpy(copy, token->value, size);
   } else {
@@ -129,6 +493,7 @@ static lf_token_t* _lf_writable_copy_locked(lf_port_base_t* port) {
 
   // Create a new, dynamically allocated token.
   lf_token_t* result = _lf_new_token((token_type_t*)port, copy, token->length);
+  result->pooled = pooled;
   result->ref_count = 1;
   // Arrange for the token to be released (and possibly freed) at
   // the start of the next time step.
@@ -148,8 +513,13 @@ static void _lf_free_token_value(lf_token_t* token) {
 #endif
     // Free the value field (the payload).
     LF_PRINT_DEBUG("_lf_free_token_value: Freeing allocated memory for payload (token value): %p", token->value);
-    // First check the token's destructor field and invoke it if it is not NULL.
-    if (token->type->destructor != NULL) {
+    // Pooled payloads go back to where they came from.
+    if (token->pooled) {
+      _lf_payload_release(token->value);
+      token->pooled = false;
+    }
+    // Otherwise, check the token's destructor field and invoke it if it is not NULL.
+    else if (token->type->destructor != NULL) {
       token->type->destructor(token->value);
     }
     // If Python Target is not enabled and destructor is NULL
@@ -163,6 +533,97 @@ static void _lf_free_token_value(lf_token_t* token) {
   }
 }
 
+/**
+ * @brief Return the calling thread's token cache, creating it on first use.
+ * @return The cache, or NULL if it could not be allocated.
+ */
+static lf_token_cache_t* _lf_token_cache_get(void) {
+  lf_token_cache_t* cache = _lf_token_cache;
+  if (cache != NULL)
+    return cache;
+  cache = (lf_token_cache_t*)calloc(1, sizeof(lf_token_cache_t));
+  if (cache == NULL)
+    return NULL;
+  _lf_token_cache = cache;
+#if !defined(LF_SINGLE_THREADED)
+  pthread_once(&_lf_token_cache_key_once, _lf_token_cache_key_create);
+  pthread_setspecific(_lf_token_cache_key, cache);
+#endif
+  return cache;
+}
+
+/**
+ * @brief Free a list of tokens linked through their next fields.
+ */
+static void _lf_token_free_list(lf_token_t* token) {
+  while (token != NULL) {
+    lf_token_t* next = token->next;
+    LF_PRINT_DEBUG("Freeing allocated memory for token: %p", (void*)token);
+    free(token);
+    token = next;
+  }
+}
+
+/**
+ * @brief Move a batch of tokens from the global pool into 'cache'.
+ */
+static void _lf_token_cache_refill(lf_token_cache_t* cache) {
+  lf_token_t* batch = NULL;
+  LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT);
+  if (_lf_token_pool_batches > 0) {
+    batch = _lf_token_pool[--_lf_token_pool_batches];
+  }
+  LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
+  if (batch != NULL) {
+    cache->tokens = batch;
+    cache->count = _LF_TOKEN_BATCH_SIZE;
+  }
+}
+
+/**
+ * @brief Move a batch of tokens from 'cache' to the global pool, or free it if the pool is full.
+ */
+static void _lf_token_cache_spill(lf_token_cache_t* cache) {
+  lf_token_t* batch = cache->tokens;
+  lf_token_t* last = batch;
+  for (int i = 1; i < _LF_TOKEN_BATCH_SIZE; i++) {
+    last = last->next;
+  }
+  cache->tokens = last->next;
+  cache->count -= _LF_TOKEN_BATCH_SIZE;
+  last->next = NULL;
+
+  LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT);
+  if (_lf_token_pool_batches < _LF_TOKEN_POOL_BATCHES) {
+    _lf_token_pool[_lf_token_pool_batches++] = batch;
+    batch = NULL;
+  }
+  LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
+  // The pool is full.
+  _lf_token_free_list(batch);
+}
+
+#if !defined(LF_SINGLE_THREADED)
+/**
+ * @brief Release the cache of a thread that is exiting.
+ * Whole batches go to the global pool and the remaining tokens are freed.
+ */
+static void _lf_token_cache_release(void* arg) {
+  lf_token_cache_t* cache = (lf_token_cache_t*)arg;
+  while (cache->count >= _LF_TOKEN_BATCH_SIZE) {
+    _lf_token_cache_spill(cache);
+  }
+  _lf_token_free_list(cache->tokens);
+  if (_lf_token_cache == cache) {
+    // A later thread-exit destructor that frees a token gets a fresh cache.
+    _lf_token_cache = NULL;
+  }
+  free(cache);
+}
+
+static void _lf_token_cache_key_create(void) { pthread_key_create(&_lf_token_cache_key, _lf_token_cache_release); }
+#endif
+
 token_freed _lf_free_token(lf_token_t* token) {
   token_freed result = NOT_FREED;
   if (token == NULL)
@@ -173,30 +634,22 @@ token_freed _lf_free_token(lf_token_t* token) {
 
   // Tokens that are created at the start of execution and associated with
   // output ports or actions persist until they are overwritten.
-  // Need to acquire a mutex to access the recycle bin.
-  LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT);
-  if (_lf_token_recycling_bin == NULL) {
-    _lf_token_recycling_bin = hashset_create(4); // Initial size is 16.
-    if (_lf_token_recycling_bin == NULL) {
-      LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
-      lf_print_error_and_exit("Out of memory: failed to setup _lf_token_recycling_bin");
-    }
-  }
-  if (hashset_num_items(_lf_token_recycling_bin) < _LF_TOKEN_RECYCLING_BIN_SIZE_LIMIT) {
-    // Recycle instead of freeing.
-    LF_PRINT_DEBUG("_lf_free_token: Putting token on the recycling bin: %p", (void*)token);
-    if (!hashset_add(_lf_token_recycling_bin, token)) {
-      lf_print_warning("Putting token %p on the recycling bin, but it is already there!", (void*)token);
+  // Recycle the token through this thread's cache, which needs no lock.
+  lf_token_cache_t* cache = _lf_token_cache_get();
+  if (cache != NULL) {
+    LF_PRINT_DEBUG("_lf_free_token: Putting token in the thread's cache: %p", (void*)token);
+    token->next = cache->tokens;
+    cache->tokens = token;
+    if (++cache->count > _LF_TOKEN_CACHE_SIZE_LIMIT) {
+      _lf_token_cache_spill(cache);
     }
   } else {
-    // Recycling bin is full.
     LF_PRINT_DEBUG("_lf_free_token: Freeing allocated memory for token: %p", (void*)token);
     free(token);
   }
 #if !defined NDEBUG
-  _lf_count_token_allocations--;
+  lf_atomic_fetch_add(&_lf_count_token_allocations, -1);
 #endif
-  LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
   result &= TOKEN_FREED;
 
   return result;
@@ -204,39 +657,60 @@ token_freed _lf_free_token(lf_token_t* token) {
 
 lf_token_t* _lf_new_token(token_type_t* type, void* value, size_t length) {
   lf_token_t* result = NULL;
-  // Check the recycling bin.
-  LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT);
-  if (_lf_token_recycling_bin != NULL) {
-    hashset_itr_t iterator = hashset_iterator(_lf_token_recycling_bin);
-    if (hashset_iterator_next(iterator) >= 0) {
-      result = hashset_iterator_value(iterator);
-      hashset_remove(_lf_token_recycling_bin, result);
-      // Make sure there isn't a previous value.
-      result->value = NULL;
-      LF_PRINT_DEBUG("_lf_new_token: Retrieved token from the recycling bin: %p", (void*)result);
+  // Check the thread's cache, refilling it from the global pool if it is empty.
+  lf_token_cache_t* cache = _lf_token_cache_get();
+  if (cache != NULL) {
+    if (cache->tokens == NULL) {
+      _lf_token_cache_refill(cache);
+    }
+    result = cache->tokens;
+    if (result != NULL) {
+      cache->tokens = result->next;
+      cache->count--;
+      result->next = NULL;
+      LF_PRINT_DEBUG("_lf_new_token: Retrieved token from the thread's cache: %p", (void*)result);
     }
-    free(iterator);
   }
 
 // Count the token allocation to catch memory leaks.
 #if !defined NDEBUG
-  _lf_count_token_allocations++;
+  lf_atomic_fetch_add(&_lf_count_token_allocations, 1);
 #endif
 
-  LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
-
   if (result == NULL) {
-    // Nothing found on the recycle bin.
+    // Nothing found in the cache or the pool.
     result = (lf_token_t*)calloc(1, sizeof(lf_token_t));
     LF_PRINT_DEBUG("_lf_new_token: Allocated memory for token: %p", (void*)result);
   }
   result->type = type;
   result->length = length;
   result->value = value;
+  result->pooled = false;
   result->ref_count = 0;
   return result;
 }
 
+lf_token_t* _lf_new_token_with_buffer(token_type_t* type, size_t size, size_t length) {
+  void* value = _lf_payload_alloc(type, size, false);
+  bool pooled = value != NULL;
+  if (!pooled) {
+    value = malloc(size);
+    if (value == NULL && size > 0)
+      return NULL;
+  }
+// Count allocations to issue a warning if this is never freed.
+#if !defined NDEBUG
+  if (value != NULL) {
+    LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT);
+    _lf_count_payload_allocations++;
+    LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
+  }
+#endif
+  lf_token_t* result = _lf_new_token(type, value, length);
+  result->pooled = pooled;
+  return result;
+}
+
 lf_token_t* _lf_get_token(token_template_t* tmplt) {
   LF_CRITICAL_SECTION_ENTER(GLOBAL_ENVIRONMENT);
   if (tmplt->token != NULL && tmplt->token->ref_count == 1) {
@@ -278,6 +752,9 @@ void _lf_initialize_template(token_template_t* tmplt, size_t element_size) {
   tmplt->type.element_size = element_size;
   tmplt->token = _lf_new_token((token_type_t*)tmplt, NULL, 0);
   tmplt->token->ref_count = 1;
+#ifdef LF_PAYLOAD_POOLS
+  lf_enable_payload_pool(tmplt);
+#endif
 }
 
 lf_token_t* _lf_initialize_token_with_value(token_template_t* tmplt, void* value, size_t length) {
@@ -299,8 +776,16 @@ lf_token_t* _lf_initialize_token_with_value(token_template_t* tmplt, void* value
 lf_token_t* _lf_initialize_token(token_template_t* tmplt, size_t length) {
   assert(tmplt != NULL);
   // Allocate memory for storing the array.
-  void* value = calloc(length, tmplt->type.element_size);
+  size_t size = length * tmplt->type.element_size;
+  void* value = _lf_payload_alloc(&tmplt->type, size, false);
+  bool pooled = value != NULL;
+  if (pooled) {
+    memset(value, 0, size);
+  } else {
+    value = calloc(length, tmplt->type.element_size);
+  }
   lf_token_t* result = _lf_initialize_token_with_value(tmplt, value, length);
+  result->pooled = pooled;
   return result;
 }
 
@@ -323,18 +808,19 @@ void _lf_free_all_tokens() {
     hashset_destroy(_lf_token_templates);
     _lf_token_templates = NULL;
   }
-  if (_lf_token_recycling_bin != NULL) {
-    hashset_itr_t iterator = hashset_iterator(_lf_token_recycling_bin);
-    while (hashset_iterator_next(iterator) >= 0) {
-      void* token = hashset_iterator_value(iterator);
-      LF_PRINT_DEBUG("Freeing token from _lf_token_recycling_bin: %p", token);
-      // Payload should already be freed, so we just free the token:
-      free(token);
-    }
-    free(iterator);
-    hashset_destroy(_lf_token_recycling_bin);
-    _lf_token_recycling_bin = NULL;
+  // Payloads should already be freed, so we just free the tokens. Only this
+  // thread's cache is emptied. Threads that may still be running, such as
+  // those calling lf_schedule(), keep theirs until they exit.
+  while (_lf_token_pool_batches > 0) {
+    _lf_token_free_list(_lf_token_pool[--_lf_token_pool_batches]);
+  }
+  lf_token_cache_t* cache = _lf_token_cache;
+  if (cache != NULL) {
+    _lf_token_free_list(cache->tokens);
+    cache->tokens = NULL;
+    cache->count = 0;
   }
+  _lf_payload_free_all();
   LF_CRITICAL_SECTION_EXIT(GLOBAL_ENVIRONMENT);
 }
 
@@ -459,10 +459,12 @@ void _lf_process_mode_changes(environment_t* env, reactor_mode_state_t* states[]
       if (q_size > 0) {
         event_t** delayed_removal = (event_t**)calloc(q_size, sizeof(event_t*));
         size_t delayed_removal_count = 0;
+        event_t** queued = (event_t**)calloc(q_size, sizeof(event_t*));
+        pqueue_tag_elements(env->event_q, (pqueue_tag_element_t**)queued);
 
         // Find events
         for (size_t i = 0; i < q_size; i++) {
-          event_t* event = (event_t*)env->event_q->d[i + 1]; // internal queue data structure omits index 0
+          event_t* event = queued[i];
           if (event != NULL && event->trigger != NULL && !_lf_mode_is_active(event->trigger->mode)) {
             delayed_removal[delayed_removal_count++] = event;
             // This will store the event including possibly those chained up in super dense time
@@ -477,6 +479,7 @@ void _lf_process_mode_changes(environment_t* env, reactor_mode_state_t* states[]
           pqueue_tag_remove(env->event_q, (pqueue_tag_element_t*)(delayed_removal[i]));
         }
 
+        free(queued);
         free(delayed_removal);
       }
     }
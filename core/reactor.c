@@ -87,7 +87,9 @@ int wait_until(environment_t* env, instant_t wakeup_time) {
 void lf_print_snapshot(environment_t* env) {
   if (LOG_LEVEL > LOG_LEVEL_LOG) {
     LF_PRINT_DEBUG(">>> START Snapshot");
-    pqueue_dump(env->reaction_q, env->reaction_q->prt);
+    for (size_t i = 1; i <= reaction_heap_size(&env->reaction_q); i++) {
+      print_reaction(reaction_heap_at(&env->reaction_q, i));
+    }
     LF_PRINT_DEBUG(">>> END Snapshot");
   }
 }
@@ -115,12 +117,73 @@ void _lf_trigger_reaction(environment_t* env, reaction_t* reaction, int worker_n
     LF_PRINT_DEBUG("Enqueueing downstream reaction %s, which has level %lld.", reaction->name,
                    reaction->index & 0xffffLL);
     reaction->status = queued;
-    if (pqueue_insert(env->reaction_q, reaction) != 0) {
+    if (reaction_heap_insert(&env->reaction_q, reaction, reaction->index) != 0) {
       lf_print_error_and_exit("Could not insert reaction into reaction_q");
     }
   }
 }
 
+bool _lf_may_execute_inline(environment_t* env, reaction_t* reaction) {
+  // The reaction queue is ordered by inferred deadline first.
+  reaction_t* waiting = reaction_heap_peek(&env->reaction_q);
+  return waiting == NULL || LF_INFERRED_DEADLINE(waiting->index) >= LF_INFERRED_DEADLINE(reaction->index);
+}
+
+bool _lf_chain_needs_cpu_times(void) { return false; }
+
+void _lf_chain_executed(environment_t* env, int worker_number, reaction_t** reactions, instant_t* end_times,
+                        int64_t* cpu_times, size_t length, instant_t start_time, int64_t start_cpu_time) {
+  // Only the threaded runtime accounts for the execution of reactions.
+  (void)env;
+  (void)worker_number;
+  (void)reactions;
+  (void)end_times;
+  (void)cpu_times;
+  (void)length;
+  (void)start_time;
+  (void)start_cpu_time;
+}
+
+bool _lf_handle_violations(environment_t* env, reaction_t* reaction, int worker_number) {
+  bool violation = false;
+
+  // FIXME: These comments look outdated. We may need to update them.
+  // If the reaction has a deadline, compare to current physical time
+  // and invoke the deadline violation reaction instead of the reaction function
+  // if a violation has occurred. Note that the violation reaction will be invoked
+  // at most once per logical time value. If the violation reaction triggers the
+  // same reaction at the current time value, even if at a future superdense time,
+  // then the reaction will be invoked and the violation reaction will not be invoked again.
+  if (reaction->deadline >= 0LL) {
+    // Get the current physical time.
+    instant_t physical_time = lf_time_physical();
+    // FIXME: These comments look outdated. We may need to update them.
+    // Check for deadline violation.
+    // There are currently two distinct deadline mechanisms:
+    // local deadlines are defined with the reaction;
+    // container deadlines are defined in the container.
+    // They can have different deadlines, so we have to check both.
+    // Handle the local deadline first.
+    if (reaction->deadline == 0 || physical_time > lf_time_add(env->current_tag.time, reaction->deadline)) {
+      LF_PRINT_LOG("Deadline violation. Invoking deadline handler.");
+      tracepoint_reaction_deadline_missed(env, reaction, worker_number);
+      // Deadline violation has occurred.
+      violation = true;
+      // Invoke the local handler, if there is one.
+      tracepoint_reaction_starts(env, reaction, worker_number);
+      reaction_function_t handler = reaction->deadline_violation_handler;
+      if (handler != NULL) {
+        (*handler)(reaction->self);
+        // If the reaction produced outputs, put the resulting
+        // triggered reactions into the queue.
+        schedule_output_reactions(env, reaction, worker_number);
+      }
+      tracepoint_reaction_ends(env, reaction, worker_number);
+    }
+  }
+  return violation;
+}
+
 /**
  * Execute all the reactions in the reaction queue at the current tag.
  *
@@ -132,9 +195,9 @@ int _lf_do_step(environment_t* env) {
   assert(env != GLOBAL_ENVIRONMENT);
 
   // Invoke reactions.
-  while (pqueue_size(env->reaction_q) > 0) {
+  while (reaction_heap_size(&env->reaction_q) > 0) {
     // lf_print_snapshot();
-    reaction_t* reaction = (reaction_t*)pqueue_pop(env->reaction_q);
+    reaction_t* reaction = reaction_heap_pop(&env->reaction_q);
     reaction->status = running;
 
     // ---- Phase 0.5: observability report (single-threaded) ----
@@ -146,7 +209,7 @@ int _lf_do_step(environment_t* env) {
     rep.lag_ns = rep.physical_time_ns - rep.logical_time_ns;
     rep.reactor_id = -1;
     rep.reaction_id = (reaction != NULL) ? reaction->number : -1;
-    rep.ready_q_len = (int)pqueue_size(env->reaction_q);
+    rep.ready_q_len = (int)reaction_heap_size(&env->reaction_q);
     rep.deadline_misses = 0;
     ms_report(&rep);
     // -----------------------------------------------------------
@@ -154,42 +217,7 @@ int _lf_do_step(environment_t* env) {
     LF_PRINT_LOG("Invoking reaction %s at elapsed logical tag " PRINTF_TAG ".", reaction->name,
                  env->current_tag.time - start_time, env->current_tag.microstep);
 
-    bool violation = false;
-
-    // FIXME: These comments look outdated. We may need to update them.
-    // If the reaction has a deadline, compare to current physical time
-    // and invoke the deadline violation reaction instead of the reaction function
-    // if a violation has occurred. Note that the violation reaction will be invoked
-    // at most once per logical time value. If the violation reaction triggers the
-    // same reaction at the current time value, even if at a future superdense time,
-    // then the reaction will be invoked and the violation reaction will not be invoked again.
-    if (reaction->deadline >= 0LL) {
-      // Get the current physical time.
-      instant_t physical_time = lf_time_physical();
-      // FIXME: These comments look outdated. We may need to update them.
-      // Check for deadline violation.
-      // There are currently two distinct deadline mechanisms:
-      // local deadlines are defined with the reaction;
-      // container deadlines are defined in the container.
-      // They can have different deadlines, so we have to check both.
-      // Handle the local deadline first.
-      if (reaction->deadline == 0 || physical_time > lf_time_add(env->current_tag.time, reaction->deadline)) {
-        LF_PRINT_LOG("Deadline violation. Invoking deadline handler.");
-        tracepoint_reaction_deadline_missed(env, reaction, 0);
-        // Deadline violation has occurred.
-        violation = true;
-        // Invoke the local handler, if there is one.
-        tracepoint_reaction_starts(env, reaction, 0);
-        reaction_function_t handler = reaction->deadline_violation_handler;
-        if (handler != NULL) {
-          (*handler)(reaction->self);
-          // If the reaction produced outputs, put the resulting
-          // triggered reactions into the queue.
-          schedule_output_reactions(env, reaction, 0);
-        }
-        tracepoint_reaction_ends(env, reaction, 0);
-      }
-    }
+    bool violation = _lf_handle_violations(env, reaction, 0);
 
     if (!violation) {
       // Invoke the reaction function.
@@ -29,10 +29,12 @@
 #include "util.h"
 #include "vector.h"
 #include "lf_core_version.h"
+#include "master_scheduler_stats.h"
 #include "hashset/hashset.h"
 #include "hashset/hashset_itr.h"
 #include "environment.h"
 #include "reactor_common.h"
+#include "timer_group.h"
 
 #if !defined(LF_SINGLE_THREADED)
 #include "watchdog.h"
@@ -265,120 +267,131 @@ bool lf_is_tag_after_stop_tag(environment_t* env, tag_t tag) {
   return (lf_tag_compare(tag, env->stop_tag) > 0);
 }
 
-void _lf_pop_events(environment_t* env) {
-  assert(env != GLOBAL_ENVIRONMENT);
-#ifdef MODAL_REACTORS
-  _lf_handle_mode_triggered_reactions(env);
-#endif
-
-  event_t* event = (event_t*)pqueue_tag_peek(env->event_q);
-  while (event != NULL && lf_tag_compare(event->base.tag, env->current_tag) == 0) {
-    event = (event_t*)pqueue_tag_pop(env->event_q);
-
-    if (event->trigger == NULL) {
-      LF_PRINT_DEBUG("Popped dummy event from the event queue.");
-      lf_recycle_event(env, event);
-      // Peek at the next event in the event queue.
-      event = (event_t*)pqueue_tag_peek(env->event_q);
-      continue;
-    }
+/**
+ * @brief Trigger the reactions of an event taken off the event queue at the current tag and recycle the event.
+ * @param env The environment.
+ * @param event The event.
+ */
+static void _lf_handle_popped_event(environment_t* env, event_t* event) {
+  if (event->trigger == NULL) {
+    LF_PRINT_DEBUG("Popped dummy event from the event queue.");
+    lf_recycle_event(env, event);
+    return;
+  }
+  if (event->trigger->timer_group != NULL) {
+    _lf_timer_group_fire(env, event);
+    return;
+  }
 
 #ifdef MODAL_REACTORS
-    // If this event is associated with an inactive mode it should haven been suspended and no longer on the event
-    // queue. NOTE: This should not be possible
-    if (!_lf_mode_is_active(event->trigger->mode)) {
-      lf_print_warning(
-          "Assumption violated. There is an event on the event queue that is associated to an inactive mode.");
-    }
+  // If this event is associated with an inactive mode it should haven been suspended and no longer on the event
+  // queue. NOTE: This should not be possible
+  if (!_lf_mode_is_active(event->trigger->mode)) {
+    lf_print_warning(
+        "Assumption violated. There is an event on the event queue that is associated to an inactive mode.");
+  }
 #endif
 
-    lf_token_t* token = event->token;
+  lf_token_t* token = event->token;
 
-    // Put the corresponding reactions onto the reaction queue.
-    for (int i = 0; i < event->trigger->number_of_reactions; i++) {
-      reaction_t* reaction = event->trigger->reactions[i];
-      // Do not enqueue this reaction twice.
-      if (reaction->status == inactive) {
+  // Put the corresponding reactions onto the reaction queue.
+  for (int i = 0; i < event->trigger->number_of_reactions; i++) {
+    reaction_t* reaction = event->trigger->reactions[i];
+    // Do not enqueue this reaction twice.
+    if (reaction->status == inactive) {
 #ifdef FEDERATED_DECENTRALIZED
-        // In federated execution, an intended tag that is not (NEVER, 0)
-        // indicates that this particular event is triggered by a network message.
-        // The intended tag is set in handle_tagged_message in federate.c whenever
-        // a tagged message arrives from another federate.
-        if (event->intended_tag.time != NEVER) {
-          // If the intended tag of the event is actually set,
-          // transfer the intended tag to the trigger so that
-          // the reaction can access the value.
-          event->trigger->intended_tag = event->intended_tag;
-          // And check if it is in the past compared to the current tag.
-          if (lf_tag_compare(event->intended_tag, env->current_tag) < 0) {
-            // Mark the triggered reaction with a STP violation
-            reaction->is_STP_violated = true;
-            LF_PRINT_LOG("Trigger %p has violated the reaction's STP offset. Intended tag: " PRINTF_TAG
-                         ". Current tag: " PRINTF_TAG,
-                         (void*)event->trigger, event->intended_tag.time - start_time, event->intended_tag.microstep,
-                         env->current_tag.time - start_time, env->current_tag.microstep);
-            // Need to update the last_known_status_tag of the port because otherwise,
-            // the MLAA could get stuck, causing the program to lock up.
-            // This should not call update_last_known_status_on_input_port because we
-            // are starting a new tag step execution, so there are no reactions blocked on this input.
-            if (lf_tag_compare(env->current_tag, event->trigger->last_known_status_tag) > 0) {
-              event->trigger->last_known_status_tag = env->current_tag;
-            }
+      // In federated execution, an intended tag that is not (NEVER, 0)
+      // indicates that this particular event is triggered by a network message.
+      // The intended tag is set in handle_tagged_message in federate.c whenever
+      // a tagged message arrives from another federate.
+      if (event->intended_tag.time != NEVER) {
+        // If the intended tag of the event is actually set,
+        // transfer the intended tag to the trigger so that
+        // the reaction can access the value.
+        event->trigger->intended_tag = event->intended_tag;
+        // And check if it is in the past compared to the current tag.
+        if (lf_tag_compare(event->intended_tag, env->current_tag) < 0) {
+          // Mark the triggered reaction with a STP violation
+          reaction->is_STP_violated = true;
+          LF_PRINT_LOG("Trigger %p has violated the reaction's STP offset. Intended tag: " PRINTF_TAG
+                       ". Current tag: " PRINTF_TAG,
+                       (void*)event->trigger, event->intended_tag.time - start_time, event->intended_tag.microstep,
+                       env->current_tag.time - start_time, env->current_tag.microstep);
+          // Need to update the last_known_status_tag of the port because otherwise,
+          // the MLAA could get stuck, causing the program to lock up.
+          // This should not call update_last_known_status_on_input_port because we
+          // are starting a new tag step execution, so there are no reactions blocked on this input.
+          if (lf_tag_compare(env->current_tag, event->trigger->last_known_status_tag) > 0) {
+            event->trigger->last_known_status_tag = env->current_tag;
           }
         }
+      }
 #endif
 
 #ifdef MODAL_REACTORS
-        // Check if reaction is disabled by mode inactivity
-        if (!_lf_mode_is_active(reaction->mode)) {
-          LF_PRINT_DEBUG("Suppressing reaction %s due inactive mode.", reaction->name);
-          continue; // Suppress reaction by preventing entering reaction queue
-        }
-#endif
-        LF_PRINT_DEBUG("Triggering reaction %s.", reaction->name);
-        _lf_trigger_reaction(env, reaction, -1);
-      } else {
-        LF_PRINT_DEBUG("Reaction is already triggered: %s", reaction->name);
+      // Check if reaction is disabled by mode inactivity
+      if (!_lf_mode_is_active(reaction->mode)) {
+        LF_PRINT_DEBUG("Suppressing reaction %s due inactive mode.", reaction->name);
+        continue; // Suppress reaction by preventing entering reaction queue
       }
+#endif
+      LF_PRINT_DEBUG("Triggering reaction %s.", reaction->name);
+      _lf_trigger_reaction(env, reaction, -1);
+    } else {
+      LF_PRINT_DEBUG("Reaction is already triggered: %s", reaction->name);
     }
+  }
 
-    // Mark the trigger present
-    event->trigger->status = present;
+  // Mark the trigger present
+  event->trigger->status = present;
 
-    // If the trigger is a periodic timer, create a new event for its next execution.
-    if (event->trigger->is_timer && event->trigger->period > 0LL) {
-      // Reschedule the trigger.
-      lf_schedule_trigger(env, event->trigger, event->trigger->period, NULL);
-    } else {
-      // For actions, store a pointer to status field so it is reset later.
-      int ipfas = lf_atomic_fetch_add(&env->is_present_fields_abbreviated_size, 1);
-      if (ipfas < env->is_present_fields_size) {
-        env->is_present_fields_abbreviated[ipfas] = (bool*)&event->trigger->status;
-      }
+  // If the trigger is a periodic timer, create a new event for its next execution.
+  if (event->trigger->is_timer && event->trigger->period > 0LL) {
+    // Reschedule the trigger.
+    lf_schedule_trigger(env, event->trigger, event->trigger->period, NULL);
+  } else {
+    // For actions, store a pointer to status field so it is reset later.
+    int ipfas = lf_atomic_fetch_add(&env->is_present_fields_abbreviated_size, 1);
+    if (ipfas < env->is_present_fields_size) {
+      env->is_present_fields_abbreviated[ipfas] = (bool*)&event->trigger->status;
     }
+  }
 
-    // Copy the token pointer into the trigger struct so that the
-    // reactions can access it. This overwrites the previous template token,
-    // for which we decrement the reference count.
-    _lf_replace_template_token((token_template_t*)event->trigger, token);
+  // Copy the token pointer into the trigger struct so that the
+  // reactions can access it. This overwrites the previous template token,
+  // for which we decrement the reference count.
+  _lf_replace_template_token((token_template_t*)event->trigger, token);
 
-    // Decrement the reference count because the event queue no longer needs this token.
-    // This has to be done after the above call to _lf_replace_template_token because
-    // that call will increment the reference count and we need to not let the token be
-    // freed prematurely.
-    _lf_done_using(token);
+  // Decrement the reference count because the event queue no longer needs this token.
+  // This has to be done after the above call to _lf_replace_template_token because
+  // that call will increment the reference count and we need to not let the token be
+  // freed prematurely.
+  _lf_done_using(token);
 
-    lf_recycle_event(env, event);
+  lf_recycle_event(env, event);
+}
 
-    // Peek at the next event in the event queue.
-    event = (event_t*)pqueue_tag_peek(env->event_q);
-  };
+void _lf_pop_events(environment_t* env) {
+  assert(env != GLOBAL_ENVIRONMENT);
+#ifdef MODAL_REACTORS
+  _lf_handle_mode_triggered_reactions(env);
+#endif
+
+  // Take all events at the current tag off the event queue at once. Handling them
+  // schedules no events at the current tag, but check again to be sure.
+  vector_t* popped = &env->popped_events;
+  while (pqueue_tag_pop_all_with_tag(env->event_q, env->current_tag, popped) > 0) {
+    event_t* event;
+    while ((event = (event_t*)vector_pop(popped)) != NULL) {
+      _lf_handle_popped_event(env, event);
+    }
+  }
 }
 
 event_t* lf_get_new_event(environment_t* env) {
   assert(env != GLOBAL_ENVIRONMENT);
   // Recycle event_t structs, if possible.
-  event_t* e = (event_t*)pqueue_tag_pop(env->recycle_q);
+  event_t* e = env->free_events;
   if (e == NULL) {
     e = (event_t*)calloc(1, sizeof(struct event_t));
     if (e == NULL)
@@ -388,7 +401,9 @@ event_t* lf_get_new_event(environment_t* env) {
 #endif
     LF_PRINT_DEBUG("lf_get_new_event: Allocated event: %p", (void*)e);
   } else {
-    LF_PRINT_DEBUG("lf_get_new_event: Retrieved event from the recycle queue: %p", (void*)e);
+    env->free_events = e->next;
+    e->next = NULL;
+    LF_PRINT_DEBUG("lf_get_new_event: Retrieved event from the free list: %p", (void*)e);
   }
   return e;
 }
@@ -433,6 +448,12 @@ bool _lf_initialize_timer(environment_t* env, trigger_t* timer) {
   tag_t next_tag = (tag_t){.time = lf_time_logical(env) + delay, .microstep = 0};
   // Do not schedule the next event if it is after the timeout.
   if (!lf_is_tag_after_stop_tag(env, next_tag)) {
+    if (timer->period > 0 && timer->mode == NULL) {
+      // Periodic timers outside modes fire with the others of their group.
+      _lf_timer_group_add(env, timer, next_tag);
+      tracepoint_schedule(env, timer, delay); // Trace even though schedule is not called.
+      return result;
+    }
     event_t* e = lf_get_new_event(env);
     e->trigger = timer;
     e->base.tag = next_tag;
@@ -453,7 +474,7 @@ bool _lf_initialize_timers(environment_t* env) {
   }
 
   // To avoid runtime memory allocations for timer-driven programs
-  // the recycle queue is initialized with a single event.
+  // the free list of events is initialized with a single event.
   if (env->timer_triggers_size > 0) {
     event_t* e = lf_get_new_event(env);
     lf_recycle_event(env, e);
@@ -507,7 +528,8 @@ void lf_recycle_event(environment_t* env, event_t* e) {
 #ifdef FEDERATED_DECENTRALIZED
   e->intended_tag = (tag_t){.time = NEVER, .microstep = 0u};
 #endif
-  pqueue_tag_insert(env->recycle_q, (pqueue_tag_element_t*)e);
+  e->next = env->free_events;
+  env->free_events = e;
 }
 
 event_t* _lf_create_dummy_events(environment_t* env, tag_t tag) {
@@ -786,24 +808,15 @@ void _lf_invoke_reaction(environment_t* env, reaction_t* reaction, int worker) {
 #endif
 }
 
-/**
- * For the specified reaction, if it has produced outputs, insert the
- * resulting triggered reactions into the reaction queue.
- * This procedure assumes the mutex lock is NOT held and grabs
- * the lock only when it actually inserts something onto the reaction queue.
- * @param env Environment in which we are executing.
- * @param reaction The reaction that has just executed.
- * @param worker The thread number of the worker thread or 0 for single-threaded execution (for tracing).
- */
-void schedule_output_reactions(environment_t* env, reaction_t* reaction, int worker) {
+reaction_t* _lf_trigger_output_reactions(environment_t* env, reaction_t* reaction, int worker) {
   assert(env != GLOBAL_ENVIRONMENT);
 
-  // If the reaction produced outputs, put the resulting triggered
-  // reactions into the reaction queue. As an optimization, if exactly one
-  // downstream reaction is enabled by this reaction, then it may be
-  // executed immediately in this same thread
-  // without going through the reaction queue.
-  reaction_t* downstream_to_execute_now = NULL;
+  // If the reaction produced outputs, put the resulting triggered reactions
+  // into the reaction queue, except for the one that may be executed
+  // immediately in this same thread without going through the reaction queue.
+  // That candidate is a reaction that only this reaction enables and that has
+  // the least index, i.e., the earliest inferred deadline, of those.
+  reaction_t* candidate = NULL;
   int num_downstream_reactions = 0;
 #ifdef FEDERATED_DECENTRALIZED // Only pass down STP violation for federated programs that use decentralized
                                // coordination.
@@ -833,31 +846,16 @@ void schedule_output_reactions(environment_t* env, reaction_t* reaction, int wor
                              downstream_reaction->is_STP_violated, downstream_reaction->name);
             }
 #endif
-            if (downstream_reaction != NULL && downstream_reaction != downstream_to_execute_now) {
+            if (downstream_reaction != NULL && downstream_reaction != candidate) {
               num_downstream_reactions++;
-              // If there is exactly one downstream reaction that is enabled by this
-              // reaction, then we can execute that reaction immediately without
-              // going through the reaction queue. In multithreaded execution, this
-              // avoids acquiring a mutex lock.
-              // FIXME: Check the earliest deadline on the reaction queue.
-              // This optimization could violate EDF scheduling otherwise.
-              if (num_downstream_reactions == 1 && downstream_reaction->last_enabling_reaction == reaction) {
-                // So far, this downstream reaction is a candidate to execute now.
-                downstream_to_execute_now = downstream_reaction;
-              } else {
-                // If there is a previous candidate reaction to execute now,
-                // it is no longer a candidate.
-                if (downstream_to_execute_now != NULL) {
-                  // More than one downstream reaction is enabled.
-                  // In this case, if we were to execute the downstream reaction
-                  // immediately without changing any queues, then the second
-                  // downstream reaction would be blocked because this reaction
-                  // remains on the executing queue. Hence, the optimization
-                  // is not valid. Put the candidate reaction on the queue.
-                  _lf_trigger_reaction(env, downstream_to_execute_now, worker);
-                  downstream_to_execute_now = NULL;
+              if (downstream_reaction->last_enabling_reaction == reaction &&
+                  (candidate == NULL || downstream_reaction->index < candidate->index)) {
+                // Queue the previous candidate, if any, in favor of this one.
+                if (candidate != NULL) {
+                  _lf_trigger_reaction(env, candidate, worker);
                 }
-                // Queue the reaction.
+                candidate = downstream_reaction;
+              } else {
                 _lf_trigger_reaction(env, downstream_reaction, worker);
               }
             }
@@ -866,89 +864,91 @@ void schedule_output_reactions(environment_t* env, reaction_t* reaction, int wor
       }
     }
   }
-  if (downstream_to_execute_now != NULL) {
-    LF_PRINT_LOG("Env %u: Worker %d: Optimizing and executing downstream reaction now: %s", env->id, worker,
-                 downstream_to_execute_now->name);
-    bool violation = false;
-#ifdef FEDERATED_DECENTRALIZED // Only use the STP handler for federated programs that use decentralized coordination
-    // If the is_STP_violated for the reaction is true,
-    // an input trigger to this reaction has been triggered at a later
-    // logical time than originally anticipated. In this case, a special
-    // STP handler will be invoked.
-    // FIXME: Note that the STP handler will be invoked
-    // at most once per logical time value. If the STP handler triggers the
-    // same reaction at the current time value, even if at a future superdense time,
-    // then the reaction will be invoked and the STP handler will not be invoked again.
-    // However, input ports to a federate reactor are network port types so this possibly should
-    // be disallowed.
-    // @note The STP handler and the deadline handler are not mutually exclusive.
-    //  In other words, both can be invoked for a reaction if it is triggered late
-    //  in logical time (STP offset is violated) and also misses the constraint on
-    //  physical time (deadline).
-    // @note In absence of a STP handler, the is_STP_violated will be passed down the reaction
-    //  chain until it is dealt with in a downstream STP handler.
-    if (downstream_to_execute_now->is_STP_violated == true) {
-      // Tardiness has occurred
-      LF_PRINT_LOG("Env %u: Event has STP violation.", env->id);
-      reaction_function_t handler = downstream_to_execute_now->STP_handler;
-      // Invoke the STP handler if there is one.
-      if (handler != NULL) {
-        // There is a violation and it is being handled here
-        // If there is no STP handler, pass the is_STP_violated
-        // to downstream reactions.
-        violation = true;
-        LF_PRINT_LOG("Env %u: Invoke tardiness handler.", env->id);
-        (*handler)(downstream_to_execute_now->self);
-
-        // If the reaction produced outputs, put the resulting
-        // triggered reactions into the queue or execute them directly if possible.
-        schedule_output_reactions(env, downstream_to_execute_now, worker);
-
-        // Reset the tardiness because it has been dealt with in the
-        // STP handler
-        downstream_to_execute_now->is_STP_violated = false;
-        LF_PRINT_DEBUG("Env %u: Reset reaction's is_STP_violated field to false: %s", env->id,
-                       downstream_to_execute_now->name);
-      }
-    }
+  if (candidate == NULL) {
+    return NULL;
+  }
+#if !defined(LF_SINGLE_THREADED)
+  // With more than one worker, if more than one downstream reaction is enabled,
+  // executing the candidate immediately would block the others, because this
+  // reaction remains on the executing queue until the chain ends. With one
+  // worker, the others have to wait for this worker anyway.
+  bool blocks_others = num_downstream_reactions > 1 && env->num_workers > 1;
+#else
+  bool blocks_others = false;
 #endif
-    if (downstream_to_execute_now->deadline >= 0LL) {
-      // Get the current physical time.
-      instant_t physical_time = lf_time_physical();
-      // Check for deadline violation.
-      if (downstream_to_execute_now->deadline == 0 ||
-          physical_time > lf_time_add(env->current_tag.time, downstream_to_execute_now->deadline)) {
-        // Deadline violation has occurred.
-        tracepoint_reaction_deadline_missed(env, downstream_to_execute_now, worker);
-        violation = true;
-        // Invoke the local handler, if there is one.
-        reaction_function_t handler = downstream_to_execute_now->deadline_violation_handler;
-        tracepoint_reaction_starts(env, downstream_to_execute_now, worker);
-        if (handler != NULL) {
-          // Assume the mutex is still not held.
-          (*handler)(downstream_to_execute_now->self);
-
-          // If the reaction produced outputs, put the resulting
-          // triggered reactions into the queue or execute them directly if possible.
-          schedule_output_reactions(env, downstream_to_execute_now, worker);
-        }
-        tracepoint_reaction_ends(env, downstream_to_execute_now, worker);
-      }
-    }
-    if (!violation) {
-      // Invoke the downstream_reaction function.
-      _lf_invoke_reaction(env, downstream_to_execute_now, worker);
+  // Executing the candidate ahead of a waiting reaction with an earlier deadline
+  // would violate EDF scheduling, so the runtime has to agree.
+  if (blocks_others || !_lf_may_execute_inline(env, candidate)) {
+    _lf_trigger_reaction(env, candidate, worker);
+    return NULL;
+  }
+  return candidate;
+}
 
-      // If the downstream_reaction produced outputs, put the resulting triggered
-      // reactions into the queue (or execute them directly, if possible).
-      schedule_output_reactions(env, downstream_to_execute_now, worker);
+void _lf_execute_chain(environment_t* env, reaction_t* reaction, int worker) {
+  assert(env != GLOBAL_ENVIRONMENT);
+
+  // The runtime is told about the executed reactions in batches.
+  reaction_t* chain[LF_CHAIN_BATCH];
+  instant_t end_times[LF_CHAIN_BATCH];
+  int64_t cpu_times[LF_CHAIN_BATCH];
+  size_t length = 0;
+  // Each reaction is charged the CPU time of the thread since the previous one ended.
+  bool sample_cpu = _lf_chain_needs_cpu_times();
+  instant_t start_time = lf_time_physical();
+  int64_t start_cpu_time = sample_cpu ? ms_stats_thread_cpu_ns() : -1;
+  while (reaction != NULL) {
+    LF_PRINT_LOG("Env %u: Worker %d: Optimizing and executing downstream reaction now: %s", env->id, worker,
+                 reaction->name);
+    reaction_t* next = NULL;
+    // A violation handler schedules the reactions that it triggers itself.
+    if (!_lf_handle_violations(env, reaction, worker)) {
+      _lf_invoke_reaction(env, reaction, worker);
+      next = _lf_trigger_output_reactions(env, reaction, worker);
     }
 
     // Reset the is_STP_violated because it has been passed
     // down the chain
-    downstream_to_execute_now->is_STP_violated = false;
-    LF_PRINT_DEBUG("Env %u: Finally, reset reaction's is_STP_violated field to false: %s", env->id,
-                   downstream_to_execute_now->name);
+    reaction->is_STP_violated = false;
+    LF_PRINT_DEBUG("Env %u: Finally, reset reaction's is_STP_violated field to false: %s", env->id, reaction->name);
+
+    chain[length] = reaction;
+    end_times[length] = lf_time_physical();
+    if (sample_cpu) {
+      cpu_times[length] = ms_stats_thread_cpu_ns();
+    }
+    length++;
+    if (length == LF_CHAIN_BATCH) {
+      _lf_chain_executed(env, worker, chain, end_times, sample_cpu ? cpu_times : NULL, length, start_time,
+                         start_cpu_time);
+      start_time = end_times[length - 1];
+      start_cpu_time = sample_cpu ? cpu_times[length - 1] : -1;
+      length = 0;
+    }
+    reaction = next;
+  }
+  if (length > 0) {
+    _lf_chain_executed(env, worker, chain, end_times, sample_cpu ? cpu_times : NULL, length, start_time,
+                       start_cpu_time);
+  }
+}
+
+/**
+ * For the specified reaction, if it has produced outputs, insert the
+ * resulting triggered reactions into the reaction queue.
+ * As an optimization, a chain of reactions that each are the only one enabled
+ * by the previous one is executed immediately in this thread, for as long as
+ * that respects the order in which the scheduler would execute them.
+ * This procedure assumes the mutex lock is NOT held and grabs
+ * the lock only when it actually inserts something onto the reaction queue.
+ * @param env Environment in which we are executing.
+ * @param reaction The reaction that has just executed.
+ * @param worker The thread number of the worker thread or 0 for single-threaded execution (for tracing).
+ */
+void schedule_output_reactions(environment_t* env, reaction_t* reaction, int worker) {
+  reaction_t* next = _lf_trigger_output_reactions(env, reaction, worker);
+  if (next != NULL) {
+    _lf_execute_chain(env, next, worker);
   }
 }
 
@@ -1191,6 +1191,7 @@ void initialize_global(void) {
 #else
   lf_tracing_global_init("main", NULL, 0, max_threads_tracing);
 #endif
+  lf_tracing_filter_init();
   // Call the code-generated function to initialize all actions, timers, and ports
   // This is done for all environments/enclaves at the same time.
   _lf_initialize_trigger_objects();
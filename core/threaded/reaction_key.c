@@ -0,0 +1,198 @@
+/**
+ * @file
+ *
+ * @brief Computation and precomputation of stable reaction keys, and the
+ * table that maps a key back to its reaction.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+
+#include "reaction_key.h"
+#include "reactor.h"
+#include "vector.h"
+#include "watchdog.h"
+
+// Substitute for a computed key of zero, which is reserved for "not computed".
+#define LF_REACTION_KEY_ZERO_SUBSTITUTE 0x9E3779B185EBCA87ULL
+
+// Minimum capacity of the key -> reaction table, leaving room for reactions
+// that get their key lazily.
+#define LF_REACTION_KEY_TABLE_MIN_CAPACITY 1024
+
+typedef struct {
+  uint64_t key; // 0 marks an empty slot.
+  reaction_t* reaction; // NULL while the slot is being filled.
+} lf_reaction_key_slot_t;
+
+// Stands in for the reaction of a key that several reactions share.
+static char _lf_reaction_key_collision;
+#define LF_REACTION_KEY_COLLISION ((reaction_t*)(void*)&_lf_reaction_key_collision)
+
+// Open-addressing table from stable key to reaction, allocated by
+// lf_reaction_keys_init() and only ever added to afterwards.
+static lf_reaction_key_slot_t* _lf_reaction_key_table = NULL;
+static size_t _lf_reaction_key_mask = 0;
+static size_t _lf_reaction_key_count = 0;
+
+#define LF_FNV_OFFSET_BASIS 1469598103934665603ULL
+
+static uint64_t _lf_hash_str64(uint64_t h, const char* s) {
+  if (s == NULL)
+    return h;
+  while (*s) {
+    h ^= (uint8_t)(*s++);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/**
+ * Continue the hash 'h' with the full name of a reactor, as lf_reactor_full_name()
+ * would return it, without building that string.
+ */
+static uint64_t _lf_hash_full_name(uint64_t h, self_base_t* self) {
+  if (self->parent != NULL) {
+    h = _lf_hash_full_name(h, self->parent);
+    h = _lf_hash_str64(h, ".");
+  }
+  return _lf_hash_str64(h, self->name);
+}
+
+/**
+ * Add a reaction to the key table. Safe to call concurrently with lookups and
+ * other inserts. Adding a reaction again changes nothing. If another reaction
+ * already has the key, the key is marked as shared so that lookups for it miss.
+ * Once the table is three-quarters full, further keys are left out and lookups
+ * for them miss.
+ */
+static void _lf_reaction_key_table_insert(uint64_t key, reaction_t* reaction) {
+  lf_reaction_key_slot_t* table = __atomic_load_n(&_lf_reaction_key_table, __ATOMIC_ACQUIRE);
+  if (table == NULL)
+    return;
+  for (size_t i = (size_t)(key * 0x9E3779B185EBCA87ULL >> 32) & _lf_reaction_key_mask;;
+       i = (i + 1) & _lf_reaction_key_mask) {
+    uint64_t expected = __atomic_load_n(&table[i].key, __ATOMIC_ACQUIRE);
+    if (expected == 0) {
+      // Concurrent inserts may overshoot the limit by one key each, which still leaves empty slots.
+      if (__atomic_load_n(&_lf_reaction_key_count, __ATOMIC_RELAXED) * 4 >= (_lf_reaction_key_mask + 1) * 3)
+        return;
+      if (__atomic_compare_exchange_n(&table[i].key, &expected, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        __atomic_add_fetch(&_lf_reaction_key_count, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&table[i].reaction, reaction, __ATOMIC_RELEASE);
+        return;
+      }
+    }
+    if (expected == key) {
+      // Wait for the thread that claimed the slot to fill it in, which it does
+      // right after claiming it, so this rarely yields more than once.
+      reaction_t* present;
+      while ((present = __atomic_load_n(&table[i].reaction, __ATOMIC_ACQUIRE)) == NULL) {
+        sched_yield();
+      }
+      if (present != reaction)
+        __atomic_store_n(&table[i].reaction, LF_REACTION_KEY_COLLISION, __ATOMIC_RELEASE);
+      return;
+    }
+  }
+}
+
+reaction_t* lf_reaction_find_by_key(uint64_t key) {
+  lf_reaction_key_slot_t* table = __atomic_load_n(&_lf_reaction_key_table, __ATOMIC_ACQUIRE);
+  if (table == NULL || key == 0)
+    return NULL;
+  for (size_t i = (size_t)(key * 0x9E3779B185EBCA87ULL >> 32) & _lf_reaction_key_mask;;
+       i = (i + 1) & _lf_reaction_key_mask) {
+    uint64_t slot_key = __atomic_load_n(&table[i].key, __ATOMIC_ACQUIRE);
+    if (slot_key == key) {
+      reaction_t* reaction = __atomic_load_n(&table[i].reaction, __ATOMIC_ACQUIRE);
+      return reaction == LF_REACTION_KEY_COLLISION ? NULL : reaction;
+    }
+    if (slot_key == 0)
+      return NULL;
+  }
+}
+
+uint64_t lf_reaction_compute_stable_key(reaction_t* reaction) {
+  if (reaction == NULL) {
+    return 0;
+  }
+  uint64_t key;
+  self_base_t* self = (self_base_t*)reaction->self;
+  // Only an unnamed top-level reactor has an empty full name.
+  if (self != NULL && (self->parent != NULL || (self->name != NULL && self->name[0] != '\0'))) {
+    key = _lf_hash_full_name(LF_FNV_OFFSET_BASIS, self) ^
+          (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
+  } else if (reaction->name != NULL && reaction->name[0] != '\0') {
+    key = _lf_hash_str64(LF_FNV_OFFSET_BASIS, reaction->name) ^
+          (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
+  } else {
+    key = ((uint64_t)(uint32_t)reaction->number << 32) ^ (uint64_t)(uint32_t)LF_LEVEL(reaction->index);
+  }
+  if (key == 0) {
+    key = LF_REACTION_KEY_ZERO_SUBSTITUTE;
+  }
+  // Concurrent computations on first use store the same value.
+  __atomic_store_n(&reaction->stable_key, key, __ATOMIC_RELAXED);
+  _lf_reaction_key_table_insert(key, reaction);
+  return key;
+}
+
+void lf_reaction_keys_init(environment_t* envs, int num_envs) {
+  vector_t pending = vector_new(64);
+  for (int e = 0; e < num_envs; e++) {
+    environment_t* env = &envs[e];
+    vector_pushall(&pending, (void**)env->startup_reactions, (size_t)env->startup_reactions_size);
+    vector_pushall(&pending, (void**)env->shutdown_reactions, (size_t)env->shutdown_reactions_size);
+    vector_pushall(&pending, (void**)env->reset_reactions, (size_t)env->reset_reactions_size);
+    for (int i = 0; i < env->timer_triggers_size; i++) {
+      trigger_t* timer = env->timer_triggers[i];
+      if (timer != NULL) {
+        vector_pushall(&pending, (void**)timer->reactions, (size_t)timer->number_of_reactions);
+      }
+    }
+    for (int i = 0; i < env->watchdogs_size; i++) {
+      trigger_t* trigger = env->watchdogs[i] != NULL ? env->watchdogs[i]->trigger : NULL;
+      if (trigger != NULL) {
+        vector_pushall(&pending, (void**)trigger->reactions, (size_t)trigger->number_of_reactions);
+      }
+    }
+  }
+  // A non-zero key marks a reaction as visited.
+  vector_t visited = vector_new(64);
+  reaction_t* reaction;
+  while ((reaction = (reaction_t*)vector_pop(&pending)) != NULL) {
+    if (reaction->stable_key != 0) {
+      continue;
+    }
+    lf_reaction_compute_stable_key(reaction);
+    vector_push(&visited, reaction);
+    for (size_t i = 0; i < reaction->num_outputs; i++) {
+      if (reaction->triggers == NULL || reaction->triggered_sizes == NULL) {
+        break;
+      }
+      for (int j = 0; j < reaction->triggered_sizes[i]; j++) {
+        trigger_t* trigger = reaction->triggers[i][j];
+        if (trigger != NULL) {
+          vector_pushall(&pending, (void**)trigger->reactions, (size_t)trigger->number_of_reactions);
+        }
+      }
+    }
+  }
+  vector_free(&pending);
+
+  size_t capacity = LF_REACTION_KEY_TABLE_MIN_CAPACITY;
+  while (capacity < 4 * vector_size(&visited)) {
+    capacity *= 2;
+  }
+  lf_reaction_key_slot_t* table = (lf_reaction_key_slot_t*)calloc(capacity, sizeof(lf_reaction_key_slot_t));
+  if (table != NULL) {
+    _lf_reaction_key_mask = capacity - 1;
+    __atomic_store_n(&_lf_reaction_key_table, table, __ATOMIC_RELEASE);
+    for (size_t i = 0; i < vector_size(&visited); i++) {
+      reaction = (reaction_t*)*vector_at(&visited, i);
+      _lf_reaction_key_table_insert(reaction->stable_key, reaction);
+    }
+  }
+  vector_free(&visited);
+}
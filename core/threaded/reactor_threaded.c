@@ -35,6 +35,7 @@
 #include "reactor_common.h"
 #include "watchdog.h"
 #include "master_scheduler.h"
+#include "reaction_key.h"
 
 #ifdef FEDERATED
 #include "federate.h"
@@ -43,7 +44,8 @@
 // Global variables defined in tag.c and shared across environments:
 extern instant_t start_time;
 
-#if !defined(SCHEDULER) || SCHEDULER == SCHED_NP || SCHEDULER == SCHED_GEDF_NP || SCHEDULER == SCHED_ADAPTIVE
+#if !defined(SCHEDULER) || SCHEDULER == SCHED_NP || SCHEDULER == SCHED_GEDF_NP || SCHEDULER == SCHED_GEDF_LEVELED || \
+    SCHEDULER == SCHED_NP_WORK_STEALING || SCHEDULER == SCHED_ADAPTIVE
 reaction_t* lf_sched_requeue_current_and_pick_by_index(
     lf_scheduler_t* scheduler,
     int worker_number,
@@ -58,31 +60,6 @@ reaction_t* lf_sched_requeue_current_and_pick_by_key(
 );
 #endif
 
-static inline uint64_t _ms_hash_str64(const char* s) {
-  uint64_t h = 1469598103934665603ULL; // FNV-1a 64-bit offset basis
-  if (s == NULL) return h;
-  while (*s) {
-    h ^= (uint8_t)(*s++);
-    h *= 1099511628211ULL;
-  }
-  return h;
-}
-
-static inline uint64_t _ms_reaction_stable_key(reaction_t* reaction) {
-  if (reaction == NULL) return 0;
-  const char* instance = NULL;
-  if (reaction->self != NULL) {
-    instance = lf_reactor_full_name((self_base_t*)reaction->self);
-  }
-  if (instance != NULL && instance[0] != '\0') {
-    return _ms_hash_str64(instance) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  if (reaction->name != NULL && reaction->name[0] != '\0') {
-    return _ms_hash_str64(reaction->name) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  return ((uint64_t)(uint32_t)reaction->number << 32) ^ (uint64_t)(uint32_t)LF_LEVEL(reaction->index);
-}
-
 /**
  * The maximum amount of time a worker thread should stall
  * before checking the reaction queue again.
@@ -580,6 +557,7 @@ void _lf_next_locked(environment_t* env) {
   if (lf_tag_compare(env->current_tag, next_tag) < 0 || lf_tag_compare(next_tag, start_tag) > 0) {
     _lf_advance_tag(env, next_tag);
   }
+  ms_on_tag_advance(env->id, (long long)env->current_tag.time, env->current_tag.microstep);
 
   _lf_start_time_step(env);
 
@@ -681,6 +659,29 @@ void _lf_trigger_reaction(environment_t* env, reaction_t* reaction, int worker_n
 #endif
 }
 
+bool _lf_may_execute_inline(environment_t* env, reaction_t* reaction) {
+  return ms_may_execute_inline(env->id, lf_reaction_stable_key(reaction)) &&
+         lf_sched_may_execute_now(env->scheduler, reaction);
+}
+
+bool _lf_chain_needs_cpu_times(void) { return ms_chain_needs_cpu_times(); }
+
+void _lf_chain_executed(environment_t* env, int worker_number, reaction_t** reactions, instant_t* end_times,
+                        int64_t* cpu_times, size_t length, instant_t start_time, int64_t start_cpu_time) {
+  uint64_t keys[LF_CHAIN_BATCH];
+  long long ends[LF_CHAIN_BATCH];
+  long long cpu_ends[LF_CHAIN_BATCH];
+  for (size_t i = 0; i < length; i++) {
+    keys[i] = lf_reaction_stable_key(reactions[i]);
+    ends[i] = (long long)end_times[i];
+    if (cpu_times != NULL) {
+      cpu_ends[i] = (long long)cpu_times[i];
+    }
+  }
+  ms_on_chain_executed(env->id, worker_number, keys, ends, cpu_times != NULL ? cpu_ends : NULL, (int)length,
+                       (long long)start_time, (long long)start_cpu_time);
+}
+
 /**
  * Perform the necessary operations before tag (0,0) can be processed.
  *
@@ -856,6 +857,8 @@ static bool _lf_worker_handle_deadline_violation_for_reaction(environment_t* env
     if (reaction->deadline == 0 || physical_time > lf_time_add(env->current_tag.time, reaction->deadline)) {
       // Deadline violation has occurred.
       tracepoint_reaction_deadline_missed(env, reaction, worker_number);
+      __atomic_fetch_add(&env->deadline_misses, 1, __ATOMIC_RELAXED);
+      ms_on_deadline_miss(env->id, worker_number, lf_reaction_stable_key(reaction));
       violation_occurred = true;
       // Invoke the local handler, if there is one.
       tracepoint_reaction_starts(env, reaction, worker_number);
@@ -946,12 +949,12 @@ static bool _lf_worker_handle_STP_violation_for_reaction(environment_t* env, int
  * executing the deadline or STP violation handler(s) on the 'reaction', if they
  * exist.
  * @param env Environment within which we are executing.
- * @param worker_number The ID of the worker.
  * @param reaction The reaction.
+ * @param worker_number The ID of the worker.
  *
  * @return true if a violation occurred and was handled. false otherwise.
  */
-static bool _lf_worker_handle_violations(environment_t* env, int worker_number, reaction_t* reaction) {
+bool _lf_handle_violations(environment_t* env, reaction_t* reaction, int worker_number) {
   bool violation = false;
 
   violation = _lf_worker_handle_STP_violation_for_reaction(env, worker_number, reaction) ||
@@ -975,6 +978,27 @@ static inline bool _ms_should_report(void) {
   return (report_every == 1) || (counter % (uint32_t)report_every == 0);
 }
 
+/**
+ * Fold a new lag sample into the environment's physical-time-delay variation
+ * and return the updated estimate. Workers report concurrently, so the previous
+ * lag is swapped out atomically and the estimate is updated with a CAS loop.
+ * @param env Environment within which we are executing.
+ * @param lag_ns Physical minus logical time at the report.
+ */
+static interval_t _lf_update_ptdv(environment_t* env, interval_t lag_ns) {
+  interval_t previous = __atomic_exchange_n(&env->last_report_lag, lag_ns, __ATOMIC_RELAXED);
+  interval_t ptdv = __atomic_load_n(&env->ptdv, __ATOMIC_RELAXED);
+  if (previous == NEVER) {
+    return ptdv;
+  }
+  interval_t delta = (lag_ns > previous) ? lag_ns - previous : previous - lag_ns;
+  interval_t updated;
+  do {
+    updated = ptdv + (delta - ptdv) / 16;
+  } while (!__atomic_compare_exchange_n(&env->ptdv, &ptdv, updated, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  return updated;
+}
+
 /**
  * Invoke 'reaction' and schedule any resulting triggered reaction(s) on the
  * reaction queue.
@@ -1005,9 +1029,9 @@ static void _lf_worker_invoke_reaction(environment_t* env, int worker_number, re
     rep.reactor_id = -1;
     rep.reaction_id = (reaction != NULL) ? reaction->number : -1;
 
-    // Optional metrics (Phase0.5: unknown -> -1)
-    rep.ready_q_len = -1;
-    rep.deadline_misses = 0;
+    rep.ready_q_len = lf_sched_ready_depth(env->scheduler);
+    rep.deadline_misses = __atomic_load_n(&env->deadline_misses, __ATOMIC_RELAXED);
+    interval_t ptdv = _lf_update_ptdv(env, rep.lag_ns);
 
     ms_report(&rep);
 
@@ -1017,11 +1041,11 @@ static void _lf_worker_invoke_reaction(environment_t* env, int worker_number, re
         (uint64_t)rep.physical_time_ns,
         rep.lag_ns,
         rep.ready_q_len,
-        -1
+        ptdv
     );
 
     ms_os_policy_t policy;
-    if (ms_take_os_policy(worker_number, &policy)) {
+    if (ms_take_os_policy(env->id, worker_number, &policy)) {
       int applied_nice = 0;
       int rc = _ms_os_apply_policy(worker_number, &policy, &applied_nice);
       if (rc == 0) {
@@ -1040,15 +1064,19 @@ static void _lf_worker_invoke_reaction(environment_t* env, int worker_number, re
                reaction->name, env->current_tag.time - start_time, env->current_tag.microstep);
 
   // Notify execution start
-  ms_on_reaction_start(env->id, worker_number, _ms_reaction_stable_key(reaction), (long long)lf_time_physical());
+  ms_on_reaction_start(env->id, worker_number, lf_reaction_stable_key(reaction), (long long)lf_time_physical());
 
   _lf_invoke_reaction(env, reaction, worker_number);
 
   // If the reaction produced outputs, schedule triggered reactions
-  schedule_output_reactions(env, reaction, worker_number);
+  reaction_t* chain = _lf_trigger_output_reactions(env, reaction, worker_number);
 
-  // Notify execution end
-  ms_on_reaction_end(env->id, worker_number, _ms_reaction_stable_key(reaction), (long long)lf_time_physical(), 0);
+  // Notify execution end before the chain, which is accounted for on its own.
+  ms_on_reaction_end(env->id, worker_number, lf_reaction_stable_key(reaction), (long long)lf_time_physical(), 0);
+
+  if (chain != NULL) {
+    _lf_execute_chain(env, chain, worker_number);
+  }
 
   reaction->is_STP_violated = false;
 }
@@ -1079,8 +1107,9 @@ static void _lf_worker_do_work(environment_t* env, int worker_number) {
   // Fall back to the existing scheduler
   while ((current_reaction_to_execute = lf_sched_get_ready_reaction(env->scheduler, worker_number)) != NULL) {
     long long pick = ms_pick_next(env->id, worker_number, (long long)env->current_tag.time);
-    const uint64_t current_key = _ms_reaction_stable_key(current_reaction_to_execute);
-#if !defined(SCHEDULER) || SCHEDULER == SCHED_NP || SCHEDULER == SCHED_GEDF_NP || SCHEDULER == SCHED_ADAPTIVE
+    const uint64_t current_key = lf_reaction_stable_key(current_reaction_to_execute);
+#if !defined(SCHEDULER) || SCHEDULER == SCHED_NP || SCHEDULER == SCHED_GEDF_NP || SCHEDULER == SCHED_GEDF_LEVELED || \
+    SCHEDULER == SCHED_NP_WORK_STEALING || SCHEDULER == SCHED_ADAPTIVE
     if (pick >= 0 && current_reaction_to_execute != NULL &&
         (uint64_t)pick != current_key) {
       reaction_t* picked = lf_sched_requeue_current_and_pick_by_key(
@@ -1112,13 +1141,13 @@ static void _lf_worker_do_work(environment_t* env, int worker_number) {
     }
 #endif // FEDERATED_CENTRALIZED
 
-    bool violation = _lf_worker_handle_violations(env, worker_number, current_reaction_to_execute);
+    bool violation = _lf_handle_violations(env, current_reaction_to_execute, worker_number);
     bool degraded_skip = false;
     if (!violation) {
       degraded_skip = ms_should_skip_reaction(
           env->id,
           worker_number,
-          _ms_reaction_stable_key(current_reaction_to_execute),
+          lf_reaction_stable_key(current_reaction_to_execute),
           (long long)env->current_tag.time
       );
     }
@@ -1396,6 +1425,9 @@ int lf_reactor_c_main(int argc, const char* argv[]) {
   environment_t* envs;
   int num_envs = _lf_get_environments(&envs);
 
+  // Compute stable reaction keys before any worker can ask for them.
+  lf_reaction_keys_init(envs, num_envs);
+
   // Invode initialization of master scheduler
   bool rc = ms_init(NULL);
   if (rc != true) {
@@ -27,7 +27,7 @@
 
 #include "low_level_platform.h"
 #include "environment.h"
-#include "pqueue.h"
+#include "reaction_heap.h"
 #include "reactor_threaded.h"
 #include "scheduler_instance.h"
 #include "scheduler_sync_tag_advance.h"
@@ -36,6 +36,7 @@
 #include "reactor.h"
 #include "util.h"
 #include "master_scheduler.h"
+#include "reaction_key.h"
 
 #ifdef FEDERATED
 #include "federate.h"
@@ -43,37 +44,12 @@
 
 // Data specific to the GEDF scheduler.
 typedef struct custom_scheduler_data_t {
-  pqueue_t* reaction_q;
+  reaction_heap_t reaction_q;
   lf_cond_t reaction_q_changed;
   size_t current_level;
   bool solo_holds_mutex; // Indicates sole thread holds the mutex.
 } custom_scheduler_data_t;
 
-static inline uint64_t _ms_hash_str64(const char* s) {
-  uint64_t h = 1469598103934665603ULL;
-  if (s == NULL) return h;
-  while (*s) {
-    h ^= (uint8_t)(*s++);
-    h *= 1099511628211ULL;
-  }
-  return h;
-}
-
-static inline uint64_t _ms_reaction_stable_key(reaction_t* reaction) {
-  if (reaction == NULL) return 0;
-  const char* instance = NULL;
-  if (reaction->self != NULL) {
-    instance = lf_reactor_full_name((self_base_t*)reaction->self);
-  }
-  if (instance != NULL && instance[0] != '\0') {
-    return _ms_hash_str64(instance) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  if (reaction->name != NULL && reaction->name[0] != '\0') {
-    return _ms_hash_str64(reaction->name) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  return ((uint64_t)(uint32_t)reaction->number << 32) ^ (uint64_t)(uint32_t)LF_LEVEL(reaction->index);
-}
-
 /////////////////// Scheduler Private API /////////////////////////
 
 /**
@@ -158,10 +134,7 @@ void lf_sched_init(environment_t* env, size_t number_of_workers, sched_params_t*
   scheduler->custom_data = (custom_scheduler_data_t*)calloc(1, sizeof(custom_scheduler_data_t));
 
   // Initialize the reaction queue.
-  size_t queue_size = INITIAL_REACT_QUEUE_SIZE;
-  scheduler->custom_data->reaction_q =
-      pqueue_init(queue_size, in_reverse_order, get_reaction_index, get_reaction_position, set_reaction_position,
-                  reaction_matches, print_reaction);
+  scheduler->custom_data->reaction_q = reaction_heap_new(INITIAL_REACT_QUEUE_SIZE);
 
   LF_COND_INIT(&scheduler->custom_data->reaction_q_changed, &env->mutex);
 
@@ -174,7 +147,7 @@ void lf_sched_init(environment_t* env, size_t number_of_workers, sched_params_t*
  * This must be called when the scheduler is no longer needed.
  */
 void lf_sched_free(lf_scheduler_t* scheduler) {
-  pqueue_free((pqueue_t*)scheduler->custom_data->reaction_q);
+  reaction_heap_free(&scheduler->custom_data->reaction_q);
   free(scheduler->custom_data);
 }
 
@@ -188,7 +161,7 @@ reaction_t* lf_sched_get_ready_reaction(lf_scheduler_t* scheduler, int worker_nu
 
   // Iterate until the stop_tag is reached or the event queue is empty.
   while (!scheduler->should_stop) {
-    reaction_t* reaction_to_return = (reaction_t*)pqueue_peek(scheduler->custom_data->reaction_q);
+    reaction_t* reaction_to_return = reaction_heap_peek(&scheduler->custom_data->reaction_q);
     if (reaction_to_return != NULL) {
       // Found a reaction.  Check the level.  Notice that because of deadlines, the current level
       // may advance to the maximum and then back down to 0.
@@ -197,11 +170,11 @@ reaction_t* lf_sched_get_ready_reaction(lf_scheduler_t* scheduler, int worker_nu
         LF_PRINT_DEBUG("Scheduler: Worker %d found a reaction at level %zu.", worker_number,
                        scheduler->custom_data->current_level);
         // Remove the reaction from the queue.
-        pqueue_pop(scheduler->custom_data->reaction_q);
+        reaction_heap_pop(&scheduler->custom_data->reaction_q);
 
         // If there is another reaction at the current level and an idle thread, then
         // notify an idle thread.
-        reaction_t* next_reaction = (reaction_t*)pqueue_peek(scheduler->custom_data->reaction_q);
+        reaction_t* next_reaction = reaction_heap_peek(&scheduler->custom_data->reaction_q);
         if (next_reaction != NULL && LF_LEVEL(next_reaction->index) == scheduler->custom_data->current_level &&
             scheduler->number_of_idle_workers > 0) {
           // Notify an idle thread. Note that we could do a broadcast here, but it's probably not
@@ -267,11 +240,10 @@ reaction_t* lf_sched_requeue_current_and_pick_by_index(
     return current;
   }
 
-  pqueue_t* q = scheduler->custom_data->reaction_q;
+  reaction_heap_t* q = &scheduler->custom_data->reaction_q;
   reaction_t* target = NULL;
-  for (size_t i = 1; i < q->size; i++) {
-    reaction_t* candidate = (reaction_t*)q->d[i];
-    if (candidate == NULL) continue;
+  for (size_t i = 1; i <= reaction_heap_size(q); i++) {
+    reaction_t* candidate = reaction_heap_at(q, i);
     if ((uint64_t)candidate->index == reaction_index &&
         LF_LEVEL(candidate->index) == scheduler->custom_data->current_level) {
       target = candidate;
@@ -280,15 +252,9 @@ reaction_t* lf_sched_requeue_current_and_pick_by_index(
   }
 
   if (target != NULL) {
-    pqueue_remove(q, (void*)target);
-    if (pqueue_insert(q, (void*)current) != 0) {
-      // Keep the queue consistent if requeue fails.
-      pqueue_insert(q, (void*)target);
-      LF_MUTEX_UNLOCK(&scheduler->env->mutex);
-      return current;
-    }
+    reaction_heap_replace(q, target->pos, current, current->index);
 
-    reaction_t* next_reaction = (reaction_t*)pqueue_peek(q);
+    reaction_t* next_reaction = reaction_heap_peek(q);
     if (next_reaction != NULL &&
         LF_LEVEL(next_reaction->index) == scheduler->custom_data->current_level &&
         scheduler->number_of_idle_workers > 0) {
@@ -317,27 +283,30 @@ reaction_t* lf_sched_requeue_current_and_pick_by_key(
     return current;
   }
 
-  pqueue_t* q = scheduler->custom_data->reaction_q;
-  reaction_t* target = NULL;
-  for (size_t i = 1; i < q->size; i++) {
-    reaction_t* candidate = (reaction_t*)q->d[i];
-    if (candidate == NULL) continue;
-    if (_ms_reaction_stable_key(candidate) == reaction_key &&
-        LF_LEVEL(candidate->index) == scheduler->custom_data->current_level) {
-      target = candidate;
-      break;
+  reaction_heap_t* q = &scheduler->custom_data->reaction_q;
+  reaction_t* target = lf_reaction_find_by_key(reaction_key);
+  if (target != NULL) {
+    // The queue tracks each reaction's position, so no scan is needed.
+    if (target->pos == 0 || target->pos > reaction_heap_size(q) || reaction_heap_at(q, target->pos) != target ||
+        LF_LEVEL(target->index) != scheduler->custom_data->current_level) {
+      target = NULL;
+    }
+  } else {
+    // The key is unknown or shared by several reactions. Fall back to a scan.
+    for (size_t i = 1; i <= reaction_heap_size(q); i++) {
+      reaction_t* candidate = reaction_heap_at(q, i);
+      if (lf_reaction_stable_key(candidate) == reaction_key &&
+          LF_LEVEL(candidate->index) == scheduler->custom_data->current_level) {
+        target = candidate;
+        break;
+      }
     }
   }
 
   if (target != NULL) {
-    pqueue_remove(q, (void*)target);
-    if (pqueue_insert(q, (void*)current) != 0) {
-      pqueue_insert(q, (void*)target);
-      LF_MUTEX_UNLOCK(&scheduler->env->mutex);
-      return current;
-    }
+    reaction_heap_replace(q, target->pos, current, current->index);
 
-    reaction_t* next_reaction = (reaction_t*)pqueue_peek(q);
+    reaction_t* next_reaction = reaction_heap_peek(q);
     if (next_reaction != NULL &&
         LF_LEVEL(next_reaction->index) == scheduler->custom_data->current_level &&
         scheduler->number_of_idle_workers > 0) {
@@ -351,6 +320,25 @@ reaction_t* lf_sched_requeue_current_and_pick_by_key(
   return current;
 }
 
+int lf_sched_ready_depth(lf_scheduler_t* scheduler) {
+  if (scheduler == NULL || scheduler->custom_data == NULL) return 0;
+  // The queue is only changed under the environment mutex; a relaxed read of
+  // its size is enough for a metric.
+  return (int)__atomic_load_n(&scheduler->custom_data->reaction_q.size, __ATOMIC_RELAXED);
+}
+
+bool lf_sched_may_execute_now(lf_scheduler_t* scheduler, reaction_t* reaction) {
+  // Skip the lock in the common case of a chain that runs while nothing else waits.
+  if (__atomic_load_n(&scheduler->custom_data->reaction_q.size, __ATOMIC_RELAXED) == 0)
+    return true;
+  LF_MUTEX_LOCK(&scheduler->env->mutex);
+  reaction_t* waiting = reaction_heap_peek(&scheduler->custom_data->reaction_q);
+  bool may_execute =
+      waiting == NULL || LF_INFERRED_DEADLINE(waiting->index) >= LF_INFERRED_DEADLINE(reaction->index);
+  LF_MUTEX_UNLOCK(&scheduler->env->mutex);
+  return may_execute;
+}
+
 void lf_sched_done_with_reaction(size_t worker_number, reaction_t* done_reaction) {
   (void)worker_number; // Suppress unused parameter warning.
   if (!lf_atomic_bool_compare_and_swap((int*)&done_reaction->status, queued, inactive)) {
@@ -371,13 +359,13 @@ void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reacti
     LF_MUTEX_LOCK(&scheduler->env->mutex);
     LF_PRINT_DEBUG("Scheduler: Locked mutex for environment.");
   }
-  pqueue_insert(scheduler->custom_data->reaction_q, (void*)reaction);
+  reaction_heap_insert(&scheduler->custom_data->reaction_q, reaction, reaction->index);
 
   // ---- Phase 1-A: notify "ready" (log-only) ----
   // Use scheduler->env, not "env" (which does not exist here).
   ms_on_reaction_ready(
       scheduler->env->id,
-      _ms_reaction_stable_key(reaction),
+      lf_reaction_stable_key(reaction),
       (long long)scheduler->env->current_tag.time,
       (long long)reaction->deadline,
       (int)reaction->is_an_input_reaction);
@@ -390,7 +378,7 @@ void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reacti
     // But in federated execution, it could be called because of message arrival.
     // Also, in modal models, reset and startup reactions may be triggered.
 #if defined(FEDERATED) || (defined(MODAL) && !defined(LF_SINGLE_THREADED))
-    reaction_t* triggered_reaction = (reaction_t*)pqueue_peek(scheduler->custom_data->reaction_q);
+    reaction_t* triggered_reaction = reaction_heap_peek(&scheduler->custom_data->reaction_q);
     if (LF_LEVEL(triggered_reaction->index) == scheduler->custom_data->current_level) {
       LF_COND_SIGNAL(&scheduler->custom_data->reaction_q_changed);
     }
@@ -0,0 +1,483 @@
+/**
+ * @file
+ *
+ * @brief Leveled Global Earliest Deadline First (GEDF) non-preemptive scheduler for the
+ * threaded runtime of the C target of Lingua Franca.
+ *
+ * Like the GEDF-NP scheduler, this scheduler prioritizes reactions with the smallest (inferred)
+ * deadline. Instead of a single priority queue guarded by the environment mutex, it keeps one
+ * array of triggered reactions per level, as the NP scheduler does. Reactions triggered during
+ * execution land on a higher level, so a level is complete by the time all workers go idle
+ * and the scheduler moves on to it. At that point, the last idle worker sorts the level by
+ * `lf_combine_deadline_and_level` so that the slot popped first holds the earliest deadline.
+ * Workers then claim reactions with an atomic decrement of the level index, without holding
+ * the environment mutex.
+ *
+ * Levels are executed strictly in order, so unlike GEDF-NP, a reaction with an earlier
+ * deadline never runs ahead of a ready reaction at a lower level.
+ */
+#include "lf_types.h"
+
+#if SCHEDULER == SCHED_GEDF_LEVELED
+
+#ifndef NUMBER_OF_WORKERS
+#define NUMBER_OF_WORKERS 1
+#endif // NUMBER_OF_WORKERS
+
+#include <assert.h>
+
+#include "low_level_platform.h"
+#include "environment.h"
+#include "scheduler_instance.h"
+#include "scheduler_sync_tag_advance.h"
+#include "scheduler.h"
+#include "lf_semaphore.h"
+#include "tracepoint.h"
+#include "util.h"
+#include "reactor_threaded.h"
+#include "reactor.h"
+#include "master_scheduler.h"
+#include "reaction_key.h"
+
+#ifdef FEDERATED
+#include "federate.h"
+#endif
+
+// Data specific to the leveled GEDF scheduler.
+typedef struct custom_scheduler_data_t {
+  reaction_t** executing_reactions;
+  lf_mutex_t* array_of_mutexes;
+  reaction_t*** triggered_reactions;
+  volatile size_t next_reaction_level;
+  lf_semaphore_t* semaphore; // Signal the maximum number of worker threads that should
+                             // be executing work at the same time.  Initially 0.
+} custom_scheduler_data_t;
+
+/////////////////// Scheduler Private API /////////////////////////
+
+/**
+ * @brief Insert 'reaction' into scheduler->triggered_reactions at the appropriate level.
+ *
+ * Each insertion claims its own slot with an atomic increment, so concurrent
+ * workers need no lock unless a federate inserts at the level being executed.
+ *
+ * @param reaction The reaction to insert.
+ */
+static inline void _lf_sched_insert_reaction(lf_scheduler_t* scheduler, reaction_t* reaction) {
+  size_t reaction_level = LF_LEVEL(reaction->index);
+#ifdef FEDERATED
+  // Lock the mutex if federated because a federate can insert reactions with
+  // a level equal to the current level. See scheduler_NP.c for why the cached
+  // level cannot lead to a logic error.
+  size_t current_level = scheduler->custom_data->next_reaction_level - 1;
+  if (reaction_level == current_level) {
+    LF_MUTEX_LOCK(&scheduler->custom_data->array_of_mutexes[reaction_level]);
+  }
+  // The level index for the current level can sometimes become negative. Set
+  // it back to zero before adding a reaction.
+  if (scheduler->indexes[reaction_level] < 0) {
+    scheduler->indexes[reaction_level] = 0;
+  }
+#endif
+  int reaction_q_level_index = lf_atomic_fetch_add((int*)&scheduler->indexes[reaction_level], 1);
+  assert(reaction_q_level_index >= 0);
+  LF_PRINT_DEBUG("Scheduler: Inserting at level %zu with index %d.", reaction_level, reaction_q_level_index);
+  reaction->pos = (size_t)reaction_q_level_index;
+  __atomic_store_n(&scheduler->custom_data->triggered_reactions[reaction_level][reaction_q_level_index], reaction,
+                   __ATOMIC_RELEASE);
+#ifdef FEDERATED
+  if (reaction_level == current_level) {
+    LF_MUTEX_UNLOCK(&scheduler->custom_data->array_of_mutexes[reaction_level]);
+  }
+#endif
+}
+
+/**
+ * @brief Sort the first 'count' reactions of a level so that the earliest
+ * deadline is at the highest index, which is the one popped first.
+ *
+ * Levels are usually short, so an insertion sort beats qsort here. The
+ * reactions' positions are updated for lf_sched_requeue_current_and_pick_by_key().
+ */
+static void _lf_sched_sort_level_by_deadline(reaction_t** reactions, int count) {
+  for (int i = 1; i < count; i++) {
+    reaction_t* reaction = reactions[i];
+    int j = i - 1;
+    while (j >= 0 && reactions[j]->index < reaction->index) {
+      reactions[j + 1] = reactions[j];
+      j--;
+    }
+    reactions[j + 1] = reaction;
+  }
+  for (int i = 0; i < count; i++) {
+    reactions[i]->pos = (size_t)i;
+  }
+}
+
+/**
+ * @brief Distribute any reaction that is ready to execute to idle worker
+ * thread(s).
+ *
+ * @return 1 if any reaction is ready. 0 otherwise.
+ */
+static int _lf_sched_distribute_ready_reactions(lf_scheduler_t* scheduler) {
+  // Note: All the threads are idle, which means that they are done inserting
+  // reactions. Therefore, the reaction vectors can be accessed without
+  // locking a mutex.
+  while (scheduler->custom_data->next_reaction_level <= scheduler->max_reaction_level) {
+    size_t level = scheduler->custom_data->next_reaction_level;
+#ifdef FEDERATED
+    lf_stall_advance_level_federation(scheduler->env, level);
+#endif
+    scheduler->custom_data->executing_reactions = scheduler->custom_data->triggered_reactions[level];
+    scheduler->custom_data->next_reaction_level++;
+
+    if (scheduler->indexes[level] > 0) {
+      _lf_sched_sort_level_by_deadline(scheduler->custom_data->executing_reactions, scheduler->indexes[level]);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief If there is work to be done, notify workers individually.
+ *
+ * This assumes that the caller is not holding any thread mutexes.
+ */
+static void _lf_sched_notify_workers(lf_scheduler_t* scheduler) {
+  // Note: All threads are idle. Therefore, there is no need to lock the mutex while accessing the index for the
+  // current level.
+  size_t workers_to_awaken = LF_MIN(scheduler->number_of_idle_workers,
+                                    (size_t)(scheduler->indexes[scheduler->custom_data->next_reaction_level - 1]));
+  LF_PRINT_DEBUG("Scheduler: Notifying %zu workers.", workers_to_awaken);
+
+  scheduler->number_of_idle_workers -= workers_to_awaken;
+
+  if (workers_to_awaken > 1) {
+    // Notify all the workers except the worker thread that has called this
+    // function.
+    lf_semaphore_release(scheduler->custom_data->semaphore, (workers_to_awaken - 1));
+  }
+}
+
+/**
+ * @brief Signal all worker threads that it is time to stop.
+ */
+static void _lf_sched_signal_stop(lf_scheduler_t* scheduler) {
+  scheduler->should_stop = true;
+  lf_semaphore_release(scheduler->custom_data->semaphore, (scheduler->number_of_workers - 1));
+}
+
+/**
+ * @brief Advance tag or distribute reactions to worker threads.
+ *
+ * This function assumes the caller does not hold the mutex lock.
+ */
+static void _lf_scheduler_try_advance_tag_and_distribute(lf_scheduler_t* scheduler) {
+  environment_t* env = scheduler->env;
+  scheduler->indexes[scheduler->custom_data->next_reaction_level - 1] = 0;
+
+  // Loop until it's time to stop or work has been distributed
+  while (true) {
+    if (scheduler->custom_data->next_reaction_level == (scheduler->max_reaction_level + 1)) {
+      scheduler->custom_data->next_reaction_level = 0;
+      LF_MUTEX_LOCK(&env->mutex);
+      // Nothing more happening at this tag.
+      LF_PRINT_DEBUG("Scheduler: Advancing tag.");
+      if (_lf_sched_advance_tag_locked(scheduler)) {
+        LF_PRINT_DEBUG("Scheduler: Reached stop tag.");
+        _lf_sched_signal_stop(scheduler);
+        LF_MUTEX_UNLOCK(&env->mutex);
+        break;
+      }
+      LF_MUTEX_UNLOCK(&env->mutex);
+    }
+
+    if (_lf_sched_distribute_ready_reactions(scheduler) > 0) {
+      _lf_sched_notify_workers(scheduler);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Wait until the scheduler assigns work.
+ *
+ * If the calling worker thread is the last to become idle, it will call on the
+ * scheduler to distribute work. Otherwise, it will wait on
+ * 'scheduler->custom_data->semaphore'.
+ *
+ * @param worker_number The worker number of the worker thread asking for work
+ * to be assigned to it.
+ */
+static void _lf_sched_wait_for_work(lf_scheduler_t* scheduler, size_t worker_number) {
+  if (lf_atomic_add_fetch((int*)&scheduler->number_of_idle_workers, 1) == (int)scheduler->number_of_workers) {
+    // Last thread to go idle
+    LF_PRINT_DEBUG("Scheduler: Worker %zu is the last idle thread.", worker_number);
+    _lf_scheduler_try_advance_tag_and_distribute(scheduler);
+  } else {
+    LF_PRINT_DEBUG("Scheduler: Worker %zu is trying to acquire the scheduling semaphore.", worker_number);
+    lf_semaphore_acquire(scheduler->custom_data->semaphore);
+    LF_PRINT_DEBUG("Scheduler: Worker %zu acquired the scheduling semaphore.", worker_number);
+  }
+}
+
+/**
+ * @brief Swap 'current' into the slot of the first queued reaction at the
+ * current level that satisfies 'matches'.
+ *
+ * Slots are claimed by workers with an atomic exchange, so a compare-and-swap
+ * here either takes the reaction before a worker does or fails and moves on.
+ *
+ * @return The reaction taken out of the queue, or 'current' if none matched.
+ */
+static reaction_t* _lf_sched_requeue_current(lf_scheduler_t* scheduler, reaction_t* current,
+                                             bool (*matches)(reaction_t*, uint64_t), uint64_t value) {
+  if (scheduler == NULL || scheduler->custom_data == NULL || current == NULL)
+    return current;
+
+  size_t current_level = scheduler->custom_data->next_reaction_level - 1;
+#ifdef FEDERATED
+  LF_MUTEX_LOCK(&scheduler->custom_data->array_of_mutexes[current_level]);
+#endif
+  reaction_t** executing = scheduler->custom_data->executing_reactions;
+  reaction_t* target = NULL;
+  // Scan from the top, which is where the earliest deadlines are.
+  for (int i = lf_atomic_fetch_add((int*)&scheduler->indexes[current_level], 0) - 1; i >= 0 && target == NULL; i--) {
+    reaction_t* candidate = __atomic_load_n(&executing[i], __ATOMIC_ACQUIRE);
+    if (candidate == NULL || !matches(candidate, value))
+      continue;
+    current->pos = (size_t)i;
+    if (__atomic_compare_exchange_n(&executing[i], &candidate, current, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      target = candidate;
+    }
+  }
+#ifdef FEDERATED
+  LF_MUTEX_UNLOCK(&scheduler->custom_data->array_of_mutexes[current_level]);
+#endif
+  return (target != NULL) ? target : current;
+}
+
+/**
+ * @brief Swap 'current' into the slot of 'target' if 'target' is still queued
+ * at the current level.
+ *
+ * @return 'target' if the swap happened, 'current' otherwise.
+ */
+static reaction_t* _lf_sched_requeue_current_at(lf_scheduler_t* scheduler, reaction_t* current, reaction_t* target) {
+  if (scheduler->custom_data == NULL || current == NULL)
+    return current;
+  size_t current_level = scheduler->custom_data->next_reaction_level - 1;
+  size_t pos = target->pos;
+  if (LF_LEVEL(target->index) != current_level ||
+      (int)pos >= lf_atomic_fetch_add((int*)&scheduler->indexes[current_level], 0))
+    return current;
+#ifdef FEDERATED
+  LF_MUTEX_LOCK(&scheduler->custom_data->array_of_mutexes[current_level]);
+#endif
+  current->pos = pos;
+  reaction_t* expected = target;
+  bool swapped = __atomic_compare_exchange_n(&scheduler->custom_data->executing_reactions[pos], &expected, current,
+                                             false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#ifdef FEDERATED
+  LF_MUTEX_UNLOCK(&scheduler->custom_data->array_of_mutexes[current_level]);
+#endif
+  return swapped ? target : current;
+}
+
+static bool _lf_sched_index_matches(reaction_t* reaction, uint64_t reaction_index) {
+  return (uint64_t)reaction->index == reaction_index;
+}
+
+static bool _lf_sched_key_matches(reaction_t* reaction, uint64_t reaction_key) {
+  return lf_reaction_stable_key(reaction) == reaction_key;
+}
+
+///////////////////// Scheduler Init and Destroy API /////////////////////////
+
+/**
+ * @brief Initialize the scheduler.
+ *
+ * This has to be called before other functions of the scheduler can be used.
+ * If the scheduler is already initialized, this will be a no-op.
+ *
+ * @param env Environment within which we are executing.
+ * @param number_of_workers Indicate how many workers this scheduler will be
+ *  managing.
+ * @param option Pointer to a `sched_params_t` struct containing additional
+ *  scheduler parameters.
+ */
+void lf_sched_init(environment_t* env, size_t number_of_workers, sched_params_t* params) {
+  assert(env != GLOBAL_ENVIRONMENT);
+
+  LF_PRINT_DEBUG("Env %u: Scheduler: Initializing with %zu workers", env->id, number_of_workers);
+
+  // Like the NP scheduler, this scheduler requires `num_reactions_per_level`
+  // to size the per-level arrays.
+  if (init_sched_instance(env, &env->scheduler, number_of_workers, params)) {
+    if (params == NULL || params->num_reactions_per_level == NULL) {
+      lf_print_warning("Scheduler initialized with no reactions");
+      return;
+    }
+  } else {
+    // Already initialized
+    return;
+  }
+
+  lf_scheduler_t* scheduler = env->scheduler;
+  scheduler->custom_data = (custom_scheduler_data_t*)calloc(1, sizeof(custom_scheduler_data_t));
+  scheduler->custom_data->triggered_reactions =
+      (reaction_t***)calloc((scheduler->max_reaction_level + 1), sizeof(reaction_t**));
+  scheduler->custom_data->array_of_mutexes =
+      (lf_mutex_t*)calloc((scheduler->max_reaction_level + 1), sizeof(lf_mutex_t));
+  scheduler->custom_data->semaphore = lf_semaphore_new(0);
+  scheduler->custom_data->next_reaction_level = 1;
+  scheduler->indexes = (volatile int*)calloc((scheduler->max_reaction_level + 1), sizeof(volatile int));
+
+  for (size_t i = 0; i <= scheduler->max_reaction_level; i++) {
+    size_t queue_size = params->num_reactions_per_level[i];
+    scheduler->custom_data->triggered_reactions[i] = (reaction_t**)calloc(queue_size, sizeof(reaction_t*));
+    LF_PRINT_DEBUG("Scheduler: Initialized vector of reactions for level %zu with size %zu", i, queue_size);
+    LF_MUTEX_INIT(&scheduler->custom_data->array_of_mutexes[i]);
+  }
+  scheduler->custom_data->executing_reactions = scheduler->custom_data->triggered_reactions[0];
+}
+
+/**
+ * @brief Free the memory used by the scheduler.
+ *
+ * This must be called when the scheduler is no longer needed.
+ */
+void lf_sched_free(lf_scheduler_t* scheduler) {
+  if (scheduler->custom_data != NULL) {
+    if (scheduler->custom_data->triggered_reactions) {
+      for (size_t j = 0; j <= scheduler->max_reaction_level; j++) {
+        free(scheduler->custom_data->triggered_reactions[j]);
+      }
+      free(scheduler->custom_data->triggered_reactions);
+    }
+    free(scheduler->custom_data->array_of_mutexes);
+    lf_semaphore_destroy(scheduler->custom_data->semaphore);
+    free(scheduler->custom_data);
+  }
+}
+
+///////////////////// Scheduler Worker API (public) /////////////////////////
+
+reaction_t* lf_sched_get_ready_reaction(lf_scheduler_t* scheduler, int worker_number) {
+  // If the enclave has no reactions, return NULL.
+  if (scheduler->custom_data == NULL)
+    return NULL;
+
+  // Iterate until the stop tag is reached or reaction vectors are empty
+  while (!scheduler->should_stop) {
+    size_t current_level = scheduler->custom_data->next_reaction_level - 1;
+    reaction_t* reaction_to_return = NULL;
+#ifdef FEDERATED
+    // Need to lock the mutex because federate.c could trigger reactions at
+    // the current level (if there is a causality loop)
+    LF_MUTEX_LOCK(&scheduler->custom_data->array_of_mutexes[current_level]);
+#endif
+    int current_level_q_index = lf_atomic_add_fetch((int*)&scheduler->indexes[current_level], -1);
+    if (current_level_q_index >= 0) {
+      LF_PRINT_DEBUG("Scheduler: Worker %d popping reaction with level %zu, index for level: %d.", worker_number,
+                     current_level, current_level_q_index);
+      // Exchange rather than load so that a concurrent requeue cannot hand out the same reaction twice.
+      reaction_to_return =
+          __atomic_exchange_n(&scheduler->custom_data->executing_reactions[current_level_q_index], NULL,
+                              __ATOMIC_ACQ_REL);
+    }
+#ifdef FEDERATED
+    LF_MUTEX_UNLOCK(&scheduler->custom_data->array_of_mutexes[current_level]);
+#endif
+
+    if (reaction_to_return != NULL) {
+      return reaction_to_return;
+    }
+
+    LF_PRINT_DEBUG("Worker %d is out of ready reactions.", worker_number);
+
+    // Ask the scheduler for more work and wait
+    tracepoint_worker_wait_starts(scheduler->env, worker_number);
+    _lf_sched_wait_for_work(scheduler, worker_number);
+    tracepoint_worker_wait_ends(scheduler->env, worker_number);
+  }
+
+  // It's time for the worker thread to stop and exit.
+  return NULL;
+}
+
+reaction_t* lf_sched_requeue_current_and_pick_by_index(
+    lf_scheduler_t* scheduler,
+    int worker_number,
+    reaction_t* current,
+    uint64_t reaction_index
+) {
+  (void)worker_number; // Reserved for future use.
+  return _lf_sched_requeue_current(scheduler, current, _lf_sched_index_matches, reaction_index);
+}
+
+reaction_t* lf_sched_requeue_current_and_pick_by_key(
+    lf_scheduler_t* scheduler,
+    int worker_number,
+    reaction_t* current,
+    uint64_t reaction_key
+) {
+  (void)worker_number; // Reserved for future use.
+  if (scheduler == NULL)
+    return current;
+  reaction_t* target = lf_reaction_find_by_key(reaction_key);
+  if (target != NULL)
+    return _lf_sched_requeue_current_at(scheduler, current, target);
+  // The key is unknown or shared by several reactions. Fall back to a scan.
+  return _lf_sched_requeue_current(scheduler, current, _lf_sched_key_matches, reaction_key);
+}
+
+int lf_sched_ready_depth(lf_scheduler_t* scheduler) {
+  if (scheduler == NULL || scheduler->custom_data == NULL) return 0;
+  // Inserts and pops only touch the per-level indexes, so sum them rather than
+  // add a shared counter to the lock-free paths. The current level's index goes
+  // negative once it is drained.
+  size_t next_level = __atomic_load_n(&scheduler->custom_data->next_reaction_level, __ATOMIC_RELAXED);
+  int depth = 0;
+  for (size_t level = (next_level > 0) ? next_level - 1 : 0; level <= scheduler->max_reaction_level; level++) {
+    int count = __atomic_load_n(&scheduler->indexes[level], __ATOMIC_RELAXED);
+    if (count > 0) depth += count;
+  }
+  return depth;
+}
+
+bool lf_sched_may_execute_now(lf_scheduler_t* scheduler, reaction_t* reaction) {
+  // The current level is sorted so that its earliest deadline is popped first,
+  // from the top. As in lf_sched_ready_depth(), a stale read only gives a stale answer.
+  size_t next_level = __atomic_load_n(&scheduler->custom_data->next_reaction_level, __ATOMIC_RELAXED);
+  size_t current_level = (next_level > 0) ? next_level - 1 : 0;
+  int top = __atomic_load_n(&scheduler->indexes[current_level], __ATOMIC_ACQUIRE) - 1;
+  if (top < 0)
+    return true;
+  reaction_t* waiting = __atomic_load_n(&scheduler->custom_data->executing_reactions[top], __ATOMIC_ACQUIRE);
+  return waiting == NULL || LF_INFERRED_DEADLINE(waiting->index) >= LF_INFERRED_DEADLINE(reaction->index);
+}
+
+void lf_sched_done_with_reaction(size_t worker_number, reaction_t* done_reaction) {
+  (void)worker_number; // Suppress unused parameter warning.
+  if (!lf_atomic_bool_compare_and_swap((int*)&done_reaction->status, queued, inactive)) {
+    lf_print_error_and_exit("Unexpected reaction status: %d. Expected %d.", done_reaction->status, queued);
+  }
+}
+
+void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reaction, int worker_number) {
+  (void)worker_number; // Suppress unused parameter warning.
+  if (reaction == NULL || !lf_atomic_bool_compare_and_swap((int*)&reaction->status, inactive, queued)) {
+    return;
+  }
+  LF_PRINT_DEBUG("Scheduler: Enqueueing reaction %s, which has level %lld.", reaction->name, LF_LEVEL(reaction->index));
+  _lf_sched_insert_reaction(scheduler, reaction);
+
+  ms_on_reaction_ready(scheduler->env->id, lf_reaction_stable_key(reaction),
+                       (long long)scheduler->env->current_tag.time, (long long)reaction->deadline,
+                       (int)reaction->is_an_input_reaction);
+}
+#endif // SCHEDULER == SCHED_GEDF_LEVELED
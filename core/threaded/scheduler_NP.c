@@ -8,7 +8,9 @@
  */
 #include "lf_types.h"
 
-#if SCHEDULER == SCHED_NP || !defined(SCHEDULER)
+// The work-stealing variant relies on nothing being triggered at the executing
+// level, which federated execution does not guarantee, so it falls back to NP.
+#if SCHEDULER == SCHED_NP || !defined(SCHEDULER) || (SCHEDULER == SCHED_NP_WORK_STEALING && defined(FEDERATED))
 
 #ifndef NUMBER_OF_WORKERS
 #define NUMBER_OF_WORKERS 1
@@ -27,6 +29,7 @@
 #include "reactor_threaded.h"
 #include "reactor.h"
 #include "master_scheduler.h"
+#include "reaction_key.h"
 
 #ifdef FEDERATED
 #include "federate.h"
@@ -43,33 +46,9 @@ typedef struct custom_scheduler_data_t {
                              // For example, if the scheduler releases the semaphore with a count of 4,
                              // no more than 4 worker threads should wake up to process reactions.
   lf_mutex_t reaction_q_lock;
+  int ready_depth; // Reactions triggered at this tag and not yet popped. Guarded by reaction_q_lock.
 } custom_scheduler_data_t;
 
-static inline uint64_t _ms_hash_str64(const char* s) {
-  uint64_t h = 1469598103934665603ULL;
-  if (s == NULL) return h;
-  while (*s) {
-    h ^= (uint8_t)(*s++);
-    h *= 1099511628211ULL;
-  }
-  return h;
-}
-
-static inline uint64_t _ms_reaction_stable_key(reaction_t* reaction) {
-  if (reaction == NULL) return 0;
-  const char* instance = NULL;
-  if (reaction->self != NULL) {
-    instance = lf_reactor_full_name((self_base_t*)reaction->self);
-  }
-  if (instance != NULL && instance[0] != '\0') {
-    return _ms_hash_str64(instance) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  if (reaction->name != NULL && reaction->name[0] != '\0') {
-    return _ms_hash_str64(reaction->name) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  return ((uint64_t)(uint32_t)reaction->number << 32) ^ (uint64_t)(uint32_t)LF_LEVEL(reaction->index);
-}
-
 /////////////////// Scheduler Private API /////////////////////////
 
 /**
@@ -110,6 +89,9 @@ static inline void _lf_sched_insert_reaction(lf_scheduler_t* scheduler, reaction
   LF_PRINT_DEBUG("Scheduler: Accessing triggered reactions at the level %zu with index %d.", reaction_level,
                  reaction_q_level_index);
   ((reaction_t***)scheduler->custom_data->triggered_reactions)[reaction_level][reaction_q_level_index] = reaction;
+  // Remember the slot so that a master scheduler override can find the reaction without a scan.
+  reaction->pos = (size_t)reaction_q_level_index;
+  __atomic_store_n(&scheduler->custom_data->ready_depth, scheduler->custom_data->ready_depth + 1, __ATOMIC_RELAXED);
   LF_PRINT_DEBUG("Scheduler: Index for level %zu is at %d.", reaction_level, reaction_q_level_index);
 #ifdef FEDERATED
   if (reaction_level == current_level) {
@@ -366,6 +348,8 @@ reaction_t* lf_sched_get_ready_reaction(lf_scheduler_t* scheduler, int worker_nu
                      worker_number, current_level, current_level_q_index);
       reaction_to_return = scheduler->custom_data->executing_reactions[current_level_q_index];
       scheduler->custom_data->executing_reactions[current_level_q_index] = NULL;
+      __atomic_store_n(&scheduler->custom_data->ready_depth, scheduler->custom_data->ready_depth - 1,
+                       __ATOMIC_RELAXED);
     }
 #ifdef FEDERATED
     lf_mutex_unlock(&scheduler->custom_data->array_of_mutexes[current_level]);
@@ -414,6 +398,7 @@ reaction_t* lf_sched_requeue_current_and_pick_by_index(
       if ((uint64_t)candidate->index == reaction_index) {
         target = candidate;
         executing[i] = current;
+        current->pos = (size_t)i;
         break;
       }
     }
@@ -443,14 +428,26 @@ reaction_t* lf_sched_requeue_current_and_pick_by_key(
 
   reaction_t** executing = scheduler->custom_data->executing_reactions;
   int max_index = scheduler->indexes[current_level];
-  reaction_t* target = NULL;
-  if (max_index >= 0) {
+  reaction_t* target = lf_reaction_find_by_key(reaction_key);
+  if (target != NULL) {
+    // Swap in place if the target is still queued at the current level.
+    size_t pos = target->pos;
+    if (LF_LEVEL(target->index) == current_level && max_index > 0 && pos < (size_t)max_index &&
+        executing[pos] == target) {
+      executing[pos] = current;
+      current->pos = pos;
+    } else {
+      target = NULL;
+    }
+  } else if (max_index >= 0) {
+    // The key is unknown or shared by several reactions. Fall back to a scan.
     for (int i = 0; i <= max_index; i++) {
       reaction_t* candidate = executing[i];
       if (candidate == NULL) continue;
-      if (_ms_reaction_stable_key(candidate) == reaction_key) {
+      if (lf_reaction_stable_key(candidate) == reaction_key) {
         target = candidate;
         executing[i] = current;
+        current->pos = (size_t)i;
         break;
       }
     }
@@ -463,6 +460,18 @@ reaction_t* lf_sched_requeue_current_and_pick_by_key(
   return (target != NULL) ? target : current;
 }
 
+int lf_sched_ready_depth(lf_scheduler_t* scheduler) {
+  if (scheduler == NULL || scheduler->custom_data == NULL) return 0;
+  return __atomic_load_n(&scheduler->custom_data->ready_depth, __ATOMIC_RELAXED);
+}
+
+bool lf_sched_may_execute_now(lf_scheduler_t* scheduler, reaction_t* reaction) {
+  (void)scheduler;
+  (void)reaction;
+  // This scheduler does not order reactions by deadline.
+  return true;
+}
+
 /**
  * @brief Inform the scheduler that worker thread 'worker_number' is done
  * executing the 'done_reaction'.
@@ -508,9 +517,9 @@ void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reacti
 
   ms_on_reaction_ready(
       scheduler->env->id,
-      _ms_reaction_stable_key(reaction),
+      lf_reaction_stable_key(reaction),
       (long long)scheduler->env->current_tag.time,
       (long long)reaction->deadline,
       (int)reaction->is_an_input_reaction);
 }
-#endif // SCHEDULER == SCHED_NP || !defined(SCHEDULER)
+#endif // SCHEDULER == SCHED_NP || !defined(SCHEDULER) || ...
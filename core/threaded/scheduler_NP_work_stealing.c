@@ -0,0 +1,533 @@
+/**
+ * @file
+ *
+ * @brief Work-stealing non-preemptive scheduler for the threaded runtime of the C target of Lingua Franca.
+ *
+ * This scheduler executes levels in order with the same barrier as the NP scheduler. Instead of one
+ * array per level shared by all workers, each worker owns a Chase-Lev deque per level. A reaction
+ * triggered by a worker is pushed onto that worker's deque, and the worker pops it again once its level
+ * is reached, which keeps chains of reactions on the same core. A worker that runs dry steals from the
+ * other deques before going idle. No lock is taken on the fast path.
+ *
+ * Reactions triggered from outside a worker (worker number -1, e.g. at tag advance) go to an extra
+ * shared deque that every worker steals from.
+ *
+ * Because triggered reactions always have a higher level than the one executing, nothing is pushed onto
+ * a level while it is being popped. That is what lets a requeue swap a slot in place, and it does not
+ * hold in federated execution, where a network input can trigger a reaction at the current level.
+ * Federated programs therefore get the NP scheduler (see scheduler_NP.c).
+ */
+#include "lf_types.h"
+
+#if SCHEDULER == SCHED_NP_WORK_STEALING && !defined(FEDERATED)
+
+#ifndef NUMBER_OF_WORKERS
+#define NUMBER_OF_WORKERS 1
+#endif // NUMBER_OF_WORKERS
+
+#include <assert.h>
+#include <limits.h>
+
+#include "low_level_platform.h"
+#include "environment.h"
+#include "scheduler_instance.h"
+#include "scheduler_sync_tag_advance.h"
+#include "scheduler.h"
+#include "lf_semaphore.h"
+#include "tracepoint.h"
+#include "util.h"
+#include "reactor_threaded.h"
+#include "reactor.h"
+#include "master_scheduler.h"
+#include "reaction_key.h"
+
+/**
+ * @brief A Chase-Lev deque of the reactions at one level owned by one worker.
+ *
+ * The owner pushes and pops at the bottom; other workers steal from the top.
+ * The buffer holds every reaction of the level, so it never needs to grow.
+ */
+typedef struct ws_deque_t {
+  long top;
+  char pad[64 - sizeof(long)]; // Keep thieves off the owner's cache line.
+  long bottom;
+  reaction_t** buffer;
+  size_t capacity;
+} ws_deque_t;
+
+// Data specific to the work-stealing NP scheduler.
+typedef struct custom_scheduler_data_t {
+  ws_deque_t* deques;     // Indexed by level * num_deques + worker; the last deque of a level is shared.
+  size_t num_deques;      // number_of_workers + 1.
+  lf_mutex_t shared_lock; // Serializes pushes onto the shared deques.
+  volatile size_t next_reaction_level;
+  lf_semaphore_t* semaphore; // Signal the maximum number of worker threads that should
+                             // be executing work at the same time.  Initially 0.
+} custom_scheduler_data_t;
+
+/////////////////// Scheduler Private API /////////////////////////
+
+static inline ws_deque_t* _lf_sched_deque(lf_scheduler_t* scheduler, size_t level, size_t owner) {
+  return &scheduler->custom_data->deques[level * scheduler->custom_data->num_deques + owner];
+}
+
+// A reaction's position packs the owner of its deque into the upper half and its slot into the lower half.
+#define WS_POS_BITS (sizeof(size_t) * CHAR_BIT / 2)
+#define WS_POS_LIMIT ((size_t)1 << WS_POS_BITS)
+#define WS_POS(owner, slot) (((size_t)(owner) << WS_POS_BITS) | (size_t)(slot))
+#define WS_POS_OWNER(pos) ((size_t)(pos) >> WS_POS_BITS)
+#define WS_POS_SLOT(pos) ((size_t)(pos) & (WS_POS_LIMIT - 1))
+
+/**
+ * @brief Push 'reaction' onto the bottom of 'deque', which belongs to 'owner'.
+ * Only the owner may call this.
+ */
+static void _lf_sched_deque_push(ws_deque_t* deque, size_t owner, reaction_t* reaction) {
+  long b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+  if ((size_t)b >= deque->capacity) {
+    lf_print_error_and_exit("Scheduler: Level holds more than %zu reactions.", deque->capacity);
+  }
+  reaction->pos = WS_POS(owner, b);
+  __atomic_store_n(&deque->buffer[b], reaction, __ATOMIC_RELAXED);
+  __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take the slot 'index' once it has been claimed through top or bottom.
+ *
+ * The exchange, rather than a load, lets a concurrent requeue swap the slot
+ * without the same reaction being handed out twice.
+ */
+static inline reaction_t* _lf_sched_deque_take(ws_deque_t* deque, long index) {
+  return __atomic_exchange_n(&deque->buffer[index], NULL, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @brief Pop a reaction from the bottom of 'deque'. Only the owner may call this.
+ * @return The reaction, or NULL if the deque is empty.
+ */
+static reaction_t* _lf_sched_deque_pop(ws_deque_t* deque) {
+  long b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&deque->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+  if (t > b) {
+    // Empty.
+    __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+    return NULL;
+  }
+  if (t < b)
+    return _lf_sched_deque_take(deque, b);
+  // Last element: race the thieves for it.
+  bool won = __atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+  __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+  return won ? _lf_sched_deque_take(deque, b) : NULL;
+}
+
+/**
+ * @brief Steal a reaction from the top of 'deque'.
+ * @param contended Set to true if the deque was not empty but another worker won the race.
+ * @return The reaction, or NULL if none was stolen.
+ */
+static reaction_t* _lf_sched_deque_steal(ws_deque_t* deque, bool* contended) {
+  long t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+  if (t >= b)
+    return NULL;
+  if (!__atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    *contended = true;
+    return NULL;
+  }
+  return _lf_sched_deque_take(deque, t);
+}
+
+/**
+ * @brief Pop from the worker's own deque at the current level, or steal from the others.
+ *
+ * Nothing is pushed onto the current level while it executes, so once every deque
+ * is seen empty without contention, the level is done.
+ */
+static reaction_t* _lf_sched_find_reaction(lf_scheduler_t* scheduler, size_t level, int worker_number) {
+  size_t num_deques = scheduler->custom_data->num_deques;
+  size_t self = (worker_number >= 0 && (size_t)worker_number < num_deques - 1) ? (size_t)worker_number : 0;
+  reaction_t* reaction = _lf_sched_deque_pop(_lf_sched_deque(scheduler, level, self));
+  bool contended = true;
+  while (reaction == NULL && contended) {
+    contended = false;
+    for (size_t i = 1; i < num_deques && reaction == NULL; i++) {
+      reaction = _lf_sched_deque_steal(_lf_sched_deque(scheduler, level, (self + i) % num_deques), &contended);
+    }
+  }
+  return reaction;
+}
+
+/**
+ * @brief Return the number of reactions queued at 'level'. All workers must be idle.
+ */
+static size_t _lf_sched_level_size(lf_scheduler_t* scheduler, size_t level) {
+  size_t size = 0;
+  for (size_t i = 0; i < scheduler->custom_data->num_deques; i++) {
+    ws_deque_t* deque = _lf_sched_deque(scheduler, level, i);
+    size += (size_t)(deque->bottom - deque->top);
+  }
+  return size;
+}
+
+/**
+ * @brief Distribute any reaction that is ready to execute to idle worker
+ * thread(s).
+ *
+ * @return The number of reactions at the new current level, 0 if there are none.
+ */
+static size_t _lf_sched_distribute_ready_reactions(lf_scheduler_t* scheduler) {
+  // Note: All the threads are idle, which means that they are done inserting
+  // reactions. Therefore, the deques can be accessed without synchronization.
+  while (scheduler->custom_data->next_reaction_level <= scheduler->max_reaction_level) {
+    size_t size = _lf_sched_level_size(scheduler, scheduler->custom_data->next_reaction_level);
+    scheduler->custom_data->next_reaction_level++;
+    if (size > 0) {
+      return size;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Wake up enough workers for 'ready' reactions, counting the caller.
+ *
+ * This assumes that the caller is not holding any thread mutexes.
+ */
+static void _lf_sched_notify_workers(lf_scheduler_t* scheduler, size_t ready) {
+  size_t workers_to_awaken = LF_MIN(scheduler->number_of_idle_workers, ready);
+  LF_PRINT_DEBUG("Scheduler: Notifying %zu workers.", workers_to_awaken);
+
+  scheduler->number_of_idle_workers -= workers_to_awaken;
+
+  if (workers_to_awaken > 1) {
+    // Notify all the workers except the worker thread that has called this
+    // function.
+    lf_semaphore_release(scheduler->custom_data->semaphore, (workers_to_awaken - 1));
+  }
+}
+
+/**
+ * @brief Signal all worker threads that it is time to stop.
+ */
+static void _lf_sched_signal_stop(lf_scheduler_t* scheduler) {
+  scheduler->should_stop = true;
+  lf_semaphore_release(scheduler->custom_data->semaphore, (scheduler->number_of_workers - 1));
+}
+
+/**
+ * @brief Advance tag or distribute reactions to worker threads.
+ *
+ * This function assumes the caller does not hold the mutex lock.
+ */
+static void _lf_scheduler_try_advance_tag_and_distribute(lf_scheduler_t* scheduler) {
+  environment_t* env = scheduler->env;
+  // Reset the deques of the level that just finished.
+  size_t finished_level = scheduler->custom_data->next_reaction_level - 1;
+  for (size_t i = 0; i < scheduler->custom_data->num_deques; i++) {
+    ws_deque_t* deque = _lf_sched_deque(scheduler, finished_level, i);
+    deque->top = 0;
+    deque->bottom = 0;
+  }
+
+  // Loop until it's time to stop or work has been distributed
+  while (true) {
+    if (scheduler->custom_data->next_reaction_level == (scheduler->max_reaction_level + 1)) {
+      scheduler->custom_data->next_reaction_level = 0;
+      LF_MUTEX_LOCK(&env->mutex);
+      // Nothing more happening at this tag.
+      LF_PRINT_DEBUG("Scheduler: Advancing tag.");
+      if (_lf_sched_advance_tag_locked(scheduler)) {
+        LF_PRINT_DEBUG("Scheduler: Reached stop tag.");
+        _lf_sched_signal_stop(scheduler);
+        LF_MUTEX_UNLOCK(&env->mutex);
+        break;
+      }
+      LF_MUTEX_UNLOCK(&env->mutex);
+    }
+
+    size_t ready = _lf_sched_distribute_ready_reactions(scheduler);
+    if (ready > 0) {
+      _lf_sched_notify_workers(scheduler, ready);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Wait until the scheduler assigns work.
+ *
+ * If the calling worker thread is the last to become idle, it will call on the
+ * scheduler to distribute work. Otherwise, it will wait on
+ * 'scheduler->custom_data->semaphore'.
+ *
+ * @param worker_number The worker number of the worker thread asking for work
+ * to be assigned to it.
+ */
+static void _lf_sched_wait_for_work(lf_scheduler_t* scheduler, size_t worker_number) {
+  if (lf_atomic_add_fetch((int*)&scheduler->number_of_idle_workers, 1) == (int)scheduler->number_of_workers) {
+    // Last thread to go idle
+    LF_PRINT_DEBUG("Scheduler: Worker %zu is the last idle thread.", worker_number);
+    _lf_scheduler_try_advance_tag_and_distribute(scheduler);
+  } else {
+    LF_PRINT_DEBUG("Scheduler: Worker %zu is trying to acquire the scheduling semaphore.", worker_number);
+    lf_semaphore_acquire(scheduler->custom_data->semaphore);
+    LF_PRINT_DEBUG("Scheduler: Worker %zu acquired the scheduling semaphore.", worker_number);
+  }
+}
+
+/**
+ * @brief Swap 'current' into the slot of the first queued reaction at the
+ * current level that satisfies 'matches'.
+ *
+ * A compare-and-swap either takes the reaction before a worker claims the slot
+ * or fails and moves on. The caller's own deque is searched first.
+ *
+ * @return The reaction taken out of the queue, or 'current' if none matched.
+ */
+static reaction_t* _lf_sched_requeue_current(lf_scheduler_t* scheduler, int worker_number, reaction_t* current,
+                                             bool (*matches)(reaction_t*, uint64_t), uint64_t value) {
+  if (scheduler == NULL || scheduler->custom_data == NULL || current == NULL)
+    return current;
+
+  size_t level = scheduler->custom_data->next_reaction_level - 1;
+  size_t num_deques = scheduler->custom_data->num_deques;
+  size_t self = (worker_number >= 0 && (size_t)worker_number < num_deques - 1) ? (size_t)worker_number : 0;
+  for (size_t i = 0; i < num_deques; i++) {
+    size_t owner = (self + i) % num_deques;
+    ws_deque_t* deque = _lf_sched_deque(scheduler, level, owner);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    for (long j = top; j < bottom; j++) {
+      reaction_t* candidate = __atomic_load_n(&deque->buffer[j], __ATOMIC_ACQUIRE);
+      if (candidate == NULL || !matches(candidate, value))
+        continue;
+      current->pos = WS_POS(owner, j);
+      if (__atomic_compare_exchange_n(&deque->buffer[j], &candidate, current, false, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE)) {
+        return candidate;
+      }
+    }
+  }
+  return current;
+}
+
+/**
+ * @brief Swap 'current' into the slot of 'target' if 'target' is still queued
+ * at the current level.
+ *
+ * Slots are not reused while their level executes, so the slot recorded at
+ * push time is either still 'target' or has been claimed.
+ *
+ * @return 'target' if the swap happened, 'current' otherwise.
+ */
+static reaction_t* _lf_sched_requeue_current_at(lf_scheduler_t* scheduler, reaction_t* current, reaction_t* target) {
+  if (scheduler->custom_data == NULL || current == NULL)
+    return current;
+  size_t level = scheduler->custom_data->next_reaction_level - 1;
+  size_t owner = WS_POS_OWNER(target->pos);
+  size_t slot = WS_POS_SLOT(target->pos);
+  if (LF_LEVEL(target->index) != level || owner >= scheduler->custom_data->num_deques)
+    return current;
+  ws_deque_t* deque = _lf_sched_deque(scheduler, level, owner);
+  if (slot >= deque->capacity)
+    return current;
+  current->pos = target->pos;
+  reaction_t* expected = target;
+  if (__atomic_compare_exchange_n(&deque->buffer[slot], &expected, current, false, __ATOMIC_ACQ_REL,
+                                  __ATOMIC_ACQUIRE)) {
+    return target;
+  }
+  return current;
+}
+
+static bool _lf_sched_index_matches(reaction_t* reaction, uint64_t reaction_index) {
+  return (uint64_t)reaction->index == reaction_index;
+}
+
+static bool _lf_sched_key_matches(reaction_t* reaction, uint64_t reaction_key) {
+  return lf_reaction_stable_key(reaction) == reaction_key;
+}
+
+///////////////////// Scheduler Init and Destroy API /////////////////////////
+
+/**
+ * @brief Initialize the scheduler.
+ *
+ * This has to be called before other functions of the scheduler can be used.
+ * If the scheduler is already initialized, this will be a no-op.
+ *
+ * @param env Environment within which we are executing.
+ * @param number_of_workers Indicate how many workers this scheduler will be
+ *  managing.
+ * @param option Pointer to a `sched_params_t` struct containing additional
+ *  scheduler parameters.
+ */
+void lf_sched_init(environment_t* env, size_t number_of_workers, sched_params_t* params) {
+  assert(env != GLOBAL_ENVIRONMENT);
+
+  LF_PRINT_DEBUG("Env %u: Scheduler: Initializing with %zu workers", env->id, number_of_workers);
+
+  // Like the NP scheduler, this scheduler requires `num_reactions_per_level`
+  // to size the deques.
+  if (init_sched_instance(env, &env->scheduler, number_of_workers, params)) {
+    if (params == NULL || params->num_reactions_per_level == NULL) {
+      lf_print_warning("Scheduler initialized with no reactions");
+      return;
+    }
+  } else {
+    // Already initialized
+    return;
+  }
+
+  lf_scheduler_t* scheduler = env->scheduler;
+  // Owners and slots have to fit into a reaction's position.
+  if (number_of_workers + 1 > WS_POS_LIMIT) {
+    lf_print_error_and_exit("Scheduler: More than %zu workers.", WS_POS_LIMIT - 1);
+  }
+  for (size_t level = 0; level <= scheduler->max_reaction_level; level++) {
+    if (params->num_reactions_per_level[level] > WS_POS_LIMIT) {
+      lf_print_error_and_exit("Scheduler: Level holds more than %zu reactions.", WS_POS_LIMIT);
+    }
+  }
+  scheduler->custom_data = (custom_scheduler_data_t*)calloc(1, sizeof(custom_scheduler_data_t));
+  scheduler->custom_data->num_deques = number_of_workers + 1;
+  scheduler->custom_data->deques =
+      (ws_deque_t*)calloc((scheduler->max_reaction_level + 1) * scheduler->custom_data->num_deques, sizeof(ws_deque_t));
+  for (size_t level = 0; level <= scheduler->max_reaction_level; level++) {
+    size_t capacity = params->num_reactions_per_level[level];
+    for (size_t i = 0; i < scheduler->custom_data->num_deques; i++) {
+      ws_deque_t* deque = _lf_sched_deque(scheduler, level, i);
+      deque->buffer = (reaction_t**)calloc(capacity, sizeof(reaction_t*));
+      deque->capacity = capacity;
+    }
+  }
+  LF_MUTEX_INIT(&scheduler->custom_data->shared_lock);
+  scheduler->custom_data->semaphore = lf_semaphore_new(0);
+  scheduler->custom_data->next_reaction_level = 1;
+}
+
+/**
+ * @brief Free the memory used by the scheduler.
+ *
+ * This must be called when the scheduler is no longer needed.
+ */
+void lf_sched_free(lf_scheduler_t* scheduler) {
+  if (scheduler->custom_data != NULL) {
+    size_t num_deques = (scheduler->max_reaction_level + 1) * scheduler->custom_data->num_deques;
+    for (size_t i = 0; i < num_deques; i++) {
+      free(scheduler->custom_data->deques[i].buffer);
+    }
+    free(scheduler->custom_data->deques);
+    LF_MUTEX_DESTROY(&scheduler->custom_data->shared_lock);
+    lf_semaphore_destroy(scheduler->custom_data->semaphore);
+    free(scheduler->custom_data);
+  }
+}
+
+///////////////////// Scheduler Worker API (public) /////////////////////////
+
+reaction_t* lf_sched_get_ready_reaction(lf_scheduler_t* scheduler, int worker_number) {
+  // If the enclave has no reactions, return NULL.
+  if (scheduler->custom_data == NULL)
+    return NULL;
+
+  // Iterate until the stop tag is reached or the deques are empty
+  while (!scheduler->should_stop) {
+    size_t current_level = scheduler->custom_data->next_reaction_level - 1;
+    reaction_t* reaction_to_return = _lf_sched_find_reaction(scheduler, current_level, worker_number);
+    if (reaction_to_return != NULL) {
+      return reaction_to_return;
+    }
+
+    LF_PRINT_DEBUG("Worker %d is out of ready reactions.", worker_number);
+
+    // Ask the scheduler for more work and wait
+    tracepoint_worker_wait_starts(scheduler->env, worker_number);
+    _lf_sched_wait_for_work(scheduler, worker_number);
+    tracepoint_worker_wait_ends(scheduler->env, worker_number);
+  }
+
+  // It's time for the worker thread to stop and exit.
+  return NULL;
+}
+
+reaction_t* lf_sched_requeue_current_and_pick_by_index(
+    lf_scheduler_t* scheduler,
+    int worker_number,
+    reaction_t* current,
+    uint64_t reaction_index
+) {
+  return _lf_sched_requeue_current(scheduler, worker_number, current, _lf_sched_index_matches, reaction_index);
+}
+
+reaction_t* lf_sched_requeue_current_and_pick_by_key(
+    lf_scheduler_t* scheduler,
+    int worker_number,
+    reaction_t* current,
+    uint64_t reaction_key
+) {
+  if (scheduler == NULL)
+    return current;
+  reaction_t* target = lf_reaction_find_by_key(reaction_key);
+  if (target != NULL)
+    return _lf_sched_requeue_current_at(scheduler, current, target);
+  // The key is unknown or shared by several reactions. Fall back to a scan.
+  return _lf_sched_requeue_current(scheduler, worker_number, current, _lf_sched_key_matches, reaction_key);
+}
+
+int lf_sched_ready_depth(lf_scheduler_t* scheduler) {
+  if (scheduler == NULL || scheduler->custom_data == NULL) return 0;
+  // Sum the deque sizes from the current level up; see _lf_sched_level_size().
+  // The reads are not a snapshot, so concurrent pops and steals may make a
+  // deque look briefly empty or one reaction larger.
+  size_t next_level = __atomic_load_n(&scheduler->custom_data->next_reaction_level, __ATOMIC_RELAXED);
+  int depth = 0;
+  for (size_t level = (next_level > 0) ? next_level - 1 : 0; level <= scheduler->max_reaction_level; level++) {
+    for (size_t i = 0; i < scheduler->custom_data->num_deques; i++) {
+      ws_deque_t* deque = _lf_sched_deque(scheduler, level, i);
+      long size = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+      if (size > 0) depth += (int)size;
+    }
+  }
+  return depth;
+}
+
+bool lf_sched_may_execute_now(lf_scheduler_t* scheduler, reaction_t* reaction) {
+  (void)scheduler;
+  (void)reaction;
+  // This scheduler does not order reactions by deadline.
+  return true;
+}
+
+void lf_sched_done_with_reaction(size_t worker_number, reaction_t* done_reaction) {
+  (void)worker_number; // Suppress unused parameter warning.
+  if (!lf_atomic_bool_compare_and_swap((int*)&done_reaction->status, queued, inactive)) {
+    lf_print_error_and_exit("Unexpected reaction status: %d. Expected %d.", done_reaction->status, queued);
+  }
+}
+
+void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reaction, int worker_number) {
+  if (reaction == NULL || !lf_atomic_bool_compare_and_swap((int*)&reaction->status, inactive, queued)) {
+    return;
+  }
+  LF_PRINT_DEBUG("Scheduler: Enqueueing reaction %s, which has level %lld.", reaction->name, LF_LEVEL(reaction->index));
+  size_t level = LF_LEVEL(reaction->index);
+  size_t num_deques = scheduler->custom_data->num_deques;
+  if (worker_number >= 0 && (size_t)worker_number < num_deques - 1) {
+    _lf_sched_deque_push(_lf_sched_deque(scheduler, level, (size_t)worker_number), (size_t)worker_number, reaction);
+  } else {
+    LF_MUTEX_LOCK(&scheduler->custom_data->shared_lock);
+    _lf_sched_deque_push(_lf_sched_deque(scheduler, level, num_deques - 1), num_deques - 1, reaction);
+    LF_MUTEX_UNLOCK(&scheduler->custom_data->shared_lock);
+  }
+
+  ms_on_reaction_ready(scheduler->env->id, lf_reaction_stable_key(reaction),
+                       (long long)scheduler->env->current_tag.time, (long long)reaction->deadline,
+                       (int)reaction->is_an_input_reaction);
+}
+#endif // SCHEDULER == SCHED_NP_WORK_STEALING && !defined(FEDERATED)
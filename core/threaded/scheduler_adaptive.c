@@ -21,6 +21,7 @@
 #include "reactor.h"
 #include "util.h"
 #include "master_scheduler.h"
+#include "reaction_key.h"
 
 #ifdef FEDERATED
 #include "federate.h"
@@ -83,6 +84,8 @@ typedef struct {
   reaction_t*** reactions_by_worker;
   /** The total number of workers active, including those who have finished their work. */
   size_t num_workers;
+  /** The number of queued reactions over all levels. Guarded by assignments_lock. */
+  int ready_depth;
   lf_mutex_t assignments_lock;
 } worker_assignments_t;
 
@@ -106,31 +109,6 @@ typedef struct custom_scheduler_data_t {
   size_t level_counter;
 } custom_scheduler_data_t;
 
-static inline uint64_t _ms_hash_str64(const char* s) {
-  uint64_t h = 1469598103934665603ULL;
-  if (s == NULL) return h;
-  while (*s) {
-    h ^= (uint8_t)(*s++);
-    h *= 1099511628211ULL;
-  }
-  return h;
-}
-
-static inline uint64_t _ms_reaction_stable_key(reaction_t* reaction) {
-  if (reaction == NULL) return 0;
-  const char* instance = NULL;
-  if (reaction->self != NULL) {
-    instance = lf_reactor_full_name((self_base_t*)reaction->self);
-  }
-  if (instance != NULL && instance[0] != '\0') {
-    return _ms_hash_str64(instance) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  if (reaction->name != NULL && reaction->name[0] != '\0') {
-    return _ms_hash_str64(reaction->name) ^ (((uint64_t)(uint32_t)reaction->number) * 0x9E3779B185EBCA87ULL);
-  }
-  return ((uint64_t)(uint32_t)reaction->number << 32) ^ (uint64_t)(uint32_t)LF_LEVEL(reaction->index);
-}
-
 ///////////////////////// Scheduler Private Functions ///////////////////////////
 
 /**
@@ -236,13 +214,15 @@ static reaction_t* get_reaction(lf_scheduler_t* scheduler, size_t worker) {
   worker_assignments_t* worker_assignments = scheduler->custom_data->worker_assignments;
 #ifndef FEDERATED
   LF_MUTEX_LOCK(&worker_assignments->assignments_lock);
-  int index = lf_atomic_add_fetch(worker_assignments->num_reactions_by_worker + worker, -1);
-  if (index >= 0) {
+  // The count is unsigned, so do not decrement it below zero.
+  size_t* num_reactions = worker_assignments->num_reactions_by_worker + worker;
+  if (*num_reactions > 0) {
+    size_t index = __atomic_sub_fetch(num_reactions, 1, __ATOMIC_SEQ_CST);
     reaction_t* ret = worker_assignments->reactions_by_worker[worker][index];
+    __atomic_store_n(&worker_assignments->ready_depth, worker_assignments->ready_depth - 1, __ATOMIC_RELAXED);
     LF_MUTEX_UNLOCK(&worker_assignments->assignments_lock);
     return ret;
   }
-  worker_assignments->num_reactions_by_worker[worker] = 0;
   LF_MUTEX_UNLOCK(&worker_assignments->assignments_lock);
   return NULL;
 #else
@@ -262,6 +242,7 @@ static reaction_t* get_reaction(lf_scheduler_t* scheduler, size_t worker) {
   reaction_t* ret = NULL;
   if (old_num_reactions > 0) {
     ret = worker_assignments->reactions_by_worker[worker][index];
+    __atomic_store_n(&worker_assignments->ready_depth, worker_assignments->ready_depth - 1, __ATOMIC_RELAXED);
   }
   LF_MUTEX_UNLOCK(&worker_assignments->assignments_lock);
   return ret;
@@ -321,8 +302,9 @@ static void worker_assignments_put(lf_scheduler_t* scheduler, reaction_t* reacti
   size_t worker = hash % worker_assignments->num_workers_by_level[level];
   LF_MUTEX_LOCK(&worker_assignments->assignments_lock);
   size_t num_preceding_reactions =
-      lf_atomic_fetch_add(&worker_assignments->num_reactions_by_worker_by_level[level][worker], 1);
+      __atomic_fetch_add(&worker_assignments->num_reactions_by_worker_by_level[level][worker], 1, __ATOMIC_SEQ_CST);
   worker_assignments->reactions_by_worker_by_level[level][worker][num_preceding_reactions] = reaction;
+  __atomic_store_n(&worker_assignments->ready_depth, worker_assignments->ready_depth + 1, __ATOMIC_RELAXED);
   LF_MUTEX_UNLOCK(&worker_assignments->assignments_lock);
 }
 
@@ -423,7 +405,7 @@ static bool worker_states_finished_with_level_locked(lf_scheduler_t* scheduler,
   assert(((int64_t)worker_assignments->num_reactions_by_worker[worker]) <= 0);
   // Why use an atomic operation when we are supposed to be "as good as locked"? Because I took a
   // shortcut, and the shortcut was imperfect.
-  size_t ret = lf_atomic_add_fetch(&worker_states->num_loose_threads, -1);
+  size_t ret = __atomic_sub_fetch(&worker_states->num_loose_threads, 1, __ATOMIC_SEQ_CST);
   assert(ret <= worker_assignments->max_num_workers); // Check for underflow
   return !ret;
 }
@@ -806,7 +788,7 @@ reaction_t* lf_sched_requeue_current_and_pick_by_key(
     for (size_t i = 0; i < count; i++) {
       reaction_t* candidate = worker_assignments->reactions_by_worker[worker][i];
       if (candidate == NULL) continue;
-      if (_ms_reaction_stable_key(candidate) == reaction_key) {
+      if (lf_reaction_stable_key(candidate) == reaction_key) {
         target = candidate;
         worker_assignments->reactions_by_worker[worker][i] = current;
         break;
@@ -820,6 +802,18 @@ reaction_t* lf_sched_requeue_current_and_pick_by_key(
   return (target != NULL) ? target : current;
 }
 
+int lf_sched_ready_depth(lf_scheduler_t* scheduler) {
+  if (scheduler == NULL || scheduler->custom_data == NULL) return 0;
+  return __atomic_load_n(&scheduler->custom_data->worker_assignments->ready_depth, __ATOMIC_RELAXED);
+}
+
+bool lf_sched_may_execute_now(lf_scheduler_t* scheduler, reaction_t* reaction) {
+  (void)scheduler;
+  (void)reaction;
+  // This scheduler does not order reactions by deadline.
+  return true;
+}
+
 void lf_sched_done_with_reaction(size_t worker_number, reaction_t* done_reaction) {
   (void)worker_number;
   LF_ASSERT(done_reaction->status != inactive, "");
@@ -832,7 +826,7 @@ void lf_scheduler_trigger_reaction(lf_scheduler_t* scheduler, reaction_t* reacti
     return;
   ms_on_reaction_ready(
       scheduler->env->id,
-      _ms_reaction_stable_key(reaction),
+      lf_reaction_stable_key(reaction),
       (long long)scheduler->env->current_tag.time,
       (long long)reaction->deadline,
       (int)reaction->is_an_input_reaction);
@@ -0,0 +1,124 @@
+/**
+ * @file timer_group.c
+ * @brief Coalescing of periodic timers that fire at the same tags. See timer_group.h.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "timer_group.h"
+#include "environment.h"
+#include "reactor.h"
+#include "reactor_common.h"
+#include "tracepoint.h"
+#include "util.h"
+
+/**
+ * @brief Return the group of the environment with the specified period that fires next at the specified tag, or NULL.
+ */
+static timer_group_t* find_group(environment_t* env, interval_t period, tag_t tag) {
+  for (timer_group_t* group = env->timer_groups; group != NULL; group = group->next) {
+    if (group->trigger.period == period && group->event != NULL && lf_tag_compare(group->event->base.tag, tag) == 0) {
+      return group;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Append timers to a group.
+ */
+static void add_timers(timer_group_t* group, trigger_t** timers, size_t count) {
+  if (group->size + count > group->capacity) {
+    size_t capacity = group->capacity == 0 ? 4 : group->capacity;
+    while (capacity < group->size + count) {
+      capacity *= 2;
+    }
+    group->timers = (trigger_t**)realloc(group->timers, capacity * sizeof(trigger_t*));
+    LF_ASSERT_NON_NULL(group->timers);
+    group->capacity = capacity;
+  }
+  for (size_t i = 0; i < count; i++) {
+    group->timers[group->size++] = timers[i];
+  }
+}
+
+/**
+ * @brief Put the event of a group on the event queue at the specified tag.
+ */
+static void schedule_group(environment_t* env, timer_group_t* group, event_t* event, tag_t tag) {
+  event->trigger = &group->trigger;
+  event->base.tag = tag;
+  group->event = event;
+  pqueue_tag_insert(env->event_q, (pqueue_tag_element_t*)event);
+}
+
+void _lf_timer_group_add(environment_t* env, trigger_t* timer, tag_t tag) {
+  timer_group_t* group = find_group(env, timer->period, tag);
+  if (group == NULL) {
+    group = (timer_group_t*)calloc(1, sizeof(timer_group_t));
+    LF_ASSERT_NON_NULL(group);
+    group->trigger.is_timer = true;
+    group->trigger.period = timer->period;
+    group->trigger.timer_group = group;
+    group->next = env->timer_groups;
+    env->timer_groups = group;
+    schedule_group(env, group, lf_get_new_event(env), tag);
+  }
+  add_timers(group, &timer, 1);
+}
+
+void _lf_timer_group_fire(environment_t* env, event_t* event) {
+  timer_group_t* group = event->trigger->timer_group;
+  assert(group->event == event);
+  group->event = NULL;
+  LF_PRINT_DEBUG("Firing a group of %zu timers with period " PRINTF_TIME ".", group->size, group->trigger.period);
+
+  for (size_t i = 0; i < group->size; i++) {
+    trigger_t* timer = group->timers[i];
+    for (int j = 0; j < timer->number_of_reactions; j++) {
+      reaction_t* reaction = timer->reactions[j];
+      // Do not enqueue this reaction twice.
+      if (reaction->status == inactive) {
+        LF_PRINT_DEBUG("Triggering reaction %s.", reaction->name);
+        _lf_trigger_reaction(env, reaction, -1);
+      }
+    }
+    timer->status = present;
+  }
+
+  // Schedule the group one period later, unless another group already fires then.
+  interval_t period = group->trigger.period;
+  tag_t next_tag = lf_delay_tag(env->current_tag, period);
+  if (lf_is_tag_after_stop_tag(env, next_tag)) {
+    lf_recycle_event(env, event);
+    return;
+  }
+  for (size_t i = 0; i < group->size; i++) {
+    tracepoint_schedule(env, group->timers[i], period); // Trace as if each timer were scheduled.
+  }
+  timer_group_t* other = find_group(env, period, next_tag);
+  if (other == NULL) {
+    schedule_group(env, group, event, next_tag);
+    return;
+  }
+  LF_PRINT_DEBUG("Merging a group of %zu timers into one of %zu.", group->size, other->size);
+  add_timers(other, group->timers, group->size);
+  lf_recycle_event(env, event);
+  timer_group_t** link = &env->timer_groups;
+  while (*link != group) {
+    link = &(*link)->next;
+  }
+  *link = group->next;
+  free(group->timers);
+  free(group);
+}
+
+void _lf_timer_groups_free(environment_t* env) {
+  while (env->timer_groups != NULL) {
+    timer_group_t* group = env->timer_groups;
+    env->timer_groups = group->next;
+    free(group->timers);
+    free(group);
+  }
+}
@@ -12,8 +12,10 @@
 
 #ifdef LF_TRACE
 
+#include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "low_level_platform.h"
@@ -25,7 +27,297 @@
 #include "reactor_common.h"
 #include "util.h"
 
+////////////////////////////////////////////////////////////
+//// Filtering of events
+
+uint8_t _lf_trace_event_filter[NUM_EVENT_TYPES];
+
+/** Trace 1 in this many events of each type. 0 and 1 mean every event. */
+static uint32_t _lf_trace_sample_period[NUM_EVENT_TYPES];
+
+/** The LF_TRACE_REACTORS entries separated by null characters, or NULL if all reactors are traced. */
+static char* _lf_trace_allowlist = NULL;
+static size_t _lf_trace_allowlist_size = 0;
+
+/** Intervals of one type open on a thread beyond this depth are not traced. */
+#define LF_TRACE_MAX_NESTING 64
+
+/**
+ * Events of each type seen by this thread since the last traced one. For each
+ * interval start type, the number of intervals open on this thread and, one bit
+ * per nesting level, whether their starts were traced. Intervals nest, e.g. when
+ * a reaction executes a chain of reactions within its own start and end.
+ */
+#if defined(LF_SINGLE_THREADED)
+static uint32_t _lf_trace_sample_count[NUM_EVENT_TYPES];
+static uint32_t _lf_trace_open_depth[NUM_EVENT_TYPES];
+static uint64_t _lf_trace_open_admitted[NUM_EVENT_TYPES];
+#else
+static thread_local uint32_t _lf_trace_sample_count[NUM_EVENT_TYPES];
+static thread_local uint32_t _lf_trace_open_depth[NUM_EVENT_TYPES];
+static thread_local uint64_t _lf_trace_open_admitted[NUM_EVENT_TYPES];
+#endif
+
+/**
+ * Return the start event of an interval if the given type ends one, and -1 otherwise.
+ */
+static int _lf_trace_interval_start(int event_type) {
+  switch (event_type) {
+  case reaction_ends:
+    return reaction_starts;
+  case worker_wait_ends:
+    return worker_wait_starts;
+  case scheduler_advancing_time_ends:
+    return scheduler_advancing_time_starts;
+  default:
+    return -1;
+  }
+}
+
+/**
+ * Return whether the given type starts an interval.
+ */
+static bool _lf_trace_opens_interval(int event_type) {
+  return event_type == reaction_starts || event_type == worker_wait_starts ||
+         event_type == scheduler_advancing_time_starts;
+}
+
+/**
+ * Compare a name given by the user with a name from trace_event_names, ignoring case, spaces, '-' and '_'.
+ */
+static bool _lf_trace_names_match(const char* given, size_t length, const char* name) {
+  const char* end = given + length;
+  while (true) {
+    while (given < end && (*given == ' ' || *given == '-' || *given == '_'))
+      given++;
+    while (*name == ' ' || *name == '-' || *name == '_')
+      name++;
+    if (given == end || *name == '\0')
+      return given == end && *name == '\0';
+    if (tolower((unsigned char)*given) != tolower((unsigned char)*name))
+      return false;
+    given++;
+    name++;
+  }
+}
+
+/**
+ * Return the event type given by number or by name, or -1 if there is none.
+ */
+static int _lf_trace_event_type(const char* given, size_t length) {
+  char* end;
+  long number = strtol(given, &end, 10);
+  if (length > 0 && end == given + length)
+    return number >= 0 && number < NUM_EVENT_TYPES ? (int)number : -1;
+  for (int i = 0; i < NUM_EVENT_TYPES; i++) {
+    if (_lf_trace_names_match(given, length, trace_event_names[i]))
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * Return the length of the comma-separated entry at the start of the given string.
+ */
+static size_t _lf_trace_entry_length(const char* entry) {
+  const char* comma = strchr(entry, ',');
+  return comma == NULL ? strlen(entry) : (size_t)(comma - entry);
+}
+
+/**
+ * Apply the LF_TRACE_EVENTS variable.
+ */
+static void _lf_trace_parse_events(const char* events) {
+  // A list of types to trace starts from none, and a list of types to leave out from all.
+  bool listed_any = false;
+  const char* entry = events;
+  while (entry != NULL) {
+    if (*entry != '-' && *entry != ',' && *entry != '\0')
+      listed_any = true;
+    entry = strchr(entry, ',');
+    if (entry != NULL)
+      entry++;
+  }
+  if (listed_any) {
+    memset(_lf_trace_event_filter, LF_TRACE_DROP, sizeof(_lf_trace_event_filter));
+  }
+  entry = events;
+  while (*entry != '\0') {
+    size_t length = _lf_trace_entry_length(entry);
+    bool leave_out = length > 0 && *entry == '-';
+    int type = leave_out ? _lf_trace_event_type(entry + 1, length - 1) : _lf_trace_event_type(entry, length);
+    if (type >= 0) {
+      _lf_trace_event_filter[type] = leave_out ? LF_TRACE_DROP : LF_TRACE_KEEP;
+    } else if (length > 0) {
+      lf_print_warning("Unknown trace event type %.*s in LF_TRACE_EVENTS.", (int)length, entry);
+    }
+    entry += length;
+    if (*entry == ',')
+      entry++;
+  }
+}
+
+/**
+ * Apply the LF_TRACE_SAMPLE variable.
+ */
+static void _lf_trace_parse_sample(const char* sample) {
+  const char* entry = sample;
+  while (*entry != '\0') {
+    size_t length = _lf_trace_entry_length(entry);
+    const char* equals = memchr(entry, '=', length);
+    char* end;
+    long period = strtol(equals == NULL ? entry : equals + 1, &end, 10);
+    if (end != entry + length || period < 1 || period > INT32_MAX) {
+      lf_print_warning("Invalid entry %.*s in LF_TRACE_SAMPLE.", (int)length, entry);
+    } else if (equals == NULL) {
+      for (int i = 0; i < NUM_EVENT_TYPES; i++) {
+        _lf_trace_sample_period[i] = (uint32_t)period;
+      }
+    } else {
+      int type = _lf_trace_event_type(entry, (size_t)(equals - entry));
+      if (type >= 0) {
+        _lf_trace_sample_period[type] = (uint32_t)period;
+      } else {
+        lf_print_warning("Unknown trace event type %.*s in LF_TRACE_SAMPLE.", (int)(equals - entry), entry);
+      }
+    }
+    entry += length;
+    if (*entry == ',')
+      entry++;
+  }
+}
+
+/**
+ * Apply the LF_TRACE_REACTORS variable.
+ */
+static void _lf_trace_parse_reactors(const char* reactors) {
+  _lf_trace_allowlist = strdup(reactors);
+  if (_lf_trace_allowlist == NULL) {
+    lf_print_warning("Out of memory for LF_TRACE_REACTORS. All reactors will be traced.");
+    return;
+  }
+  // Separate the entries.
+  _lf_trace_allowlist_size = strlen(reactors) + 1;
+  for (char* c = _lf_trace_allowlist; *c != '\0'; c++) {
+    if (*c == ',')
+      *c = '\0';
+  }
+}
+
+/**
+ * Return the reactions of a registered reactor that LF_TRACE_REACTORS leaves out.
+ */
+static uint64_t _lf_trace_excluded_reactions(const char* name) {
+  uint64_t excluded = UINT64_MAX;
+  size_t name_length = strlen(name);
+  for (const char* entry = _lf_trace_allowlist; entry < _lf_trace_allowlist + _lf_trace_allowlist_size;
+       entry += strlen(entry) + 1) {
+    size_t length = strlen(entry);
+    if (length == 0)
+      continue;
+    if (length <= name_length) {
+      // The entry may be this reactor or one that contains it.
+      if (strncmp(entry, name, length) == 0 && (name[length] == '\0' || name[length] == '.' || name[length] == '['))
+        return 0;
+    } else if (strncmp(entry, name, name_length) == 0 && entry[name_length] == '.') {
+      // The entry may be a reaction of this reactor.
+      char* end;
+      long reaction = strtol(entry + name_length + 1, &end, 10);
+      if (end != entry + name_length + 1 && *end == '\0' && reaction >= 0) {
+        excluded &= ~((uint64_t)1 << (reaction < 63 ? reaction : 63));
+      }
+    }
+  }
+  return excluded;
+}
+
+void lf_tracing_filter_init(void) {
+  memset(_lf_trace_event_filter, LF_TRACE_KEEP, sizeof(_lf_trace_event_filter));
+  memset(_lf_trace_sample_period, 0, sizeof(_lf_trace_sample_period));
+  free(_lf_trace_allowlist);
+  _lf_trace_allowlist = NULL;
+  _lf_trace_allowlist_size = 0;
+  const char* events = getenv("LF_TRACE_EVENTS");
+  if (events != NULL) {
+    _lf_trace_parse_events(events);
+  }
+  const char* sample = getenv("LF_TRACE_SAMPLE");
+  if (sample != NULL) {
+    _lf_trace_parse_sample(sample);
+  }
+  const char* reactors = getenv("LF_TRACE_REACTORS");
+  if (reactors != NULL && reactors[0] != '\0') {
+    _lf_trace_parse_reactors(reactors);
+  }
+  // Types whose events must be examined one by one.
+  for (int i = 0; i < NUM_EVENT_TYPES; i++) {
+    if (_lf_trace_event_filter[i] == LF_TRACE_DROP)
+      continue;
+    int start = _lf_trace_interval_start(i);
+    bool sampled = _lf_trace_sample_period[start >= 0 ? start : i] > 1;
+    bool per_reactor = _lf_trace_allowlist != NULL && (i == reaction_starts || i == reaction_ends ||
+                                                       i == reaction_deadline_missed || i == schedule_called);
+    if (sampled || per_reactor) {
+      _lf_trace_event_filter[i] = LF_TRACE_CHECK;
+    }
+  }
+}
+
+/**
+ * Decide whether to trace an event that does not end a sampled interval.
+ */
+static bool _lf_trace_decide(int event_type, void* reactor, int dst_id) {
+  if (_lf_trace_allowlist != NULL && reactor != NULL) {
+    uint64_t excluded = ((self_base_t*)reactor)->trace_excluded_reactions;
+    if (event_type == schedule_called) {
+      // Schedule events are traced if any reaction of the reactor is.
+      if (excluded == UINT64_MAX)
+        return false;
+    } else if (event_type == reaction_starts || event_type == reaction_ends || event_type == reaction_deadline_missed) {
+      if (dst_id >= 0 && ((excluded >> (dst_id < 63 ? dst_id : 63)) & 1))
+        return false;
+    }
+  }
+  bool admitted = true;
+  uint32_t period = _lf_trace_sample_period[event_type];
+  if (period > 1) {
+    // The first event of the thread is traced, then every period-th one.
+    admitted = _lf_trace_sample_count[event_type] == 0;
+    _lf_trace_sample_count[event_type] = (_lf_trace_sample_count[event_type] + 1) % period;
+  }
+  return admitted;
+}
+
+bool _lf_trace_filter_admits(int event_type, void* reactor, int dst_id) {
+  int start = _lf_trace_interval_start(event_type);
+  if (start >= 0 && _lf_trace_sample_period[start] > 1) {
+    // The end of an interval is traced if and only if its start was. An end
+    // without a start on this thread is not traced.
+    uint32_t depth = _lf_trace_open_depth[start];
+    if (depth == 0)
+      return false;
+    _lf_trace_open_depth[start] = --depth;
+    return depth < LF_TRACE_MAX_NESTING && ((_lf_trace_open_admitted[start] >> depth) & 1);
+  }
+  bool admitted = _lf_trace_decide(event_type, reactor, dst_id);
+  if (_lf_trace_sample_period[event_type] > 1 && _lf_trace_opens_interval(event_type)) {
+    uint32_t depth = _lf_trace_open_depth[event_type]++;
+    if (depth >= LF_TRACE_MAX_NESTING)
+      return false;
+    uint64_t bit = (uint64_t)1 << depth;
+    _lf_trace_open_admitted[event_type] =
+        admitted ? (_lf_trace_open_admitted[event_type] | bit) : (_lf_trace_open_admitted[event_type] & ~bit);
+  }
+  return admitted;
+}
+
+////////////////////////////////////////////////////////////
+//// Registration and recording of events
+
 int _lf_register_trace_event(void* pointer1, void* pointer2, _lf_trace_object_t type, char* description) {
+  if (type == trace_reactor && _lf_trace_allowlist != NULL && pointer1 != NULL && description != NULL) {
+    ((self_base_t*)pointer1)->trace_excluded_reactions = _lf_trace_excluded_reactions(description);
+  }
   object_description_t desc = {.pointer = pointer1, .trigger = pointer2, .type = type, .description = description};
   lf_tracing_register_trace_event(desc);
   return 1;
@@ -40,6 +332,10 @@ int register_user_trace_event(void* self, char* description) {
 
 void call_tracepoint(int event_type, void* reactor, tag_t tag, int worker, int src_id, int dst_id,
                      instant_t* physical_time, trigger_t* trigger, interval_t extra_delay) {
+  // Filtered types are rare, so this branch is predictable, and it precedes reading the clock.
+  uint8_t filter = _lf_trace_event_filter[event_type];
+  if (filter != LF_TRACE_KEEP && (filter == LF_TRACE_DROP || !_lf_trace_filter_admits(event_type, reactor, dst_id)))
+    return;
   instant_t local_time;
   if (physical_time == NULL) {
     local_time = lf_time_physical();
@@ -1,4 +1,7 @@
 #include "master_scheduler.h"
+#include "master_scheduler_binlog.h"
+#include "master_scheduler_metrics.h"
+#include "master_scheduler_stats.h"
 
 #include <stdio.h>
 #include <stdlib.h>   // atexit
@@ -7,6 +10,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 
 #include <sys/syscall.h>
@@ -20,6 +24,14 @@ static bool _ms_enabled = true;
 static ms_log_level_t _ms_level = MS_LEVEL_INFO;
 static bool _ms_observe_only = false;
 static bool _ms_minimal_log = false;
+// When set, hot-path events go to the binary ring-buffer log instead of _ms_log.
+static bool _ms_binary_log = false;
+// When set, every reaction's wall and CPU time is recorded (LF_MS_STATS, or
+// implied by budget_type=cpu_time).
+static bool _ms_exec_stats = false;
+static char _ms_stats_path[512];
+// When set, live state is published to the shared metrics page (LF_MS_METRICS).
+static bool _ms_live_metrics = false;
 static int _ms_partition_enabled = 0;
 static int _ms_partition_hc_workers = 0;
 
@@ -28,6 +40,8 @@ typedef enum {
   MS_CRIT_LOW = 1
 } ms_criticality_t;
 
+#define MS_CRIT_COUNT 2
+
 typedef enum {
   MS_DEGRADE_DEFER = 0,
   MS_DEGRADE_SKIP = 1
@@ -72,6 +86,7 @@ typedef struct {
   int64_t budget;
   int64_t window_start_mono_ns;
   int64_t used_in_window;
+  bool in_use;
 } ms_reaction_policy_t;
 
 static ms_policy_config_t _ms_policy = {
@@ -100,10 +115,18 @@ static ms_os_config_t _ms_os_config = {
   .hc_guard_ready_q_len = -1
 };
 
-#define MS_MAX_REACTION_POLICIES 2048
-static ms_reaction_policy_t _ms_reaction_policies[MS_MAX_REACTION_POLICIES];
-static int _ms_reaction_policy_count = 0;
+// Open-addressing hash table of per-reaction policies, keyed by (env_id,
+// reaction_index). It is only written while the config is loaded in ms_init(),
+// before any worker runs, and is read-only (and so lock-free) afterwards.
+#define MS_POLICY_TABLE_MIN_CAPACITY 256
+static ms_reaction_policy_t* _ms_policy_table = NULL;
+static size_t _ms_policy_table_capacity = 0; // Zero or a power of two.
+static size_t _ms_policy_table_count = 0;
+// Returned for reactions without a configured policy when default_budget >= 0.
+static ms_reaction_policy_t _ms_default_reaction_policy;
 static bool _ms_config_loaded = false;
+// True between a successful ms_init() and ms_shutdown(); hooks are no-ops otherwise.
+static bool _ms_active = false;
 
 // Ensure shutdown runs even if the LF program calls exit(0).
 static bool _ms_atexit_registered = false;
@@ -115,20 +138,48 @@ static int64_t _ms_report_min_interval_ns = 100LL * 1000LL * 1000LL;
 
 #define MS_MAX_WORKERS 256
 static int64_t _ms_last_report_mono_ns[MS_MAX_WORKERS] = {0};
-static ms_criticality_t _ms_worker_last_crit[MS_MAX_WORKERS];
-static int _ms_worker_crit_known[MS_MAX_WORKERS] = {0};
-static ms_os_policy_t _ms_worker_pending_policy[MS_MAX_WORKERS];
-static int _ms_worker_policy_pending[MS_MAX_WORKERS] = {0};
-static int _ms_worker_last_nice_delta[MS_MAX_WORKERS] = {0};
-static int _ms_worker_last_sched_policy[MS_MAX_WORKERS] = {0}; // ms_sched_policy_t
-static int _ms_worker_last_rt_priority[MS_MAX_WORKERS] = {0};
-static int64_t _ms_worker_last_nice_switch_ns[MS_MAX_WORKERS] = {0};
-static uint8_t _ms_worker_crit_mask[MS_MAX_WORKERS] = {0}; // bit0: high, bit1: low
 
 #define MS_MAX_ENVS 32
-#define MS_MAX_READY_PER_ENV 1024
 
-static void _ms_logf(ms_log_level_t lvl, const char* fmt, ...);
+// Criticality and OS policy state of one worker thread. Worker ids are per
+// environment, so the state is kept per (environment, worker) pair. Each pair
+// is a single thread, which is the only one to touch its state, so no lock is
+// needed.
+typedef struct {
+  ms_criticality_t last_crit;
+  int crit_known;
+  uint8_t crit_mask; // bit0: high, bit1: low
+  ms_os_policy_t pending_policy;
+  int policy_pending;
+  int last_nice_delta;
+  int last_sched_policy; // ms_sched_policy_t
+  int last_rt_priority;
+  int64_t last_nice_switch_ns;
+} ms_worker_state_t;
+
+// Per environment, an array of MS_MAX_WORKERS states, allocated on first use.
+static ms_worker_state_t* _ms_worker_states[MS_MAX_ENVS];
+
+// The ready set of each environment is split into shards. A reaction is filed
+// in the shard of the worker that made it ready, so concurrent ready/start/end
+// calls from different workers rarely touch the same lock. Each shard keeps one
+// (deadline, ready_time) min-heap per criticality and publishes the heap heads
+// under a sequence lock, which lets ms_pick_next() run without any lock.
+#define MS_READY_SHARDS 16
+#define MS_READY_PER_SHARD 256
+#define MS_MAX_READY_PER_ENV (MS_READY_SHARDS * MS_READY_PER_SHARD)
+// Open-addressing index from reaction key to shard slot. Lookups take no lock;
+// keys are added under the set's index_lock. Once half of the slots have been
+// used, the key of a reaction that leaves the ready set is replaced by a
+// tombstone, which later inserts reuse, so any number of distinct reactions fit.
+#define MS_READY_INDEX_SIZE (2 * MS_MAX_READY_PER_ENV)
+#define MS_READY_INDEX_RETIRE_AT (MS_READY_INDEX_SIZE / 2)
+#define MS_READY_KEY_EMPTY 0ULL
+#define MS_READY_KEY_TOMBSTONE UINT64_MAX
+#define MS_READY_KEY_ZERO_ALIAS 0x8000000000000000ULL
+#define MS_READY_KEY_TOMBSTONE_ALIAS (UINT64_MAX - 1)
+
+static void _ms_logf(ms_log_level_t lvl, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
 
 typedef enum {
   MS_READY = 0,
@@ -142,15 +193,65 @@ typedef struct {
   int64_t ready_time_ns;
   int is_input;
   ms_ready_state_t state;
+  ms_criticality_t criticality;
+  int heap_pos; // Position in heap[criticality]; -1 while running.
+  bool in_use;
 } ms_ready_entry_t;
 
 typedef struct {
-  ms_ready_entry_t entries[MS_MAX_READY_PER_ENV];
-  int count;
+  int64_t deadline_ns;
+  int64_t ready_time_ns;
+  uint64_t reaction_index;
+  int valid;
+} ms_ready_head_t;
+
+typedef struct {
+  pthread_mutex_t lock; // Guards everything below except the published fields.
+  // Published fields, written under lock and read lock-free through seq.
+  uint32_t seq;
+  ms_ready_head_t heads[MS_CRIT_COUNT];
+  int count;  // Entries held, ready or running.
+  int queued; // Entries not running.
+  int free_top;
+  int free_slots[MS_READY_PER_SHARD];
+  int heap_size[MS_CRIT_COUNT];
+  int heap[MS_CRIT_COUNT][MS_READY_PER_SHARD];
+  ms_ready_entry_t entries[MS_READY_PER_SHARD];
+} ms_ready_shard_t;
+
+typedef struct {
+  uint64_t key;
+  // shard * MS_READY_PER_SHARD + slot + 1, 0 when not held, or -1 while the key is being retired.
+  int32_t loc;
+} ms_ready_index_slot_t;
+
+typedef struct {
+  ms_ready_shard_t shards[MS_READY_SHARDS];
+  ms_ready_index_slot_t index[MS_READY_INDEX_SIZE];
+  pthread_mutex_t index_lock; // Serializes changes to index keys.
+  int index_used;             // Index slots that are not empty, tombstones included.
   long long last_pick_reaction_index;
+  // Env-level LC budget accounting for graceful (partial) shedding. Active when
+  // _ms_policy.default_budget >= 0: at most default_budget LC reactions are kept
+  // PER LOGICAL TAG while degrade pressure is active; the rest are shed.
+  // lc_window_start_ns holds the current tag's logical time, lc_used_in_window
+  // the count used in it.
+  pthread_mutex_t lc_budget_lock;
+  int64_t lc_window_start_ns;
+  int64_t lc_used_in_window;
+  // With budget_type=cpu_time, the LC CPU time used in the current
+  // budget_window_ns window of monotonic time, also under lc_budget_lock.
+  int64_t lc_cpu_window_start_ns;
+  int64_t lc_cpu_used_ns;
 } ms_ready_set_t;
 
-static ms_ready_set_t _ms_ready_sets[MS_MAX_ENVS];
+static ms_ready_set_t* _ms_ready_sets[MS_MAX_ENVS];
+// Worker id of the calling thread, recorded by ms_register_worker(); selects the shard.
+static __thread int _ms_tls_worker_id = -1;
+// Start of the reaction running on this thread, for the execution-time stats.
+static __thread uint64_t _ms_tls_start_key = 0;
+static __thread int64_t _ms_tls_start_wall_ns = -1;
+static __thread int64_t _ms_tls_start_cpu_ns = -1;
 static int _ms_env_pressure[MS_MAX_ENVS] = {0};
 static int _ms_env_degrade_pressure[MS_MAX_ENVS] = {0};
 static bool _ms_degrade_enabled = false;
@@ -163,12 +264,6 @@ static bool _ms_hc_strict_priority = false;
 // state (pressure / has_hc_ready / criticality) for every evaluation, to root-
 // cause why degradation does/doesn't fire. Off by default (no normal-run impact).
 static bool _ms_degrade_debug = false;
-// Env-level LC budget accounting for graceful (partial) shedding. Active when
-// _ms_policy.default_budget >= 0: at most default_budget LC reactions are kept
-// PER LOGICAL TAG while degrade pressure is active; the rest are shed. The first
-// array holds the current tag's logical time, the second the count used in it.
-static int64_t _ms_env_lc_window_start_ns[MS_MAX_ENVS] = {0};
-static int64_t _ms_env_lc_used_in_window[MS_MAX_ENVS] = {0};
 
 static int64_t _ms_now_mono_ns(void) {
   struct timespec ts;
@@ -212,22 +307,57 @@ static char* _ms_trim(char* s) {
   return s;
 }
 
-static ms_reaction_policy_t* _ms_find_policy(int env_id, uint64_t reaction_index) {
-  for (int i = 0; i < _ms_reaction_policy_count; i++) {
-    ms_reaction_policy_t* p = &_ms_reaction_policies[i];
-    if (p->env_id == env_id && p->reaction_index == reaction_index) {
-      return p;
-    }
+static size_t _ms_policy_slot(int env_id, uint64_t reaction_index, size_t capacity) {
+  uint64_t h = (reaction_index ^ ((uint64_t)(uint32_t)env_id << 32)) * 0x9E3779B97F4A7C15ULL;
+  return (size_t)(h >> 32) & (capacity - 1);
+}
+
+static ms_reaction_policy_t* _ms_find_configured_policy(int env_id, uint64_t reaction_index) {
+  if (_ms_policy_table_capacity == 0) return NULL;
+  size_t i = _ms_policy_slot(env_id, reaction_index, _ms_policy_table_capacity);
+  for (;;) {
+    ms_reaction_policy_t* p = &_ms_policy_table[i];
+    if (!p->in_use) return NULL;
+    if (p->env_id == env_id && p->reaction_index == reaction_index) return p;
+    i = (i + 1) & (_ms_policy_table_capacity - 1);
   }
-  return NULL;
 }
 
-static ms_reaction_policy_t* _ms_get_policy(int env_id, uint64_t reaction_index, bool create_if_missing) {
-  ms_reaction_policy_t* pol = _ms_find_policy(env_id, reaction_index);
-  if (pol != NULL || !create_if_missing) return pol;
-  if (_ms_reaction_policy_count >= MS_MAX_REACTION_POLICIES) return NULL;
+// Policy of a reaction: the configured one, else the implicit default when
+// default_budget >= 0 (high criticality, not degradable), else NULL.
+static ms_reaction_policy_t* _ms_find_policy(int env_id, uint64_t reaction_index) {
+  ms_reaction_policy_t* pol = _ms_find_configured_policy(env_id, reaction_index);
+  if (pol != NULL || _ms_policy.default_budget < 0) return pol;
+  return &_ms_default_reaction_policy;
+}
+
+static bool _ms_policy_table_grow(void) {
+  size_t capacity = (_ms_policy_table_capacity == 0) ? MS_POLICY_TABLE_MIN_CAPACITY : 2 * _ms_policy_table_capacity;
+  ms_reaction_policy_t* table = (ms_reaction_policy_t*)calloc(capacity, sizeof(ms_reaction_policy_t));
+  if (table == NULL) return false;
+  for (size_t j = 0; j < _ms_policy_table_capacity; j++) {
+    ms_reaction_policy_t* p = &_ms_policy_table[j];
+    if (!p->in_use) continue;
+    size_t i = _ms_policy_slot(p->env_id, p->reaction_index, capacity);
+    while (table[i].in_use) i = (i + 1) & (capacity - 1);
+    table[i] = *p;
+  }
+  free(_ms_policy_table);
+  _ms_policy_table = table;
+  _ms_policy_table_capacity = capacity;
+  return true;
+}
 
-  pol = &_ms_reaction_policies[_ms_reaction_policy_count++];
+// Config-load time only; see _ms_policy_table.
+static ms_reaction_policy_t* _ms_add_policy(int env_id, uint64_t reaction_index) {
+  ms_reaction_policy_t* pol = _ms_find_configured_policy(env_id, reaction_index);
+  if (pol != NULL) return pol;
+  // Keep the load factor at or below one half.
+  if (2 * (_ms_policy_table_count + 1) > _ms_policy_table_capacity && !_ms_policy_table_grow()) return NULL;
+
+  size_t i = _ms_policy_slot(env_id, reaction_index, _ms_policy_table_capacity);
+  while (_ms_policy_table[i].in_use) i = (i + 1) & (_ms_policy_table_capacity - 1);
+  pol = &_ms_policy_table[i];
   pol->env_id = env_id;
   pol->reaction_index = reaction_index;
   pol->criticality = MS_CRIT_HIGH;
@@ -235,9 +365,16 @@ static ms_reaction_policy_t* _ms_get_policy(int env_id, uint64_t reaction_index,
   pol->budget = _ms_policy.default_budget;
   pol->window_start_mono_ns = 0;
   pol->used_in_window = 0;
+  pol->in_use = true;
+  _ms_policy_table_count++;
   return pol;
 }
 
+static ms_criticality_t _ms_reaction_criticality(int env_id, uint64_t reaction_index) {
+  ms_reaction_policy_t* pol = _ms_find_policy(env_id, reaction_index);
+  return (pol != NULL) ? pol->criticality : MS_CRIT_HIGH;
+}
+
 static ms_criticality_t _ms_parse_criticality(const char* s, int* ok) {
   if (s == NULL) {
     if (ok) *ok = 0;
@@ -351,7 +488,7 @@ static void _ms_parse_reaction_line(char* line) {
     return;
   }
 
-  ms_reaction_policy_t* pol = _ms_get_policy(env_id, reaction_index, true);
+  ms_reaction_policy_t* pol = _ms_add_policy(env_id, reaction_index);
   if (pol == NULL) {
     _ms_logf(MS_LEVEL_WARN, "event=config_reaction_overflow env=%d reaction_index=%llu",
              env_id, (unsigned long long)reaction_index);
@@ -401,29 +538,317 @@ static void _ms_load_config(const char* path) {
 
   fclose(f);
   _ms_logf(MS_LEVEL_INFO,
-           "event=config_loaded path=%s degrade_action=%s budget_type=%d window_ns=%lld default_budget=%lld",
+           "event=config_loaded path=%s degrade_action=%s budget_type=%d window_ns=%lld default_budget=%lld reactions=%zu",
            path, _ms_degrade_str(_ms_policy.degrade_action),
            (int)_ms_policy.budget_type, (long long)_ms_policy.budget_window_ns,
-           (long long)_ms_policy.default_budget);
+           (long long)_ms_policy.default_budget, _ms_policy_table_count);
 }
 
-static ms_ready_set_t* _ms_get_ready_set(int env_id) {
+// ---------------- Ready set ----------------
+
+static ms_ready_set_t* _ms_get_ready_set(int env_id, bool create_if_missing) {
   if (env_id < 0 || env_id >= MS_MAX_ENVS) return NULL;
-  return &_ms_ready_sets[env_id];
+  ms_ready_set_t* set = __atomic_load_n(&_ms_ready_sets[env_id], __ATOMIC_ACQUIRE);
+  if (set != NULL || !create_if_missing) return set;
+
+  ms_ready_set_t* fresh = (ms_ready_set_t*)calloc(1, sizeof(ms_ready_set_t));
+  if (fresh == NULL) return NULL;
+  for (int s = 0; s < MS_READY_SHARDS; s++) {
+    ms_ready_shard_t* shard = &fresh->shards[s];
+    pthread_mutex_init(&shard->lock, NULL);
+    for (int i = 0; i < MS_READY_PER_SHARD; i++) {
+      shard->free_slots[i] = MS_READY_PER_SHARD - 1 - i;
+    }
+    shard->free_top = MS_READY_PER_SHARD;
+  }
+  pthread_mutex_init(&fresh->index_lock, NULL);
+  pthread_mutex_init(&fresh->lc_budget_lock, NULL);
+  fresh->last_pick_reaction_index = -1;
+
+  ms_ready_set_t* expected = NULL;
+  if (__atomic_compare_exchange_n(&_ms_ready_sets[env_id], &expected, fresh, false, __ATOMIC_ACQ_REL,
+                                  __ATOMIC_ACQUIRE)) {
+    return fresh;
+  }
+  // Another thread installed the set first.
+  for (int s = 0; s < MS_READY_SHARDS; s++) {
+    pthread_mutex_destroy(&fresh->shards[s].lock);
+  }
+  pthread_mutex_destroy(&fresh->index_lock);
+  pthread_mutex_destroy(&fresh->lc_budget_lock);
+  free(fresh);
+  return expected;
+}
+
+static ms_worker_state_t* _ms_get_worker_state(int env_id, int worker_id, bool create_if_missing) {
+  if (env_id < 0 || env_id >= MS_MAX_ENVS || worker_id < 0 || worker_id >= MS_MAX_WORKERS) return NULL;
+  ms_worker_state_t* states = __atomic_load_n(&_ms_worker_states[env_id], __ATOMIC_ACQUIRE);
+  if (states == NULL && create_if_missing) {
+    ms_worker_state_t* fresh = (ms_worker_state_t*)calloc(MS_MAX_WORKERS, sizeof(ms_worker_state_t));
+    if (fresh == NULL) return NULL;
+    if (__atomic_compare_exchange_n(&_ms_worker_states[env_id], &states, fresh, false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+      states = fresh;
+    } else {
+      // Another worker of the environment installed the states first.
+      free(fresh);
+    }
+  }
+  return (states != NULL) ? &states[worker_id] : NULL;
+}
+
+// The index key of a reaction; the two reserved values are aliased.
+static uint64_t _ms_ready_index_key(uint64_t reaction_index) {
+  if (reaction_index == MS_READY_KEY_EMPTY) return MS_READY_KEY_ZERO_ALIAS;
+  if (reaction_index == MS_READY_KEY_TOMBSTONE) return MS_READY_KEY_TOMBSTONE_ALIAS;
+  return reaction_index;
+}
+
+static ms_ready_index_slot_t* _ms_ready_index_slot(ms_ready_set_t* set, uint64_t reaction_index,
+                                                   bool insert_if_missing) {
+  const uint64_t key = _ms_ready_index_key(reaction_index);
+  // Reaction keys are already hashes, but mix once more so that small integer
+  // indexes do not land in adjacent slots.
+  uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+  const size_t start = (size_t)(h >> 32) & (MS_READY_INDEX_SIZE - 1);
+  size_t i = start;
+  for (int probe = 0; probe < MS_READY_INDEX_SIZE; probe++) {
+    ms_ready_index_slot_t* slot = &set->index[i];
+    uint64_t cur = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
+    if (cur == key) return slot;
+    if (cur == MS_READY_KEY_EMPTY) break;
+    i = (i + 1) & (MS_READY_INDEX_SIZE - 1);
+  }
+  if (!insert_if_missing) return NULL;
+
+  // Probe again under the lock, so that a key is never added twice, and take
+  // the first tombstone or empty slot.
+  ms_ready_index_slot_t* found = NULL;
+  ms_ready_index_slot_t* free_slot = NULL;
+  pthread_mutex_lock(&set->index_lock);
+  i = start;
+  for (int probe = 0; probe < MS_READY_INDEX_SIZE; probe++) {
+    ms_ready_index_slot_t* slot = &set->index[i];
+    uint64_t cur = __atomic_load_n(&slot->key, __ATOMIC_RELAXED);
+    if (cur == key) {
+      found = slot;
+      break;
+    }
+    if (cur == MS_READY_KEY_TOMBSTONE && free_slot == NULL) free_slot = slot;
+    if (cur == MS_READY_KEY_EMPTY) {
+      if (free_slot == NULL) {
+        free_slot = slot;
+        __atomic_store_n(&set->index_used, set->index_used + 1, __ATOMIC_RELAXED);
+      }
+      break;
+    }
+    i = (i + 1) & (MS_READY_INDEX_SIZE - 1);
+  }
+  if (found == NULL && free_slot != NULL) {
+    __atomic_store_n(&free_slot->key, key, __ATOMIC_RELEASE);
+    found = free_slot;
+  }
+  pthread_mutex_unlock(&set->index_lock);
+  return found;
+}
+
+// Replace the key of a reaction that just left the ready set by a tombstone,
+// unless the index is still sparse or the reaction has become ready again.
+static void _ms_ready_index_retire(ms_ready_set_t* set, ms_ready_index_slot_t* islot) {
+  if (__atomic_load_n(&set->index_used, __ATOMIC_RELAXED) < MS_READY_INDEX_RETIRE_AT) return;
+  int32_t expected = 0;
+  // Hold loc at -1 so that no ready can claim the slot while its key changes.
+  if (!__atomic_compare_exchange_n(&islot->loc, &expected, -1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  pthread_mutex_lock(&set->index_lock);
+  __atomic_store_n(&islot->key, MS_READY_KEY_TOMBSTONE, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&set->index_lock);
+  __atomic_store_n(&islot->loc, 0, __ATOMIC_RELEASE);
+}
+
+static bool _ms_ready_before(const ms_ready_entry_t* a, const ms_ready_entry_t* b) {
+  return a->deadline_ns < b->deadline_ns ||
+         (a->deadline_ns == b->deadline_ns && a->ready_time_ns < b->ready_time_ns);
+}
+
+static void _ms_heap_swap(ms_ready_shard_t* shard, int* heap, int i, int j) {
+  int tmp = heap[i];
+  heap[i] = heap[j];
+  heap[j] = tmp;
+  shard->entries[heap[i]].heap_pos = i;
+  shard->entries[heap[j]].heap_pos = j;
+}
+
+static void _ms_heap_sift(ms_ready_shard_t* shard, ms_criticality_t crit, int pos) {
+  int* heap = shard->heap[crit];
+  const int size = shard->heap_size[crit];
+  while (pos > 0) {
+    int parent = (pos - 1) / 2;
+    if (!_ms_ready_before(&shard->entries[heap[pos]], &shard->entries[heap[parent]])) break;
+    _ms_heap_swap(shard, heap, pos, parent);
+    pos = parent;
+  }
+  for (;;) {
+    int best = pos;
+    int left = 2 * pos + 1;
+    int right = left + 1;
+    if (left < size && _ms_ready_before(&shard->entries[heap[left]], &shard->entries[heap[best]])) best = left;
+    if (right < size && _ms_ready_before(&shard->entries[heap[right]], &shard->entries[heap[best]])) best = right;
+    if (best == pos) break;
+    _ms_heap_swap(shard, heap, pos, best);
+    pos = best;
+  }
+}
+
+static void _ms_heap_push(ms_ready_shard_t* shard, int slot) {
+  ms_ready_entry_t* entry = &shard->entries[slot];
+  const int pos = shard->heap_size[entry->criticality]++;
+  shard->heap[entry->criticality][pos] = slot;
+  entry->heap_pos = pos;
+  _ms_heap_sift(shard, entry->criticality, pos);
+}
+
+static void _ms_heap_remove(ms_ready_shard_t* shard, int slot) {
+  ms_ready_entry_t* entry = &shard->entries[slot];
+  const ms_criticality_t crit = entry->criticality;
+  const int pos = entry->heap_pos;
+  if (pos < 0) return;
+  const int last = --shard->heap_size[crit];
+  if (pos != last) {
+    shard->heap[crit][pos] = shard->heap[crit][last];
+    shard->entries[shard->heap[crit][pos]].heap_pos = pos;
+    _ms_heap_sift(shard, crit, pos);
+  }
+  entry->heap_pos = -1;
+}
+
+// Publish the heap heads and counters of a shard. Caller holds shard->lock.
+static void _ms_shard_publish(ms_ready_shard_t* shard) {
+  __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for (int c = 0; c < MS_CRIT_COUNT; c++) {
+    ms_ready_head_t* head = &shard->heads[c];
+    if (shard->heap_size[c] > 0) {
+      const ms_ready_entry_t* top = &shard->entries[shard->heap[c][0]];
+      __atomic_store_n(&head->deadline_ns, top->deadline_ns, __ATOMIC_RELAXED);
+      __atomic_store_n(&head->ready_time_ns, top->ready_time_ns, __ATOMIC_RELAXED);
+      __atomic_store_n(&head->reaction_index, top->reaction_index, __ATOMIC_RELAXED);
+      __atomic_store_n(&head->valid, 1, __ATOMIC_RELAXED);
+    } else {
+      __atomic_store_n(&head->valid, 0, __ATOMIC_RELAXED);
+    }
+  }
+  __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELEASE);
 }
 
-static int _ms_ready_find(ms_ready_set_t* set, uint64_t reaction_index) {
-  for (int i = 0; i < set->count; i++) {
-    if (set->entries[i].reaction_index == reaction_index) return i;
+// Lock-free snapshot of the published heads of a shard.
+static void _ms_shard_read_heads(ms_ready_shard_t* shard, ms_ready_head_t heads[MS_CRIT_COUNT]) {
+  for (;;) {
+    uint32_t before = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+    if ((before & 1U) == 0) {
+      for (int c = 0; c < MS_CRIT_COUNT; c++) {
+        heads[c].valid = __atomic_load_n(&shard->heads[c].valid, __ATOMIC_RELAXED);
+        heads[c].deadline_ns = __atomic_load_n(&shard->heads[c].deadline_ns, __ATOMIC_RELAXED);
+        heads[c].ready_time_ns = __atomic_load_n(&shard->heads[c].ready_time_ns, __ATOMIC_RELAXED);
+        heads[c].reaction_index = __atomic_load_n(&shard->heads[c].reaction_index, __ATOMIC_RELAXED);
+      }
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) == before) return;
+    }
+    sched_yield();
   }
-  return -1;
 }
 
-static void _ms_ready_remove_at(ms_ready_set_t* set, int index) {
-  if (index < 0 || index >= set->count) return;
-  set->count--;
-  if (index != set->count) {
-    set->entries[index] = set->entries[set->count];
+static bool _ms_head_before(const ms_ready_head_t* a, const ms_ready_head_t* b) {
+  if (!a->valid) return false;
+  if (!b->valid) return true;
+  return a->deadline_ns < b->deadline_ns ||
+         (a->deadline_ns == b->deadline_ns && a->ready_time_ns < b->ready_time_ns);
+}
+
+// Lock the shard that holds reaction_index and return its slot, or -1 with no
+// lock held when the reaction is not in the set.
+static int _ms_ready_lock_entry(ms_ready_set_t* set, ms_ready_index_slot_t* islot, uint64_t reaction_index,
+                                ms_ready_shard_t** out_shard) {
+  for (;;) {
+    int32_t loc = __atomic_load_n(&islot->loc, __ATOMIC_ACQUIRE);
+    if (loc <= 0) return -1;
+    ms_ready_shard_t* shard = &set->shards[(loc - 1) / MS_READY_PER_SHARD];
+    const int slot = (loc - 1) % MS_READY_PER_SHARD;
+    pthread_mutex_lock(&shard->lock);
+    if (__atomic_load_n(&islot->loc, __ATOMIC_RELAXED) == loc && shard->entries[slot].in_use &&
+        shard->entries[slot].reaction_index == reaction_index) {
+      *out_shard = shard;
+      return slot;
+    }
+    // Moved or removed while we were acquiring the lock.
+    pthread_mutex_unlock(&shard->lock);
+    // The index slot now belongs to another reaction.
+    if (__atomic_load_n(&islot->key, __ATOMIC_ACQUIRE) != _ms_ready_index_key(reaction_index)) return -1;
+  }
+}
+
+// Caller holds shard->lock; the index slot is cleared before the lock is released.
+static void _ms_ready_remove_locked(ms_ready_shard_t* shard, ms_ready_index_slot_t* islot, int slot) {
+  ms_ready_entry_t* entry = &shard->entries[slot];
+  if (entry->heap_pos >= 0) {
+    _ms_heap_remove(shard, slot);
+    __atomic_store_n(&shard->queued, shard->queued - 1, __ATOMIC_RELAXED);
+  }
+  entry->in_use = false;
+  shard->free_slots[shard->free_top++] = slot;
+  __atomic_store_n(&shard->count, shard->count - 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&islot->loc, 0, __ATOMIC_RELEASE);
+  _ms_shard_publish(shard);
+}
+
+static bool _ms_ready_remove(ms_ready_set_t* set, uint64_t reaction_index) {
+  ms_ready_index_slot_t* islot = _ms_ready_index_slot(set, reaction_index, false);
+  if (islot == NULL) return false;
+  ms_ready_shard_t* shard = NULL;
+  int slot = _ms_ready_lock_entry(set, islot, reaction_index, &shard);
+  if (slot < 0) return false;
+  _ms_ready_remove_locked(shard, islot, slot);
+  pthread_mutex_unlock(&shard->lock);
+  _ms_ready_index_retire(set, islot);
+  return true;
+}
+
+static int _ms_ready_queued(ms_ready_set_t* set) {
+  int total = 0;
+  for (int s = 0; s < MS_READY_SHARDS; s++) {
+    total += __atomic_load_n(&set->shards[s].queued, __ATOMIC_RELAXED);
+  }
+  return total;
+}
+
+static int _ms_ready_count(ms_ready_set_t* set) {
+  int total = 0;
+  for (int s = 0; s < MS_READY_SHARDS; s++) {
+    total += __atomic_load_n(&set->shards[s].count, __ATOMIC_RELAXED);
+  }
+  return total;
+}
+
+// "a|b|c" list of queued reactions for diagnostics. Takes every shard lock in
+// turn, so only call it when the resulting line is actually going to be logged.
+static void _ms_ready_describe(ms_ready_set_t* set, char* buf, size_t size) {
+  buf[0] = '\0';
+  if (set == NULL) return;
+  size_t used = 0;
+  for (int s = 0; s < MS_READY_SHARDS; s++) {
+    ms_ready_shard_t* shard = &set->shards[s];
+    if (__atomic_load_n(&shard->count, __ATOMIC_RELAXED) == 0) continue;
+    pthread_mutex_lock(&shard->lock);
+    for (int c = 0; c < MS_CRIT_COUNT; c++) {
+      for (int i = 0; i < shard->heap_size[c] && used < size - 32; i++) {
+        int n = snprintf(buf + used, size - used, "%s%llu", used == 0 ? "" : "|",
+                         (unsigned long long)shard->entries[shard->heap[c][i]].reaction_index);
+        if (n > 0) used += (size_t)n;
+      }
+    }
+    pthread_mutex_unlock(&shard->lock);
   }
 }
 
@@ -598,6 +1023,83 @@ static void _ms_logf(ms_log_level_t lvl, const char* fmt, ...) {
   pthread_mutex_unlock(&_ms_lock);
 }
 
+// Route a hot-path event to the binary log. Returns false when the caller should
+// fall back to the text log; true when the event was handled (written or filtered).
+static bool _ms_bin_log(ms_log_level_t lvl, ms_bin_event_t event, int env_id, int worker_id, uint64_t key,
+                        int32_t i0, int32_t i1, int32_t i2, int64_t a, int64_t b, int64_t c) {
+  if (!_ms_binary_log) return false;
+  if (!_ms_enabled || lvl > _ms_level) return true;
+  ms_bin_record_t rec = {
+    .mono_ns = _ms_now_mono_ns(),
+    .event = (uint16_t)event,
+    .level = (uint8_t)lvl,
+    .reserved = 0,
+    .env_id = env_id,
+    .worker_id = worker_id,
+    .i0 = i0,
+    .i1 = i1,
+    .i2 = i2,
+    .key = key,
+    .a = a,
+    .b = b,
+    .c = c
+  };
+  ms_binlog_write(&rec);
+  return true;
+}
+
+// ---------------- CPU-time budgets ----------------
+//
+// With budget_type=cpu_time, the CPU time of each LC reaction is charged to
+// its own budget (the budget column of its config line) and to the env-wide
+// default_budget, both in nanoseconds per budget_window_ns of monotonic time.
+// A negative budget is unlimited.
+
+// CPU time used in a window that started at *start, or 0 once it has expired.
+static int64_t _ms_window_used(const int64_t* start, const int64_t* used, int64_t now) {
+  if (now - __atomic_load_n(start, __ATOMIC_RELAXED) >= _ms_policy.budget_window_ns) return 0;
+  return __atomic_load_n(used, __ATOMIC_RELAXED);
+}
+
+static void _ms_charge_lc_cpu(int env_id, uint64_t reaction_index, int64_t cpu_ns) {
+  ms_reaction_policy_t* pol = _ms_find_configured_policy(env_id, reaction_index);
+  if (pol == NULL || pol->criticality != MS_CRIT_LOW) return;
+  const int64_t now = _ms_now_mono_ns();
+  // A reaction runs on one worker at a time, so only readers race with this.
+  if (now - pol->window_start_mono_ns >= _ms_policy.budget_window_ns) {
+    __atomic_store_n(&pol->window_start_mono_ns, now, __ATOMIC_RELAXED);
+    __atomic_store_n(&pol->used_in_window, 0, __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&pol->used_in_window, cpu_ns, __ATOMIC_RELAXED);
+
+  ms_ready_set_t* set = _ms_get_ready_set(env_id, false);
+  if (set == NULL) return;
+  pthread_mutex_lock(&set->lc_budget_lock);
+  if (now - set->lc_cpu_window_start_ns >= _ms_policy.budget_window_ns) {
+    set->lc_cpu_window_start_ns = now;
+    set->lc_cpu_used_ns = 0;
+  }
+  set->lc_cpu_used_ns += cpu_ns;
+  pthread_mutex_unlock(&set->lc_budget_lock);
+}
+
+// Whether an LC reaction may still run under pressure. Without any budget,
+// every LC reaction is shed, as with reaction_count.
+static int _ms_lc_cpu_within_budget(ms_ready_set_t* set, ms_reaction_policy_t* pol) {
+  if (pol->budget < 0 && _ms_policy.default_budget < 0) return 0;
+  const int64_t now = _ms_now_mono_ns();
+  if (pol->budget >= 0 && _ms_window_used(&pol->window_start_mono_ns, &pol->used_in_window, now) >= pol->budget) {
+    return 0;
+  }
+  if (_ms_policy.default_budget >= 0) {
+    pthread_mutex_lock(&set->lc_budget_lock);
+    const int64_t used = _ms_window_used(&set->lc_cpu_window_start_ns, &set->lc_cpu_used_ns, now);
+    pthread_mutex_unlock(&set->lc_budget_lock);
+    if (used >= _ms_policy.default_budget) return 0;
+  }
+  return 1;
+}
+
 // atexit() handler must be a function with signature void(void).
 static void _ms_shutdown_atexit(void) {
   ms_shutdown();
@@ -667,9 +1169,16 @@ bool ms_init(const char* config_path) {
   fprintf(_ms_log, "# phase3 master_scheduler started pid=%d\n", (int)getpid());
   fflush(_ms_log);
 
-  for (int i = 0; i < MS_MAX_ENVS; i++) {
-    _ms_ready_sets[i].count = 0;
-    _ms_ready_sets[i].last_pick_reaction_index = -1;
+  if (_ms_is_true(getenv("LF_MS_LOG_BINARY"))) {
+    char bin_path[512];
+    const char* bin = getenv("LF_MS_LOG_BINARY_PATH");
+    if (bin == NULL || bin[0] == '\0') {
+      snprintf(bin_path, sizeof(bin_path), "%s.bin", path);
+      bin = bin_path;
+    }
+    _ms_binary_log = ms_binlog_open(bin);
+    fprintf(_ms_log, "# binary event log %s path=%s\n", _ms_binary_log ? "enabled" : "open_failed", bin);
+    fflush(_ms_log);
   }
 
   pthread_mutex_unlock(&_ms_lock);
@@ -679,7 +1188,30 @@ bool ms_init(const char* config_path) {
     cfg_path = getenv("LF_MS_CONFIG");
   }
   _ms_load_config(cfg_path);
+  _ms_default_reaction_policy.env_id = -1;
+  _ms_default_reaction_policy.criticality = MS_CRIT_HIGH;
+  _ms_default_reaction_policy.degradable = false;
+  _ms_default_reaction_policy.budget = _ms_policy.default_budget;
+  _ms_default_reaction_policy.in_use = true;
   _ms_os_load_env();
+  const char* stats_path = getenv("LF_MS_STATS_PATH");
+  if (stats_path != NULL && stats_path[0] != '\0') {
+    snprintf(_ms_stats_path, sizeof(_ms_stats_path), "%s", stats_path);
+  }
+  _ms_exec_stats = _ms_is_true(getenv("LF_MS_STATS")) || _ms_stats_path[0] != '\0' ||
+                   _ms_policy.budget_type == MS_BUDGET_CPU_TIME;
+  const char* metrics_path = getenv("LF_MS_METRICS_PATH");
+  if (_ms_is_true(getenv("LF_MS_METRICS")) || (metrics_path != NULL && metrics_path[0] != '\0')) {
+    char default_metrics_path[64];
+    if (metrics_path == NULL || metrics_path[0] == '\0') {
+      snprintf(default_metrics_path, sizeof(default_metrics_path), "/dev/shm/lf_ms_metrics.%d", (int)getpid());
+      metrics_path = default_metrics_path;
+    }
+    _ms_live_metrics = ms_metrics_open(metrics_path);
+    _ms_logf(MS_LEVEL_INFO, "event=metrics_page status=%s path=%s", _ms_live_metrics ? "enabled" : "open_failed",
+             metrics_path);
+  }
+  __atomic_store_n(&_ms_active, true, __ATOMIC_RELEASE);
 
   return true;
 }
@@ -693,6 +1225,13 @@ void ms_shutdown(void) {
     return;
   }
   _ms_shutdown_called = true;
+  __atomic_store_n(&_ms_active, false, __ATOMIC_RELEASE);
+  ms_binlog_close();
+  _ms_live_metrics = false;
+  ms_metrics_close();
+  if (_ms_stats_path[0] != '\0' && !ms_stats_export(_ms_stats_path) && _ms_log != NULL) {
+    fprintf(_ms_log, "# execution stats export failed path=%s\n", _ms_stats_path);
+  }
 
   if (_ms_log != NULL) {
     fprintf(_ms_log, "# phase3 master_scheduler shutdown pid=%d\n", (int)getpid());
@@ -719,7 +1258,9 @@ void ms_set_enabled(bool enabled) {
 void ms_register_worker(const ms_worker_info_t* info) {
   if (info == NULL) return;
 
-  // Phase 0: log only
+  // Called on the worker's own thread; remembered to pick its ready-set shard.
+  _ms_tls_worker_id = (int)info->worker_id;
+
   _ms_logf(MS_LEVEL_INFO,
            "event=register_worker worker_id=%d os_pid=%d os_tid=%d name=%s flags=0x%x",
            (int)info->worker_id,
@@ -746,7 +1287,12 @@ void ms_report(const ms_report_t* report) {
     return;
   }
   _ms_last_report_mono_ns[wid] = now;
-  
+
+  if (_ms_bin_log(MS_LEVEL_INFO, MS_BIN_EV_REPORT, -1, (int)report->worker_id, (uint64_t)report->deadline_misses,
+                  (int32_t)report->reactor_id, (int32_t)report->reaction_id, (int32_t)report->ready_q_len,
+                  report->logical_time_ns, report->physical_time_ns, report->lag_ns)) {
+    return;
+  }
   _ms_logf(MS_LEVEL_INFO,
            "event=report worker_id=%d reactor_id=%d reaction_id=%d logical=%lld physical=%lld lag=%lld ready_q=%d miss=%lld",
            (int)report->worker_id,
@@ -775,42 +1321,103 @@ void ms_on_reaction_ready(
     long long deadline_ns,
     int is_input
 ) {
-    if (!_ms_enabled) return;
+    if (!_ms_enabled || !__atomic_load_n(&_ms_active, __ATOMIC_ACQUIRE)) return;
 
     int updated = 0;
     int dropped = 0;
     int64_t ready_time = _ms_now_mono_ns();
 
-    pthread_mutex_lock(&_ms_lock);
-    if (_ms_enabled && _ms_log != NULL) {
-      ms_ready_set_t* set = _ms_get_ready_set(env_id);
-      if (set == NULL) {
-        dropped = 1;
-      } else {
-        int idx = _ms_ready_find(set, reaction_index);
-        if (idx >= 0) {
-          ms_ready_entry_t* entry = &set->entries[idx];
+    ms_ready_set_t* set = _ms_get_ready_set(env_id, true);
+    ms_ready_index_slot_t* islot = (set != NULL) ? _ms_ready_index_slot(set, reaction_index, true) : NULL;
+    if (islot == NULL) {
+      dropped = 1;
+    } else {
+      const ms_criticality_t crit = _ms_reaction_criticality(env_id, reaction_index);
+      const int home = (_ms_tls_worker_id < 0) ? 0 : (_ms_tls_worker_id % MS_READY_SHARDS);
+      const uint64_t key = _ms_ready_index_key(reaction_index);
+      for (;;) {
+        if (__atomic_load_n(&islot->key, __ATOMIC_ACQUIRE) != key) {
+          // The key was retired from this index slot; add it again.
+          islot = _ms_ready_index_slot(set, reaction_index, true);
+          if (islot == NULL) {
+            dropped = 1;
+            break;
+          }
+        }
+        ms_ready_shard_t* shard = NULL;
+        int slot = _ms_ready_lock_entry(set, islot, reaction_index, &shard);
+        if (slot >= 0) {
+          // Already held (possibly running): refresh in place.
+          ms_ready_entry_t* entry = &shard->entries[slot];
           entry->deadline_ns = deadline_ns;
           entry->ready_time_ns = ready_time;
           entry->is_input = is_input;
           entry->state = MS_READY;
+          if (entry->heap_pos >= 0) {
+            _ms_heap_sift(shard, entry->criticality, entry->heap_pos);
+          } else {
+            _ms_heap_push(shard, slot);
+            __atomic_store_n(&shard->queued, shard->queued + 1, __ATOMIC_RELAXED);
+          }
+          _ms_shard_publish(shard);
+          pthread_mutex_unlock(&shard->lock);
           updated = 1;
-        } else if (set->count < MS_MAX_READY_PER_ENV) {
-          ms_ready_entry_t* entry = &set->entries[set->count++];
-          entry->reaction_index = reaction_index;
-          entry->deadline_ns = deadline_ns;
-          entry->ready_time_ns = ready_time;
-          entry->is_input = is_input;
-          entry->state = MS_READY;
-        } else {
-          dropped = 1;
+          break;
         }
 
+        // Not held: file it in this worker's shard, or the next one with room.
+        int s = 0;
+        for (; s < MS_READY_SHARDS; s++) {
+          shard = &set->shards[(home + s) % MS_READY_SHARDS];
+          pthread_mutex_lock(&shard->lock);
+          if (shard->free_top > 0) break;
+          pthread_mutex_unlock(&shard->lock);
+        }
+        if (s == MS_READY_SHARDS) {
+          dropped = 1;
+          break;
+        }
+        slot = shard->free_slots[--shard->free_top];
+        const int32_t loc = (int32_t)((shard - set->shards) * MS_READY_PER_SHARD + slot + 1);
+        int32_t expected = 0;
+        // Claim the index slot while still holding the shard lock so that a
+        // concurrent start/end sees a fully initialized entry.
+        if (!__atomic_compare_exchange_n(&islot->loc, &expected, loc, false, __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE)) {
+          // Lost a race with another ready of the same reaction; update theirs.
+          shard->free_slots[shard->free_top++] = slot;
+          pthread_mutex_unlock(&shard->lock);
+          continue;
+        }
+        if (__atomic_load_n(&islot->key, __ATOMIC_ACQUIRE) != key) {
+          // The key was retired before the claim; give the slot back and retry.
+          __atomic_store_n(&islot->loc, 0, __ATOMIC_RELEASE);
+          shard->free_slots[shard->free_top++] = slot;
+          pthread_mutex_unlock(&shard->lock);
+          continue;
+        }
+        ms_ready_entry_t* entry = &shard->entries[slot];
+        entry->reaction_index = reaction_index;
+        entry->deadline_ns = deadline_ns;
+        entry->ready_time_ns = ready_time;
+        entry->is_input = is_input;
+        entry->state = MS_READY;
+        entry->criticality = crit;
+        entry->in_use = true;
+        _ms_heap_push(shard, slot);
+        __atomic_store_n(&shard->count, shard->count + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&shard->queued, shard->queued + 1, __ATOMIC_RELAXED);
+        _ms_shard_publish(shard);
+        pthread_mutex_unlock(&shard->lock);
+        break;
       }
     }
-    pthread_mutex_unlock(&_ms_lock);
 
     if (dropped) {
+      if (_ms_bin_log(MS_LEVEL_WARN, MS_BIN_EV_READY_DROP, env_id, _ms_tls_worker_id, reaction_index, is_input, 0, 0,
+                      logical_time_ns, deadline_ns, 0)) {
+        return;
+      }
       _ms_logf(
           MS_LEVEL_WARN,
           "event=ready_drop env=%d reaction_index=%llu logical=%lld deadline=%lld is_input=%d",
@@ -819,7 +1426,9 @@ void ms_on_reaction_ready(
       return;
     }
 
-    if (!_ms_minimal_log) {
+    if (!_ms_minimal_log &&
+        !_ms_bin_log(MS_LEVEL_DEBUG, MS_BIN_EV_READY, env_id, _ms_tls_worker_id, reaction_index, is_input, updated,
+                     0, logical_time_ns, deadline_ns, 0)) {
       _ms_logf(
           MS_LEVEL_DEBUG,
           "event=ready env=%d reaction_index=%llu logical=%lld deadline=%lld is_input=%d updated=%d",
@@ -836,7 +1445,9 @@ long long ms_pick_next(
 ) {
     if (!_ms_enabled) return -1;
     if (_ms_observe_only) {
-      if (!_ms_minimal_log) {
+      if (!_ms_minimal_log &&
+          !_ms_bin_log(MS_LEVEL_INFO, MS_BIN_EV_PICK_OBSERVE_ONLY, env_id, worker_id, 0, 0, 0, 0, logical_time_ns,
+                       0, 0)) {
         _ms_logf(
             MS_LEVEL_INFO,
             "event=pick_next env=%d candidate=-1 reason=observe_only logical=%lld",
@@ -845,18 +1456,10 @@ long long ms_pick_next(
       return -1;
     }
 
-    uint64_t candidate = 0;
-    int has_candidate = 0;
-    int64_t candidate_deadline = 0;
-    int64_t candidate_ready = 0;
-    uint64_t fallback_candidate = 0;
-    int has_fallback_candidate = 0;
-    int64_t fallback_deadline = 0;
-    int64_t fallback_ready = 0;
-    uint64_t hc_candidate = 0;
-    int has_hc_candidate = 0;
-    int64_t hc_deadline = 0;
-    int64_t hc_ready = 0;
+    // Lock-free: merge the published per-shard heads instead of scanning entries.
+    ms_ready_head_t candidate = {0};
+    ms_ready_head_t fallback = {0};
+    ms_ready_head_t hc = {0};
     int force_hc_guard = 0;
     int degrade_pressure = 0;
     int ready_count = 0;
@@ -865,105 +1468,71 @@ long long ms_pick_next(
     const ms_criticality_t target_crit = _ms_worker_target_crit(worker_id);
     const int partition_enabled = _ms_partition_enabled;
 
-    pthread_mutex_lock(&_ms_lock);
-    if (_ms_enabled && _ms_log != NULL) {
-      ms_ready_set_t* set = _ms_get_ready_set(env_id);
+    ms_ready_set_t* set = NULL;
+    if (__atomic_load_n(&_ms_active, __ATOMIC_ACQUIRE)) {
+      set = _ms_get_ready_set(env_id, false);
       if (_ms_os_config.hc_guard_enabled &&
           env_id >= 0 && env_id < MS_MAX_ENVS &&
-          _ms_env_pressure[env_id]) {
+          __atomic_load_n(&_ms_env_pressure[env_id], __ATOMIC_RELAXED)) {
         force_hc_guard = 1;
       }
       if (_ms_degrade_enabled &&
           env_id >= 0 && env_id < MS_MAX_ENVS &&
-          _ms_env_degrade_pressure[env_id]) {
+          __atomic_load_n(&_ms_env_degrade_pressure[env_id], __ATOMIC_RELAXED)) {
         degrade_pressure = 1;
       }
       if (set != NULL) {
-        int i = 0;
-        while (i < set->count) {
-          ms_ready_entry_t* entry = &set->entries[i];
-          if (entry->state == MS_RUNNING) {
-            i++;
-            continue;
-          }
-          ready_count++;
-          size_t used = strlen(ready_buf);
-          if (used < sizeof(ready_buf) - 32) {
-            snprintf(ready_buf + used, sizeof(ready_buf) - used, "%s%llu",
-                     used == 0 ? "" : "|",
-                     (unsigned long long)entry->reaction_index);
-          }
-
-          ms_reaction_policy_t* pol = _ms_find_policy(env_id, entry->reaction_index);
-
-          ms_criticality_t entry_crit = MS_CRIT_HIGH;
-          if (pol != NULL) {
-            entry_crit = pol->criticality;
-          }
-
-          if (!has_fallback_candidate ||
-              entry->deadline_ns < fallback_deadline ||
-              (entry->deadline_ns == fallback_deadline &&
-               entry->ready_time_ns < fallback_ready)) {
-            fallback_candidate = entry->reaction_index;
-            fallback_deadline = entry->deadline_ns;
-            fallback_ready = entry->ready_time_ns;
-            has_fallback_candidate = 1;
-          }
-
-          if (entry_crit == MS_CRIT_HIGH) {
-            if (!has_hc_candidate ||
-                entry->deadline_ns < hc_deadline ||
-                (entry->deadline_ns == hc_deadline &&
-                 entry->ready_time_ns < hc_ready)) {
-              hc_candidate = entry->reaction_index;
-              hc_deadline = entry->deadline_ns;
-              hc_ready = entry->ready_time_ns;
-              has_hc_candidate = 1;
+        for (int s = 0; s < MS_READY_SHARDS; s++) {
+          ms_ready_shard_t* shard = &set->shards[s];
+          if (__atomic_load_n(&shard->queued, __ATOMIC_RELAXED) == 0) continue;
+          ms_ready_head_t heads[MS_CRIT_COUNT];
+          _ms_shard_read_heads(shard, heads);
+          for (int c = 0; c < MS_CRIT_COUNT; c++) {
+            if (_ms_head_before(&heads[c], &fallback)) fallback = heads[c];
+            if (c == MS_CRIT_HIGH && _ms_head_before(&heads[c], &hc)) hc = heads[c];
+            if ((!partition_enabled || c == (int)target_crit) && _ms_head_before(&heads[c], &candidate)) {
+              candidate = heads[c];
             }
           }
-
-          if (!partition_enabled || entry_crit == target_crit) {
-            if (!has_candidate ||
-                entry->deadline_ns < candidate_deadline ||
-                (entry->deadline_ns == candidate_deadline &&
-                 entry->ready_time_ns < candidate_ready)) {
-              candidate = entry->reaction_index;
-              candidate_deadline = entry->deadline_ns;
-              candidate_ready = entry->ready_time_ns;
-              has_candidate = 1;
-            }
-          }
-          i++;
         }
-        if ((force_hc_guard || degrade_pressure || _ms_hc_strict_priority) && has_hc_candidate) {
-          candidate = hc_candidate;
-          candidate_deadline = hc_deadline;
-          candidate_ready = hc_ready;
-          has_candidate = 1;
+        if ((force_hc_guard || degrade_pressure || _ms_hc_strict_priority) && hc.valid) {
+          candidate = hc;
         }
-        if (!has_candidate && has_fallback_candidate) {
-          candidate = fallback_candidate;
-          candidate_deadline = fallback_deadline;
-          candidate_ready = fallback_ready;
-          has_candidate = 1;
+        if (!candidate.valid && fallback.valid) {
+          candidate = fallback;
         }
-        set->last_pick_reaction_index = has_candidate ? (long long)candidate : -1;
+        __atomic_store_n(&set->last_pick_reaction_index,
+                         candidate.valid ? (long long)candidate.reaction_index : -1LL, __ATOMIC_RELAXED);
       }
     }
-    pthread_mutex_unlock(&_ms_lock);
 
     if (!_ms_minimal_log) {
-      if (has_candidate) {
-        _ms_logf(
-            MS_LEVEL_DEBUG,
-            "event=pick_next env=%d candidate=%llu reason=%s deadline=%lld ready_time=%lld logical=%lld ready_count=%d ready_set=%s",
-            env_id, (unsigned long long)candidate, (long long)candidate_deadline,
-            (force_hc_guard || degrade_pressure || _ms_hc_strict_priority) ? "hc_first" : "earliest_deadline",
-            (long long)candidate_ready, logical_time_ns, ready_count,
-            ready_buf[0] != '\0' ? ready_buf : "-"
-        );
-      } else {
+      if (set != NULL) {
+        ready_count = _ms_ready_queued(set);
+      }
+      const int hc_first = (force_hc_guard || degrade_pressure || _ms_hc_strict_priority) ? 1 : 0;
+      if (candidate.valid) {
+        // The binary record does not carry the ready_set listing.
+        if (!_ms_bin_log(MS_LEVEL_DEBUG, MS_BIN_EV_PICK_NEXT, env_id, worker_id, candidate.reaction_index, hc_first,
+                         ready_count, 0, logical_time_ns, candidate.deadline_ns, candidate.ready_time_ns)) {
+          if (_ms_level >= MS_LEVEL_DEBUG) {
+            _ms_ready_describe(set, ready_buf, sizeof(ready_buf));
+          }
+          _ms_logf(
+              MS_LEVEL_DEBUG,
+              "event=pick_next env=%d candidate=%llu reason=%s deadline=%lld ready_time=%lld logical=%lld ready_count=%d ready_set=%s",
+              env_id, (unsigned long long)candidate.reaction_index,
+              hc_first ? "hc_first" : "earliest_deadline",
+              (long long)candidate.deadline_ns,
+              (long long)candidate.ready_time_ns, logical_time_ns, ready_count,
+              ready_buf[0] != '\0' ? ready_buf : "-"
+          );
+        }
+      } else if (!_ms_bin_log(MS_LEVEL_INFO, MS_BIN_EV_FALLBACK_NO_CAND, env_id, worker_id, 0, 0, ready_count, 0,
+                              logical_time_ns, 0, 0)) {
+        if (_ms_level >= MS_LEVEL_INFO) {
+          _ms_ready_describe(set, ready_buf, sizeof(ready_buf));
+        }
         _ms_logf(
             MS_LEVEL_INFO,
             "event=fallback env=%d reason=no_candidate logical=%lld ready_count=%d ready_set=%s",
@@ -974,8 +1543,8 @@ long long ms_pick_next(
     }
 
     // Phase 3: return explicit candidate when available to avoid runtime stall.
-    if (has_candidate) {
-      return (long long)candidate;
+    if (candidate.valid) {
+      return (long long)candidate.reaction_index;
     }
     return -1;
 }
@@ -990,42 +1559,52 @@ void ms_on_reaction_start(
 
     int found = 0;
     long long last_pick = -1;
-    pthread_mutex_lock(&_ms_lock);
-    if (_ms_enabled && _ms_log != NULL) {
-      ms_ready_set_t* set = _ms_get_ready_set(env_id);
+    if (__atomic_load_n(&_ms_active, __ATOMIC_ACQUIRE)) {
+      ms_ready_set_t* set = _ms_get_ready_set(env_id, false);
       if (set != NULL) {
-        last_pick = set->last_pick_reaction_index;
-        int idx = _ms_ready_find(set, reaction_index);
-        if (idx >= 0) {
-          set->entries[idx].state = MS_RUNNING;
+        last_pick = __atomic_load_n(&set->last_pick_reaction_index, __ATOMIC_RELAXED);
+        ms_ready_index_slot_t* islot = _ms_ready_index_slot(set, reaction_index, false);
+        ms_ready_shard_t* shard = NULL;
+        int slot = (islot != NULL) ? _ms_ready_lock_entry(set, islot, reaction_index, &shard) : -1;
+        if (slot >= 0) {
+          ms_ready_entry_t* entry = &shard->entries[slot];
+          entry->state = MS_RUNNING;
+          if (entry->heap_pos >= 0) {
+            _ms_heap_remove(shard, slot);
+            __atomic_store_n(&shard->queued, shard->queued - 1, __ATOMIC_RELAXED);
+            _ms_shard_publish(shard);
+          }
+          pthread_mutex_unlock(&shard->lock);
           found = 1;
         }
       }
 
       ms_reaction_policy_t* pol = _ms_find_policy(env_id, reaction_index);
-      if (pol == NULL && _ms_policy.default_budget >= 0) {
-        pol = _ms_get_policy(env_id, reaction_index, true);
-      }
-      if (pol != NULL && worker_id >= 0 && worker_id < MS_MAX_WORKERS) {
-        _ms_worker_last_crit[worker_id] = pol->criticality;
-        _ms_worker_crit_known[worker_id] = 1;
+      ms_worker_state_t* worker = (pol != NULL) ? _ms_get_worker_state(env_id, worker_id, true) : NULL;
+      if (worker != NULL) {
+        worker->last_crit = pol->criticality;
+        worker->crit_known = 1;
         if (pol->criticality == MS_CRIT_HIGH) {
-          _ms_worker_crit_mask[worker_id] |= 0x1;
+          worker->crit_mask |= 0x1;
         } else if (pol->criticality == MS_CRIT_LOW) {
-          _ms_worker_crit_mask[worker_id] |= 0x2;
+          worker->crit_mask |= 0x2;
         }
       }
     }
-    pthread_mutex_unlock(&_ms_lock);
 
     if (!_ms_minimal_log) {
-      _ms_logf(
-          MS_LEVEL_DEBUG,
-          "event=runtime_selected env=%d reaction_index=%llu physical=%lld ready_found=%d",
-          env_id, (unsigned long long)reaction_index, physical_time_ns, found
-      );
+      if (!_ms_bin_log(MS_LEVEL_DEBUG, MS_BIN_EV_RUNTIME_SELECTED, env_id, worker_id, reaction_index, found, 0, 0,
+                       physical_time_ns, 0, 0)) {
+        _ms_logf(
+            MS_LEVEL_DEBUG,
+            "event=runtime_selected env=%d reaction_index=%llu physical=%lld ready_found=%d",
+            env_id, (unsigned long long)reaction_index, physical_time_ns, found
+        );
+      }
 
-      if (!found) {
+      if (!found &&
+          !_ms_bin_log(MS_LEVEL_WARN, MS_BIN_EV_SELECTED_MISSING, env_id, worker_id, reaction_index, 0, 0, 0,
+                       physical_time_ns, 0, 0)) {
         _ms_logf(
             MS_LEVEL_WARN,
             "event=runtime_selected_missing env=%d reaction_index=%llu physical=%lld",
@@ -1034,7 +1613,8 @@ void ms_on_reaction_start(
       }
     }
 
-    if (last_pick >= 0 && (uint64_t)last_pick != reaction_index) {
+    if (last_pick >= 0 && (uint64_t)last_pick != reaction_index &&
+        !_ms_bin_log(MS_LEVEL_WARN, MS_BIN_EV_MISMATCH, env_id, worker_id, reaction_index, 0, 0, 0, last_pick, 0, 0)) {
       _ms_logf(
           MS_LEVEL_WARN,
           "event=mismatch env=%d picked=%lld runtime=%llu",
@@ -1042,6 +1622,16 @@ void ms_on_reaction_start(
       );
     }
 
+    if (_ms_live_metrics) {
+      ms_metrics_reaction_start(env_id, worker_id, reaction_index, _ms_now_mono_ns());
+    }
+
+    // Sampled last so that the hook's own logging is not charged to the reaction.
+    if (_ms_exec_stats) {
+      _ms_tls_start_key = reaction_index;
+      _ms_tls_start_wall_ns = physical_time_ns;
+      _ms_tls_start_cpu_ns = ms_stats_thread_cpu_ns();
+    }
 }
 
 void ms_on_reaction_end(
@@ -1052,27 +1642,33 @@ void ms_on_reaction_end(
     int status
 ) {
     (void)worker_id;
-    (void)physical_time_ns;
     (void)status;
 
     if (!_ms_enabled) return;
 
-    int removed = 0;
-    pthread_mutex_lock(&_ms_lock);
-    if (_ms_enabled && _ms_log != NULL) {
-      ms_ready_set_t* set = _ms_get_ready_set(env_id);
-      if (set != NULL) {
-        int idx = _ms_ready_find(set, reaction_index);
-        if (idx >= 0) {
-          _ms_ready_remove_at(set, idx);
-          removed = 1;
-        }
+    if (_ms_exec_stats && _ms_tls_start_key == reaction_index) {
+      const int64_t cpu_end_ns = ms_stats_thread_cpu_ns();
+      const int64_t cpu_ns = (cpu_end_ns >= 0 && _ms_tls_start_cpu_ns >= 0) ? cpu_end_ns - _ms_tls_start_cpu_ns : -1;
+      ms_stats_record(env_id, reaction_index, physical_time_ns - _ms_tls_start_wall_ns, cpu_ns);
+      if (_ms_policy.budget_type == MS_BUDGET_CPU_TIME && cpu_ns > 0) {
+        _ms_charge_lc_cpu(env_id, reaction_index, cpu_ns);
       }
+      _ms_tls_start_key = 0;
+    }
+    if (_ms_live_metrics) {
+      ms_metrics_reaction_end(env_id, worker_id, reaction_index, _ms_now_mono_ns());
+    }
 
+    int removed = 0;
+    if (__atomic_load_n(&_ms_active, __ATOMIC_ACQUIRE)) {
+      ms_ready_set_t* set = _ms_get_ready_set(env_id, false);
+      if (set != NULL && _ms_ready_remove(set, reaction_index)) {
+        removed = 1;
+      }
     }
-    pthread_mutex_unlock(&_ms_lock);
 
-    if (!removed && !_ms_minimal_log) {
+    if (!removed && !_ms_minimal_log &&
+        !_ms_bin_log(MS_LEVEL_WARN, MS_BIN_EV_MISSING_ON_END, env_id, worker_id, reaction_index, 0, 0, 0, 0, 0, 0)) {
       _ms_logf(
           MS_LEVEL_WARN,
           "event=ready_missing_on_end env=%d reaction_index=%llu",
@@ -1087,7 +1683,6 @@ bool ms_should_skip_reaction(
     uint64_t reaction_index,
     long long logical_time_ns
 ) {
-  (void)worker_id;
   if (!_ms_enabled || !_ms_degrade_enabled) return false;
   if (_ms_policy.degrade_action != MS_DEGRADE_SKIP) return false;
 
@@ -1097,36 +1692,33 @@ bool ms_should_skip_reaction(
   char ready_buf[1024];
   ready_buf[0] = '\0';
 
-  pthread_mutex_lock(&_ms_lock);
-  ms_ready_set_t* set = _ms_get_ready_set(env_id);
+  ms_ready_set_t* set = _ms_get_ready_set(env_id, false);
+  const int pressure = (set != NULL)
+                           ? __atomic_load_n(&_ms_env_degrade_pressure[env_id], __ATOMIC_RELAXED) : 0;
 
   if (_ms_degrade_debug) {
-    int dbg_pressure = (set != NULL && env_id >= 0 && env_id < MS_MAX_ENVS)
-                           ? _ms_env_degrade_pressure[env_id] : -1;
     ms_reaction_policy_t* dbg_pol = _ms_find_policy(env_id, reaction_index);
     int dbg_crit = dbg_pol ? (int)dbg_pol->criticality : -1;
     int dbg_degr = dbg_pol ? (dbg_pol->degradable ? 1 : 0) : -1;
     int dbg_hcr = 0, dbg_rc = 0;
     if (set != NULL) {
-      for (int i = 0; i < set->count; i++) {
-        if (set->entries[i].state == MS_RUNNING) continue;
-        dbg_rc++;
-        ms_reaction_policy_t* ep = _ms_find_policy(env_id, set->entries[i].reaction_index);
-        if (ep != NULL && ep->criticality == MS_CRIT_HIGH) dbg_hcr = 1;
+      dbg_rc = _ms_ready_queued(set);
+      for (int s = 0; s < MS_READY_SHARDS && !dbg_hcr; s++) {
+        ms_ready_head_t heads[MS_CRIT_COUNT];
+        _ms_shard_read_heads(&set->shards[s], heads);
+        dbg_hcr = heads[MS_CRIT_HIGH].valid;
       }
     }
-    pthread_mutex_unlock(&_ms_lock);
-    _ms_logf(MS_LEVEL_WARN,
-             "event=degrade_dbg env=%d rid=%llu crit=%d degradable=%d pressure=%d has_hc_ready=%d ready_count=%d",
-             env_id, (unsigned long long)reaction_index, dbg_crit, dbg_degr,
-             dbg_pressure, dbg_hcr, dbg_rc);
-    pthread_mutex_lock(&_ms_lock);
+    if (!_ms_bin_log(MS_LEVEL_WARN, MS_BIN_EV_DEGRADE_DBG, env_id, worker_id, reaction_index, dbg_crit, dbg_degr,
+                     set != NULL ? pressure : -1, dbg_hcr, dbg_rc, 0)) {
+      _ms_logf(MS_LEVEL_WARN,
+               "event=degrade_dbg env=%d rid=%llu crit=%d degradable=%d pressure=%d has_hc_ready=%d ready_count=%d",
+               env_id, (unsigned long long)reaction_index, dbg_crit, dbg_degr,
+               set != NULL ? pressure : -1, dbg_hcr, dbg_rc);
+    }
   }
 
-  if (set == NULL ||
-      env_id < 0 || env_id >= MS_MAX_ENVS ||
-      !_ms_env_degrade_pressure[env_id]) {
-    pthread_mutex_unlock(&_ms_lock);
+  if (set == NULL || !pressure) {
     return false;
   }
 
@@ -1135,18 +1727,6 @@ bool ms_should_skip_reaction(
     missing_metadata = 1;
   }
 
-  for (int i = 0; i < set->count; i++) {
-    ms_ready_entry_t* entry = &set->entries[i];
-    if (entry->state == MS_RUNNING) continue;
-    ready_count++;
-    size_t used = strlen(ready_buf);
-    if (used < sizeof(ready_buf) - 32) {
-      snprintf(ready_buf + used, sizeof(ready_buf) - used, "%s%llu",
-               used == 0 ? "" : "|",
-               (unsigned long long)entry->reaction_index);
-    }
-  }
-
   // Pressure-driven shedding: under degrade pressure, shed LC reactions beyond
   // the per-tag budget regardless of whether an HC is concurrently ready. (The
   // earlier has_hc_ready gate only shed LC that overlapped a ready HC, which is
@@ -1165,49 +1745,127 @@ bool ms_should_skip_reaction(
     // worker counts where LC ran in parallel within one window). When
     // default_budget < 0 we fall back to all-or-nothing shedding under pressure.
     int allow_within_budget = 0;
-    if (_ms_policy.default_budget >= 0 && env_id >= 0 && env_id < MS_MAX_ENVS) {
-      if (_ms_env_lc_window_start_ns[env_id] != (int64_t)logical_time_ns) {
-        _ms_env_lc_window_start_ns[env_id] = (int64_t)logical_time_ns;
-        _ms_env_lc_used_in_window[env_id] = 0;
+    if (_ms_policy.budget_type == MS_BUDGET_CPU_TIME) {
+      allow_within_budget = _ms_lc_cpu_within_budget(set, pol);
+    } else if (_ms_policy.default_budget >= 0) {
+      pthread_mutex_lock(&set->lc_budget_lock);
+      if (set->lc_window_start_ns != (int64_t)logical_time_ns) {
+        set->lc_window_start_ns = (int64_t)logical_time_ns;
+        set->lc_used_in_window = 0;
       }
-      if (_ms_env_lc_used_in_window[env_id] < _ms_policy.default_budget) {
-        _ms_env_lc_used_in_window[env_id]++;
+      if (set->lc_used_in_window < _ms_policy.default_budget) {
+        set->lc_used_in_window++;
         allow_within_budget = 1;
       }
+      pthread_mutex_unlock(&set->lc_budget_lock);
     }
     if (!allow_within_budget) {
-      int idx = _ms_ready_find(set, reaction_index);
-      if (idx >= 0) {
-        _ms_ready_remove_at(set, idx);
-      }
+      _ms_ready_remove(set, reaction_index);
       should_skip = 1;
     }
   }
-  pthread_mutex_unlock(&_ms_lock);
+
+  if (missing_metadata || should_skip) {
+    ready_count = _ms_ready_queued(set);
+    if (!_ms_binary_log) {
+      _ms_ready_describe(set, ready_buf, sizeof(ready_buf));
+    }
+  }
 
   if (missing_metadata) {
-    _ms_logf(
-        MS_LEVEL_WARN,
-        "event=fallback env=%d reason=missing_metadata logical=%lld reaction_index=%llu ready_count=%d ready_set=%s",
-        env_id, logical_time_ns, (unsigned long long)reaction_index, ready_count,
-        ready_buf[0] != '\0' ? ready_buf : "-"
-    );
+    if (!_ms_bin_log(MS_LEVEL_WARN, MS_BIN_EV_FALLBACK_NO_META, env_id, worker_id, reaction_index, 0, ready_count, 0,
+                     logical_time_ns, 0, 0)) {
+      _ms_logf(
+          MS_LEVEL_WARN,
+          "event=fallback env=%d reason=missing_metadata logical=%lld reaction_index=%llu ready_count=%d ready_set=%s",
+          env_id, logical_time_ns, (unsigned long long)reaction_index, ready_count,
+          ready_buf[0] != '\0' ? ready_buf : "-"
+      );
+    }
     return false;
   }
 
   if (should_skip) {
-    _ms_logf(
-        MS_LEVEL_WARN,
-        "event=degrade action=skip reason=pressure env=%d logical=%lld reaction_index=%llu ready_count=%d ready_set=%s",
-        env_id, logical_time_ns, (unsigned long long)reaction_index, ready_count,
-        ready_buf[0] != '\0' ? ready_buf : "-"
-    );
+    if (!_ms_bin_log(MS_LEVEL_WARN, MS_BIN_EV_DEGRADE_SKIP, env_id, worker_id, reaction_index, 0, ready_count, 0,
+                     logical_time_ns, 0, 0)) {
+      _ms_logf(
+          MS_LEVEL_WARN,
+          "event=degrade action=skip reason=pressure env=%d logical=%lld reaction_index=%llu ready_count=%d ready_set=%s",
+          env_id, logical_time_ns, (unsigned long long)reaction_index, ready_count,
+          ready_buf[0] != '\0' ? ready_buf : "-"
+      );
+    }
     return true;
   }
 
   return false;
 }
 
+bool ms_may_execute_inline(int env_id, uint64_t reaction_index) {
+  if (!_ms_enabled || !_ms_degrade_enabled) return true;
+  if (_ms_policy.degrade_action != MS_DEGRADE_SKIP) return true;
+  ms_reaction_policy_t* pol = _ms_find_policy(env_id, reaction_index);
+  return pol == NULL || pol->criticality != MS_CRIT_LOW || !pol->degradable;
+}
+
+bool ms_chain_needs_cpu_times(void) { return _ms_enabled && _ms_exec_stats; }
+
+void ms_on_chain_executed(
+    int env_id,
+    int worker_id,
+    const uint64_t* reaction_indexes,
+    const long long* end_times_ns,
+    const long long* cpu_end_times_ns,
+    int count,
+    long long start_time_ns,
+    long long start_cpu_ns
+) {
+    if (!_ms_enabled || count <= 0) return;
+
+    const bool active = __atomic_load_n(&_ms_active, __ATOMIC_ACQUIRE);
+    long long previous_end_ns = start_time_ns;
+    long long previous_cpu_ns = start_cpu_ns;
+    for (int i = 0; i < count; i++) {
+      const uint64_t reaction_index = reaction_indexes[i];
+      const int64_t wall_ns = end_times_ns[i] - previous_end_ns;
+      previous_end_ns = end_times_ns[i];
+      // Without CPU samples, the CPU time is unknown and nothing is charged to the budget.
+      int64_t cpu_ns = -1;
+      if (cpu_end_times_ns != NULL) {
+        if (cpu_end_times_ns[i] >= 0 && previous_cpu_ns >= 0) cpu_ns = cpu_end_times_ns[i] - previous_cpu_ns;
+        previous_cpu_ns = cpu_end_times_ns[i];
+      }
+      if (_ms_exec_stats) {
+        ms_stats_record(env_id, reaction_index, wall_ns, cpu_ns);
+        if (_ms_policy.budget_type == MS_BUDGET_CPU_TIME && cpu_ns > 0) {
+          _ms_charge_lc_cpu(env_id, reaction_index, cpu_ns);
+        }
+      }
+      ms_reaction_policy_t* pol = active ? _ms_find_policy(env_id, reaction_index) : NULL;
+      ms_worker_state_t* worker = (pol != NULL) ? _ms_get_worker_state(env_id, worker_id, true) : NULL;
+      if (worker != NULL) {
+        worker->last_crit = pol->criticality;
+        worker->crit_known = 1;
+        worker->crit_mask |= (pol->criticality == MS_CRIT_HIGH) ? 0x1 : 0x2;
+      }
+    }
+
+    if (_ms_live_metrics) {
+      ms_metrics_chain(env_id, worker_id, reaction_indexes, count, previous_end_ns - start_time_ns,
+                       _ms_now_mono_ns());
+    }
+
+    if (!_ms_minimal_log &&
+        !_ms_bin_log(MS_LEVEL_DEBUG, MS_BIN_EV_CHAIN, env_id, worker_id, reaction_indexes[0], count, 0, 0,
+                     start_time_ns, previous_end_ns, 0)) {
+      _ms_logf(
+          MS_LEVEL_DEBUG,
+          "event=chain env=%d worker=%d first=%llu length=%d start=%lld end=%lld",
+          env_id, worker_id, (unsigned long long)reaction_indexes[0], count, start_time_ns, previous_end_ns
+      );
+    }
+}
+
 void ms_on_metrics(
     int env_id,
     int worker_id,
@@ -1216,12 +1874,11 @@ void ms_on_metrics(
     int ready_q_len,
     int64_t ptdv_ns
 ) {
-  (void)env_id;
-  (void)ptdv_ns;
-
   if (!_ms_enabled) return;
   if (worker_id < 0 || worker_id >= MS_MAX_WORKERS) return;
 
+  // No lock: env pressure flags are single stores, and the worker state below
+  // belongs to the calling thread (see ms_worker_state_t).
   ms_criticality_t crit = MS_CRIT_HIGH;
   int desired_delta = 0;
   const int64_t now_mono_ns = (now_ns > 0) ? (int64_t)now_ns : _ms_now_mono_ns();
@@ -1232,15 +1889,18 @@ void ms_on_metrics(
     .affinity_mask = 0
   };
 
-  pthread_mutex_lock(&_ms_lock);
   int ready_len = ready_q_len;
   if (ready_len < 0) {
-    ms_ready_set_t* ready_set = _ms_get_ready_set(env_id);
+    ms_ready_set_t* ready_set = _ms_get_ready_set(env_id, false);
     if (ready_set != NULL) {
-      ready_len = ready_set->count;
+      ready_len = _ms_ready_count(ready_set);
     }
   }
 
+  if (_ms_live_metrics) {
+    ms_metrics_env_load(env_id, lag_ns, ready_len, ptdv_ns, _ms_now_mono_ns());
+  }
+
   const bool lag_enabled = (_ms_os_config.lag_threshold_ns >= 0);
   const bool ready_enabled = (_ms_os_config.ready_q_len_threshold >= 0);
   int pressure = 0;
@@ -1261,22 +1921,24 @@ void ms_on_metrics(
   }
 
   if (env_id >= 0 && env_id < MS_MAX_ENVS) {
-    _ms_env_pressure[env_id] = hc_guard_pressure;
-    _ms_env_degrade_pressure[env_id] = 0;
+    int degrade_pressure = 0;
     if (_ms_degrade_enabled) {
       if (_ms_degrade_lag_threshold_ns >= 0 && lag_ns >= _ms_degrade_lag_threshold_ns) {
-        _ms_env_degrade_pressure[env_id] = 1;
+        degrade_pressure = 1;
       }
       if (_ms_degrade_ready_q_len_threshold >= 0 && ready_len >= 0 &&
           ready_len >= _ms_degrade_ready_q_len_threshold) {
-        _ms_env_degrade_pressure[env_id] = 1;
+        degrade_pressure = 1;
       }
     }
+    __atomic_store_n(&_ms_env_pressure[env_id], hc_guard_pressure, __ATOMIC_RELAXED);
+    __atomic_store_n(&_ms_env_degrade_pressure[env_id], degrade_pressure, __ATOMIC_RELAXED);
   }
-  const int mixed_criticality_worker =
-      !_ms_partition_enabled && ((_ms_worker_crit_mask[worker_id] & 0x3) == 0x3);
-  if (_ms_worker_crit_known[worker_id]) {
-    crit = _ms_worker_last_crit[worker_id];
+  ms_worker_state_t* worker = _ms_get_worker_state(env_id, worker_id, true);
+  if (worker == NULL) return;
+  const int mixed_criticality_worker = !_ms_partition_enabled && ((worker->crit_mask & 0x3) == 0x3);
+  if (worker->crit_known) {
+    crit = worker->last_crit;
   }
   if (_ms_partition_enabled) {
     crit = _ms_worker_target_crit(worker_id);
@@ -1313,22 +1975,20 @@ void ms_on_metrics(
       }
     }
   }
-  if (desired_delta == _ms_worker_last_nice_delta[worker_id] &&
-      (int)policy.sched_policy == _ms_worker_last_sched_policy[worker_id] &&
-      policy.rt_priority == _ms_worker_last_rt_priority[worker_id]) {
-    pthread_mutex_unlock(&_ms_lock);
+  if (desired_delta == worker->last_nice_delta &&
+      (int)policy.sched_policy == worker->last_sched_policy &&
+      policy.rt_priority == worker->last_rt_priority) {
     return;
   }
   if (_ms_os_config.min_switch_interval_ns > 0 &&
-      _ms_worker_last_nice_switch_ns[worker_id] > 0 &&
-      (now_mono_ns - _ms_worker_last_nice_switch_ns[worker_id]) < _ms_os_config.min_switch_interval_ns) {
-    pthread_mutex_unlock(&_ms_lock);
+      worker->last_nice_switch_ns > 0 &&
+      (now_mono_ns - worker->last_nice_switch_ns) < _ms_os_config.min_switch_interval_ns) {
     return;
   }
-  _ms_worker_last_nice_delta[worker_id] = desired_delta;
-  _ms_worker_last_sched_policy[worker_id] = (int)policy.sched_policy;
-  _ms_worker_last_rt_priority[worker_id] = policy.rt_priority;
-  _ms_worker_last_nice_switch_ns[worker_id] = now_mono_ns;
+  worker->last_nice_delta = desired_delta;
+  worker->last_sched_policy = (int)policy.sched_policy;
+  worker->last_rt_priority = policy.rt_priority;
+  worker->last_nice_switch_ns = now_mono_ns;
 
   policy.nice_delta = desired_delta;
   if (!_ms_os_config.enabled) {
@@ -1337,29 +1997,33 @@ void ms_on_metrics(
         "event=os_policy_skip worker_id=%d reason=disabled nice_delta=%d",
         worker_id, desired_delta
     );
-    pthread_mutex_unlock(&_ms_lock);
     return;
   }
 
-  _ms_worker_pending_policy[worker_id] = policy;
-  _ms_worker_policy_pending[worker_id] = 1;
-  pthread_mutex_unlock(&_ms_lock);
+  worker->pending_policy = policy;
+  worker->policy_pending = 1;
+}
+
+void ms_on_tag_advance(int env_id, long long logical_time_ns, uint32_t microstep) {
+  if (!_ms_enabled || !_ms_live_metrics) return;
+  ms_metrics_env_tag(env_id, logical_time_ns, microstep, _ms_now_mono_ns());
+}
+
+void ms_on_deadline_miss(int env_id, int worker_id, uint64_t reaction_index) {
+  (void)worker_id;
+  if (!_ms_enabled || !_ms_live_metrics) return;
+  ms_metrics_deadline_miss(env_id, reaction_index);
 }
 
-bool ms_take_os_policy(int worker_id, ms_os_policy_t* out_policy) {
+bool ms_take_os_policy(int env_id, int worker_id, ms_os_policy_t* out_policy) {
   if (!_ms_enabled) return false;
   if (out_policy == NULL) return false;
-  if (worker_id < 0 || worker_id >= MS_MAX_WORKERS) return false;
 
-  pthread_mutex_lock(&_ms_lock);
-  if (_ms_worker_policy_pending[worker_id]) {
-    *out_policy = _ms_worker_pending_policy[worker_id];
-    _ms_worker_policy_pending[worker_id] = 0;
-    pthread_mutex_unlock(&_ms_lock);
-    return true;
-  }
-  pthread_mutex_unlock(&_ms_lock);
-  return false;
+  ms_worker_state_t* worker = _ms_get_worker_state(env_id, worker_id, false);
+  if (worker == NULL || !worker->policy_pending) return false;
+  *out_policy = worker->pending_policy;
+  worker->policy_pending = 0;
+  return true;
 }
 
 void ms_log_os_policy_apply(int worker_id, const ms_os_policy_t* policy, int nice_applied) {
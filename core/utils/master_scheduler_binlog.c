@@ -0,0 +1,187 @@
+#include "master_scheduler_binlog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Per-thread ring capacity in records; must be a power of two.
+#define MS_BIN_RING_CAPACITY 4096
+#define MS_BIN_RING_MASK (MS_BIN_RING_CAPACITY - 1)
+// How long the drainer sleeps between passes over the rings.
+#define MS_BIN_DRAIN_INTERVAL_NS (1000LL * 1000LL)
+
+typedef struct ms_bin_ring_t {
+  ms_bin_record_t records[MS_BIN_RING_CAPACITY];
+  uint64_t head;    // Next slot to write; owned by the producer thread.
+  uint64_t tail;    // Next slot to drain; owned by the drainer.
+  uint64_t dropped; // Records lost to a full ring since the last drain.
+  int retired;      // Set when the owning thread exits; the ring may then be reused.
+  struct ms_bin_ring_t* next;
+} ms_bin_ring_t;
+
+// Rings are only ever pushed to this list, never removed.
+static ms_bin_ring_t* _ms_bin_rings = NULL;
+static __thread ms_bin_ring_t* _ms_bin_tls_ring = NULL;
+static pthread_key_t _ms_bin_ring_key;
+static pthread_once_t _ms_bin_key_once = PTHREAD_ONCE_INIT;
+
+static FILE* _ms_bin_file = NULL;
+static bool _ms_bin_open = false;
+static bool _ms_bin_stop = false;
+static pthread_t _ms_bin_drainer;
+static pthread_mutex_t _ms_bin_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _ms_bin_retire_ring(void* arg) {
+  ms_bin_ring_t* ring = (ms_bin_ring_t*)arg;
+  __atomic_store_n(&ring->retired, 1, __ATOMIC_RELEASE);
+}
+
+static void _ms_bin_make_key(void) { pthread_key_create(&_ms_bin_ring_key, _ms_bin_retire_ring); }
+
+static ms_bin_ring_t* _ms_bin_acquire_ring(void) {
+  pthread_once(&_ms_bin_key_once, _ms_bin_make_key);
+
+  // Prefer a drained ring left behind by a thread that has exited.
+  ms_bin_ring_t* ring = __atomic_load_n(&_ms_bin_rings, __ATOMIC_ACQUIRE);
+  for (; ring != NULL; ring = ring->next) {
+    int expected = 1;
+    if (__atomic_load_n(&ring->retired, __ATOMIC_ACQUIRE) &&
+        __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == ring->head &&
+        __atomic_compare_exchange_n(&ring->retired, &expected, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+  if (ring == NULL) {
+    ring = (ms_bin_ring_t*)calloc(1, sizeof(ms_bin_ring_t));
+    if (ring == NULL) return NULL;
+    ms_bin_ring_t* head = __atomic_load_n(&_ms_bin_rings, __ATOMIC_RELAXED);
+    do {
+      ring->next = head;
+    } while (!__atomic_compare_exchange_n(&_ms_bin_rings, &head, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  }
+  pthread_setspecific(_ms_bin_ring_key, ring);
+  _ms_bin_tls_ring = ring;
+  return ring;
+}
+
+static int64_t _ms_bin_now_mono_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+// Copy everything currently in the rings to the file. Caller holds _ms_bin_lock.
+static void _ms_bin_drain_all(void) {
+  bool wrote = false;
+  for (ms_bin_ring_t* ring = __atomic_load_n(&_ms_bin_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+    const uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = ring->tail;
+    while (tail < head) {
+      // Write the contiguous run up to the end of the buffer, then wrap.
+      const uint64_t start = tail & MS_BIN_RING_MASK;
+      uint64_t n = head - tail;
+      if (start + n > MS_BIN_RING_CAPACITY) {
+        n = MS_BIN_RING_CAPACITY - start;
+      }
+      fwrite(&ring->records[start], sizeof(ms_bin_record_t), (size_t)n, _ms_bin_file);
+      tail += n;
+      wrote = true;
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+    const uint64_t dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0) {
+      ms_bin_record_t rec;
+      memset(&rec, 0, sizeof(rec));
+      rec.mono_ns = _ms_bin_now_mono_ns();
+      rec.event = MS_BIN_EV_DROPPED;
+      rec.level = 1; // MS_LEVEL_WARN
+      rec.env_id = -1;
+      rec.worker_id = -1;
+      rec.key = dropped;
+      fwrite(&rec, sizeof(rec), 1, _ms_bin_file);
+      wrote = true;
+    }
+  }
+  if (wrote) {
+    fflush(_ms_bin_file);
+  }
+}
+
+static void* _ms_bin_drainer_main(void* arg) {
+  (void)arg;
+  const struct timespec interval = {.tv_sec = 0, .tv_nsec = MS_BIN_DRAIN_INTERVAL_NS};
+  while (!__atomic_load_n(&_ms_bin_stop, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&_ms_bin_lock);
+    _ms_bin_drain_all();
+    pthread_mutex_unlock(&_ms_bin_lock);
+    nanosleep(&interval, NULL);
+  }
+  return NULL;
+}
+
+bool ms_binlog_open(const char* path) {
+  if (path == NULL || path[0] == '\0') return false;
+  pthread_mutex_lock(&_ms_bin_lock);
+  if (_ms_bin_file != NULL) {
+    pthread_mutex_unlock(&_ms_bin_lock);
+    return true;
+  }
+  _ms_bin_file = fopen(path, "wb");
+  if (_ms_bin_file == NULL) {
+    pthread_mutex_unlock(&_ms_bin_lock);
+    return false;
+  }
+  ms_bin_file_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MS_BIN_MAGIC, sizeof(header.magic));
+  header.version = MS_BIN_VERSION;
+  header.record_size = (uint32_t)sizeof(ms_bin_record_t);
+  header.pid = (int64_t)getpid();
+  fwrite(&header, sizeof(header), 1, _ms_bin_file);
+  fflush(_ms_bin_file);
+
+  __atomic_store_n(&_ms_bin_stop, false, __ATOMIC_RELEASE);
+  if (pthread_create(&_ms_bin_drainer, NULL, _ms_bin_drainer_main, NULL) != 0) {
+    fclose(_ms_bin_file);
+    _ms_bin_file = NULL;
+    pthread_mutex_unlock(&_ms_bin_lock);
+    return false;
+  }
+  __atomic_store_n(&_ms_bin_open, true, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&_ms_bin_lock);
+  return true;
+}
+
+bool ms_binlog_is_open(void) { return __atomic_load_n(&_ms_bin_open, __ATOMIC_ACQUIRE); }
+
+bool ms_binlog_write(const ms_bin_record_t* record) {
+  if (record == NULL || !__atomic_load_n(&_ms_bin_open, __ATOMIC_ACQUIRE)) return false;
+  ms_bin_ring_t* ring = _ms_bin_tls_ring;
+  if (ring == NULL) {
+    ring = _ms_bin_acquire_ring();
+    if (ring == NULL) return false;
+  }
+  const uint64_t head = ring->head;
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= MS_BIN_RING_CAPACITY) {
+    __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  ring->records[head & MS_BIN_RING_MASK] = *record;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void ms_binlog_close(void) {
+  if (!__atomic_exchange_n(&_ms_bin_open, false, __ATOMIC_ACQ_REL)) return;
+  __atomic_store_n(&_ms_bin_stop, true, __ATOMIC_RELEASE);
+  pthread_join(_ms_bin_drainer, NULL);
+  pthread_mutex_lock(&_ms_bin_lock);
+  _ms_bin_drain_all();
+  fclose(_ms_bin_file);
+  _ms_bin_file = NULL;
+  pthread_mutex_unlock(&_ms_bin_lock);
+}
@@ -0,0 +1,207 @@
+#include "master_scheduler_metrics.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MS_METRICS_REACTION_MASK (MS_METRICS_MAX_REACTIONS - 1)
+
+static ms_metrics_page_t* _ms_metrics_page = NULL;
+static char _ms_metrics_path[512];
+
+static int64_t _ms_metrics_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static ms_metrics_page_t* _ms_metrics_get(void) { return __atomic_load_n(&_ms_metrics_page, __ATOMIC_ACQUIRE); }
+
+// Seqlock section that waits for other writers (worker records). Worker ids are
+// per environment, so workers of different enclaves can share a record; each
+// holds it only for a few stores.
+static void _ms_metrics_write_begin(uint32_t* seq) {
+  for (;;) {
+    uint32_t even = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    if (!(even & 1u) &&
+        __atomic_compare_exchange_n(seq, &even, even + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      break;
+    }
+    sched_yield();
+  }
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void _ms_metrics_write_end(uint32_t* seq) { __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE); }
+
+// Multi-writer seqlock section (environment records): claims the record by
+// making seq odd, or fails if another writer holds it.
+static bool _ms_metrics_try_write_begin(uint32_t* seq) {
+  uint32_t even = __atomic_load_n(seq, __ATOMIC_RELAXED);
+  if (even & 1u) return false;
+  if (!__atomic_compare_exchange_n(seq, &even, even + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return false;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  return true;
+}
+
+static ms_metrics_reaction_t* _ms_metrics_reaction(ms_metrics_page_t* page, int env_id, uint64_t key) {
+  if (key == 0) return NULL;
+  size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & MS_METRICS_REACTION_MASK;
+  for (size_t probes = 0; probes < MS_METRICS_MAX_REACTIONS; probes++, i = (i + 1) & MS_METRICS_REACTION_MASK) {
+    ms_metrics_reaction_t* r = &page->reactions[i];
+    uint64_t current = __atomic_load_n(&r->key, __ATOMIC_ACQUIRE);
+    if (current == 0) {
+      if (__atomic_compare_exchange_n(&r->key, &current, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&r->env_id, env_id, __ATOMIC_RELAXED);
+        return r;
+      }
+      // Another thread claimed the slot; current now holds its key.
+    }
+    if (current == key) return r;
+  }
+  __atomic_fetch_add(&page->header.reactions_dropped, 1, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+bool ms_metrics_open(const char* path) {
+  if (path == NULL || path[0] == '\0' || _ms_metrics_get() != NULL) return false;
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  if (ftruncate(fd, (off_t)sizeof(ms_metrics_page_t)) != 0) {
+    close(fd);
+    unlink(path);
+    return false;
+  }
+  void* mapped = mmap(NULL, sizeof(ms_metrics_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    unlink(path);
+    return false;
+  }
+  ms_metrics_page_t* page = (ms_metrics_page_t*)mapped;
+  for (int i = 0; i < MS_METRICS_MAX_ENVS; i++) {
+    page->envs[i].ready_q_len = -1;
+  }
+  page->header.version = MS_METRICS_VERSION;
+  page->header.size = (uint32_t)sizeof(ms_metrics_page_t);
+  page->header.pid = (int64_t)getpid();
+  page->header.start_mono_ns = _ms_metrics_now_ns();
+  page->header.running = 1;
+  // The magic goes last so that readers never see a half-initialized page.
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(page->header.magic, MS_METRICS_MAGIC, sizeof(page->header.magic));
+  snprintf(_ms_metrics_path, sizeof(_ms_metrics_path), "%s", path);
+  __atomic_store_n(&_ms_metrics_page, page, __ATOMIC_RELEASE);
+  return true;
+}
+
+void ms_metrics_close(void) {
+  ms_metrics_page_t* page = __atomic_exchange_n(&_ms_metrics_page, NULL, __ATOMIC_ACQ_REL);
+  if (page == NULL) return;
+  __atomic_store_n(&page->header.running, 0, __ATOMIC_RELEASE);
+  // Workers that are still running may hold the old pointer, so the mapping
+  // stays in place; readers that have the file open keep seeing it too.
+  unlink(_ms_metrics_path);
+}
+
+bool ms_metrics_is_open(void) { return _ms_metrics_get() != NULL; }
+
+void ms_metrics_reaction_start(int env_id, int worker_id, uint64_t reaction_key, int64_t mono_ns) {
+  ms_metrics_page_t* page = _ms_metrics_get();
+  if (page == NULL) return;
+  ms_metrics_reaction_t* r = _ms_metrics_reaction(page, env_id, reaction_key);
+  if (r != NULL) __atomic_fetch_add(&r->invocations, 1, __ATOMIC_RELAXED);
+  if (worker_id < 0 || worker_id >= MS_METRICS_MAX_WORKERS) return;
+
+  ms_metrics_worker_t* w = &page->workers[worker_id];
+  _ms_metrics_write_begin(&w->seq);
+  __atomic_store_n(&w->active, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->env_id, env_id, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->current_reaction, reaction_key, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->last_start_mono_ns, mono_ns, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->last_update_mono_ns, mono_ns, __ATOMIC_RELAXED);
+  _ms_metrics_write_end(&w->seq);
+}
+
+void ms_metrics_reaction_end(int env_id, int worker_id, uint64_t reaction_key, int64_t mono_ns) {
+  (void)env_id;
+  ms_metrics_page_t* page = _ms_metrics_get();
+  if (page == NULL || worker_id < 0 || worker_id >= MS_METRICS_MAX_WORKERS) return;
+
+  ms_metrics_worker_t* w = &page->workers[worker_id];
+  _ms_metrics_write_begin(&w->seq);
+  __atomic_store_n(&w->reactions_run, w->reactions_run + 1, __ATOMIC_RELAXED);
+  if (w->current_reaction == reaction_key && mono_ns >= w->last_start_mono_ns) {
+    __atomic_store_n(&w->busy_ns, w->busy_ns + (mono_ns - w->last_start_mono_ns), __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&w->current_reaction, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->last_update_mono_ns, mono_ns, __ATOMIC_RELAXED);
+  _ms_metrics_write_end(&w->seq);
+}
+
+// One update for a chain of reactions that a worker executed inline, in place
+// of a start and an end update per reaction.
+void ms_metrics_chain(int env_id, int worker_id, const uint64_t* reaction_keys, int count, int64_t busy_ns,
+                      int64_t mono_ns) {
+  ms_metrics_page_t* page = _ms_metrics_get();
+  if (page == NULL) return;
+  for (int i = 0; i < count; i++) {
+    ms_metrics_reaction_t* r = _ms_metrics_reaction(page, env_id, reaction_keys[i]);
+    if (r != NULL) __atomic_fetch_add(&r->invocations, 1, __ATOMIC_RELAXED);
+  }
+  if (worker_id < 0 || worker_id >= MS_METRICS_MAX_WORKERS) return;
+
+  ms_metrics_worker_t* w = &page->workers[worker_id];
+  _ms_metrics_write_begin(&w->seq);
+  __atomic_store_n(&w->reactions_run, w->reactions_run + (uint64_t)count, __ATOMIC_RELAXED);
+  if (busy_ns > 0) {
+    __atomic_store_n(&w->busy_ns, w->busy_ns + busy_ns, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&w->last_update_mono_ns, mono_ns, __ATOMIC_RELAXED);
+  _ms_metrics_write_end(&w->seq);
+}
+
+void ms_metrics_env_tag(int env_id, int64_t tag_time_ns, uint32_t microstep, int64_t mono_ns) {
+  ms_metrics_page_t* page = _ms_metrics_get();
+  if (page == NULL || env_id < 0 || env_id >= MS_METRICS_MAX_ENVS) return;
+
+  ms_metrics_env_t* e = &page->envs[env_id];
+  if (!_ms_metrics_try_write_begin(&e->seq)) return;
+  __atomic_store_n(&e->active, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->tag_time_ns, tag_time_ns, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->tag_microstep, microstep, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->last_update_mono_ns, mono_ns, __ATOMIC_RELAXED);
+  _ms_metrics_write_end(&e->seq);
+}
+
+void ms_metrics_env_load(int env_id, int64_t lag_ns, int ready_q_len, int64_t ptdv_ns, int64_t mono_ns) {
+  ms_metrics_page_t* page = _ms_metrics_get();
+  if (page == NULL || env_id < 0 || env_id >= MS_METRICS_MAX_ENVS) return;
+
+  ms_metrics_env_t* e = &page->envs[env_id];
+  if (!_ms_metrics_try_write_begin(&e->seq)) return;
+  __atomic_store_n(&e->active, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->lag_ns, lag_ns, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->ready_q_len, ready_q_len, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->ptdv_ns, ptdv_ns, __ATOMIC_RELAXED);
+  __atomic_store_n(&e->last_update_mono_ns, mono_ns, __ATOMIC_RELAXED);
+  _ms_metrics_write_end(&e->seq);
+}
+
+void ms_metrics_deadline_miss(int env_id, uint64_t reaction_key) {
+  ms_metrics_page_t* page = _ms_metrics_get();
+  if (page == NULL) return;
+  ms_metrics_reaction_t* r = _ms_metrics_reaction(page, env_id, reaction_key);
+  if (r != NULL) __atomic_fetch_add(&r->deadline_misses, 1, __ATOMIC_RELAXED);
+  // A monotonic counter: readers may see it change within a snapshot, which
+  // is harmless, so it is bumped without taking the record.
+  if (env_id >= 0 && env_id < MS_METRICS_MAX_ENVS) {
+    __atomic_fetch_add(&page->envs[env_id].deadline_misses, 1, __ATOMIC_RELAXED);
+  }
+}
@@ -0,0 +1,172 @@
+#include "master_scheduler_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Number of reactions that can have histograms; must be a power of two.
+#define MS_STATS_TABLE_SIZE 8192
+#define MS_STATS_TABLE_MASK (MS_STATS_TABLE_SIZE - 1)
+#define MS_STATS_SUB_COUNT (1 << MS_STATS_SUB_BITS)
+
+typedef struct {
+  uint64_t count;
+  int64_t sum;
+  int64_t max;
+  uint64_t buckets[MS_STATS_BUCKETS];
+} ms_stats_histogram_t;
+
+typedef struct {
+  int env_id;
+  uint64_t reaction_index;
+  ms_stats_histogram_t metrics[MS_STATS_METRIC_COUNT];
+} ms_stats_entry_t;
+
+// Slots are claimed once with a compare-and-swap and never released, so
+// lookups need no lock. Entries are allocated on a reaction's first record.
+static ms_stats_entry_t* _ms_stats_table[MS_STATS_TABLE_SIZE];
+
+static size_t _ms_stats_slot(int env_id, uint64_t reaction_index) {
+  uint64_t h = (reaction_index ^ ((uint64_t)(uint32_t)env_id << 32)) * 0x9E3779B97F4A7C15ULL;
+  return (size_t)(h >> 32) & MS_STATS_TABLE_MASK;
+}
+
+static ms_stats_entry_t* _ms_stats_find(int env_id, uint64_t reaction_index, bool create_if_missing) {
+  size_t i = _ms_stats_slot(env_id, reaction_index);
+  ms_stats_entry_t* fresh = NULL;
+  for (size_t probes = 0; probes < MS_STATS_TABLE_SIZE; probes++, i = (i + 1) & MS_STATS_TABLE_MASK) {
+    ms_stats_entry_t* entry = __atomic_load_n(&_ms_stats_table[i], __ATOMIC_ACQUIRE);
+    if (entry == NULL) {
+      if (!create_if_missing) return NULL;
+      if (fresh == NULL) {
+        fresh = (ms_stats_entry_t*)calloc(1, sizeof(ms_stats_entry_t));
+        if (fresh == NULL) return NULL;
+        fresh->env_id = env_id;
+        fresh->reaction_index = reaction_index;
+      }
+      if (__atomic_compare_exchange_n(&_ms_stats_table[i], &entry, fresh, false, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE)) {
+        return fresh;
+      }
+      // Another thread claimed the slot; entry now holds its value.
+    }
+    if (entry->env_id == env_id && entry->reaction_index == reaction_index) {
+      free(fresh);
+      return entry;
+    }
+  }
+  free(fresh);
+  return NULL;
+}
+
+static int _ms_stats_bucket(int64_t value) {
+  if (value < MS_STATS_SUB_COUNT) return (int)value;
+  int exponent = 63 - __builtin_clzll((unsigned long long)value);
+  if (exponent > MS_STATS_MAX_EXPONENT) return MS_STATS_BUCKETS - 1;
+  int sub = (int)((value >> (exponent - MS_STATS_SUB_BITS)) & (MS_STATS_SUB_COUNT - 1));
+  return ((exponent - MS_STATS_SUB_BITS + 1) << MS_STATS_SUB_BITS) + sub;
+}
+
+// Largest value that falls into the given bucket.
+static int64_t _ms_stats_bucket_upper(int bucket) {
+  if (bucket < MS_STATS_SUB_COUNT) return bucket;
+  int exponent = (bucket >> MS_STATS_SUB_BITS) + MS_STATS_SUB_BITS - 1;
+  int64_t sub = bucket & (MS_STATS_SUB_COUNT - 1);
+  int shift = exponent - MS_STATS_SUB_BITS;
+  return ((MS_STATS_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+static void _ms_stats_add(ms_stats_histogram_t* h, int64_t value) {
+  __atomic_fetch_add(&h->buckets[_ms_stats_bucket(value)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+  int64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+  while (value > max &&
+         !__atomic_compare_exchange_n(&h->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+  __atomic_fetch_add(&h->count, 1, __ATOMIC_RELEASE);
+}
+
+static int64_t _ms_stats_quantile(ms_stats_histogram_t* h, double quantile) {
+  uint64_t count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+  if (count == 0) return -1;
+  uint64_t rank = (uint64_t)(quantile * (double)count + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > count) rank = count;
+  int64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+  uint64_t seen = 0;
+  for (int b = 0; b < MS_STATS_BUCKETS; b++) {
+    seen += __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+    if (seen >= rank) {
+      int64_t upper = _ms_stats_bucket_upper(b);
+      return (upper < max) ? upper : max;
+    }
+  }
+  return max;
+}
+
+int64_t ms_stats_thread_cpu_ns(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return -1;
+  return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+void ms_stats_record(int env_id, uint64_t reaction_index, int64_t wall_ns, int64_t cpu_ns) {
+  ms_stats_entry_t* entry = _ms_stats_find(env_id, reaction_index, true);
+  if (entry == NULL) return;
+  if (wall_ns >= 0) _ms_stats_add(&entry->metrics[MS_STATS_WALL_TIME], wall_ns);
+  if (cpu_ns >= 0) _ms_stats_add(&entry->metrics[MS_STATS_CPU_TIME], cpu_ns);
+}
+
+uint64_t ms_stats_count(int env_id, uint64_t reaction_index) {
+  ms_stats_entry_t* entry = _ms_stats_find(env_id, reaction_index, false);
+  if (entry == NULL) return 0;
+  return __atomic_load_n(&entry->metrics[MS_STATS_WALL_TIME].count, __ATOMIC_ACQUIRE);
+}
+
+int64_t ms_stats_percentile(int env_id, uint64_t reaction_index, ms_stats_metric_t metric, double quantile) {
+  if ((int)metric < 0 || (int)metric >= MS_STATS_METRIC_COUNT) return -1;
+  ms_stats_entry_t* entry = _ms_stats_find(env_id, reaction_index, false);
+  if (entry == NULL) return -1;
+  return _ms_stats_quantile(&entry->metrics[metric], quantile);
+}
+
+bool ms_stats_export(const char* path) {
+  if (path == NULL || path[0] == '\0') return false;
+  FILE* f = fopen(path, "w");
+  if (f == NULL) return false;
+  static const char* const metric_names[MS_STATS_METRIC_COUNT] = {"wall_ns", "cpu_ns"};
+  fprintf(f, "env,reaction_index,metric,count,mean,p50,p90,p99,p999,max\n");
+  for (size_t i = 0; i < MS_STATS_TABLE_SIZE; i++) {
+    ms_stats_entry_t* entry = __atomic_load_n(&_ms_stats_table[i], __ATOMIC_ACQUIRE);
+    if (entry == NULL) continue;
+    for (int m = 0; m < MS_STATS_METRIC_COUNT; m++) {
+      ms_stats_histogram_t* h = &entry->metrics[m];
+      uint64_t count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+      if (count == 0) continue;
+      fprintf(f, "%d,%llu,%s,%llu,%lld,%lld,%lld,%lld,%lld,%lld\n", entry->env_id,
+              (unsigned long long)entry->reaction_index, metric_names[m], (unsigned long long)count,
+              (long long)(__atomic_load_n(&h->sum, __ATOMIC_RELAXED) / (int64_t)count),
+              (long long)_ms_stats_quantile(h, 0.5), (long long)_ms_stats_quantile(h, 0.9),
+              (long long)_ms_stats_quantile(h, 0.99), (long long)_ms_stats_quantile(h, 0.999),
+              (long long)__atomic_load_n(&h->max, __ATOMIC_RELAXED));
+    }
+  }
+  return fclose(f) == 0;
+}
+
+void ms_stats_reset(void) {
+  for (size_t i = 0; i < MS_STATS_TABLE_SIZE; i++) {
+    ms_stats_entry_t* entry = __atomic_load_n(&_ms_stats_table[i], __ATOMIC_ACQUIRE);
+    if (entry == NULL) continue;
+    for (int m = 0; m < MS_STATS_METRIC_COUNT; m++) {
+      ms_stats_histogram_t* h = &entry->metrics[m];
+      __atomic_store_n(&h->count, 0, __ATOMIC_RELEASE);
+      __atomic_store_n(&h->sum, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&h->max, 0, __ATOMIC_RELAXED);
+      for (int b = 0; b < MS_STATS_BUCKETS; b++) {
+        __atomic_store_n(&h->buckets[b], 0, __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
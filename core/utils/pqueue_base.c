@@ -245,6 +245,15 @@ int pqueue_remove(pqueue_t* q, void* d) {
   return 0;
 }
 
+void pqueue_replace(pqueue_t* q, void* e, void* replacement) {
+  size_t posn = q->getpos(e);
+  q->d[posn] = replacement;
+  if (q->cmppri(q->getpri(e), q->getpri(replacement)) == 1)
+    bubble_up(q, posn);
+  else
+    percolate_down(q, posn);
+}
+
 void* pqueue_pop(pqueue_t* q) {
   if (!q || q->size == 1)
     return NULL;
@@ -0,0 +1,362 @@
+/**
+ * @file pqueue_calendar.c
+ * @brief Calendar queue of elements sorted by tag. See pqueue_calendar.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "pqueue_calendar.h"
+#include "util.h"               // For lf_print
+#include "low_level_platform.h" // For PRINTF_TAG
+
+//////////////////
+// Local functions, not intended for use outside this file.
+
+/**
+ * @brief Map a time to an unsigned key with the same order, so that NEVER is 0.
+ */
+static inline uint64_t calendar_key(instant_t time) { return (uint64_t)time ^ ((uint64_t)1 << 63); }
+
+/**
+ * @brief Return the bucket for the day that the specified key falls on.
+ */
+static inline pqueue_calendar_bucket_t* calendar_bucket(pqueue_calendar_t* q, uint64_t key) {
+  return &q->buckets[(key / q->width) & (q->bucket_count - 1)];
+}
+
+/**
+ * @brief Return the position in the bucket of the first element that does not have a larger
+ * tag than the specified tag, or the length of the bucket if there is none.
+ */
+static size_t bucket_lower_bound(pqueue_calendar_bucket_t* b, tag_t t) {
+  size_t low = 0;
+  size_t high = b->length;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (lf_tag_compare(b->elements[middle]->tag, t) > 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/**
+ * @brief Return the position in the bucket of the first element that has a lesser tag
+ * than the specified tag, or the length of the bucket if there is none.
+ */
+static size_t bucket_upper_bound(pqueue_calendar_bucket_t* b, tag_t t) {
+  size_t low = 0;
+  size_t high = b->length;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (lf_tag_compare(b->elements[middle]->tag, t) >= 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/**
+ * @brief Put an element into its bucket without updating the size or resizing.
+ *
+ * The element goes after the elements with an equal tag, so that adding many
+ * elements with the least tag in a bucket moves no others.
+ * @return 0 on success, 1 if memory allocation fails.
+ */
+static int bucket_insert(pqueue_calendar_t* q, pqueue_tag_element_t* e) {
+  pqueue_calendar_bucket_t* b = calendar_bucket(q, calendar_key(e->tag.time));
+  if (b->length == b->capacity) {
+    size_t capacity = b->capacity == 0 ? 4 : 2 * b->capacity;
+    pqueue_tag_element_t** elements =
+        (pqueue_tag_element_t**)realloc(b->elements, capacity * sizeof(pqueue_tag_element_t*));
+    if (elements == NULL)
+      return 1;
+    b->elements = elements;
+    b->capacity = capacity;
+  }
+  size_t position = bucket_upper_bound(b, e->tag);
+  memmove(&b->elements[position + 1], &b->elements[position], (b->length - position) * sizeof(pqueue_tag_element_t*));
+  b->elements[position] = e;
+  b->length++;
+  return 0;
+}
+
+/**
+ * @brief Make the specified key the start of the current day, rounded down to a multiple of the width.
+ */
+static void calendar_set_current(pqueue_calendar_t* q, uint64_t key) {
+  q->current_start = key - key % q->width;
+  q->current = (key / q->width) & (q->bucket_count - 1);
+}
+
+/**
+ * @brief Return the bucket holding the least element, which must exist, and make its day current.
+ */
+static pqueue_calendar_bucket_t* calendar_find_least(pqueue_calendar_t* q) {
+  // Look through one year of days, starting with the current one.
+  for (size_t i = 0; i < q->bucket_count; i++) {
+    pqueue_calendar_bucket_t* b = &q->buckets[q->current];
+    if (b->length > 0 && calendar_key(b->elements[b->length - 1]->tag.time) - q->current_start < q->width) {
+      return b;
+    }
+    if (q->current_start > UINT64_MAX - q->width)
+      break;
+    q->current_start += q->width;
+    q->current = (q->current + 1) & (q->bucket_count - 1);
+  }
+  // The next element is more than a year away. Find it directly.
+  pqueue_calendar_bucket_t* least = NULL;
+  for (size_t i = 0; i < q->bucket_count; i++) {
+    pqueue_calendar_bucket_t* b = &q->buckets[i];
+    if (b->length == 0)
+      continue;
+    if (least == NULL || lf_tag_compare(b->elements[b->length - 1]->tag, least->elements[least->length - 1]->tag) < 0) {
+      least = b;
+    }
+  }
+  calendar_set_current(q, calendar_key(least->elements[least->length - 1]->tag.time));
+  return least;
+}
+
+/**
+ * @brief Estimate the width of a day from the spacing of the earliest elements as proposed by Brown:
+ * three times the average gap between them, not counting gaps more than twice the average of all gaps.
+ */
+static uint64_t calendar_estimate_width(pqueue_calendar_t* q) {
+  size_t count = q->size < PQUEUE_CALENDAR_SAMPLES ? q->size : PQUEUE_CALENDAR_SAMPLES;
+  if (count < 2)
+    return q->width;
+  pqueue_tag_element_t* samples[PQUEUE_CALENDAR_SAMPLES];
+  for (size_t i = 0; i < count; i++) {
+    samples[i] = pqueue_calendar_pop(q);
+  }
+  uint64_t first = calendar_key(samples[0]->tag.time);
+  uint64_t last = calendar_key(samples[count - 1]->tag.time);
+  uint64_t average = (last - first) / (count - 1);
+  uint64_t sum = 0;
+  size_t gaps = 0;
+  for (size_t i = 1; i < count; i++) {
+    uint64_t gap = calendar_key(samples[i]->tag.time) - calendar_key(samples[i - 1]->tag.time);
+    if (gap / 2 <= average) {
+      sum += gap;
+      gaps++;
+    }
+  }
+  // Put the samples back, the least last so that it goes to the end of its bucket.
+  for (size_t i = count; i > 0; i--) {
+    bucket_insert(q, samples[i - 1]);
+    q->size++;
+  }
+  if (first < q->current_start) {
+    calendar_set_current(q, first);
+  }
+  uint64_t width = gaps > 0 ? sum / gaps : 0;
+  width = width > UINT64_MAX / 3 ? UINT64_MAX : 3 * width;
+  // If the elements are not spread out, keep the width.
+  return width > 0 ? width : q->width;
+}
+
+/**
+ * @brief Change the number of buckets and re-estimate the width of a day.
+ * If memory allocation fails, the queue is left as it was.
+ */
+static void calendar_resize(pqueue_calendar_t* q, size_t bucket_count) {
+  q->resizing = 1;
+  uint64_t width = calendar_estimate_width(q);
+  pqueue_calendar_bucket_t* buckets =
+      (pqueue_calendar_bucket_t*)calloc(bucket_count, sizeof(pqueue_calendar_bucket_t));
+  if (buckets != NULL) {
+    pqueue_calendar_bucket_t* old_buckets = q->buckets;
+    size_t old_bucket_count = q->bucket_count;
+    q->buckets = buckets;
+    q->bucket_count = bucket_count;
+    q->width = width;
+    uint64_t least = UINT64_MAX;
+    for (size_t i = 0; i < old_bucket_count; i++) {
+      pqueue_calendar_bucket_t* b = &old_buckets[i];
+      // Going from largest to least tag puts each element at or near the end of its new bucket.
+      for (size_t j = 0; j < b->length; j++) {
+        if (bucket_insert(q, b->elements[j]) != 0) {
+          lf_print_error_and_exit("Out of memory while resizing a calendar queue.");
+        }
+      }
+      if (b->length > 0 && calendar_key(b->elements[b->length - 1]->tag.time) < least) {
+        least = calendar_key(b->elements[b->length - 1]->tag.time);
+      }
+      free(b->elements);
+    }
+    free(old_buckets);
+    calendar_set_current(q, q->size > 0 ? least : 0);
+  }
+  q->resizing = 0;
+}
+
+/**
+ * @brief Resize the queue if it has become much larger or smaller than the number of buckets.
+ */
+static void calendar_check_size(pqueue_calendar_t* q) {
+  if (q->resizing)
+    return;
+  if (q->size > 2 * q->bucket_count) {
+    calendar_resize(q, 2 * q->bucket_count);
+  } else if (q->size < q->bucket_count / 2 && q->bucket_count > PQUEUE_CALENDAR_MIN_BUCKETS) {
+    calendar_resize(q, q->bucket_count / 2);
+  }
+}
+
+//////////////////
+// Functions defined in pqueue_calendar.h.
+
+pqueue_calendar_t* pqueue_calendar_init(size_t initial_size, pqueue_eq_elem_f eqelem, pqueue_print_entry_f prt) {
+  pqueue_calendar_t* q = (pqueue_calendar_t*)calloc(1, sizeof(pqueue_calendar_t));
+  if (q == NULL)
+    return NULL;
+  q->bucket_count = PQUEUE_CALENDAR_MIN_BUCKETS;
+  while (q->bucket_count < initial_size / 2) {
+    q->bucket_count *= 2;
+  }
+  q->buckets = (pqueue_calendar_bucket_t*)calloc(q->bucket_count, sizeof(pqueue_calendar_bucket_t));
+  if (q->buckets == NULL) {
+    free(q);
+    return NULL;
+  }
+  q->width = PQUEUE_CALENDAR_INITIAL_WIDTH;
+  q->eqelem = eqelem;
+  q->prt = prt;
+  return q;
+}
+
+void pqueue_calendar_free(pqueue_calendar_t* q) {
+  for (size_t i = 0; i < q->bucket_count; i++) {
+    pqueue_calendar_bucket_t* b = &q->buckets[i];
+    for (size_t j = 0; j < b->length; j++) {
+      if (b->elements[j]->is_dynamic) {
+        free(b->elements[j]);
+      }
+    }
+    free(b->elements);
+  }
+  free(q->buckets);
+  free(q);
+}
+
+size_t pqueue_calendar_size(pqueue_calendar_t* q) {
+  if (!q)
+    return 0;
+  return q->size;
+}
+
+int pqueue_calendar_insert(pqueue_calendar_t* q, pqueue_tag_element_t* e) {
+  if (!q)
+    return 1;
+  if (bucket_insert(q, e) != 0)
+    return 1;
+  uint64_t key = calendar_key(e->tag.time);
+  if (key < q->current_start) {
+    calendar_set_current(q, key);
+  }
+  q->size++;
+  calendar_check_size(q);
+  return 0;
+}
+
+pqueue_tag_element_t* pqueue_calendar_peek(pqueue_calendar_t* q) {
+  if (!q || q->size == 0)
+    return NULL;
+  pqueue_calendar_bucket_t* b = calendar_find_least(q);
+  return b->elements[b->length - 1];
+}
+
+pqueue_tag_element_t* pqueue_calendar_pop(pqueue_calendar_t* q) {
+  if (!q || q->size == 0)
+    return NULL;
+  pqueue_calendar_bucket_t* b = calendar_find_least(q);
+  pqueue_tag_element_t* e = b->elements[--b->length];
+  q->size--;
+  calendar_check_size(q);
+  return e;
+}
+
+size_t pqueue_calendar_pop_all_with_tag(pqueue_calendar_t* q, tag_t t, vector_t* popped) {
+  if (!q || q->size == 0)
+    return 0;
+  pqueue_calendar_bucket_t* b = calendar_find_least(q);
+  // Elements with the same tag are together at the end of the bucket.
+  size_t count = 0;
+  while (count < b->length && lf_tag_compare(b->elements[b->length - 1 - count]->tag, t) == 0) {
+    vector_push(popped, b->elements[b->length - 1 - count]);
+    count++;
+  }
+  b->length -= count;
+  q->size -= count;
+  calendar_check_size(q);
+  return count;
+}
+
+void pqueue_calendar_remove(pqueue_calendar_t* q, pqueue_tag_element_t* e) {
+  pqueue_calendar_bucket_t* b = calendar_bucket(q, calendar_key(e->tag.time));
+  for (size_t i = bucket_lower_bound(b, e->tag); i < b->length && lf_tag_compare(b->elements[i]->tag, e->tag) == 0;
+       i++) {
+    if (b->elements[i] == e) {
+      memmove(&b->elements[i], &b->elements[i + 1], (b->length - i - 1) * sizeof(pqueue_tag_element_t*));
+      b->length--;
+      q->size--;
+      calendar_check_size(q);
+      return;
+    }
+  }
+}
+
+pqueue_tag_element_t* pqueue_calendar_find_same_tag(pqueue_calendar_t* q, tag_t t) {
+  if (!q || q->size == 0)
+    return NULL;
+  pqueue_calendar_bucket_t* b = calendar_bucket(q, calendar_key(t.time));
+  size_t i = bucket_lower_bound(b, t);
+  if (i < b->length && lf_tag_compare(b->elements[i]->tag, t) == 0) {
+    return b->elements[i];
+  }
+  return NULL;
+}
+
+pqueue_tag_element_t* pqueue_calendar_find_equal_same_tag(pqueue_calendar_t* q, pqueue_tag_element_t* e) {
+  if (!q || q->size == 0)
+    return NULL;
+  pqueue_calendar_bucket_t* b = calendar_bucket(q, calendar_key(e->tag.time));
+  for (size_t i = bucket_lower_bound(b, e->tag); i < b->length && lf_tag_compare(b->elements[i]->tag, e->tag) == 0;
+       i++) {
+    if (q->eqelem(b->elements[i], e)) {
+      return b->elements[i];
+    }
+  }
+  return NULL;
+}
+
+void pqueue_calendar_elements(pqueue_calendar_t* q, pqueue_tag_element_t** elements) {
+  size_t count = 0;
+  for (size_t i = 0; i < q->bucket_count; i++) {
+    pqueue_calendar_bucket_t* b = &q->buckets[i];
+    memcpy(&elements[count], b->elements, b->length * sizeof(pqueue_tag_element_t*));
+    count += b->length;
+  }
+}
+
+void pqueue_calendar_dump(pqueue_calendar_t* q) {
+  lf_print("Calendar queue of %zu elements in %zu buckets with days of " PRINTF_TIME " ns. Current bucket: %zu.",
+           q->size, q->bucket_count, (instant_t)q->width, q->current);
+  for (size_t i = 0; i < q->bucket_count; i++) {
+    pqueue_calendar_bucket_t* b = &q->buckets[i];
+    if (b->length == 0)
+      continue;
+    lf_print("Bucket %zu:", i);
+    // Print from least to largest tag.
+    for (size_t j = b->length; j > 0; j--) {
+      q->prt(b->elements[j - 1]);
+    }
+  }
+}
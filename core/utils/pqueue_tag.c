@@ -8,25 +8,16 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "pqueue_tag.h"
+#include "pqueue_calendar.h"
 #include "util.h"               // For lf_print
 #include "low_level_platform.h" // For PRINTF_TAG
 
 //////////////////
 // Local functions, not intended for use outside this file.
 
-/**
- * @brief Callback function to get the priority of an element.
- * Return the pointer argument cast to pqueue_pri_t because the
- * element is also the priority. This function is of type pqueue_get_pri_f.
- * @param element A pointer to a pqueue_tag_element_t, cast to void*.
- */
-static pqueue_pri_t pqueue_tag_get_priority(void* element) {
-  // Suppress "error: cast from pointer to integer of different size" by casting to uintptr_t first.
-  return (pqueue_pri_t)(uintptr_t)element;
-}
-
 /**
  * @brief Callback function to determine whether two elements are equivalent.
  * Return 1 if the tags contained by given elements are identical, 0 otherwise.
@@ -38,21 +29,6 @@ static int pqueue_tag_matches(void* element1, void* element2) {
   return lf_tag_compare(((pqueue_tag_element_t*)element1)->tag, ((pqueue_tag_element_t*)element2)->tag) == 0;
 }
 
-/**
- * @brief Callback function to return the position of an element.
- * This function is of type pqueue_get_pos_f.
- * @param element A pointer to a pqueue_tag_element_t, cast to void*.
- */
-static size_t pqueue_tag_get_position(void* element) { return ((pqueue_tag_element_t*)element)->pos; }
-
-/**
- * @brief Callback function to set the position of an element.
- * This function is of type pqueue_set_pos_f.
- * @param element A pointer to a pqueue_tag_element_t, cast to void*.
- * @param pos The position.
- */
-static void pqueue_tag_set_position(void* element, size_t pos) { ((pqueue_tag_element_t*)element)->pos = pos; }
-
 /**
  * @brief Callback function to print information about an element.
  * This is a function of type pqueue_print_entry_f.
@@ -72,29 +48,155 @@ int pqueue_tag_compare(pqueue_pri_t priority1, pqueue_pri_t priority2) {
                          ((pqueue_tag_element_t*)(uintptr_t)priority2)->tag));
 }
 
+#if defined(LF_CALENDAR_QUEUE)
+
+pqueue_tag_t* pqueue_tag_init(size_t initial_size) {
+  return pqueue_calendar_init(initial_size, pqueue_tag_matches, pqueue_tag_print_element);
+}
+
+pqueue_tag_t* pqueue_tag_init_customize(size_t initial_size, pqueue_cmp_pri_f cmppri, pqueue_eq_elem_f eqelem,
+                                        pqueue_print_entry_f prt) {
+  (void)cmppri; // The calendar queue always orders by tag.
+  return pqueue_calendar_init(initial_size, eqelem, prt);
+}
+
+void pqueue_tag_free(pqueue_tag_t* q) { pqueue_calendar_free(q); }
+
+size_t pqueue_tag_size(pqueue_tag_t* q) { return pqueue_calendar_size(q); }
+
+int pqueue_tag_insert(pqueue_tag_t* q, pqueue_tag_element_t* d) { return pqueue_calendar_insert(q, d); }
+
+pqueue_tag_element_t* pqueue_tag_find_with_tag(pqueue_tag_t* q, tag_t t) { return pqueue_calendar_find_same_tag(q, t); }
+
+pqueue_tag_element_t* pqueue_tag_find_equal_same_tag(pqueue_tag_t* q, pqueue_tag_element_t* e) {
+  return pqueue_calendar_find_equal_same_tag(q, e);
+}
+
+pqueue_tag_element_t* pqueue_tag_peek(pqueue_tag_t* q) { return pqueue_calendar_peek(q); }
+
+pqueue_tag_element_t* pqueue_tag_pop(pqueue_tag_t* q) { return pqueue_calendar_pop(q); }
+
+size_t pqueue_tag_pop_all_with_tag(pqueue_tag_t* q, tag_t t, vector_t* popped) {
+  return pqueue_calendar_pop_all_with_tag(q, t, popped);
+}
+
+void pqueue_tag_remove(pqueue_tag_t* q, pqueue_tag_element_t* e) { pqueue_calendar_remove(q, e); }
+
+void pqueue_tag_elements(pqueue_tag_t* q, pqueue_tag_element_t** elements) { pqueue_calendar_elements(q, elements); }
+
+void pqueue_tag_dump(pqueue_tag_t* q) { pqueue_calendar_dump(q); }
+
+#else // D-ary heap.
+
+// A heap of elements that keeps their tags next to them, so that comparisons need not follow the pointers.
+#define DARY_HEAP(token) tag_heap##_##token
+#define DARY_HEAP_E pqueue_tag_element_t*
+#define DARY_HEAP_P tag_t
+#define DARY_HEAP_PRIORITY_BEFORE(a, b) ((a).time < (b).time || ((a).time == (b).time && (a).microstep < (b).microstep))
+#define DARY_HEAP_SET_POSITION(e, position) ((e)->pos = (position))
+#define DARY_HEAP_ARITY 4
+#include "impl/dary_heap.h"
+
+struct pqueue_tag_heap_t {
+  tag_heap_t heap;
+  /** Callback to check whether two elements with the same tag are equivalent. */
+  pqueue_eq_elem_f eqelem;
+  /** Callback to print an element. */
+  pqueue_print_entry_f prt;
+};
+
+/**
+ * @brief Argument of equal_element() when looking for an element equivalent to a given one.
+ */
+typedef struct {
+  pqueue_eq_elem_f eqelem;
+  pqueue_tag_element_t* element;
+} equal_element_arg_t;
+
+/**
+ * @brief Callback function of type tag_heap_match_f that checks whether an element is equivalent to a given one.
+ * @param element An element of the heap.
+ * @param arg A pointer to an equal_element_arg_t.
+ */
+static int equal_element(pqueue_tag_element_t* element, void* arg) {
+  equal_element_arg_t* equal = (equal_element_arg_t*)arg;
+  return equal->eqelem(element, equal->element);
+}
+
 pqueue_tag_t* pqueue_tag_init(size_t initial_size) {
-  return (pqueue_tag_t*)pqueue_init(initial_size, pqueue_tag_compare, pqueue_tag_get_priority, pqueue_tag_get_position,
-                                    pqueue_tag_set_position, pqueue_tag_matches, pqueue_tag_print_element);
+  return pqueue_tag_init_customize(initial_size, pqueue_tag_compare, pqueue_tag_matches, pqueue_tag_print_element);
 }
 
 pqueue_tag_t* pqueue_tag_init_customize(size_t initial_size, pqueue_cmp_pri_f cmppri, pqueue_eq_elem_f eqelem,
                                         pqueue_print_entry_f prt) {
-  return (pqueue_tag_t*)pqueue_init(initial_size, cmppri, pqueue_tag_get_priority, pqueue_tag_get_position,
-                                    pqueue_tag_set_position, eqelem, prt);
+  (void)cmppri; // The heap always orders by tag.
+  pqueue_tag_t* q = (pqueue_tag_t*)malloc(sizeof(pqueue_tag_t));
+  if (q == NULL)
+    return NULL;
+  q->heap = tag_heap_new(initial_size);
+  q->eqelem = eqelem;
+  q->prt = prt;
+  return q;
 }
 
 void pqueue_tag_free(pqueue_tag_t* q) {
-  for (size_t i = 1; i < q->size; i++) {
-    if (q->d[i] != NULL && ((pqueue_tag_element_t*)q->d[i])->is_dynamic) {
-      free(q->d[i]);
+  for (size_t i = 1; i <= tag_heap_size(&q->heap); i++) {
+    pqueue_tag_element_t* element = tag_heap_at(&q->heap, i);
+    if (element->is_dynamic) {
+      free(element);
     }
   }
-  pqueue_free((pqueue_t*)q);
+  tag_heap_free(&q->heap);
+  free(q);
+}
+
+size_t pqueue_tag_size(pqueue_tag_t* q) { return tag_heap_size(&q->heap); }
+
+int pqueue_tag_insert(pqueue_tag_t* q, pqueue_tag_element_t* d) { return tag_heap_insert(&q->heap, d, d->tag); }
+
+pqueue_tag_element_t* pqueue_tag_find_with_tag(pqueue_tag_t* q, tag_t t) {
+  return tag_heap_find_same_priority(&q->heap, t, NULL, NULL);
+}
+
+pqueue_tag_element_t* pqueue_tag_find_equal_same_tag(pqueue_tag_t* q, pqueue_tag_element_t* e) {
+  equal_element_arg_t arg = {.eqelem = q->eqelem, .element = e};
+  return tag_heap_find_same_priority(&q->heap, e->tag, equal_element, &arg);
 }
 
-size_t pqueue_tag_size(pqueue_tag_t* q) { return pqueue_size((pqueue_t*)q); }
+pqueue_tag_element_t* pqueue_tag_peek(pqueue_tag_t* q) { return tag_heap_peek(&q->heap); }
+
+pqueue_tag_element_t* pqueue_tag_pop(pqueue_tag_t* q) { return tag_heap_pop(&q->heap); }
 
-int pqueue_tag_insert(pqueue_tag_t* q, pqueue_tag_element_t* d) { return pqueue_insert((pqueue_t*)q, (void*)d); }
+size_t pqueue_tag_pop_all_with_tag(pqueue_tag_t* q, tag_t t, vector_t* popped) {
+  pqueue_tag_element_t* head = tag_heap_peek(&q->heap);
+  if (head == NULL || lf_tag_compare(head->tag, t) != 0)
+    return 0;
+  return tag_heap_pop_all_same_priority(&q->heap, popped);
+}
+
+void pqueue_tag_remove(pqueue_tag_t* q, pqueue_tag_element_t* e) {
+  // Do nothing if the element is not in the queue.
+  if (e->pos >= 1 && e->pos <= tag_heap_size(&q->heap) && tag_heap_at(&q->heap, e->pos) == e) {
+    tag_heap_remove(&q->heap, e->pos);
+  }
+}
+
+void pqueue_tag_elements(pqueue_tag_t* q, pqueue_tag_element_t** elements) {
+  for (size_t i = 1; i <= tag_heap_size(&q->heap); i++) {
+    elements[i - 1] = tag_heap_at(&q->heap, i);
+  }
+}
+
+void pqueue_tag_dump(pqueue_tag_t* q) {
+  for (size_t i = 1; i <= tag_heap_size(&q->heap); i++) {
+    LF_PRINT_DEBUG("Position %zu:", i);
+    q->prt(tag_heap_at(&q->heap, i));
+  }
+}
+
+#endif // LF_CALENDAR_QUEUE
+
+// The following functions are the same for both kinds of queue.
 
 int pqueue_tag_insert_tag(pqueue_tag_t* q, tag_t t) {
   pqueue_tag_element_t* d = (pqueue_tag_element_t*)malloc(sizeof(pqueue_tag_element_t));
@@ -103,17 +205,6 @@ int pqueue_tag_insert_tag(pqueue_tag_t* q, tag_t t) {
   return pqueue_tag_insert(q, d);
 }
 
-pqueue_tag_element_t* pqueue_tag_find_with_tag(pqueue_tag_t* q, tag_t t) {
-  // Create an element on the stack. This element is only needed during
-  // the duration of this function call, so putting it on the stack is OK.
-  pqueue_tag_element_t element = {.tag = t, .pos = 0, .is_dynamic = false};
-  return pqueue_find_same_priority((pqueue_t*)q, (void*)&element);
-}
-
-pqueue_tag_element_t* pqueue_tag_find_equal_same_tag(pqueue_tag_t* q, pqueue_tag_element_t* e) {
-  return pqueue_find_equal_same_priority((pqueue_t*)q, (void*)e);
-}
-
 int pqueue_tag_insert_if_no_match(pqueue_tag_t* q, tag_t t) {
   if (pqueue_tag_find_with_tag(q, t) == NULL) {
     return pqueue_tag_insert_tag(q, t);
@@ -122,8 +213,6 @@ int pqueue_tag_insert_if_no_match(pqueue_tag_t* q, tag_t t) {
   }
 }
 
-pqueue_tag_element_t* pqueue_tag_peek(pqueue_tag_t* q) { return (pqueue_tag_element_t*)pqueue_peek((pqueue_t*)q); }
-
 tag_t pqueue_tag_peek_tag(pqueue_tag_t* q) {
   pqueue_tag_element_t* element = (pqueue_tag_element_t*)pqueue_tag_peek(q);
   if (element == NULL)
@@ -132,8 +221,6 @@ tag_t pqueue_tag_peek_tag(pqueue_tag_t* q) {
     return element->tag;
 }
 
-pqueue_tag_element_t* pqueue_tag_pop(pqueue_tag_t* q) { return (pqueue_tag_element_t*)pqueue_pop((pqueue_t*)q); }
-
 tag_t pqueue_tag_pop_tag(pqueue_tag_t* q) {
   pqueue_tag_element_t* element = (pqueue_tag_element_t*)pqueue_tag_pop(q);
   if (element == NULL)
@@ -146,8 +233,6 @@ tag_t pqueue_tag_pop_tag(pqueue_tag_t* q) {
   }
 }
 
-void pqueue_tag_remove(pqueue_tag_t* q, pqueue_tag_element_t* e) { pqueue_remove((pqueue_t*)q, (void*)e); }
-
 void pqueue_tag_remove_up_to(pqueue_tag_t* q, tag_t t) {
   tag_t head = pqueue_tag_peek_tag(q);
   while (lf_tag_compare(head, FOREVER_TAG) < 0 && lf_tag_compare(head, t) <= 0) {
@@ -155,5 +240,3 @@ void pqueue_tag_remove_up_to(pqueue_tag_t* q, tag_t t) {
     head = pqueue_tag_peek_tag(q);
   }
 }
-
-void pqueue_tag_dump(pqueue_tag_t* q) { pqueue_dump((pqueue_t*)q, pqueue_tag_print_element); }
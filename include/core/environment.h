@@ -18,6 +18,7 @@
 #include "lf_types.h"
 #include "low_level_platform.h"
 #include "tracepoint.h"
+#include "reaction_heap.h"
 
 // Forward declarations so that a pointers can appear in the environment struct.
 typedef struct lf_scheduler_t lf_scheduler_t;
@@ -117,12 +118,25 @@ typedef struct environment_t {
   pqueue_tag_t* event_q;
 
   /**
-   * @brief Priority queue for recycling events.
+   * @brief Free list of events for recycling, linked through their next fields.
    *
    * Used to efficiently reuse event structures after they
    * have been processed, reducing memory allocation overhead.
    */
-  pqueue_tag_t* recycle_q;
+  event_t* free_events;
+
+  /**
+   * @brief Events taken off the event queue at the current tag that are yet to be handled.
+   *
+   * Kept in the environment so that popping events does not allocate memory.
+   */
+  vector_t popped_events;
+
+  /**
+   * @brief Groups of periodic timers that fire at the same tags, linked through their next fields.
+   * @see timer_group.h
+   */
+  struct timer_group_t* timer_groups;
 
   /**
    * @brief Array of is_present fields for ports.
@@ -268,7 +282,7 @@ typedef struct environment_t {
    * Used to schedule and execute reactions in order when
    * running in single-threaded mode.
    */
-  pqueue_t* reaction_q;
+  reaction_heap_t reaction_q;
 #else
   /**
    * @brief Number of worker threads.
@@ -325,6 +339,28 @@ typedef struct environment_t {
    * have reached zero.
    */
   lf_cond_t global_tag_barrier_requestors_reached_zero;
+
+  /**
+   * @brief Number of deadline violations detected in this environment.
+   *
+   * Incremented atomically by the worker that detects a violation.
+   */
+  int64_t deadline_misses;
+
+  /**
+   * @brief Lag (physical minus logical time) seen by the previous worker report.
+   *
+   * NEVER until the first report.
+   */
+  interval_t last_report_lag;
+
+  /**
+   * @brief Physical-time-delay variation (PTDV) of this environment.
+   *
+   * A running estimate of how much the lag changes from one worker report to
+   * the next, smoothed with a gain of 1/16 like RTP interarrival jitter.
+   */
+  interval_t ptdv;
 #endif // LF_SINGLE_THREADED
 
 #if defined(FEDERATED)
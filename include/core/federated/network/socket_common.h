@@ -281,6 +281,42 @@ int write_to_socket(int socket, size_t num_bytes, unsigned char* buffer);
  */
 int write_to_socket_close_on_error(int* socket, size_t num_bytes, unsigned char* buffer);
 
+/**
+ * @brief Write a header followed by a payload to the specified socket in one system call.
+ * @ingroup Federated
+ *
+ * The header and payload are gathered by a single writev() call, so that with
+ * Nagle's algorithm disabled they leave in the same segment and the payload is
+ * not copied into a staging buffer. If the socket accepts only part of the
+ * data, the remainder is written by further calls. Errors are handled as in
+ * @ref write_to_socket.
+ * @param socket The socket ID.
+ * @param header_length The number of header bytes.
+ * @param header The header.
+ * @param payload_length The number of payload bytes, which may be 0.
+ * @param payload The payload.
+ * @return 0 for success, -1 for failure.
+ */
+int write_to_socket_with_payload(int socket, size_t header_length, unsigned char* header, size_t payload_length,
+                                 unsigned char* payload);
+
+/**
+ * @brief Write a header followed by a payload to the specified socket in one system call.
+ * @ingroup Federated
+ *
+ * This uses @ref write_to_socket_with_payload and closes the socket if an error occurs.
+ * If an error occurs, this will change the socket ID pointed to by the first argument to -1 and will return -1.
+ *
+ * @param socket Pointer to the socket ID.
+ * @param header_length The number of header bytes.
+ * @param header The header.
+ * @param payload_length The number of payload bytes, which may be 0.
+ * @param payload The payload.
+ * @return 0 for success, -1 for failure.
+ */
+int write_to_socket_with_payload_close_on_error(int* socket, size_t header_length, unsigned char* header,
+                                                size_t payload_length, unsigned char* payload);
+
 /**
  * @brief Write the specified number of bytes to the specified socket.
  * @ingroup Federated
@@ -34,6 +34,15 @@
  * When the token_template_t (port or action) is assigned a new value, if
  * the reference count is 1, then the same token will be reused, and
  * any previous value (payload) will be freed.
+ *
+ * Payloads are normally allocated with malloc() and released with free().
+ * A port or action can instead be given a payload pool with
+ * @ref lf_enable_payload_pool. Payloads that the runtime allocates for it
+ * (by `lf_schedule_copy` and by writable copies of mutable inputs) then come
+ * from size-classed free lists owned by its token_type_t and go back there
+ * when the last token referring to them is freed. Writable copies, which
+ * normally die at the start of the next tag, are carved out of a shared tag
+ * arena that resets once all of its payloads have been released.
  */
 
 #ifndef LF_TOKEN_H
@@ -107,6 +116,8 @@ typedef struct lf_token_t {
   size_t ref_count;
   /** @brief Convenience for constructing a temporary list of tokens. */
   struct lf_token_t* next;
+  /** @brief True if the value came from a payload pool and must be returned there rather than freed. */
+  bool pooled;
 } lf_token_t;
 
 /**
@@ -314,6 +325,26 @@ lf_token_t* lf_new_token(void* port_or_action, void* val, size_t len);
  */
 lf_token_t* lf_writable_copy(lf_port_base_t* port);
 
+/**
+ * @brief Give the specified port or action a payload pool.
+ * @ingroup API
+ *
+ * Payloads that the runtime allocates for this port or action are then
+ * recycled instead of being returned to the system allocator, so that a
+ * steady stream of same-size messages causes no allocator traffic.
+ * For an action, this covers `lf_schedule_copy`. For a mutable input,
+ * it covers the writable copies made of its values.
+ * Payloads of up to 64 KiB are pooled; larger ones still use malloc().
+ * Pools are only used while the type has neither a destructor nor a copy
+ * constructor, and pooled values must not be freed or reallocated by hand.
+ * Building with `LF_PAYLOAD_POOLS` gives every port and action a pool.
+ * Pools are ignored in the Python target.
+ *
+ * @param port_or_action A port or action.
+ * @return true if the port or action has a pool.
+ */
+bool lf_enable_payload_pool(void* port_or_action);
+
 //////////////////////////////////////////////////////////
 //// Functions not intended to be used by users
 
@@ -352,6 +383,22 @@ token_freed _lf_free_token(lf_token_t* token);
  */
 lf_token_t* _lf_new_token(token_type_t* type, void* value, size_t length);
 
+/**
+ * @brief Return a new token whose value is a newly allocated buffer of the specified size.
+ * @ingroup Internal
+ *
+ * The buffer comes from the payload pool of the type if it has one
+ * (see @ref lf_enable_payload_pool) and from malloc() otherwise. It is
+ * owned by the token and released with it, so data can be read directly
+ * into it, for example from a socket, without a further copy.
+ * The reference count of the returned token will be 0.
+ * @param type The type of the token.
+ * @param size The size of the buffer in bytes.
+ * @param length The array length of the value.
+ * @return The token, or NULL if the buffer could not be allocated.
+ */
+lf_token_t* _lf_new_token_with_buffer(token_type_t* type, size_t size, size_t length);
+
 /**
  * @brief Get a token for the specified template.
  * @ingroup Internal
@@ -426,7 +473,9 @@ lf_token_t* _lf_initialize_token(token_template_t* tmplt, size_t length);
  * @brief Free all tokens.
  * @ingroup Internal
  *
- * Free tokens on the _lf_token_recycling_bin hashset and all template tokens.
+ * Free all template tokens and the tokens held for recycling in the
+ * global pool and in the calling thread's cache, then release all
+ * payload pools. Other threads release their caches when they exit.
  */
 void _lf_free_all_tokens();
 
@@ -62,6 +62,19 @@ typedef unsigned short int ushort;
  */
 #define SCHED_NP 3
 
+/**
+ * @brief Experimental GEDF scheduler with per-level, deadline-sorted queues.
+ * @ingroup Internal
+ */
+#define SCHED_GEDF_LEVELED 4
+
+/**
+ * @brief Experimental NP scheduler with per-worker, work-stealing deques.
+ * Federated programs fall back to SCHED_NP.
+ * @ingroup Internal
+ */
+#define SCHED_NP_WORK_STEALING 5
+
 /**
  * @brief A struct representing a barrier in threaded LF programs.
  * @ingroup Internal
@@ -336,6 +349,15 @@ struct reaction_t {
    * Only present when modal reactors are enabled.
    */
   reactor_mode_t* mode;
+
+  /**
+   * @brief Stable 64-bit key identifying this reaction across runs.
+   * RUNTIME: Computed once by lf_reaction_keys_init() before worker threads start for
+   * every reaction that it reaches from the environments. A reaction triggered only by
+   * an action or a network input gets it on first use, without allocating memory
+   * (see reaction_key.h). Accessed atomically. Zero means "not yet computed".
+   */
+  uint64_t stable_key;
 };
 
 /**
@@ -373,6 +395,12 @@ struct event_t {
    */
   lf_token_t* token;
 
+  /**
+   * @brief Next event on the free list of the environment.
+   * Only used while the event is recycled.
+   */
+  event_t* next;
+
 #ifdef FEDERATED
   /**
    * @brief The intended tag for this event.
@@ -460,6 +488,12 @@ struct trigger_t {
    */
   reactor_mode_t* mode;
 
+  /**
+   * @brief The group of periodic timers whose events this trigger is the trigger of.
+   * NULL for all triggers of reactors; see timer_group.h.
+   */
+  struct timer_group_t* timer_group;
+
 #ifdef FEDERATED
   /**
    * @brief Last known status tag of the port.
@@ -569,6 +603,15 @@ typedef struct self_base_t {
    */
   reactor_mode_state_t _lf__mode_state;
 #endif
+
+#if defined(LF_TRACE)
+  /**
+   * @brief Reactions of this reactor whose events are not traced.
+   * Bit n stands for reaction n, and bit 63 for all reactions numbered 63 and above.
+   * Set at startup from the LF_TRACE_REACTORS allowlist (see tracepoint.h).
+   */
+  uint64_t trace_excluded_reactions;
+#endif
 } self_base_t;
 
 /**
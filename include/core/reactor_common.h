@@ -110,7 +110,7 @@ event_t* lf_get_new_event(environment_t* env);
  * @brief Recycle the given event.
  * @ingroup Internal
  *
- * This will zero out the event and push it onto the recycle queue.
+ * This will zero out the event and push it onto the free list of the environment.
  * @param env Environment in which we are executing.
  * @param e The event to recycle.
  */
@@ -183,6 +183,73 @@ void termination(void);
  */
 void _lf_trigger_reaction(environment_t* env, reaction_t* reaction, int worker_number);
 
+/**
+ * @brief Return whether the specified reaction may be executed immediately, right after
+ * the reaction that triggered it, without going through the reaction queue.
+ * @ingroup Internal
+ *
+ * This is false if a reaction with an earlier (inferred) deadline is waiting to be executed
+ * or if the master scheduler has to see the reaction become ready.
+ * This is defined by the single-threaded and the threaded runtime.
+ *
+ * @param env Environment in which we are executing.
+ * @param reaction The reaction.
+ */
+bool _lf_may_execute_inline(environment_t* env, reaction_t* reaction);
+
+/**
+ * @brief Return whether _lf_chain_executed() needs the CPU time of the executing thread at the
+ * end of each reaction of a chain.
+ * @ingroup Internal
+ *
+ * Reading the CPU time of a thread takes a system call, so chains sample it only if this is true.
+ * This is defined by the single-threaded and the threaded runtime.
+ */
+bool _lf_chain_needs_cpu_times(void);
+
+/**
+ * @brief Handle the deadline and STP violations of a reaction that is about to be invoked.
+ * @ingroup Internal
+ *
+ * If the reaction has a violation, this invokes its handler, if any, in place of the reaction
+ * and schedules the reactions that the handler triggers.
+ * This is defined by the single-threaded and the threaded runtime.
+ *
+ * @param env Environment in which we are executing.
+ * @param reaction The reaction.
+ * @param worker_number The ID of the worker.
+ * @return true if a violation occurred and the reaction must not be invoked.
+ */
+bool _lf_handle_violations(environment_t* env, reaction_t* reaction, int worker_number);
+
+/**
+ * @brief The number of reactions of a chain that are reported with one call to _lf_chain_executed().
+ * @ingroup Internal
+ */
+#define LF_CHAIN_BATCH 16
+
+/**
+ * @brief Account for reactions that were executed one after the other, without going through
+ * the reaction queue.
+ * @ingroup Internal
+ *
+ * This is called once for up to LF_CHAIN_BATCH reactions of a chain in place of the hooks
+ * that surround the execution of a queued reaction.
+ * This is defined by the single-threaded and the threaded runtime.
+ *
+ * @param env Environment in which we are executing.
+ * @param worker_number The ID of the worker that executed the reactions.
+ * @param reactions The reactions, in the order in which they were executed.
+ * @param end_times The physical times at which the reactions ended.
+ * @param cpu_times The CPU times of the thread at which the reactions ended, or NULL if
+ * _lf_chain_needs_cpu_times() is false. An entry is negative if the CPU time is unavailable.
+ * @param length The number of reactions.
+ * @param start_time The physical time at which the first reaction started.
+ * @param start_cpu_time The CPU time of the thread at which the first reaction started.
+ */
+void _lf_chain_executed(environment_t* env, int worker_number, reaction_t** reactions, instant_t* end_times,
+                        int64_t* cpu_times, size_t length, instant_t start_time, int64_t start_cpu_time);
+
 /**
  * @brief Initialize the given timer.
  * @ingroup Internal
@@ -354,6 +421,35 @@ void _lf_invoke_reaction(environment_t* env, reaction_t* reaction, int worker);
  */
 void schedule_output_reactions(environment_t* env, reaction_t* reaction, int worker);
 
+/**
+ * @brief Trigger the reactions that the outputs of the specified reaction enable, except for one
+ * that may be executed immediately.
+ * @ingroup Internal
+ *
+ * That reaction is one that only the specified reaction enables, has the earliest deadline of
+ * those, and may be executed now according to _lf_may_execute_inline().
+ *
+ * @param env The environment in which we are executing.
+ * @param reaction The reaction that has just executed.
+ * @param worker The worker number.
+ * @return The reaction to execute immediately, or NULL if all were queued.
+ */
+reaction_t* _lf_trigger_output_reactions(environment_t* env, reaction_t* reaction, int worker);
+
+/**
+ * @brief Execute the specified reaction and, one after the other, the reactions that
+ * _lf_trigger_output_reactions() returns for it and its successors.
+ * @ingroup Internal
+ *
+ * The reactions do not go through the reaction queue. They are accounted for with
+ * _lf_chain_executed().
+ *
+ * @param env The environment in which we are executing.
+ * @param reaction The first reaction of the chain.
+ * @param worker The worker number.
+ */
+void _lf_execute_chain(environment_t* env, reaction_t* reaction, int worker);
+
 /**
  * @brief Process the command-line arguments.
  * @ingroup Internal
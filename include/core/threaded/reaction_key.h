@@ -0,0 +1,83 @@
+/**
+ * @file reaction_key.h
+ *
+ * @brief Stable reaction keys used by the master scheduler hooks.
+ *
+ * A reaction's key is an FNV-1a hash of the full name of its reactor combined
+ * with the reaction number. It identifies the same reaction across runs, which
+ * is what the master scheduler's configuration and logs refer to. The key is
+ * cached in reaction_t::stable_key so that hot paths compare an integer.
+ *
+ * lf_reaction_keys_init() computes the keys once, before worker threads start,
+ * for every reaction that it can reach from an environment. The runtime keeps
+ * no list of all reactions, so a reaction that is triggered only by an action
+ * or a network input gets its key when it is first used. That computation
+ * hashes the reactor's name and its parents' names in place. It allocates no
+ * memory, and threads that race on it store the same value atomically.
+ * @ingroup Internal
+ */
+
+#ifndef REACTION_KEY_H
+#define REACTION_KEY_H
+
+#include <stdint.h>
+
+#include "lf_types.h"
+#include "environment.h"
+
+/**
+ * @brief Compute the stable key of a reaction and cache it in the reaction.
+ * @ingroup Internal
+ *
+ * This hashes the reactor's full name and is meant to be called once per
+ * reaction. Use lf_reaction_stable_key() on hot paths.
+ * @param reaction The reaction.
+ * @return The key, which is never zero.
+ */
+uint64_t lf_reaction_compute_stable_key(reaction_t* reaction);
+
+/**
+ * @brief Precompute the stable keys of all reactions of the given environments.
+ * @ingroup Internal
+ *
+ * Starting from the startup, shutdown, reset, timer and watchdog reactions of
+ * each environment, this follows output triggers to every reachable reaction.
+ * Reactions reached only through actions or network inputs get their key on
+ * first use instead (see the file comment). Every reaction that gets a key is
+ * also added to the table behind lf_reaction_find_by_key(). Must be called
+ * after the trigger objects have been initialized and before worker threads
+ * start.
+ * @param envs The array of environments.
+ * @param num_envs The number of environments.
+ */
+void lf_reaction_keys_init(environment_t* envs, int num_envs);
+
+/**
+ * @brief Return the reaction with the given stable key.
+ * @ingroup Internal
+ *
+ * This is a lock-free hash lookup that schedulers use to find the target of a
+ * master scheduler override without scanning their queues. It knows the
+ * reactions keyed by lf_reaction_keys_init() and those keyed on first use
+ * after it, up to the table's capacity. A key that two reactions share finds
+ * neither, so callers fall back to a scan for it.
+ * @param key The stable key.
+ * @return The reaction, or NULL if it is unknown or shared.
+ */
+reaction_t* lf_reaction_find_by_key(uint64_t key);
+
+/**
+ * @brief Return the stable key of a reaction, or 0 if reaction is NULL.
+ * @ingroup Internal
+ *
+ * @param reaction The reaction.
+ */
+static inline uint64_t lf_reaction_stable_key(reaction_t* reaction) {
+  if (reaction == NULL) {
+    return 0;
+  }
+  uint64_t key = __atomic_load_n(&reaction->stable_key, __ATOMIC_RELAXED);
+  return (key != 0) ? key : lf_reaction_compute_stable_key(reaction);
+}
+
+#endif // REACTION_KEY_H
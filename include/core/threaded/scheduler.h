@@ -57,6 +57,36 @@ void lf_sched_free(lf_scheduler_t* scheduler);
  */
 reaction_t* lf_sched_get_ready_reaction(lf_scheduler_t* scheduler, int worker_number);
 
+/**
+ * @brief Return the number of reactions that are queued for the current tag
+ * but have not been handed to a worker yet.
+ * @ingroup Internal
+ *
+ * This is meant for runtime metrics and may be called from any thread without
+ * holding a lock. It takes no lock itself, so the value may be slightly stale.
+ *
+ * @param scheduler The scheduler.
+ * @return The ready depth, or 0 if the scheduler has no reactions.
+ */
+int lf_sched_ready_depth(lf_scheduler_t* scheduler);
+
+/**
+ * @brief Return whether a worker may execute 'reaction' right away, without
+ * putting it on the reaction queue.
+ * @ingroup Internal
+ *
+ * Workers ask this before executing a reaction inline, right after the reaction
+ * that triggered it. A scheduler that orders reactions by deadline returns false
+ * if a reaction with an earlier (inferred) deadline is waiting to be executed.
+ * This function assumes that the environment mutex is not locked.
+ *
+ * @param scheduler The scheduler.
+ * @param reaction The reaction that a worker would like to execute.
+ * @return true if executing the reaction now does not change the order that
+ * the scheduler would execute reactions in.
+ */
+bool lf_sched_may_execute_now(lf_scheduler_t* scheduler, reaction_t* reaction);
+
 /**
  * @brief Inform the scheduler that worker thread 'worker_number' is done
  * executing the 'done_reaction'.
@@ -0,0 +1,82 @@
+/**
+ * @file timer_group.h
+ * @brief Coalescing of periodic timers that fire at the same tags.
+ * @ingroup Internal
+ *
+ * A periodic timer that fired used to put a new event for itself on the event queue.
+ * With many timers sharing a few periods, most of the time between tags went into
+ * allocating, inserting and popping these events. Instead, periodic timers are now
+ * kept in groups of timers with the same period that fire at the same tags, that is,
+ * with the same period and the same offset modulo the period once they have started.
+ * Each group has one event on the event queue. When it is popped, all timers of the
+ * group fire and the group puts one event on the queue for the next period.
+ *
+ * Groups form when the timers are initialized, from timers with the same period and
+ * the same first tag. When a group is rescheduled and finds another group with the
+ * same period already scheduled for the same tag, for example one with a timer whose
+ * offset is a multiple of the period later, the two groups merge.
+ *
+ * Timers in modes are not grouped because the modes suspend and restore their events
+ * one timer at a time.
+ */
+
+#ifndef TIMER_GROUP_H
+#define TIMER_GROUP_H
+
+#include "lf_types.h"
+
+/**
+ * @brief A group of periodic timers that fire at the same tags.
+ * @ingroup Internal
+ */
+typedef struct timer_group_t {
+  /**
+   * @brief The trigger of the group's events on the event queue.
+   * Its timer_group field points back to the group and it has no reactions.
+   */
+  trigger_t trigger;
+
+  /** The timers of the group. */
+  trigger_t** timers;
+  size_t size;
+  size_t capacity;
+
+  /** The event of the group on the event queue, or NULL if there is none. */
+  event_t* event;
+
+  /** The next group of the environment. */
+  struct timer_group_t* next;
+} timer_group_t;
+
+/**
+ * @brief Add a periodic timer to a group of the environment and make sure that the group fires at the specified tag.
+ * @ingroup Internal
+ *
+ * This is for the initialization of the timer. If there is no group with the timer's
+ * period that fires at the tag, this creates one and puts its event on the event queue.
+ * @param env The environment.
+ * @param timer The timer.
+ * @param tag The first tag at which the timer fires after the start tag.
+ */
+void _lf_timer_group_add(environment_t* env, trigger_t* timer, tag_t tag);
+
+/**
+ * @brief Fire the timers of the group of an event popped from the event queue at the current tag.
+ * @ingroup Internal
+ *
+ * This triggers the reactions of the timers, marks the timers present, and puts the
+ * event back on the event queue one period later unless that is after the stop tag
+ * or the group merges with another one. Otherwise, the event is recycled.
+ * @param env The environment.
+ * @param event The event, whose trigger is that of a group.
+ */
+void _lf_timer_group_fire(environment_t* env, event_t* event);
+
+/**
+ * @brief Free the timer groups of the environment.
+ * @ingroup Internal
+ * @param env The environment.
+ */
+void _lf_timer_groups_free(environment_t* env);
+
+#endif // TIMER_GROUP_H
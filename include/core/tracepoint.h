@@ -95,6 +95,59 @@ typedef struct trace_record_t {
 void call_tracepoint(int event_type, void* reactor, tag_t tag, int worker, int src_id, int dst_id,
                      instant_t* physical_time, trigger_t* trigger, interval_t extra_delay);
 
+/**
+ * @brief How call_tracepoint() treats events of a type.
+ * @ingroup Internal
+ */
+typedef enum {
+  LF_TRACE_KEEP = 0, // Record every event.
+  LF_TRACE_DROP,     // Record no event.
+  LF_TRACE_CHECK     // Ask _lf_trace_filter_admits().
+} lf_trace_filter_t;
+
+/**
+ * @brief The lf_trace_filter_t of each event type, indexed by trace_event_t.
+ * @ingroup Internal
+ */
+extern uint8_t _lf_trace_event_filter[NUM_EVENT_TYPES];
+
+/**
+ * @brief Configure which events are traced from the environment.
+ * @ingroup Internal
+ *
+ * This must be called after lf_tracing_global_init() and before trace objects are registered.
+ * It reads three environment variables, all of which are optional:
+ *
+ * * LF_TRACE_EVENTS: Comma-separated event types to trace, e.g.
+ *   `reaction_starts,reaction_ends`, or to leave out when prefixed by `-`, e.g.
+ *   `-schedule_called`. Types are given by number or by their name in the trace
+ *   (see trace_event_names), ignoring case, spaces, `-` and `_`.
+ * * LF_TRACE_REACTORS: Comma-separated reactors whose reaction and schedule events
+ *   are traced, by the full names under which they are registered, e.g.
+ *   `Main.sensor`. A reactor includes the reactors it contains. A single reaction
+ *   is selected by appending its number, e.g. `Main.sensor.2`. Reactors that are
+ *   not registered are always traced.
+ * * LF_TRACE_SAMPLE: Trace 1 in N events, either of every type, e.g. `100`, or of
+ *   some types, e.g. `reaction_starts=100,schedule_called=10`. Each thread counts
+ *   separately. The end of a reaction, of a worker wait and of advancing time is
+ *   traced if and only if the corresponding start was.
+ *
+ * An event of a type that no variable affects costs one predictable branch in
+ * call_tracepoint(), and so does an event of a type left out by LF_TRACE_EVENTS.
+ */
+void lf_tracing_filter_init(void);
+
+/**
+ * @brief Return whether an event of a type marked LF_TRACE_CHECK is to be traced.
+ * @ingroup Internal
+ *
+ * This updates the sampling state of the calling thread.
+ * @param event_type The kind of tracepoint.
+ * @param reactor The reactor argument of call_tracepoint().
+ * @param dst_id The dst_id argument of call_tracepoint(), which is the reaction number for reaction events.
+ */
+bool _lf_trace_filter_admits(int event_type, void* reactor, int dst_id);
+
 /**
  * @brief Register a trace object.
  * @ingroup Internal
@@ -385,6 +438,7 @@ static inline void tracepoint_user_value(void* self, char* description, long lon
   (void)description;
   (void)value;
 }
+static inline void lf_tracing_filter_init(void) {}
 static inline void tracepoint_rti_to_federate(trace_event_t event_type, int fed_id, tag_t* tag) {
   (void)event_type;
   (void)fed_id;
@@ -0,0 +1,353 @@
+/**
+ * @file dary_heap.h
+ * @brief Defines a generic d-ary min-heap data type that stores priorities next to the elements.
+ * @ingroup Utilities
+ *
+ * Unlike pqueue_base.h, which keeps only pointers to the elements and calls back into the
+ * elements to get and compare their priorities, this heap keeps each element's priority next
+ * to the element pointer and compares priorities with a macro. Sifting an element up or down
+ * therefore reads only the heap's own array, and the comparisons are inlined. Each node has
+ * DARY_HEAP_ARITY children that are adjacent in the array, which makes the heap shallower than a
+ * binary heap and lets a step down the heap look at all children in one or two cache lines.
+ *
+ * Heaps are defined by defining DARY_HEAP_E, DARY_HEAP_P, DARY_HEAP_PRIORITY_BEFORE,
+ * DARY_HEAP_SET_POSITION, DARY_HEAP_ARITY, and DARY_HEAP, and including this file. A default heap
+ * type is defined here. This file undefines all of these macros at its end, so that a heap type can
+ * be declared in a header without leaking them to the files that include it. See reaction_heap.h
+ * for an example of a heap declaration.
+ * - DARY_HEAP_E must be the type of the elements, which must be a pointer type. NULL stands for no
+ *   element.
+ * - DARY_HEAP_P must be the type of the priorities.
+ * - DARY_HEAP_PRIORITY_BEFORE(a, b) must be nonzero if priority a ranks strictly before priority b.
+ *   The heap pops the element whose priority ranks first.
+ * - DARY_HEAP_SET_POSITION(e, pos) is called with the new position of an element whenever it moves.
+ *   Positions start at 1, so 0 can mean that an element is not in a heap.
+ * - DARY_HEAP_ARITY is the number of children of each node.
+ * - DARY_HEAP must be a function-like macro that prefixes tokens with the name of the heap. For
+ *   example, the name of the heap data type is given by evaluation of the macro DARY_HEAP(t) so
+ *   that it is "t" prefixed with the name of the heap. The function names associated with the
+ *   data type are similar.
+ *
+ * All functions are static inline so that a heap type can be declared in a header and used in
+ * several translation units.
+ */
+
+#ifndef DARY_HEAP_E
+#define DARY_HEAP_E void*
+#endif
+#ifndef DARY_HEAP_P
+#define DARY_HEAP_P unsigned long long
+#endif
+#ifndef DARY_HEAP_PRIORITY_BEFORE
+#define DARY_HEAP_PRIORITY_BEFORE(a, b) ((a) < (b))
+#endif
+#ifndef DARY_HEAP_SET_POSITION
+#define DARY_HEAP_SET_POSITION(e, pos) ((void)(e), (void)(pos))
+#endif
+#ifndef DARY_HEAP_ARITY
+#define DARY_HEAP_ARITY 4
+#endif
+#ifndef DARY_HEAP
+#define DARY_HEAP(token) dary_heap##_##token
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "vector.h"
+
+////////////////////////// Type definitions ///////////////////////////
+
+/**
+ * @brief A heap entry.
+ * @ingroup Utilities
+ */
+typedef struct DARY_HEAP(entry_t) {
+  DARY_HEAP_P priority;
+  DARY_HEAP_E element;
+} DARY_HEAP(entry_t);
+
+/**
+ * @brief A heap.
+ * @ingroup Utilities
+ */
+typedef struct DARY_HEAP(t) {
+  /** The entries in heap order at positions 1 to size. Position 0 is not used. */
+  DARY_HEAP(entry_t) * entries;
+  /** Number of elements in the heap. */
+  size_t size;
+  /** Number of elements the entries have room for. */
+  size_t capacity;
+} DARY_HEAP(t);
+
+/**
+ * @brief Callback to check whether an element is the one searched for.
+ * @ingroup Utilities
+ */
+typedef int (*DARY_HEAP(match_f))(DARY_HEAP_E element, void* arg);
+
+/////////////////////////// Private helpers ///////////////////////////
+
+static inline size_t DARY_HEAP(first_child)(size_t pos) { return DARY_HEAP_ARITY * (pos - 1) + 2; }
+
+static inline size_t DARY_HEAP(parent)(size_t pos) { return (pos - 2) / DARY_HEAP_ARITY + 1; }
+
+/** Put an entry at the specified position. */
+static inline void DARY_HEAP(place)(DARY_HEAP(t) * heap, size_t pos, DARY_HEAP(entry_t) entry) {
+  heap->entries[pos] = entry;
+  DARY_HEAP_SET_POSITION(entry.element, pos);
+}
+
+/** Move an entry that goes at or above the specified position up to where it belongs. */
+static inline void DARY_HEAP(sift_up)(DARY_HEAP(t) * heap, size_t pos, DARY_HEAP(entry_t) entry) {
+  while (pos > 1) {
+    size_t parent = DARY_HEAP(parent)(pos);
+    if (!DARY_HEAP_PRIORITY_BEFORE(entry.priority, heap->entries[parent].priority))
+      break;
+    DARY_HEAP(place)(heap, pos, heap->entries[parent]);
+    pos = parent;
+  }
+  DARY_HEAP(place)(heap, pos, entry);
+}
+
+/** Move an entry that goes at or below the specified position down to where it belongs. */
+static inline void DARY_HEAP(sift_down)(DARY_HEAP(t) * heap, size_t pos, DARY_HEAP(entry_t) entry) {
+  size_t child;
+  while ((child = DARY_HEAP(first_child)(pos)) <= heap->size) {
+    size_t last = child + DARY_HEAP_ARITY - 1;
+    if (last > heap->size)
+      last = heap->size;
+    size_t least = child;
+    for (child++; child <= last; child++) {
+      if (DARY_HEAP_PRIORITY_BEFORE(heap->entries[child].priority, heap->entries[least].priority))
+        least = child;
+    }
+    if (!DARY_HEAP_PRIORITY_BEFORE(heap->entries[least].priority, entry.priority))
+      break;
+    DARY_HEAP(place)(heap, pos, heap->entries[least]);
+    pos = least;
+  }
+  DARY_HEAP(place)(heap, pos, entry);
+}
+
+/** Put an entry at a position that is taken or vacated and restore the heap order around it. */
+static inline void DARY_HEAP(fill)(DARY_HEAP(t) * heap, size_t pos, DARY_HEAP(entry_t) entry) {
+  if (pos > 1 && DARY_HEAP_PRIORITY_BEFORE(entry.priority, heap->entries[DARY_HEAP(parent)(pos)].priority))
+    DARY_HEAP(sift_up)(heap, pos, entry);
+  else
+    DARY_HEAP(sift_down)(heap, pos, entry);
+}
+
+static inline DARY_HEAP_E DARY_HEAP(find_below)(DARY_HEAP(t) * heap, size_t pos, DARY_HEAP_P priority,
+                                               DARY_HEAP(match_f) match, void* arg) {
+  DARY_HEAP(entry_t)* entry = &heap->entries[pos];
+  // No element below one that ranks after the priority has the priority.
+  if (DARY_HEAP_PRIORITY_BEFORE(priority, entry->priority))
+    return NULL;
+  if (!DARY_HEAP_PRIORITY_BEFORE(entry->priority, priority) && (match == NULL || match(entry->element, arg)))
+    return entry->element;
+  size_t last = DARY_HEAP(first_child)(pos) + DARY_HEAP_ARITY - 1;
+  for (size_t child = DARY_HEAP(first_child)(pos); child <= last && child <= heap->size; child++) {
+    DARY_HEAP_E found = DARY_HEAP(find_below)(heap, child, priority, match, arg);
+    if (found != NULL)
+      return found;
+  }
+  return NULL;
+}
+
+//////////////////////// Function definitions /////////////////////////
+
+/**
+ * @brief Construct a new heap.
+ * @ingroup Utilities
+ *
+ * @param capacity The number of elements to allocate room for. The heap grows beyond it as needed.
+ */
+static inline DARY_HEAP(t) DARY_HEAP(new)(size_t capacity) {
+  if (capacity == 0)
+    capacity = 1;
+  DARY_HEAP(entry_t)* entries = (DARY_HEAP(entry_t)*)malloc((capacity + 1) * sizeof(DARY_HEAP(entry_t)));
+  assert(entries);
+  return (DARY_HEAP(t)){.entries = entries, .size = 0, .capacity = capacity};
+}
+
+/**
+ * @brief Free the memory held by the given heap, but not its elements.
+ * @ingroup Utilities
+ */
+static inline void DARY_HEAP(free)(DARY_HEAP(t) * heap) {
+  free(heap->entries);
+  heap->entries = NULL;
+  heap->size = heap->capacity = 0;
+}
+
+/**
+ * @brief Return the number of elements in the heap.
+ * @ingroup Utilities
+ */
+static inline size_t DARY_HEAP(size)(DARY_HEAP(t) * heap) { return heap->size; }
+
+/**
+ * @brief Return the element at the specified position, from 1 to the size of the heap.
+ * @ingroup Utilities
+ */
+static inline DARY_HEAP_E DARY_HEAP(at)(DARY_HEAP(t) * heap, size_t pos) {
+  assert(pos >= 1 && pos <= heap->size);
+  return heap->entries[pos].element;
+}
+
+/**
+ * @brief Insert an element with the given priority.
+ * @ingroup Utilities
+ * @return 0 on success, 1 if memory allocation fails.
+ */
+static inline int DARY_HEAP(insert)(DARY_HEAP(t) * heap, DARY_HEAP_E element, DARY_HEAP_P priority) {
+  if (heap->size == heap->capacity) {
+    size_t capacity = 2 * heap->capacity;
+    DARY_HEAP(entry_t)* entries =
+        (DARY_HEAP(entry_t)*)realloc(heap->entries, (capacity + 1) * sizeof(DARY_HEAP(entry_t)));
+    if (entries == NULL)
+      return 1;
+    heap->entries = entries;
+    heap->capacity = capacity;
+  }
+  DARY_HEAP(sift_up)(heap, ++heap->size, (DARY_HEAP(entry_t)){.priority = priority, .element = element});
+  return 0;
+}
+
+/**
+ * @brief Return the element whose priority ranks first without removing it, or NULL if the heap is empty.
+ * @ingroup Utilities
+ */
+static inline DARY_HEAP_E DARY_HEAP(peek)(DARY_HEAP(t) * heap) {
+  return heap->size == 0 ? NULL : heap->entries[1].element;
+}
+
+/**
+ * @brief Remove and return the element whose priority ranks first, or return NULL if the heap is empty.
+ * @ingroup Utilities
+ */
+static inline DARY_HEAP_E DARY_HEAP(pop)(DARY_HEAP(t) * heap) {
+  if (heap->size == 0)
+    return NULL;
+  DARY_HEAP_E head = heap->entries[1].element;
+  DARY_HEAP(entry_t) last = heap->entries[heap->size--];
+  if (heap->size > 0)
+    DARY_HEAP(sift_down)(heap, 1, last);
+  return head;
+}
+
+/**
+ * @brief Remove the element at the specified position.
+ * @ingroup Utilities
+ */
+static inline void DARY_HEAP(remove)(DARY_HEAP(t) * heap, size_t pos) {
+  assert(pos >= 1 && pos <= heap->size);
+  DARY_HEAP(entry_t) last = heap->entries[heap->size--];
+  if (pos <= heap->size)
+    DARY_HEAP(fill)(heap, pos, last);
+}
+
+/**
+ * @brief Put an element with the given priority in place of the element at the specified position.
+ * @ingroup Utilities
+ *
+ * This is cheaper than a removal followed by an insertion: the new element is moved up or
+ * down only as far as its priority requires.
+ */
+static inline void DARY_HEAP(replace)(DARY_HEAP(t) * heap, size_t pos, DARY_HEAP_E element, DARY_HEAP_P priority) {
+  assert(pos >= 1 && pos <= heap->size);
+  DARY_HEAP(fill)(heap, pos, (DARY_HEAP(entry_t)){.priority = priority, .element = element});
+}
+
+/**
+ * @brief Remove all elements whose priority is equal to that of the element that ranks first.
+ * @ingroup Utilities
+ *
+ * This costs about as much as popping them one at a time when there are few of them, and at
+ * most a linear pass over the heap when there are many.
+ * @param popped The vector to push the elements onto, in no particular order.
+ * @return The number of elements removed.
+ */
+static inline size_t DARY_HEAP(pop_all_same_priority)(DARY_HEAP(t) * heap, vector_t* popped) {
+  if (heap->size == 0)
+    return 0;
+  DARY_HEAP_P top = heap->entries[1].priority;
+
+  // No element ranks before its parent, so the elements with the top priority form a subtree
+  // at the root. Count them level by level, using the vector as the queue of positions to visit.
+  size_t first = vector_size(popped);
+  vector_push(popped, (void*)(uintptr_t)1);
+  for (size_t i = first; i < vector_size(popped); i++) {
+    size_t pos = (size_t)(uintptr_t)*vector_at(popped, i);
+    size_t last = DARY_HEAP(first_child)(pos) + DARY_HEAP_ARITY - 1;
+    for (size_t child = DARY_HEAP(first_child)(pos); child <= last && child <= heap->size; child++) {
+      if (!DARY_HEAP_PRIORITY_BEFORE(top, heap->entries[child].priority))
+        vector_push(popped, (void*)(uintptr_t)child);
+    }
+  }
+  size_t count = vector_size(popped) - first;
+
+  // Popping them one by one costs about count * DARY_HEAP_ARITY * log_DARY_HEAP_ARITY(size) comparisons and
+  // rebuilding the heap from the rest about 2 * size.
+  size_t depth = 0;
+  for (size_t n = heap->size; n > 1; n /= DARY_HEAP_ARITY) {
+    depth++;
+  }
+  if (count * DARY_HEAP_ARITY * depth <= 2 * heap->size) {
+    for (size_t i = first; i < first + count; i++) {
+      *vector_at(popped, i) = (void*)DARY_HEAP(pop)(heap);
+    }
+  } else {
+    for (size_t i = first; i < first + count; i++) {
+      size_t pos = (size_t)(uintptr_t)*vector_at(popped, i);
+      *vector_at(popped, i) = (void*)heap->entries[pos].element;
+      heap->entries[pos].element = NULL;
+    }
+    size_t size = 0;
+    for (size_t pos = 1; pos <= heap->size; pos++) {
+      if (heap->entries[pos].element != NULL)
+        heap->entries[++size] = heap->entries[pos];
+    }
+    heap->size = size;
+    // Sift down from the last position rather than the last parent so that the leaves get their positions too.
+    for (size_t pos = size; pos >= 1; pos--) {
+      DARY_HEAP(sift_down)(heap, pos, heap->entries[pos]);
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Return an element with the given priority for which match returns nonzero, or NULL if there is none.
+ * @ingroup Utilities
+ * @param match The callback that checks an element, or NULL to accept any element with the priority.
+ * @param arg The second argument of match.
+ */
+static inline DARY_HEAP_E DARY_HEAP(find_same_priority)(DARY_HEAP(t) * heap, DARY_HEAP_P priority,
+                                                       DARY_HEAP(match_f) match, void* arg) {
+  if (heap->size == 0)
+    return NULL;
+  return DARY_HEAP(find_below)(heap, 1, priority, match, arg);
+}
+
+/**
+ * @brief Return nonzero if no element ranks before its parent.
+ * @ingroup Utilities
+ */
+static inline int DARY_HEAP(is_valid)(DARY_HEAP(t) * heap) {
+  for (size_t pos = 2; pos <= heap->size; pos++) {
+    if (DARY_HEAP_PRIORITY_BEFORE(heap->entries[pos].priority, heap->entries[DARY_HEAP(parent)(pos)].priority))
+      return 0;
+  }
+  return 1;
+}
+
+#undef DARY_HEAP_E
+#undef DARY_HEAP_P
+#undef DARY_HEAP_PRIORITY_BEFORE
+#undef DARY_HEAP_SET_POSITION
+#undef DARY_HEAP_ARITY
+#undef DARY_HEAP
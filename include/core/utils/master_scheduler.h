@@ -17,6 +17,7 @@
  *  - LF_MS_OS_LAG_NS=...    : lag threshold for OS policy decisions
  *  - LF_MS_OS_READY_Q_LEN=... : ready queue threshold for OS policy decisions
  *  - LF_MS_OS_NICE_DELTA=... : nice delta to apply for low-criticality workers
+ *  - LF_MS_METRICS=1|true   : publish the live metrics page (master_scheduler_metrics.h)
  */
 
 #include <stdbool.h>
@@ -125,6 +126,32 @@ bool ms_should_skip_reaction(
     long long logical_time_ns
 );
 
+// Chain execution: whether a worker may execute the specified reaction inline,
+// right after the reaction that triggered it, without it becoming ready. This
+// is false only for reactions that ms_should_skip_reaction() may shed, which
+// must go through the reaction queue.
+bool ms_may_execute_inline(int env_id, uint64_t reaction_index);
+
+// Chain execution: whether ms_on_chain_executed() needs the CPU time of the
+// worker thread at the end of each reaction (see ms_stats_thread_cpu_ns()).
+bool ms_chain_needs_cpu_times(void);
+
+// Chain execution: notify that a worker executed 'count' reactions inline, one
+// after the other, starting at 'start_time_ns'. Reaction i ended at
+// end_times_ns[i], when the thread had used cpu_end_times_ns[i] of CPU time.
+// 'cpu_end_times_ns' may be NULL, and the CPU times are negative where they
+// are unavailable. This replaces the start and end hooks of those reactions.
+void ms_on_chain_executed(
+    int env_id,
+    int worker_id,
+    const uint64_t* reaction_indexes,
+    const long long* end_times_ns,
+    const long long* cpu_end_times_ns,
+    int count,
+    long long start_time_ns,
+    long long start_cpu_ns
+);
+
 // Phase 4: Report metrics for OS-level policy decisions.
 void ms_on_metrics(
     int env_id,
@@ -135,8 +162,15 @@ void ms_on_metrics(
     int64_t ptdv_ns
 );
 
-// Phase 4: Retrieve a pending OS policy for the given worker, if any.
-bool ms_take_os_policy(int worker_id, ms_os_policy_t* out_policy);
+// Live metrics: the environment advanced to a new tag.
+void ms_on_tag_advance(int env_id, long long logical_time_ns, uint32_t microstep);
+
+// Live metrics: a reaction missed its deadline.
+void ms_on_deadline_miss(int env_id, int worker_id, uint64_t reaction_index);
+
+// Phase 4: Retrieve a pending OS policy for the given worker of an environment, if any.
+// Called from the worker's own thread, like ms_on_metrics().
+bool ms_take_os_policy(int env_id, int worker_id, ms_os_policy_t* out_policy);
 
 // Phase 4: Log OS policy application results.
 void ms_log_os_policy_apply(int worker_id, const ms_os_policy_t* policy, int nice_applied);
@@ -0,0 +1,95 @@
+#ifndef MASTER_SCHEDULER_BINLOG_H
+#define MASTER_SCHEDULER_BINLOG_H
+
+/**
+ * Binary event log for the master scheduler.
+ *
+ * Hot-path events (ready, pick, start/end, degrade, report) are written as
+ * fixed-size records into a per-thread single-producer/single-consumer ring.
+ * A background drainer thread copies the rings to a file. Producers never
+ * block and never format text: when a ring is full the record is dropped and
+ * counted, and the count is written as an MS_BIN_EV_DROPPED record.
+ *
+ * File layout: one ms_bin_file_header_t followed by ms_bin_record_t records.
+ * Records from different threads are not globally ordered; sort by mono_ns.
+ * util/ms_log/ms_log_decode turns a file back into the text log format.
+ *
+ * Environment variables (read by ms_init()):
+ *  - LF_MS_LOG_BINARY=1|true      : enable the binary log
+ *  - LF_MS_LOG_BINARY_PATH=/path  : output file (default: <LF_MS_LOG>.bin)
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MS_BIN_MAGIC "LFMSBIN1"
+#define MS_BIN_VERSION 1
+
+typedef enum {
+  MS_BIN_EV_READY = 1,              // key, a=logical, b=deadline, i0=is_input, i1=updated
+  MS_BIN_EV_READY_DROP = 2,         // key, a=logical, b=deadline, i0=is_input
+  MS_BIN_EV_PICK_NEXT = 3,          // key=candidate, a=logical, b=deadline, c=ready_time, i0=hc_first, i1=ready_count
+  MS_BIN_EV_PICK_OBSERVE_ONLY = 4,  // a=logical
+  MS_BIN_EV_FALLBACK_NO_CAND = 5,   // a=logical, i1=ready_count
+  MS_BIN_EV_RUNTIME_SELECTED = 6,   // key, a=physical, i0=found
+  MS_BIN_EV_SELECTED_MISSING = 7,   // key, a=physical
+  MS_BIN_EV_MISMATCH = 8,           // key=runtime, a=picked
+  MS_BIN_EV_MISSING_ON_END = 9,     // key
+  MS_BIN_EV_FALLBACK_NO_META = 10,  // key, a=logical, i1=ready_count
+  MS_BIN_EV_DEGRADE_SKIP = 11,      // key, a=logical, i1=ready_count
+  MS_BIN_EV_DEGRADE_DBG = 12,       // key, i0=crit, i1=degradable, i2=pressure, a=has_hc_ready, b=ready_count
+  MS_BIN_EV_REPORT = 13,            // i0=reactor_id, i1=reaction_id, i2=ready_q, a=logical, b=physical, c=lag, key=miss
+  MS_BIN_EV_DROPPED = 14,           // worker_id=-1, key=records dropped since the previous DROPPED record
+  MS_BIN_EV_CHAIN = 15              // key=first reaction, i0=length, a=start physical, b=end physical
+} ms_bin_event_t;
+
+typedef struct {
+  char magic[8];          // MS_BIN_MAGIC, not NUL-terminated.
+  uint32_t version;       // MS_BIN_VERSION
+  uint32_t record_size;   // sizeof(ms_bin_record_t)
+  int64_t pid;
+} ms_bin_file_header_t;
+
+typedef struct {
+  int64_t mono_ns;        // CLOCK_MONOTONIC timestamp.
+  uint16_t event;         // ms_bin_event_t
+  uint8_t level;          // ms_log_level_t
+  uint8_t reserved;
+  int32_t env_id;
+  int32_t worker_id;
+  int32_t i0;
+  int32_t i1;
+  int32_t i2;
+  uint64_t key;
+  int64_t a;
+  int64_t b;
+  int64_t c;
+} ms_bin_record_t;
+
+/**
+ * Open the binary log and start the drainer thread.
+ * Returns false if the file cannot be opened; the log then stays disabled.
+ */
+bool ms_binlog_open(const char* path);
+
+/** True between a successful ms_binlog_open() and ms_binlog_close(). */
+bool ms_binlog_is_open(void);
+
+/**
+ * Append a record to the calling thread's ring. Never blocks; returns false
+ * if the log is closed or the ring is full (the record is then counted as dropped).
+ */
+bool ms_binlog_write(const ms_bin_record_t* record);
+
+/** Stop the drainer, flush every ring and close the file. */
+void ms_binlog_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MASTER_SCHEDULER_BINLOG_H
@@ -0,0 +1,154 @@
+#ifndef MASTER_SCHEDULER_METRICS_H
+#define MASTER_SCHEDULER_METRICS_H
+
+/**
+ * Live metrics page for the master scheduler.
+ *
+ * The runtime publishes its current state into a file-backed shared memory
+ * page that other processes can map read-only and sample at any rate without
+ * stopping or slowing the program. The page holds:
+ *  - per-worker counters (reactions run, busy time, reaction in progress),
+ *  - per-environment current tag, lag, delay variation, ready-queue length and
+ *    deadline misses,
+ *  - per-reaction invocation counts and deadline misses.
+ *
+ * Worker and environment records are protected by a seqlock: the writer makes
+ * `seq` odd, updates the record and makes it even again. Readers copy a record
+ * and retry if `seq` was odd or changed meanwhile (see ms_metrics_read_worker()
+ * and ms_metrics_read_env()). Writers claim a record by making `seq` odd with a
+ * compare-and-swap, so a record never has two writers at once. Worker ids are
+ * per environment, so workers of different enclaves share a worker record; a
+ * writer that finds it busy waits, because its counters must not lose updates.
+ * Environment records are written by any worker of the environment; a writer
+ * that finds the record busy drops its update rather than wait.
+ * Reaction records hold monotonic counters that are updated with atomic adds.
+ *
+ * util/ms_metrics/ms_metrics_top reads the page.
+ *
+ * Environment variables (read by ms_init()):
+ *  - LF_MS_METRICS=1|true   : publish the metrics page
+ *  - LF_MS_METRICS_PATH=... : page file (default: /dev/shm/lf_ms_metrics.<pid>)
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MS_METRICS_MAGIC "LFMSMET1"
+#define MS_METRICS_VERSION 1
+
+#define MS_METRICS_MAX_WORKERS 256
+#define MS_METRICS_MAX_ENVS 32
+// Must be a power of two.
+#define MS_METRICS_MAX_REACTIONS 4096
+
+typedef struct {
+  char magic[8];            // MS_METRICS_MAGIC, not NUL-terminated.
+  uint32_t version;         // MS_METRICS_VERSION
+  uint32_t size;            // sizeof(ms_metrics_page_t)
+  int64_t pid;
+  int64_t start_mono_ns;    // CLOCK_MONOTONIC time at which the page was created.
+  uint32_t running;         // 1 while the program runs, 0 after ms_shutdown().
+  uint32_t reserved;
+  uint64_t reactions_dropped; // Reactions not tracked because the table was full.
+} ms_metrics_header_t;
+
+typedef struct {
+  uint32_t seq;
+  uint32_t active;          // 1 once the worker has run a reaction.
+  int32_t env_id;
+  int32_t reserved;
+  uint64_t reactions_run;
+  uint64_t current_reaction; // Key of the reaction in progress, 0 when idle.
+  int64_t busy_ns;          // Total wall time spent in reactions.
+  int64_t last_start_mono_ns;
+  int64_t last_update_mono_ns;
+} __attribute__((aligned(64))) ms_metrics_worker_t;
+
+typedef struct {
+  uint32_t seq;
+  uint32_t active;          // 1 once the environment has reported anything.
+  int64_t tag_time_ns;      // Current logical time.
+  uint32_t tag_microstep;
+  int32_t ready_q_len;      // -1 if unknown.
+  int64_t lag_ns;           // Physical minus logical time at the last report.
+  uint64_t deadline_misses;
+  int64_t last_update_mono_ns;
+  int64_t ptdv_ns;          // Physical-time delay variation at the last report.
+} __attribute__((aligned(64))) ms_metrics_env_t;
+
+typedef struct {
+  uint64_t key;             // Stable reaction key; 0 marks a free slot.
+  int32_t env_id;
+  int32_t reserved;
+  uint64_t invocations;
+  uint64_t deadline_misses;
+} ms_metrics_reaction_t;
+
+typedef struct {
+  ms_metrics_header_t header;
+  ms_metrics_worker_t workers[MS_METRICS_MAX_WORKERS];
+  ms_metrics_env_t envs[MS_METRICS_MAX_ENVS];
+  ms_metrics_reaction_t reactions[MS_METRICS_MAX_REACTIONS];
+} ms_metrics_page_t;
+
+/**
+ * Create the page file, map it and make it the target of the update functions.
+ * Returns false if that fails; updates are then no-ops.
+ */
+bool ms_metrics_open(const char* path);
+
+/** Mark the page as no longer running, unmap it and remove the file. */
+void ms_metrics_close(void);
+
+/** True between a successful ms_metrics_open() and ms_metrics_close(). */
+bool ms_metrics_is_open(void);
+
+// Writer side, called from the master scheduler hooks.
+void ms_metrics_reaction_start(int env_id, int worker_id, uint64_t reaction_key, int64_t mono_ns);
+void ms_metrics_reaction_end(int env_id, int worker_id, uint64_t reaction_key, int64_t mono_ns);
+void ms_metrics_chain(int env_id, int worker_id, const uint64_t* reaction_keys, int count, int64_t busy_ns,
+                      int64_t mono_ns);
+void ms_metrics_env_tag(int env_id, int64_t tag_time_ns, uint32_t microstep, int64_t mono_ns);
+void ms_metrics_env_load(int env_id, int64_t lag_ns, int ready_q_len, int64_t ptdv_ns, int64_t mono_ns);
+void ms_metrics_deadline_miss(int env_id, uint64_t reaction_key);
+
+// Reader side. These are inline so that tools can use them on a read-only
+// mapping without linking the runtime. Each copies one consistent snapshot of
+// a record and returns false if it was rewritten too often to get one; callers
+// can simply retry later.
+#define MS_METRICS_READ_RETRIES 64
+
+static inline bool ms_metrics_seq_read(const uint32_t* seq, const void* record, void* out, size_t size) {
+  for (int attempt = 0; attempt < MS_METRICS_READ_RETRIES; attempt++) {
+    uint32_t before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+    if (before & 1u) continue;
+    memcpy(out, record, size);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(seq, __ATOMIC_RELAXED) == before) return true;
+  }
+  return false;
+}
+
+static inline bool ms_metrics_read_worker(const ms_metrics_page_t* page, int worker_id, ms_metrics_worker_t* out) {
+  if (worker_id < 0 || worker_id >= MS_METRICS_MAX_WORKERS) return false;
+  const ms_metrics_worker_t* w = &page->workers[worker_id];
+  return ms_metrics_seq_read(&w->seq, w, out, sizeof(*out));
+}
+
+static inline bool ms_metrics_read_env(const ms_metrics_page_t* page, int env_id, ms_metrics_env_t* out) {
+  if (env_id < 0 || env_id >= MS_METRICS_MAX_ENVS) return false;
+  const ms_metrics_env_t* e = &page->envs[env_id];
+  return ms_metrics_seq_read(&e->seq, e, out, sizeof(*out));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MASTER_SCHEDULER_METRICS_H
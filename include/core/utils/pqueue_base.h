@@ -239,6 +239,19 @@ void* pqueue_find_equal_same_priority(pqueue_t* q, void* e);
  */
 int pqueue_remove(pqueue_t* q, void* e);
 
+/**
+ * @brief Put an item in place of another one that is in the queue.
+ * @ingroup Internal
+ *
+ * This is cheaper than a remove followed by an insert: the replacement takes
+ * over the position of the old item and is moved up or down only as far as
+ * its priority requires.
+ * @param q The queue
+ * @param e The entry to take out of the queue
+ * @param replacement The entry to put in its place
+ */
+void pqueue_replace(pqueue_t* q, void* e, void* replacement);
+
 /**
  * @brief Access highest-ranking item without removing it.
  * @ingroup Internal
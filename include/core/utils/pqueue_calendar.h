@@ -0,0 +1,179 @@
+/**
+ * @file pqueue_calendar.h
+ * @brief Calendar queue of elements sorted by tag.
+ * @ingroup Internal
+ *
+ * A calendar queue (R. Brown, "Calendar Queues: A Fast O(1) Priority Queue Implementation
+ * for the Simulation Event Set Problem", CACM 31(10), 1988) divides time into "days" of a
+ * fixed width and hashes each element onto one of a power-of-two number of buckets by the
+ * day its tag falls on. Dequeuing scans the buckets in turn, like pages of a calendar,
+ * taking an element only from the bucket whose current day it falls on. When the elements
+ * are spread evenly over time, as the events of periodic timers are, the buckets stay short
+ * and insertion and removal take constant time on average, where a heap takes logarithmic
+ * time. The number of buckets follows the size of the queue, and the width of a day is
+ * re-estimated from the spacing of the earliest elements on each resize.
+ *
+ * Each bucket is an array sorted from largest to least tag, so the least element of a
+ * bucket is the last one. As with the heap, elements with equal tags leave the queue in
+ * no particular order.
+ *
+ * This is the backend of pqueue_tag.h when LF_CALENDAR_QUEUE is defined. Unlike the heap,
+ * it always orders elements by tag; the pos field of the elements is not used.
+ */
+
+#ifndef PQUEUE_CALENDAR_H
+#define PQUEUE_CALENDAR_H
+
+#include "pqueue_tag.h"
+
+/**
+ * @brief Least number of buckets of a calendar queue.
+ * @ingroup Internal
+ */
+#define PQUEUE_CALENDAR_MIN_BUCKETS 16
+
+/**
+ * @brief Width of a day of a calendar queue until it is estimated from the elements.
+ * @ingroup Internal
+ */
+#define PQUEUE_CALENDAR_INITIAL_WIDTH MSEC(1)
+
+/**
+ * @brief Number of earliest elements whose spacing determines the width of a day on a resize.
+ * @ingroup Internal
+ */
+#define PQUEUE_CALENDAR_SAMPLES 25
+
+/**
+ * @brief A bucket of a calendar queue.
+ * @ingroup Internal
+ */
+typedef struct pqueue_calendar_bucket_t {
+  /** The elements, from largest to least tag. */
+  pqueue_tag_element_t** elements;
+  size_t length;
+  size_t capacity;
+} pqueue_calendar_bucket_t;
+
+/**
+ * @brief A calendar queue.
+ * @ingroup Internal
+ */
+typedef struct pqueue_calendar_t {
+  /** Number of elements in the queue. */
+  size_t size;
+  /** Number of buckets, a power of two. */
+  size_t bucket_count;
+  pqueue_calendar_bucket_t* buckets;
+  /** Width of a day in nanoseconds. */
+  uint64_t width;
+  /** Bucket to look in first when dequeuing. */
+  size_t current;
+  /** Start of the day of the current bucket. No element in the queue is earlier. */
+  uint64_t current_start;
+  /** Whether a resize is in progress, during which the queue must not be resized again. */
+  int resizing;
+  /** Callback to check whether two elements with the same tag are equivalent. */
+  pqueue_eq_elem_f eqelem;
+  /** Callback to print an element. */
+  pqueue_print_entry_f prt;
+} pqueue_calendar_t;
+
+/**
+ * @brief Create a calendar queue.
+ * @ingroup Internal
+ * @param initial_size The expected number of elements, which determines the initial number of buckets.
+ * @param eqelem The callback function to check equivalence of elements.
+ * @param prt The callback function to print elements.
+ * @return A dynamically allocated queue or NULL if memory allocation fails.
+ */
+pqueue_calendar_t* pqueue_calendar_init(size_t initial_size, pqueue_eq_elem_f eqelem, pqueue_print_entry_f prt);
+
+/**
+ * @brief Free all memory used by the queue including elements that are marked dynamic.
+ * @ingroup Internal
+ * @param q The queue.
+ */
+void pqueue_calendar_free(pqueue_calendar_t* q);
+
+/**
+ * @brief Return the number of elements in the queue.
+ * @ingroup Internal
+ * @param q The queue.
+ */
+size_t pqueue_calendar_size(pqueue_calendar_t* q);
+
+/**
+ * @brief Insert an element into the queue.
+ * @ingroup Internal
+ * @param q The queue.
+ * @param e The element to insert.
+ * @return 0 on success, 1 if memory allocation fails.
+ */
+int pqueue_calendar_insert(pqueue_calendar_t* q, pqueue_tag_element_t* e);
+
+/**
+ * @brief Return the element with the least tag without removing it, or NULL if the queue is empty.
+ * @ingroup Internal
+ * @param q The queue.
+ */
+pqueue_tag_element_t* pqueue_calendar_peek(pqueue_calendar_t* q);
+
+/**
+ * @brief Remove and return the element with the least tag, or return NULL if the queue is empty.
+ * @ingroup Internal
+ * @param q The queue.
+ */
+pqueue_tag_element_t* pqueue_calendar_pop(pqueue_calendar_t* q);
+
+/**
+ * @brief If the least tag in the queue is the specified tag, remove all elements with that tag.
+ * @ingroup Internal
+ * @param q The queue.
+ * @param t The tag.
+ * @param popped The vector to push the elements onto.
+ * @return The number of elements removed.
+ */
+size_t pqueue_calendar_pop_all_with_tag(pqueue_calendar_t* q, tag_t t, vector_t* popped);
+
+/**
+ * @brief Remove an element from the queue. Do nothing if it is not in the queue.
+ * @ingroup Internal
+ * @param q The queue.
+ * @param e The element to remove.
+ */
+void pqueue_calendar_remove(pqueue_calendar_t* q, pqueue_tag_element_t* e);
+
+/**
+ * @brief Return an element with the specified tag or NULL if there is none.
+ * @ingroup Internal
+ * @param q The queue.
+ * @param t The tag.
+ */
+pqueue_tag_element_t* pqueue_calendar_find_same_tag(pqueue_calendar_t* q, tag_t t);
+
+/**
+ * @brief Return an element with the same tag as the supplied element that matches it
+ * (`eqelem` returns non-zero), or NULL if there is none.
+ * @ingroup Internal
+ * @param q The queue.
+ * @param e The element.
+ */
+pqueue_tag_element_t* pqueue_calendar_find_equal_same_tag(pqueue_calendar_t* q, pqueue_tag_element_t* e);
+
+/**
+ * @brief Copy pointers to all elements of the queue, in no particular order, into the specified array.
+ * @ingroup Internal
+ * @param q The queue.
+ * @param elements An array with room for pqueue_calendar_size() elements.
+ */
+void pqueue_calendar_elements(pqueue_calendar_t* q, pqueue_tag_element_t** elements);
+
+/**
+ * @brief Dump the queue and its internal structure.
+ * @ingroup Internal
+ * @param q The queue.
+ */
+void pqueue_calendar_dump(pqueue_calendar_t* q);
+
+#endif // PQUEUE_CALENDAR_H
@@ -11,6 +11,14 @@
  * pqueue_tag_element_t or a derived struct, as explained below. What you put onto the
  * queue is a pointer to a tagged_element_t struct. That pointer, when cast to pqueue_pri_t,
  * an alias for long long, also serves as the "priority" for the queue.
+ *
+ * By default, the queue is a 4-ary heap that keeps the tag of each element next to the
+ * pointer to the element (see impl/dary_heap.h), so that comparing tags never follows the
+ * pointers. If LF_CALENDAR_QUEUE is defined, it is a calendar queue instead (see
+ * pqueue_calendar.h), which inserts and pops in constant average time when the tags are
+ * spread evenly over time, as those of periodic timers are. Both always order elements by
+ * tag, so the cmppri argument of pqueue_tag_init_customize() is ignored. The tag of an
+ * element must therefore not change while it is in the queue.
  */
 
 #ifndef PQUEUE_TAG_H
@@ -18,6 +26,7 @@
 
 #include "pqueue_base.h"
 #include "tag.h"
+#include "vector.h"
 
 /**
  * @brief The type for an element in a priority queue that is sorted by tag.
@@ -86,7 +95,11 @@ typedef struct {
  * @brief Type of a priority queue sorted by tags.
  * @ingroup Internal
  */
-typedef pqueue_t pqueue_tag_t;
+#if defined(LF_CALENDAR_QUEUE)
+typedef struct pqueue_calendar_t pqueue_tag_t;
+#else
+typedef struct pqueue_tag_heap_t pqueue_tag_t;
+#endif
 
 /**
  * @brief Callback comparison function for the tag-based priority queue.
@@ -116,7 +129,7 @@ pqueue_tag_t* pqueue_tag_init(size_t initial_size);
  * The caller should call @ref pqueue_tag_free() when finished with the queue.
  *
  * @param initial_size The initial size of the priority queue.
- * @param cmppri The callback function to compare priorities.
+ * @param cmppri Ignored. The queue always orders elements by tag.
  * @param eqelem The callback function to check equivalence of payloads.
  * @param prt The callback function to print elements.
  *
@@ -227,6 +240,19 @@ pqueue_tag_element_t* pqueue_tag_pop(pqueue_tag_t* q);
  */
 tag_t pqueue_tag_pop_tag(pqueue_tag_t* q);
 
+/**
+ * @brief If the least tag in the queue is the specified tag, pop all elements with that tag.
+ * @ingroup Internal
+ *
+ * This takes one pass over the elements with the tag rather than a pop for each of them.
+ * As with pqueue_tag_pop, freeing dynamically allocated elements is up to the caller.
+ * @param q The queue.
+ * @param t The tag.
+ * @param popped The vector to push the elements onto, in no particular order.
+ * @return The number of elements popped.
+ */
+size_t pqueue_tag_pop_all_with_tag(pqueue_tag_t* q, tag_t t, vector_t* popped);
+
 /**
  * @brief Remove an item from the queue.
  * @ingroup Internal
@@ -244,6 +270,14 @@ void pqueue_tag_remove(pqueue_tag_t* q, pqueue_tag_element_t* e);
  */
 void pqueue_tag_remove_up_to(pqueue_tag_t* q, tag_t t);
 
+/**
+ * @brief Copy pointers to all elements of the queue, in no particular order, into the specified array.
+ * @ingroup Internal
+ * @param q The queue.
+ * @param elements An array with room for pqueue_tag_size() elements.
+ */
+void pqueue_tag_elements(pqueue_tag_t* q, pqueue_tag_element_t** elements);
+
 /**
  * Dump the queue and it's internal structure.
  * @param q the queue
@@ -0,0 +1,33 @@
+/**
+ * @file reaction_heap.h
+ * @brief Defines the heap type of reaction queues, which are sorted by reaction index.
+ * @ingroup Internal
+ *
+ * To create a reaction queue:
+ * ```c
+ * reaction_heap_t q = reaction_heap_new(INITIAL_REACT_QUEUE_SIZE);
+ * ```
+ * To put a reaction on it:
+ * ```c
+ * reaction_heap_insert(&q, reaction, reaction->index);
+ * ```
+ * The reaction with the least index comes first. Because the index holds the deadline in its
+ * most significant bits and the level in its least significant bits, this orders reactions by
+ * deadline and then by level. The queue keeps the pos field of each reaction up to date.
+ *
+ * See @ref dary_heap.h for the functions of the heap and how to declare other heap types.
+ */
+
+#ifndef REACTION_HEAP_H
+#define REACTION_HEAP_H
+
+#include "lf_types.h"
+
+#define DARY_HEAP(token) reaction_heap##_##token
+#define DARY_HEAP_E reaction_t*
+#define DARY_HEAP_P index_t
+#define DARY_HEAP_SET_POSITION(e, position) ((e)->pos = (position))
+#define DARY_HEAP_ARITY 4
+#include "impl/dary_heap.h"
+
+#endif // REACTION_HEAP_H
@@ -39,6 +39,14 @@
  */
 #define LF_LEVEL(index) (index & 0xffffLL)
 
+/**
+ * @brief Macro for extracting the inferred deadline from the index of a reaction.
+ * @ingroup Internal
+ * The upper 48 bits of the index are the reaction's inferred deadline, so a
+ * reaction with a smaller index is due no later than one with a larger index.
+ */
+#define LF_INFERRED_DEADLINE(index) ((index) >> 16)
+
 /**
  * @brief Utility for finding the maximum of two values.
  * @ingroup Internal
@@ -139,6 +147,14 @@ void lf_vprint_error_and_exit(const char* format, va_list args) ATTRIBUTE_FORMAT
  */
 #define LF_MUTEX_UNLOCK(mutex) LF_ASSERTN(lf_mutex_unlock(mutex), "Mutex unlock failed.")
 
+/**
+ * @brief Destroy mutex with error checking.
+ * @ingroup Internal
+ * This is optimized away if the NDEBUG flag is defined.
+ * @param mutex Pointer to the mutex to destroy.
+ */
+#define LF_MUTEX_DESTROY(mutex) LF_ASSERTN(lf_mutex_destroy(mutex), "Mutex destroy failed.")
+
 /**
  * @brief Initialize condition variable with error checking.
  * @ingroup Internal
@@ -250,6 +250,15 @@ int lf_mutex_lock(lf_mutex_t* mutex);
  */
 int lf_mutex_unlock(lf_mutex_t* mutex);
 
+/**
+ * @brief Release the resources held by the specified mutex, which must not be locked.
+ * @ingroup Platform
+ *
+ * @param mutex The mutex
+ * @return 0 on success
+ */
+int lf_mutex_destroy(lf_mutex_t* mutex);
+
 /**
  * @brief Initialize a conditional variable.
  * @ingroup Platform
@@ -41,6 +41,8 @@ int lf_mutex_lock(lf_mutex_t* mutex) { return pthread_mutex_lock((pthread_mutex_
 
 int lf_mutex_unlock(lf_mutex_t* mutex) { return pthread_mutex_unlock((pthread_mutex_t*)mutex); }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) { return pthread_mutex_destroy((pthread_mutex_t*)mutex); }
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   cond->mutex = mutex;
   pthread_condattr_t cond_attr;
@@ -181,6 +181,12 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return 0;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  mutex_delete(*mutex);
+  *mutex = NULL;
+  return 0;
+}
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   *cond = (lf_cond_t)condition_new(*mutex);
   return 0;
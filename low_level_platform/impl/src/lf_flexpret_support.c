@@ -186,6 +186,12 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return 0;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  // The lock holds no resources.
+  (void)mutex;
+  return 0;
+}
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   *cond = (lf_cond_t)FP_COND_INITIALIZER(mutex);
   return 0;
@@ -250,6 +250,12 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return 0;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  // The SDK has no call to release a recursive mutex; it holds no resources.
+  (void)mutex;
+  return 0;
+}
+
 // condition variables "notify" threads using a semaphore per core.
 // although there are only two cores, may not use just a single semaphore
 // as a cond_broadcast may be called from within an interrupt
@@ -229,6 +229,12 @@ int lf_mutex_unlock(_lf_critical_section_t* critical_section) {
   return 0;
 }
 
+int lf_mutex_destroy(_lf_critical_section_t* critical_section) {
+  // The following Windows API does not return a value.
+  DeleteCriticalSection((PCRITICAL_SECTION)critical_section);
+  return 0;
+}
+
 int lf_cond_init(lf_cond_t* cond, _lf_critical_section_t* critical_section) {
   // The following Windows API does not return a value.
   cond->critical_section = critical_section;
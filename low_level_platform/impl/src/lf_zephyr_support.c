@@ -207,6 +207,12 @@ int lf_mutex_unlock(lf_mutex_t* mutex) {
   return res;
 }
 
+int lf_mutex_destroy(lf_mutex_t* mutex) {
+  // Kernel mutexes hold no resources.
+  (void)mutex;
+  return 0;
+}
+
 int lf_cond_init(lf_cond_t* cond, lf_mutex_t* mutex) {
   cond->mutex = mutex;
   return k_condvar_init(&cond->condition);
@@ -7,6 +7,8 @@
  * @ingroup Platform
  */
 
+#include <stdint.h>
+
 /**
  * @brief Pointer to the platform-specific implementation of a mutex.
  * @ingroup Platform
@@ -41,6 +43,80 @@ int lf_platform_mutex_lock(lf_platform_mutex_ptr_t mutex);
  */
 int lf_platform_mutex_unlock(lf_platform_mutex_ptr_t mutex);
 
+/**
+ * @brief Pointer to the platform-specific implementation of a condition variable.
+ * @ingroup Platform
+ */
+typedef void* lf_platform_cond_ptr_t;
+
+/**
+ * @brief Create a new condition variable associated with the given mutex and return (a pointer to) it.
+ *
+ * @return The condition variable, or NULL if the platform or build has no threads.
+ * @ingroup Platform
+ */
+lf_platform_cond_ptr_t lf_platform_cond_new(lf_platform_mutex_ptr_t mutex);
+
+/**
+ * @brief Free all resources associated with the provided condition variable.
+ * @ingroup Platform
+ */
+void lf_platform_cond_free(lf_platform_cond_ptr_t cond);
+
+/**
+ * @brief Wait on the given condition variable. Its mutex must be held.
+ *
+ * @return 0 on success, platform-specific error number otherwise.
+ * @ingroup Platform
+ */
+int lf_platform_cond_wait(lf_platform_cond_ptr_t cond);
+
+/**
+ * @brief Wait on the given condition variable until it is signaled or the platform clock reaches wakeup_time.
+ * Its mutex must be held.
+ *
+ * @param wakeup_time A time of the clock read by lf_platform_clock_ns().
+ * @return 0 when signaled, 1 on timeout, platform-specific error number otherwise.
+ * @ingroup Platform
+ */
+int lf_platform_cond_timedwait(lf_platform_cond_ptr_t cond, int64_t wakeup_time);
+
+/**
+ * @brief Wake up all threads waiting on the given condition variable.
+ *
+ * @return 0 on success, platform-specific error number otherwise.
+ * @ingroup Platform
+ */
+int lf_platform_cond_broadcast(lf_platform_cond_ptr_t cond);
+
+/**
+ * @brief Pointer to the platform-specific implementation of a thread.
+ * @ingroup Platform
+ */
+typedef void* lf_platform_thread_ptr_t;
+
+/**
+ * @brief Start a thread that runs the given function with the given argument.
+ *
+ * @return The thread, or NULL if it could not be created or the platform or build has no threads.
+ * @ingroup Platform
+ */
+lf_platform_thread_ptr_t lf_platform_thread_new(void* (*function)(void*), void* argument);
+
+/**
+ * @brief Wait for the given thread to finish and free its resources.
+ *
+ * @return 0 on success, platform-specific error number otherwise.
+ * @ingroup Platform
+ */
+int lf_platform_thread_join(lf_platform_thread_ptr_t thread);
+
+/**
+ * @brief Return the current time of the platform clock in nanoseconds.
+ * @ingroup Platform
+ */
+int64_t lf_platform_clock_ns(void);
+
 /// \cond INTERNAL  // Doxygen conditional.
 // The following is defined in low_level_platform.h, so ask Doxygen to ignore this.
 
@@ -21,3 +21,76 @@ lf_platform_mutex_ptr_t lf_platform_mutex_new() {
 void lf_platform_mutex_free(lf_platform_mutex_ptr_t mutex) { free((void*)mutex); }
 int lf_platform_mutex_lock(lf_platform_mutex_ptr_t mutex) { return lf_mutex_lock((lf_mutex_t*)mutex); }
 int lf_platform_mutex_unlock(lf_platform_mutex_ptr_t mutex) { return lf_mutex_unlock((lf_mutex_t*)mutex); }
+
+// CLOCK ***********************************************************************
+
+int64_t lf_platform_clock_ns(void) {
+  instant_t now = 0;
+  _lf_clock_gettime(&now);
+  return now;
+}
+
+// CONDITION VARIABLES AND THREADS *********************************************
+
+#if defined(LF_SINGLE_THREADED)
+
+lf_platform_cond_ptr_t lf_platform_cond_new(lf_platform_mutex_ptr_t mutex) {
+  (void)mutex;
+  return NULL;
+}
+void lf_platform_cond_free(lf_platform_cond_ptr_t cond) { (void)cond; }
+int lf_platform_cond_wait(lf_platform_cond_ptr_t cond) {
+  (void)cond;
+  return -1;
+}
+int lf_platform_cond_timedwait(lf_platform_cond_ptr_t cond, int64_t wakeup_time) {
+  (void)cond;
+  (void)wakeup_time;
+  return -1;
+}
+int lf_platform_cond_broadcast(lf_platform_cond_ptr_t cond) {
+  (void)cond;
+  return -1;
+}
+lf_platform_thread_ptr_t lf_platform_thread_new(void* (*function)(void*), void* argument) {
+  (void)function;
+  (void)argument;
+  return NULL;
+}
+int lf_platform_thread_join(lf_platform_thread_ptr_t thread) {
+  (void)thread;
+  return -1;
+}
+
+#else
+
+lf_platform_cond_ptr_t lf_platform_cond_new(lf_platform_mutex_ptr_t mutex) {
+  lf_cond_t* cond = (lf_cond_t*)malloc(sizeof(lf_cond_t));
+  if (cond && lf_cond_init(cond, (lf_mutex_t*)mutex) != 0) {
+    free(cond);
+    cond = NULL;
+  }
+  return (lf_platform_cond_ptr_t)cond;
+}
+void lf_platform_cond_free(lf_platform_cond_ptr_t cond) { free((void*)cond); }
+int lf_platform_cond_wait(lf_platform_cond_ptr_t cond) { return lf_cond_wait((lf_cond_t*)cond); }
+int lf_platform_cond_timedwait(lf_platform_cond_ptr_t cond, int64_t wakeup_time) {
+  return _lf_cond_timedwait((lf_cond_t*)cond, wakeup_time);
+}
+int lf_platform_cond_broadcast(lf_platform_cond_ptr_t cond) { return lf_cond_broadcast((lf_cond_t*)cond); }
+
+lf_platform_thread_ptr_t lf_platform_thread_new(void* (*function)(void*), void* argument) {
+  lf_thread_t* thread = (lf_thread_t*)malloc(sizeof(lf_thread_t));
+  if (thread && lf_thread_create(thread, function, argument) != 0) {
+    free(thread);
+    thread = NULL;
+  }
+  return (lf_platform_thread_ptr_t)thread;
+}
+int lf_platform_thread_join(lf_platform_thread_ptr_t thread) {
+  int result = lf_thread_join(*(lf_thread_t*)thread, NULL);
+  free(thread);
+  return result;
+}
+
+#endif // LF_SINGLE_THREADED
@@ -22,6 +22,14 @@ endfunction()
 
 # Add the appropriate directories for the provided build parameters.
 add_test_dir(${TEST_DIR}/general)
+if(DEFINED LF_SINGLE_THREADED)
+    add_test_dir(${TEST_DIR}/single_threaded)
+else()
+    add_test_dir(${TEST_DIR}/threaded)
+endif()
+if(DEFINED LF_TRACE)
+    add_test_dir(${TEST_DIR}/trace)
+endif()
 if(NUMBER_OF_WORKERS)
     if (${CMAKE_SYSTEM_NAME} STREQUAL "Linux")
       add_test_dir(${TEST_DIR}/scheduling)
@@ -41,6 +49,46 @@ foreach(FILE ${TEST_FILES})
         ${CoreLib} ${Lib}
     )
     target_include_directories(${NAME} PRIVATE ${TEST_DIR})
+    # Tests of the default trace implementation use its internal headers.
+    if(TARGET lf-trace-impl)
+        target_include_directories(${NAME} PRIVATE ${LF_ROOT}/trace/impl/include)
+    endif()
     # Warnings as errors
     lf_enable_compiler_warnings(${NAME})
 endforeach(FILE ${TEST_FILES})
+
+# The end-to-end benchmark of the threaded runtime on synthetic workloads; see test/workload/workload_bench.c.
+# It provides the code-generated functions itself, which the runtime lacks without workers or with
+# federation or enclaves.
+if(NOT DEFINED LF_SINGLE_THREADED AND NOT DEFINED FEDERATED AND NOT DEFINED LF_ENCLAVES)
+    add_executable(workload_bench ${TEST_DIR}/workload/workload_bench.c ${TEST_DIR}/workload/workload.c)
+    target_link_libraries(workload_bench PRIVATE lf::low-level-platform-impl ${CoreLib} ${Lib} m)
+    lf_enable_compiler_warnings(workload_bench)
+    # A short execution in every master scheduler phase.
+    add_test(
+        NAME workload_bench_smoke
+        COMMAND workload_bench --levels 3 --width 4 --fan-out 2 --period 1ms --timeout 20ms --workers 1,2
+                --repetitions 1 --output ${CMAKE_CURRENT_BINARY_DIR}/workload_smoke.json
+    )
+
+    # `cmake --build <dir> --target workload` builds workload_bench in Release mode once for each scheduler,
+    # runs it, and merges the results into <dir>/workload/results.json.
+    set(LF_WORKLOAD_SCHEDULERS "NP;GEDF_NP;ADAPTIVE" CACHE STRING "Schedulers compared by the workload target.")
+    set(LF_WORKLOAD_ARGS "" CACHE STRING "Extra arguments of workload_bench for the workload target, e.g. --levels 8.")
+    # A list would be split into separate arguments of the command.
+    string(REPLACE ";" "," WORKLOAD_SCHEDULERS "${LF_WORKLOAD_SCHEDULERS}")
+    add_custom_target(
+        workload
+        COMMAND ${CMAKE_COMMAND}
+            -DSOURCE_DIR=${CMAKE_SOURCE_DIR}
+            -DBENCH_DIR=${CMAKE_BINARY_DIR}/workload
+            -DSCHEDULERS=${WORKLOAD_SCHEDULERS}
+            -DARGS=${LF_WORKLOAD_ARGS}
+            -DBENCH_TARGET=workload_bench
+            -DBENCH_PROGRAM=workload_bench
+            -DLATER_ARGS=
+            -P ${LF_ROOT}/bench/RunBench.cmake
+        USES_TERMINAL
+        VERBATIM
+    )
+endif()
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "lf_token.h"
+#include "lf_types.h"
+#include "low_level_platform.h"
+
+#define CHURN_THREADS 4
+#define CHURN_ROUNDS 2000
+#define CHURN_DEPTH 100
+// The number of tokens moved between a thread's cache and the global pool at once.
+#define TOKEN_BATCH 32
+
+#if !defined(LF_SINGLE_THREADED)
+// The runtime's critical section lives in reactor_threaded.c, which needs a
+// generated program. A plain mutex is enough for the token pool.
+static lf_mutex_t critical_section;
+
+int lf_critical_section_enter(environment_t* env) {
+  (void)env;
+  return lf_mutex_lock(&critical_section);
+}
+
+int lf_critical_section_exit(environment_t* env) {
+  (void)env;
+  return lf_mutex_unlock(&critical_section);
+}
+#else
+// Single-threaded builds take the critical section from reactor.c, which
+// calls this code-generated function.
+void lf_create_environments(void) {}
+#endif
+
+static token_type_t int_type = {.element_size = sizeof(int), .destructor = NULL, .copy_constructor = NULL};
+
+static lf_token_t* new_token(int v) {
+  int* value = (int*)malloc(sizeof(int));
+  *value = v;
+  lf_token_t* token = _lf_new_token(&int_type, value, 1);
+  token->ref_count = 1;
+  assert(token->value == value && token->length == 1 && token->type == &int_type);
+  return token;
+}
+
+static void reuse_on_same_thread(void) {
+  lf_token_t* token = new_token(1);
+  _lf_done_using(token);
+  // The freed token comes back from the thread's cache, with its value cleared.
+  lf_token_t* again = _lf_new_token(&int_type, NULL, 0);
+  assert(again == token);
+  assert(again->value == NULL && again->next == NULL && again->ref_count == 0);
+  again->ref_count = 1;
+  _lf_done_using(again);
+}
+
+static void payload_pools(void) {
+  // An action-like template: payloads from _lf_initialize_token, as used by lf_schedule_copy.
+  token_template_t action = {0};
+  _lf_initialize_template(&action, sizeof(int));
+  lf_token_t* token = _lf_initialize_token(&action, 4);
+#if !defined(LF_PAYLOAD_POOLS)
+  assert(!token->pooled);
+#endif
+  assert(lf_enable_payload_pool(&action));
+  assert(lf_enable_payload_pool(&action));
+
+  token = _lf_initialize_token(&action, 4);
+  assert(token->pooled);
+  int* first = (int*)token->value;
+  assert(first[0] == 0 && first[3] == 0);
+  first[0] = 42;
+  // The template token is reused, so 'first' is released after its replacement is allocated.
+  token = _lf_initialize_token(&action, 4);
+  int* second = (int*)token->value;
+  assert(second != first);
+  token = _lf_initialize_token(&action, 4);
+  assert(token->value == first);
+  assert(first[0] == 0);
+  // Payloads too large for any size class are not pooled.
+  token = _lf_initialize_token(&action, 1 << 20);
+  assert(!token->pooled);
+
+  // A port with two readers: writable copies come from the tag arena.
+  self_base_t reactor = {0};
+  lf_port_base_t port = {.num_destinations = 2, .source_reactor = &reactor};
+  _lf_initialize_template(&port.tmplt, sizeof(int));
+  assert(lf_enable_payload_pool(&port));
+  lf_token_t* input = _lf_initialize_token(&port.tmplt, 8);
+  input->ref_count = 2;
+  ((int*)input->value)[7] = 7;
+  lf_token_t* copy = lf_writable_copy(&port);
+  assert(copy != input && copy->pooled);
+  assert(memcmp(copy->value, input->value, 8 * sizeof(int)) == 0);
+  void* arena_slot = copy->value;
+  // The start of the next tag releases the copy and empties the arena.
+  _lf_free_token_copies();
+  copy = lf_writable_copy(&port);
+  assert(copy->value == arena_slot);
+
+  // A copy that outlives its tag keeps its place while the arena moves on.
+  copy->ref_count++;
+  _lf_free_token_copies();
+  lf_token_t* next = lf_writable_copy(&port);
+  assert(next->value != arena_slot);
+  assert(((int*)copy->value)[7] == 7);
+  _lf_done_using(copy);
+  _lf_free_token_copies();
+  input->ref_count = 1;
+
+  // Tokens that own a buffer, as used to receive network messages, take it from the pool.
+  lf_token_t* message = _lf_new_token_with_buffer((token_type_t*)&action, 100, 100);
+  assert(message->pooled && message->length == 100 && message->ref_count == 0);
+  void* buffer = message->value;
+  _lf_free_token(message);
+  message = _lf_new_token_with_buffer((token_type_t*)&action, 100, 100);
+  assert(message->value == buffer);
+  _lf_free_token(message);
+
+  _lf_free_all_tokens();
+  // Pools do not survive the end of execution.
+  _lf_initialize_template(&action, sizeof(int));
+  token = _lf_initialize_token(&action, 4);
+#if !defined(LF_PAYLOAD_POOLS)
+  assert(!token->pooled);
+#endif
+  _lf_free_all_tokens();
+}
+
+#if !defined(LF_SINGLE_THREADED)
+static void* churn(void* arg) {
+  (void)arg;
+  lf_token_t* live[CHURN_DEPTH];
+  for (int round = 0; round < CHURN_ROUNDS; round++) {
+    // Allocate and free in bursts larger than a cache, so that batches move
+    // through the global pool.
+    for (int i = 0; i < CHURN_DEPTH; i++) {
+      live[i] = new_token(round * CHURN_DEPTH + i);
+    }
+    for (int i = 0; i < CHURN_DEPTH; i++) {
+      assert(*(int*)live[i]->value == round * CHURN_DEPTH + i);
+      _lf_done_using(live[i]);
+    }
+  }
+  return NULL;
+}
+
+static lf_token_t* exited_tokens[TOKEN_BATCH];
+
+static void* free_batch_and_exit(void* arg) {
+  (void)arg;
+  for (int i = 0; i < TOKEN_BATCH; i++) {
+    exited_tokens[i] = new_token(i);
+  }
+  for (int i = 0; i < TOKEN_BATCH; i++) {
+    _lf_done_using(exited_tokens[i]);
+  }
+  return NULL;
+}
+
+static void* take_one(void* arg) {
+  *(lf_token_t**)arg = _lf_new_token(&int_type, NULL, 0);
+  return NULL;
+}
+
+static void cache_released_at_thread_exit(void) {
+  // The tokens left in the cache of an exiting thread go to the global pool,
+  // from which a new thread's empty cache refills.
+  lf_thread_t thread;
+  assert(lf_thread_create(&thread, free_batch_and_exit, NULL) == 0);
+  assert(lf_thread_join(thread, NULL) == 0);
+  lf_token_t* token = NULL;
+  assert(lf_thread_create(&thread, take_one, &token) == 0);
+  assert(lf_thread_join(thread, NULL) == 0);
+  bool found = false;
+  for (int i = 0; i < TOKEN_BATCH; i++) {
+    found |= token == exited_tokens[i];
+  }
+  assert(found);
+  token->ref_count = 1;
+  _lf_done_using(token);
+}
+#endif
+
+int main(void) {
+#if !defined(LF_SINGLE_THREADED)
+  assert(lf_mutex_init(&critical_section) == 0);
+#endif
+  reuse_on_same_thread();
+  payload_pools();
+
+#if !defined(LF_SINGLE_THREADED)
+  cache_released_at_thread_exit();
+  lf_thread_t threads[CHURN_THREADS];
+  for (int i = 0; i < CHURN_THREADS; i++) {
+    assert(lf_thread_create(&threads[i], churn, NULL) == 0);
+  }
+  for (int i = 0; i < CHURN_THREADS; i++) {
+    assert(lf_thread_join(threads[i], NULL) == 0);
+  }
+#endif
+#if !defined NDEBUG
+  assert(_lf_count_token_allocations == 0);
+#endif
+
+  // Releases every pooled and cached token, after which allocation still works.
+  _lf_free_all_tokens();
+  lf_token_t* token = new_token(7);
+  _lf_done_using(token);
+  _lf_free_all_tokens();
+  return 0;
+}
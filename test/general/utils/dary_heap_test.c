@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <time.h>
+#include "pqueue.h"
+#include "pqueue_tag.h"
+#include "reaction_heap.h"
+
+#define RANDOM_SEED 2718
+#define MAX_REACTIONS 2000
+#define OPERATIONS 20000
+
+// Reaction queue benchmark: at each of this many tags, this many reactions are triggered and then executed.
+#define TAGS 5000
+#define REACTIONS_PER_TAG 200
+
+// Event queue benchmark: this many events stay pending while the earliest one is repeatedly
+// popped and rescheduled.
+#define HOLD_PENDING 100000
+#define HOLD_OPERATIONS 300000
+
+static reaction_t reactions[MAX_REACTIONS];
+
+// Reference: the reactions that are in the heap, in no particular order.
+static reaction_t* reference[MAX_REACTIONS];
+static size_t reference_size = 0;
+
+static long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static index_t reference_least_index(void) {
+  index_t least = (index_t)-1;
+  for (size_t i = 0; i < reference_size; i++) {
+    if (reference[i]->index < least)
+      least = reference[i]->index;
+  }
+  return least;
+}
+
+static void reference_take(size_t i) { reference[i] = reference[--reference_size]; }
+
+static void reference_remove(reaction_t* reaction) {
+  for (size_t i = 0; i < reference_size; i++) {
+    if (reference[i] == reaction) {
+      reference_take(i);
+      return;
+    }
+  }
+  assert(false);
+}
+
+static int is_reaction(reaction_t* element, void* arg) { return element == (reaction_t*)arg; }
+
+/** Compare the heap against the reference under random inserts, pops, removals and replacements. */
+static void random_operations(void) {
+  reaction_heap_t heap = reaction_heap_new(1);
+  size_t free_count = MAX_REACTIONS;
+  reaction_t* unused[MAX_REACTIONS];
+  for (size_t i = 0; i < MAX_REACTIONS; i++) {
+    unused[i] = &reactions[i];
+  }
+  for (int i = 0; i < OPERATIONS; i++) {
+    int grow = i < OPERATIONS / 2 ? 60 : 40;
+    int choice = rand() % 100;
+    if (free_count > 0 && (choice < grow || reference_size == 0)) {
+      reaction_t* reaction = unused[--free_count];
+      // Few distinct indexes, so that many are equal.
+      reaction->index = (index_t)(rand() % 50);
+      assert(reaction_heap_insert(&heap, reaction, reaction->index) == 0);
+      reference[reference_size++] = reaction;
+    } else if (choice < 80) {
+      index_t least = reference_least_index();
+      reaction_t* head = reaction_heap_peek(&heap);
+      assert(head->index == least);
+      assert(reaction_heap_pop(&heap) == head);
+      reference_remove(head);
+      unused[free_count++] = head;
+    } else if (choice < 90) {
+      size_t victim = (size_t)rand() % reference_size;
+      reaction_t* reaction = reference[victim];
+      assert(reaction_heap_find_same_priority(&heap, reaction->index, is_reaction, reaction) == reaction);
+      assert(reaction_heap_at(&heap, reaction->pos) == reaction);
+      reaction_heap_remove(&heap, reaction->pos);
+      reference_take(victim);
+      unused[free_count++] = reaction;
+    } else if (free_count > 0) {
+      size_t victim = (size_t)rand() % reference_size;
+      reaction_t* reaction = reference[victim];
+      reaction_t* replacement = unused[--free_count];
+      replacement->index = (index_t)(rand() % 50);
+      reaction_heap_replace(&heap, reaction->pos, replacement, replacement->index);
+      reference[victim] = replacement;
+      unused[free_count++] = reaction;
+    }
+    assert(reaction_heap_size(&heap) == reference_size);
+    assert(reaction_heap_is_valid(&heap));
+  }
+
+  // Take off all reactions with the least index at once until the heap is empty.
+  vector_t popped = vector_new(1);
+  while (reference_size > 0) {
+    index_t least = reference_least_index();
+    size_t count = reaction_heap_pop_all_same_priority(&heap, &popped);
+    assert(count == vector_size(&popped));
+    reaction_t* reaction;
+    while ((reaction = (reaction_t*)vector_pop(&popped)) != NULL) {
+      assert(reaction->index == least);
+      reference_remove(reaction);
+    }
+    assert(reaction_heap_is_valid(&heap));
+    for (size_t i = 1; i <= reaction_heap_size(&heap); i++) {
+      assert(reaction_heap_at(&heap, i)->pos == i);
+    }
+  }
+  assert(reaction_heap_size(&heap) == 0);
+  assert(reaction_heap_pop(&heap) == NULL);
+  assert(reaction_heap_peek(&heap) == NULL);
+  assert(reaction_heap_find_same_priority(&heap, 0, NULL, NULL) == NULL);
+  vector_free(&popped);
+  reaction_heap_free(&heap);
+}
+
+//////////////////
+// Benchmarks against the binary heap of pqueue_base.h.
+
+static reaction_t* bench_reactions;
+
+static void reaction_setup(void) {
+  srand(RANDOM_SEED);
+  for (size_t i = 0; i < REACTIONS_PER_TAG; i++) {
+    // A deadline in the upper bits of some reactions and a level in the lower 16 bits of all.
+    index_t deadline = (rand() % 4 == 0) ? (index_t)(rand() % 1000) : (index_t)0xFFFFFFFFFFFFLL;
+    bench_reactions[i].index = (deadline << 16) | (index_t)(rand() % 20);
+  }
+}
+
+static void benchmark_reaction_queue(void) {
+  bench_reactions = (reaction_t*)calloc(REACTIONS_PER_TAG, sizeof(reaction_t));
+  assert(bench_reactions != NULL);
+
+  reaction_setup();
+  pqueue_t* binary = pqueue_init(REACTIONS_PER_TAG, in_reverse_order, get_reaction_index, get_reaction_position,
+                                 set_reaction_position, reaction_matches, print_reaction);
+  long long start = now_ns();
+  index_t binary_sum = 0;
+  for (int t = 0; t < TAGS; t++) {
+    for (size_t i = 0; i < REACTIONS_PER_TAG; i++) {
+      pqueue_insert(binary, &bench_reactions[i]);
+    }
+    reaction_t* reaction;
+    while ((reaction = (reaction_t*)pqueue_pop(binary)) != NULL) {
+      binary_sum += reaction->index;
+    }
+  }
+  long long binary_ns = now_ns() - start;
+  pqueue_free(binary);
+
+  reaction_setup();
+  reaction_heap_t heap = reaction_heap_new(REACTIONS_PER_TAG);
+  start = now_ns();
+  index_t heap_sum = 0;
+  for (int t = 0; t < TAGS; t++) {
+    for (size_t i = 0; i < REACTIONS_PER_TAG; i++) {
+      reaction_heap_insert(&heap, &bench_reactions[i], bench_reactions[i].index);
+    }
+    reaction_t* reaction;
+    while ((reaction = reaction_heap_pop(&heap)) != NULL) {
+      heap_sum += reaction->index;
+    }
+  }
+  long long heap_ns = now_ns() - start;
+  reaction_heap_free(&heap);
+  assert(heap_sum == binary_sum);
+
+  long long operations = (long long)TAGS * REACTIONS_PER_TAG;
+  printf("Reaction queue benchmark with %d tags of %d reactions:\n", TAGS, REACTIONS_PER_TAG);
+  printf("  binary heap:    %8.1f ns per insert and pop\n", (double)binary_ns / (double)operations);
+  printf("  d-ary heap:     %8.1f ns per insert and pop\n", (double)heap_ns / (double)operations);
+  free(bench_reactions);
+}
+
+static pqueue_pri_t get_priority(void* element) { return (pqueue_pri_t)(uintptr_t)element; }
+static size_t get_position(void* element) { return ((pqueue_tag_element_t*)element)->pos; }
+static void set_position(void* element, size_t pos) { ((pqueue_tag_element_t*)element)->pos = pos; }
+static int same_tag(void* element1, void* element2) {
+  return lf_tag_compare(((pqueue_tag_element_t*)element1)->tag, ((pqueue_tag_element_t*)element2)->tag) == 0;
+}
+static void print_element(void* element) {
+  printf("Element with time %lld.\n", (long long)((pqueue_tag_element_t*)element)->tag.time);
+}
+
+static void hold_setup(pqueue_tag_element_t* events) {
+  srand(RANDOM_SEED);
+  for (size_t i = 0; i < HOLD_PENDING; i++) {
+    events[i].tag.time = (instant_t)(rand() % 100000) * USEC(1);
+    events[i].tag.microstep = (microstep_t)(rand() % 2);
+    events[i].is_dynamic = 0;
+  }
+}
+
+static void benchmark_event_queue(void) {
+  pqueue_tag_element_t* events = (pqueue_tag_element_t*)calloc(HOLD_PENDING, sizeof(pqueue_tag_element_t));
+  assert(events != NULL);
+
+  hold_setup(events);
+  pqueue_t* binary = pqueue_init(HOLD_PENDING, pqueue_tag_compare, get_priority, get_position, set_position, same_tag,
+                                 print_element);
+  long long start = now_ns();
+  for (size_t i = 0; i < HOLD_PENDING; i++) {
+    pqueue_insert(binary, &events[i]);
+  }
+  for (int i = 0; i < HOLD_OPERATIONS; i++) {
+    pqueue_tag_element_t* e = (pqueue_tag_element_t*)pqueue_pop(binary);
+    e->tag.time += (instant_t)(rand() % 100000) * USEC(1);
+    pqueue_insert(binary, e);
+  }
+  long long binary_ns = now_ns() - start;
+  tag_t binary_head = ((pqueue_tag_element_t*)pqueue_peek(binary))->tag;
+  pqueue_free(binary);
+
+  hold_setup(events);
+  pqueue_tag_t* q = pqueue_tag_init(HOLD_PENDING);
+  start = now_ns();
+  for (size_t i = 0; i < HOLD_PENDING; i++) {
+    pqueue_tag_insert(q, &events[i]);
+  }
+  for (int i = 0; i < HOLD_OPERATIONS; i++) {
+    pqueue_tag_element_t* e = pqueue_tag_pop(q);
+    e->tag.time += (instant_t)(rand() % 100000) * USEC(1);
+    pqueue_tag_insert(q, e);
+  }
+  long long tag_ns = now_ns() - start;
+  // Both saw the same random numbers, so they end with the same tags, even if equal tags left in another order.
+  assert(lf_tag_compare(pqueue_tag_peek_tag(q), binary_head) == 0);
+  pqueue_tag_free(q);
+
+  printf("Event queue benchmark with %d pending events and %d pop and insert pairs:\n", HOLD_PENDING,
+         HOLD_OPERATIONS);
+  printf("  binary heap:    %8.1f ns per pair\n", (double)binary_ns / HOLD_OPERATIONS);
+#if defined(LF_CALENDAR_QUEUE)
+  printf("  calendar queue: %8.1f ns per pair\n", (double)tag_ns / HOLD_OPERATIONS);
+#else
+  printf("  d-ary heap:     %8.1f ns per pair\n", (double)tag_ns / HOLD_OPERATIONS);
+#endif
+  free(events);
+}
+
+int main() {
+  srand(RANDOM_SEED);
+  random_operations();
+  benchmark_reaction_queue();
+  benchmark_event_queue();
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "master_scheduler.h"
+#include "master_scheduler_binlog.h"
+
+#define THREADS 4
+#define PER_THREAD 500
+
+static void* worker(void* arg) {
+  int id = (int)(intptr_t)arg;
+  ms_worker_info_t info = {.worker_id = id, .os_pid = 0, .os_tid = ms_gettid(), .name = "test", .flags = 0};
+  ms_register_worker(&info);
+  for (int i = 0; i < PER_THREAD; i++) {
+    uint64_t key = 1 + (uint64_t)id * PER_THREAD + (uint64_t)i;
+    ms_on_reaction_ready(0, key, 0, (long long)key, 0);
+    ms_on_reaction_start(0, id, key, 0);
+    ms_on_reaction_end(0, id, key, 0, 0);
+  }
+  return NULL;
+}
+
+int main(void) {
+  char text_path[] = "/tmp/lf_ms_binlog_test_XXXXXX";
+  int fd = mkstemp(text_path);
+  assert(fd >= 0);
+  close(fd);
+  char bin_path[sizeof(text_path) + 4];
+  snprintf(bin_path, sizeof(bin_path), "%s.bin", text_path);
+
+  setenv("LF_MS_LOG", text_path, 1);
+  setenv("LF_MS_LOG_LEVEL", "DEBUG", 1);
+  setenv("LF_MS_LOG_BINARY", "1", 1);
+  assert(ms_init(NULL));
+  assert(ms_binlog_is_open());
+
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    assert(pthread_create(&threads[i], NULL, worker, (void*)(intptr_t)i) == 0);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  ms_shutdown();
+  assert(!ms_binlog_is_open());
+
+  FILE* f = fopen(bin_path, "rb");
+  assert(f != NULL);
+  ms_bin_file_header_t header;
+  assert(fread(&header, sizeof(header), 1, f) == 1);
+  assert(memcmp(header.magic, MS_BIN_MAGIC, sizeof(header.magic)) == 0);
+  assert(header.record_size == sizeof(ms_bin_record_t));
+
+  // Every ready and runtime_selected event arrives unless the drainer fell behind.
+  int ready = 0, selected = 0, dropped = 0;
+  ms_bin_record_t rec;
+  while (fread(&rec, sizeof(rec), 1, f) == 1) {
+    if (rec.event == MS_BIN_EV_READY)
+      ready++;
+    else if (rec.event == MS_BIN_EV_RUNTIME_SELECTED)
+      selected++;
+    else if (rec.event == MS_BIN_EV_DROPPED)
+      dropped += (int)rec.key;
+  }
+  fclose(f);
+  assert(ready + selected + dropped >= 2 * THREADS * PER_THREAD);
+  assert(ready <= THREADS * PER_THREAD && selected <= THREADS * PER_THREAD);
+
+  remove(bin_path);
+  remove(text_path);
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "master_scheduler.h"
+#include "master_scheduler_metrics.h"
+
+#define ENV 1
+#define WORKER 3
+#define REACTION 0x1234
+// Workers of different environments that have the same worker id share a record.
+#define SHARED_WORKER 5
+#define SHARING_ENVS 4
+#define UPDATES 20000
+
+static const ms_metrics_page_t* map_read_only(const char* path) {
+  int fd = open(path, O_RDONLY);
+  assert(fd >= 0);
+  void* mapped = mmap(NULL, sizeof(ms_metrics_page_t), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  assert(mapped != MAP_FAILED);
+  return (const ms_metrics_page_t*)mapped;
+}
+
+static void* shared_worker(void* arg) {
+  int env_id = (int)(intptr_t)arg;
+  uint64_t key = 0x5000 + (uint64_t)env_id;
+  for (int i = 0; i < UPDATES; i++) {
+    ms_metrics_chain(env_id, SHARED_WORKER, &key, 1, 1, 0);
+  }
+  return NULL;
+}
+
+static void shared_worker_record(const ms_metrics_page_t* page) {
+  pthread_t threads[SHARING_ENVS];
+  for (int i = 0; i < SHARING_ENVS; i++) {
+    assert(pthread_create(&threads[i], NULL, shared_worker, (void*)(intptr_t)i) == 0);
+  }
+  for (int i = 0; i < SHARING_ENVS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  ms_metrics_worker_t worker;
+  assert(ms_metrics_read_worker(page, SHARED_WORKER, &worker));
+  assert(worker.seq % 2 == 0);
+  assert(worker.reactions_run == (uint64_t)SHARING_ENVS * UPDATES);
+  assert(worker.busy_ns == (int64_t)SHARING_ENVS * UPDATES);
+}
+
+int main(void) {
+  char path[] = "/tmp/lf_ms_metrics_test_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  setenv("LF_MS_LOG", "/dev/null", 1);
+  setenv("LF_MS_METRICS_PATH", path, 1);
+  assert(ms_init(NULL));
+  assert(ms_metrics_is_open());
+
+  const ms_metrics_page_t* page = map_read_only(path);
+  assert(memcmp(page->header.magic, MS_METRICS_MAGIC, sizeof(page->header.magic)) == 0);
+  assert(page->header.version == MS_METRICS_VERSION);
+  assert(page->header.pid == (int64_t)getpid());
+  assert(page->header.running == 1);
+
+  ms_metrics_env_t env;
+  assert(ms_metrics_read_env(page, ENV, &env));
+  assert(!env.active);
+  assert(env.ready_q_len == -1);
+
+  ms_on_tag_advance(ENV, 5000, 2);
+  ms_on_reaction_ready(ENV, REACTION, 5000, 0, 0);
+  ms_on_reaction_start(ENV, WORKER, REACTION, 0);
+
+  ms_metrics_worker_t worker;
+  assert(ms_metrics_read_worker(page, WORKER, &worker));
+  assert(worker.active && worker.env_id == ENV);
+  assert(worker.current_reaction == REACTION);
+  assert(worker.reactions_run == 0);
+
+  ms_on_deadline_miss(ENV, WORKER, REACTION);
+  ms_on_reaction_end(ENV, WORKER, REACTION, 0, 0);
+  ms_on_metrics(ENV, WORKER, 0, 777, 4, 55);
+
+  assert(ms_metrics_read_worker(page, WORKER, &worker));
+  assert(worker.current_reaction == 0);
+  assert(worker.reactions_run == 1);
+  assert(worker.busy_ns >= 0);
+  assert(worker.seq % 2 == 0);
+
+  assert(ms_metrics_read_env(page, ENV, &env));
+  assert(env.active);
+  assert(env.tag_time_ns == 5000 && env.tag_microstep == 2);
+  assert(env.lag_ns == 777);
+  assert(env.ready_q_len == 4);
+  assert(env.ptdv_ns == 55);
+  assert(env.deadline_misses == 1);
+
+  int found = 0;
+  for (int i = 0; i < MS_METRICS_MAX_REACTIONS; i++) {
+    if (page->reactions[i].key == REACTION) {
+      assert(page->reactions[i].env_id == ENV);
+      assert(page->reactions[i].invocations == 1);
+      assert(page->reactions[i].deadline_misses == 1);
+      found++;
+    }
+  }
+  assert(found == 1);
+
+  shared_worker_record(page);
+
+  // Shutdown marks the page as finished and removes the file; the existing
+  // mapping stays readable.
+  ms_shutdown();
+  assert(!ms_metrics_is_open());
+  assert(page->header.running == 0);
+  assert(access(path, F_OK) != 0);
+  munmap((void*)page, sizeof(ms_metrics_page_t));
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include "master_scheduler.h"
+#include "master_scheduler_stats.h"
+
+#define ENV 0
+#define LC_REACTION 7
+#define HC_REACTION 8
+
+static long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void within_bucket_error(int64_t actual, int64_t expected) {
+  // Eight sub-buckets per power of two: at most 12.5% above the true value.
+  assert(actual >= expected);
+  assert(actual <= expected + expected / 8 + 1);
+}
+
+static void percentiles(void) {
+  for (int64_t v = 1; v <= 1000; v++) {
+    ms_stats_record(1, 42, v * 1000, v);
+  }
+  assert(ms_stats_count(1, 42) == 1000);
+  assert(ms_stats_count(1, 43) == 0);
+  assert(ms_stats_percentile(1, 43, MS_STATS_WALL_TIME, 0.5) == -1);
+  within_bucket_error(ms_stats_percentile(1, 42, MS_STATS_WALL_TIME, 0.5), 500000);
+  within_bucket_error(ms_stats_percentile(1, 42, MS_STATS_WALL_TIME, 0.99), 990000);
+  within_bucket_error(ms_stats_percentile(1, 42, MS_STATS_CPU_TIME, 0.9), 900);
+  // Small values are exact, and no percentile exceeds the maximum.
+  assert(ms_stats_percentile(1, 42, MS_STATS_CPU_TIME, 0.001) == 1);
+  assert(ms_stats_percentile(1, 42, MS_STATS_CPU_TIME, 1.0) == 1000);
+}
+
+static void export_csv(void) {
+  char path[] = "/tmp/lf_ms_stats_test_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+  assert(ms_stats_export(path));
+  FILE* f = fopen(path, "r");
+  assert(f != NULL);
+  char line[256];
+  assert(fgets(line, sizeof(line), f) != NULL);
+  assert(strncmp(line, "env,reaction_index,metric,count", 31) == 0);
+  int rows = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (strncmp(line, "1,42,", 5) == 0)
+      rows++;
+  }
+  fclose(f);
+  assert(rows == 2);
+  remove(path);
+}
+
+// Spin until the thread has used 'ns' of CPU time, however long a loaded machine takes to give it that.
+static void burn_cpu(long long ns) {
+  int64_t end = ms_stats_thread_cpu_ns() + ns;
+  volatile unsigned long spin = 0;
+  while (ms_stats_thread_cpu_ns() < end) {
+    spin++;
+  }
+}
+
+static void run(uint64_t reaction, long long cpu_ns) {
+  ms_on_reaction_ready(ENV, reaction, 0, 0, 0);
+  ms_on_reaction_start(ENV, 0, reaction, now_ns());
+  burn_cpu(cpu_ns);
+  ms_on_reaction_end(ENV, 0, reaction, now_ns(), 0);
+}
+
+static void cpu_budget(void) {
+  // Degrade pressure: any lag counts.
+  ms_on_metrics(ENV, 0, 0, 1, -1, -1);
+
+  // Within its 2 ms budget, the LC reaction is kept.
+  assert(!ms_should_skip_reaction(ENV, 0, LC_REACTION, 0));
+  run(LC_REACTION, 3000000LL);
+  assert(ms_stats_count(ENV, LC_REACTION) == 1);
+  // Both samples are present. The hooks sample around the burn, so neither can be less than it.
+  assert(ms_stats_percentile(ENV, LC_REACTION, MS_STATS_CPU_TIME, 0.5) >= 3000000LL);
+  assert(ms_stats_percentile(ENV, LC_REACTION, MS_STATS_WALL_TIME, 0.5) >= 3000000LL);
+
+  // Its budget is now spent for the rest of the window. HC reactions are never shed.
+  ms_on_reaction_ready(ENV, LC_REACTION, 0, 0, 0);
+  assert(ms_should_skip_reaction(ENV, 0, LC_REACTION, 0));
+  assert(!ms_should_skip_reaction(ENV, 0, HC_REACTION, 0));
+  run(HC_REACTION, 100000LL);
+  assert(ms_stats_count(ENV, HC_REACTION) == 1);
+}
+
+int main(void) {
+  percentiles();
+  export_csv();
+
+  char config_path[] = "/tmp/lf_ms_stats_config_XXXXXX";
+  int fd = mkstemp(config_path);
+  assert(fd >= 0);
+  FILE* f = fdopen(fd, "w");
+  assert(f != NULL);
+  fprintf(f, "degrade_action = skip\n");
+  fprintf(f, "budget_type = cpu_time\n");
+  fprintf(f, "budget_window_ns = 60000000000\n");
+  fprintf(f, "reaction,%d,%d,low,2000000,1\n", ENV, LC_REACTION);
+  fclose(f);
+
+  setenv("LF_MS_LOG", "/dev/null", 1);
+  setenv("LF_MS_LOG_LEVEL", "ERROR", 1);
+  setenv("LF_MS_DEGRADE_ENABLE", "1", 1);
+  setenv("LF_MS_DEGRADE_LAG_NS", "0", 1);
+  assert(ms_init(config_path));
+  cpu_budget();
+  ms_shutdown();
+  remove(config_path);
+  return 0;
+}
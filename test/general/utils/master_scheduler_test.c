@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "master_scheduler.h"
+#include "master_scheduler_stats.h"
+
+#define ENV 0
+#define THREADS 8
+#define PER_THREAD 200
+// More configured reactions than the old fixed policy table could hold.
+#define CONFIGURED 4000
+#define CONFIGURED_BASE 100000
+// Each round of the distinct-keys test uses fresh keys, many more in total than the ready index has slots.
+#define DISTINCT_ENV 1
+#define DISTINCT_ROUNDS 20
+#define DISTINCT_BASE 1000000
+
+static void pick_earliest_deadline(void) {
+  ms_on_reaction_ready(ENV, 11, 0, 300, 0);
+  ms_on_reaction_ready(ENV, 12, 0, 100, 0);
+  ms_on_reaction_ready(ENV, 13, 0, 200, 0);
+  assert(ms_pick_next(ENV, 0, 0) == 12);
+
+  // A running reaction is no longer a candidate.
+  ms_on_reaction_start(ENV, 0, 12, 0);
+  assert(ms_pick_next(ENV, 0, 0) == 13);
+
+  // Re-readying an entry updates it in place.
+  ms_on_reaction_ready(ENV, 11, 0, 50, 0);
+  assert(ms_pick_next(ENV, 0, 0) == 11);
+
+  ms_on_reaction_end(ENV, 0, 12, 0, 0);
+  ms_on_reaction_start(ENV, 0, 11, 0);
+  ms_on_reaction_end(ENV, 0, 11, 0, 0);
+  assert(ms_pick_next(ENV, 0, 0) == 13);
+  ms_on_reaction_start(ENV, 0, 13, 0);
+  ms_on_reaction_end(ENV, 0, 13, 0, 0);
+  assert(ms_pick_next(ENV, 0, 0) == -1);
+}
+
+static void write_config(const char* path) {
+  FILE* f = fopen(path, "w");
+  assert(f != NULL);
+  fprintf(f, "degrade_action = skip\n");
+  for (int i = 0; i < CONFIGURED; i++) {
+    // Even indexes are low criticality, odd are high.
+    fprintf(f, "reaction,0,%d,%s,-1,%d\n", CONFIGURED_BASE + i, (i % 2 == 0) ? "low" : "high", i % 2 == 0);
+  }
+  fclose(f);
+}
+
+static void configured_criticality(void) {
+  // With strict HC priority, a high-criticality reaction wins over an earlier LC deadline.
+  const uint64_t lc = CONFIGURED_BASE + CONFIGURED - 2;
+  const uint64_t hc = CONFIGURED_BASE + CONFIGURED - 1;
+  ms_on_reaction_ready(ENV, lc, 0, 10, 0);
+  ms_on_reaction_ready(ENV, hc, 0, 20, 0);
+  assert(ms_pick_next(ENV, 0, 0) == (long long)hc);
+  ms_on_reaction_start(ENV, 0, hc, 0);
+  ms_on_reaction_end(ENV, 0, hc, 0, 0);
+  assert(ms_pick_next(ENV, 0, 0) == (long long)lc);
+  ms_on_reaction_start(ENV, 0, lc, 0);
+  ms_on_reaction_end(ENV, 0, lc, 0, 0);
+}
+
+static void chain_accounting(void) {
+  // Degradable LC reactions may be shed, so they have to become ready rather than run inline.
+  assert(!ms_may_execute_inline(ENV, CONFIGURED_BASE));
+  assert(ms_may_execute_inline(ENV, CONFIGURED_BASE + 1));
+  assert(ms_may_execute_inline(ENV, 31));
+
+  // Each reaction of a chain starts when the previous one ends.
+  const uint64_t keys[] = {31, 32, 33};
+  const long long ends[] = {1100, 1300, 1600};
+  ms_on_chain_executed(ENV, 0, keys, ends, NULL, 3, 1000, -1);
+  for (int i = 0; i < 3; i++) {
+    assert(ms_stats_count(ENV, keys[i]) == 1);
+    assert(ms_stats_percentile(ENV, keys[i], MS_STATS_CPU_TIME, 1.0) == -1);
+  }
+  int64_t wall = ms_stats_percentile(ENV, 32, MS_STATS_WALL_TIME, 1.0);
+  assert(wall >= 200 && wall <= 200 + 200 / 8);
+
+  // With CPU samples, each reaction gets the CPU time since the previous one ended.
+  const uint64_t sampled_keys[] = {34, 35, 36};
+  const long long sampled_ends[] = {2100, 2300, 2400};
+  const long long cpu_ends[] = {1400, 1420, -1};
+  assert(ms_chain_needs_cpu_times());
+  ms_on_chain_executed(ENV, 0, sampled_keys, sampled_ends, cpu_ends, 3, 2000, 1000);
+  int64_t cpu = ms_stats_percentile(ENV, 34, MS_STATS_CPU_TIME, 1.0);
+  assert(cpu >= 400 && cpu <= 400 + 400 / 8);
+  cpu = ms_stats_percentile(ENV, 35, MS_STATS_CPU_TIME, 1.0);
+  assert(cpu >= 20 && cpu <= 20 + 20 / 8);
+  // An unavailable sample records no CPU time.
+  assert(ms_stats_count(ENV, 36) == 1);
+  assert(ms_stats_percentile(ENV, 36, MS_STATS_CPU_TIME, 1.0) == -1);
+  // The reactions of the chain never became ready.
+  assert(ms_pick_next(ENV, 0, 0) == -1);
+}
+
+static void* worker(void* arg) {
+  int id = (int)(intptr_t)arg;
+  ms_worker_info_t info = {.worker_id = id, .os_pid = 0, .os_tid = ms_gettid(), .name = "test", .flags = 0};
+  ms_register_worker(&info);
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < PER_THREAD; i++) {
+      uint64_t key = 1000 + (uint64_t)id * PER_THREAD + (uint64_t)i;
+      ms_on_reaction_ready(ENV, key, 0, (long long)key, 0);
+    }
+    for (int i = 0; i < PER_THREAD; i++) {
+      uint64_t key = 1000 + (uint64_t)id * PER_THREAD + (uint64_t)i;
+      ms_on_reaction_start(ENV, id, key, 0);
+      ms_on_reaction_end(ENV, id, key, 0, 0);
+    }
+  }
+  return NULL;
+}
+
+static void concurrent_ready_and_end(void) {
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    assert(pthread_create(&threads[i], NULL, worker, (void*)(intptr_t)i) == 0);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  // Everything that became ready has ended.
+  assert(ms_pick_next(ENV, 0, 0) == -1);
+}
+
+static void* distinct_worker(void* arg) {
+  int id = (int)(intptr_t)arg;
+  ms_worker_info_t info = {.worker_id = id, .os_pid = 0, .os_tid = ms_gettid(), .name = "test", .flags = 0};
+  ms_register_worker(&info);
+  for (int round = 0; round < DISTINCT_ROUNDS; round++) {
+    uint64_t base = DISTINCT_BASE + ((uint64_t)round * THREADS + (uint64_t)id) * PER_THREAD;
+    for (int i = 0; i < PER_THREAD; i++) {
+      ms_on_reaction_ready(DISTINCT_ENV, base + (uint64_t)i, 0, (long long)i, 0);
+    }
+    for (int i = 0; i < PER_THREAD; i++) {
+      ms_on_reaction_start(DISTINCT_ENV, id, base + (uint64_t)i, 0);
+      ms_on_reaction_end(DISTINCT_ENV, id, base + (uint64_t)i, 0, 0);
+    }
+  }
+  return NULL;
+}
+
+static void distinct_keys_beyond_index(void) {
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    assert(pthread_create(&threads[i], NULL, distinct_worker, (void*)(intptr_t)i) == 0);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(ms_pick_next(DISTINCT_ENV, 0, 0) == -1);
+  // Keys of reactions that left the ready set were retired, so new ones still fit.
+  for (uint64_t key = 1; key <= 100; key++) {
+    ms_on_reaction_ready(DISTINCT_ENV, key, 0, (long long)key, 0);
+  }
+  for (uint64_t key = 1; key <= 100; key++) {
+    assert(ms_pick_next(DISTINCT_ENV, 0, 0) == (long long)key);
+    ms_on_reaction_start(DISTINCT_ENV, 0, key, 0);
+    ms_on_reaction_end(DISTINCT_ENV, 0, key, 0, 0);
+  }
+  assert(ms_pick_next(DISTINCT_ENV, 0, 0) == -1);
+}
+
+int main(void) {
+  setenv("LF_MS_LOG", "/dev/null", 1);
+  setenv("LF_MS_LOG_LEVEL", "ERROR", 1);
+  setenv("LF_MS_HC_STRICT_PRIORITY", "1", 1);
+  setenv("LF_MS_DEGRADE_ENABLE", "1", 1);
+  setenv("LF_MS_STATS", "1", 1);
+  char config_path[] = "/tmp/lf_ms_config_test_XXXXXX";
+  int fd = mkstemp(config_path);
+  assert(fd >= 0);
+  close(fd);
+  write_config(config_path);
+  assert(ms_init(config_path));
+  pick_earliest_deadline();
+  configured_criticality();
+  concurrent_ready_and_end();
+  chain_accounting();
+  // Last, because its keys also fill the execution-time stats table.
+  distinct_keys_beyond_index();
+  ms_shutdown();
+  remove(config_path);
+  return 0;
+}
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "pqueue_base.h"
+#include "pqueue_calendar.h"
+
+#define RANDOM_SEED 1830
+#define MAX_ELEMENTS 3000
+#define OPERATIONS 100000
+
+typedef struct {
+  pqueue_tag_element_t base;
+  int trigger;
+} test_element_t;
+
+static test_element_t elements[MAX_ELEMENTS];
+
+// Reference: the elements that are in the queue, in no particular order.
+static test_element_t* reference[MAX_ELEMENTS];
+static size_t reference_size = 0;
+
+static int same_trigger(void* element1, void* element2) {
+  return ((test_element_t*)element1)->trigger == ((test_element_t*)element2)->trigger;
+}
+
+static void print_element(void* element) {
+  test_element_t* e = (test_element_t*)element;
+  printf("(%lld, %u) trigger %d\n", (long long)e->base.tag.time, e->base.tag.microstep, e->trigger);
+}
+
+static tag_t reference_least_tag(void) {
+  tag_t least = FOREVER_TAG;
+  for (size_t i = 0; i < reference_size; i++) {
+    if (lf_tag_compare(reference[i]->base.tag, least) < 0)
+      least = reference[i]->base.tag;
+  }
+  return least;
+}
+
+static void reference_take(size_t i) { reference[i] = reference[--reference_size]; }
+
+/** Remove the specified element, which must be there, from the reference. */
+static void reference_remove(pqueue_tag_element_t* e) {
+  for (size_t i = 0; i < reference_size; i++) {
+    if (&reference[i]->base == e) {
+      reference_take(i);
+      return;
+    }
+  }
+  assert(false);
+}
+
+static tag_t random_tag(instant_t base) {
+  tag_t t = {.time = base, .microstep = (microstep_t)(rand() % 3)};
+  switch (rand() % 10) {
+  case 0: // Far beyond a year of days.
+    t.time += SEC(1000) + (instant_t)(rand() % 1000) * MSEC(1);
+    break;
+  case 1: // Before the earliest element.
+    t.time -= (instant_t)(rand() % 100) * USEC(1);
+    break;
+  case 2: // The same time as others.
+    break;
+  default: // Spread evenly.
+    t.time += (instant_t)(rand() % 1000) * USEC(10);
+    break;
+  }
+  if (rand() % 500 == 0)
+    t = FOREVER_TAG;
+  return t;
+}
+
+/** Compare the calendar queue against the reference under random inserts, pops and removals. */
+static void random_operations(void) {
+  pqueue_calendar_t* q = pqueue_calendar_init(1, same_trigger, print_element);
+  assert(q != NULL);
+  size_t free_count = MAX_ELEMENTS;
+  test_element_t* unused[MAX_ELEMENTS];
+  for (size_t i = 0; i < MAX_ELEMENTS; i++) {
+    unused[i] = &elements[i];
+  }
+  instant_t time = 0;
+  for (int i = 0; i < OPERATIONS; i++) {
+    // Grow the queue for the first half and shrink it for the second.
+    int grow = i < OPERATIONS / 2 ? 60 : 40;
+    int choice = rand() % 100;
+    if (free_count > 0 && (choice < grow || reference_size == 0)) {
+      test_element_t* e = unused[--free_count];
+      e->base.tag = random_tag(time);
+      e->trigger = rand() % 4;
+      assert(pqueue_calendar_insert(q, &e->base) == 0);
+      reference[reference_size++] = e;
+    } else if (choice < 90 || reference_size == 0) {
+      tag_t least = reference_least_tag();
+      pqueue_tag_element_t* head = pqueue_calendar_peek(q);
+      assert(lf_tag_compare(head->tag, least) == 0);
+      assert(pqueue_calendar_pop(q) == head);
+      reference_remove(head);
+      unused[free_count++] = (test_element_t*)head;
+      if (least.time != FOREVER)
+        time = least.time;
+    } else {
+      size_t victim = (size_t)rand() % reference_size;
+      test_element_t* e = reference[victim];
+      assert(pqueue_calendar_find_same_tag(q, e->base.tag) != NULL);
+      assert(lf_tag_compare(pqueue_calendar_find_same_tag(q, e->base.tag)->tag, e->base.tag) == 0);
+      pqueue_tag_element_t* match = pqueue_calendar_find_equal_same_tag(q, &e->base);
+      assert(match != NULL && ((test_element_t*)match)->trigger == e->trigger);
+      pqueue_calendar_remove(q, &e->base);
+      reference_take(victim);
+      unused[free_count++] = e;
+    }
+    assert(pqueue_calendar_size(q) == reference_size);
+  }
+
+  // All remaining elements are listed once.
+  pqueue_tag_element_t* listed[MAX_ELEMENTS];
+  pqueue_calendar_elements(q, listed);
+  for (size_t i = 0; i < reference_size; i++) {
+    size_t count = 0;
+    for (size_t j = 0; j < reference_size; j++) {
+      if (listed[j] == &reference[i]->base)
+        count++;
+    }
+    assert(count == 1);
+  }
+  while (reference_size > 0) {
+    tag_t least = reference_least_tag();
+    pqueue_tag_element_t* head = pqueue_calendar_pop(q);
+    assert(lf_tag_compare(head->tag, least) == 0);
+    reference_remove(head);
+  }
+  assert(pqueue_calendar_pop(q) == NULL);
+  assert(pqueue_calendar_peek(q) == NULL);
+  tag_t missing = {.time = 0, .microstep = 0};
+  assert(pqueue_calendar_find_same_tag(q, missing) == NULL);
+  pqueue_calendar_free(q);
+}
+
+/** Check that dynamic elements are freed with the queue. Run with a leak checker to see the effect. */
+static void free_dynamic(void) {
+  pqueue_calendar_t* q = pqueue_calendar_init(4, same_trigger, print_element);
+  for (int i = 0; i < 100; i++) {
+    pqueue_tag_element_t* e = (pqueue_tag_element_t*)calloc(1, sizeof(pqueue_tag_element_t));
+    e->tag.time = (instant_t)(rand() % 100) * MSEC(1);
+    e->is_dynamic = 1;
+    pqueue_calendar_insert(q, e);
+  }
+  pqueue_calendar_dump(q);
+  pqueue_calendar_free(q);
+}
+
+//////////////////
+// Differential check against the binary heap.
+
+static pqueue_pri_t get_priority(void* element) { return (pqueue_pri_t)(uintptr_t)element; }
+static size_t get_position(void* element) { return ((pqueue_tag_element_t*)element)->pos; }
+static void set_position(void* element, size_t pos) { ((pqueue_tag_element_t*)element)->pos = pos; }
+
+static const interval_t periods[] = {MSEC(1), MSEC(2), MSEC(5), MSEC(10), MSEC(20), MSEC(50), MSEC(100)};
+#define PERIOD_COUNT (sizeof(periods) / sizeof(periods[0]))
+
+static void hold_setup(pqueue_tag_element_t* events) {
+  srand(RANDOM_SEED);
+  for (size_t i = 0; i < MAX_ELEMENTS; i++) {
+    interval_t period = periods[i % PERIOD_COUNT];
+    events[i].tag.time = (instant_t)(rand() % 1000) * (period / 1000);
+    events[i].tag.microstep = 0;
+    events[i].is_dynamic = 0;
+  }
+}
+
+/**
+ * Repeatedly pop the earliest event from the binary heap and the calendar queue
+ * and reschedule it one period later. Both must pop the same sequence of tags.
+ * Events with the same tag may come out in a different order, but all of them
+ * are popped before any later tag, so the sequences do not diverge.
+ */
+static void hold_matches_heap(void) {
+  static pqueue_tag_element_t heap_events[MAX_ELEMENTS];
+  static pqueue_tag_element_t calendar_events[MAX_ELEMENTS];
+  hold_setup(heap_events);
+  hold_setup(calendar_events);
+  pqueue_t* heap = pqueue_init(MAX_ELEMENTS, pqueue_tag_compare, get_priority, get_position, set_position,
+                               same_trigger, print_element);
+  pqueue_calendar_t* calendar = pqueue_calendar_init(MAX_ELEMENTS, same_trigger, print_element);
+  for (size_t i = 0; i < MAX_ELEMENTS; i++) {
+    pqueue_insert(heap, &heap_events[i]);
+    pqueue_calendar_insert(calendar, &calendar_events[i]);
+  }
+  instant_t last = NEVER;
+  for (int i = 0; i < OPERATIONS; i++) {
+    pqueue_tag_element_t* h = (pqueue_tag_element_t*)pqueue_pop(heap);
+    pqueue_tag_element_t* c = pqueue_calendar_pop(calendar);
+    assert(lf_tag_compare(h->tag, c->tag) == 0);
+    assert(h->tag.time >= last);
+    last = h->tag.time;
+    h->tag.time += periods[(size_t)(h - heap_events) % PERIOD_COUNT];
+    c->tag.time += periods[(size_t)(c - calendar_events) % PERIOD_COUNT];
+    pqueue_insert(heap, h);
+    pqueue_calendar_insert(calendar, c);
+  }
+  pqueue_free(heap);
+  pqueue_calendar_free(calendar);
+}
+
+int main() {
+  srand(RANDOM_SEED);
+  random_operations();
+  free_dynamic();
+  hold_matches_heap();
+  return 0;
+}
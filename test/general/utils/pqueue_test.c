@@ -1,17 +1,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 #include "pqueue_tag.h"
 #include "tag.h"
+#include "vector.h"
+
+// Callbacks for a binary heap of pqueue_tag_element_t, which pqueue_tag.h no longer uses.
+static pqueue_pri_t get_priority(void* element) { return (pqueue_pri_t)(uintptr_t)element; }
+static size_t get_position(void* element) { return ((pqueue_tag_element_t*)element)->pos; }
+static void set_position(void* element, size_t pos) { ((pqueue_tag_element_t*)element)->pos = pos; }
+static int same_tag(void* element1, void* element2) {
+  return lf_tag_compare(((pqueue_tag_element_t*)element1)->tag, ((pqueue_tag_element_t*)element2)->tag) == 0;
+}
+static void print_element(void* element) {
+  printf("Element with time %lld.\n", (long long)((pqueue_tag_element_t*)element)->tag.time);
+}
+
+static pqueue_t* binary_heap_init(size_t initial_size) {
+  return pqueue_init(initial_size, pqueue_tag_compare, get_priority, get_position, set_position, same_tag,
+                     print_element);
+}
 
 static void trivial(void) {
   // Create an event queue.
   pqueue_tag_t* q = pqueue_tag_init(1);
   assert(q != NULL);
-  assert(pqueue_is_valid((pqueue_t*)q));
-  pqueue_print((pqueue_t*)q, NULL);
   pqueue_tag_free(q);
+  pqueue_t* heap = binary_heap_init(1);
+  assert(pqueue_is_valid(heap));
+  pqueue_print(heap, NULL);
+  pqueue_free(heap);
 }
 
 static void insert_on_queue(pqueue_tag_t* q) {
@@ -27,7 +47,7 @@ static void insert_on_queue(pqueue_tag_t* q) {
   assert(pqueue_tag_insert_if_no_match(q, t1));
   assert(pqueue_tag_insert_if_no_match(q, t4));
   printf("======== Contents of the queue:\n");
-  pqueue_print((pqueue_t*)q, NULL);
+  pqueue_tag_dump(q);
   assert(pqueue_tag_size(q) == 4);
 }
 
@@ -84,6 +104,63 @@ static void remove_from_queue(pqueue_tag_t* q, pqueue_tag_element_t* e1, pqueue_
   assert(pqueue_tag_size(q) == 1);
 }
 
+static void pop_all_with_tag(int distinct_times) {
+  // Few distinct times make long runs of equal tags, which the heap pops by rebuilding itself.
+  pqueue_tag_t* q = pqueue_tag_init(16);
+  size_t counts[16] = {0};
+  for (int i = 0; i < 1000; i++) {
+    int index = rand() % distinct_times;
+    counts[index]++;
+    tag_t t = {.time = USEC(index / 2), .microstep = index % 2};
+    assert(!pqueue_tag_insert_tag(q, t));
+  }
+  vector_t popped = vector_new(4);
+  tag_t earlier = NEVER_TAG;
+  for (int index = 0; index < distinct_times; index++) {
+    if (counts[index] == 0)
+      continue;
+    tag_t t = {.time = USEC(index / 2), .microstep = index % 2};
+    assert(lf_tag_compare(pqueue_tag_peek_tag(q), t) == 0);
+    // Nothing happens unless the least tag is the one asked for.
+    assert(pqueue_tag_pop_all_with_tag(q, earlier, &popped) == 0);
+    assert(pqueue_tag_pop_all_with_tag(q, t, &popped) == counts[index]);
+    assert(vector_size(&popped) == counts[index]);
+    pqueue_tag_element_t* e;
+    while ((e = (pqueue_tag_element_t*)vector_pop(&popped)) != NULL) {
+      assert(lf_tag_compare(e->tag, t) == 0);
+      free(e);
+    }
+    earlier = t;
+  }
+  assert(pqueue_tag_size(q) == 0);
+  vector_free(&popped);
+  pqueue_tag_free(q);
+}
+
+static void replace_in_queue(void) {
+  pqueue_t* q = binary_heap_init(2);
+  pqueue_tag_element_t e2 = {.tag = {.time = USEC(2), .microstep = 0}, .pos = 0, .is_dynamic = 0};
+  pqueue_tag_element_t e3 = {.tag = {.time = USEC(5), .microstep = 0}, .pos = 0, .is_dynamic = 0};
+  pqueue_tag_element_t e4 = {.tag = {.time = USEC(4), .microstep = 0}, .pos = 0, .is_dynamic = 0};
+  pqueue_tag_element_t e5 = {.tag = {.time = USEC(6), .microstep = 0}, .pos = 0, .is_dynamic = 0};
+  pqueue_tag_element_t e6 = {.tag = {.time = USEC(1), .microstep = 0}, .pos = 0, .is_dynamic = 0};
+  assert(pqueue_insert(q, &e2) == 0);
+  assert(pqueue_insert(q, &e3) == 0);
+  assert(pqueue_insert(q, &e4) == 0);
+  // Replacing the head with a later entry moves it down.
+  void* head = pqueue_peek(q);
+  pqueue_replace(q, head, &e5);
+  assert(pqueue_peek(q) == &e4);
+  // Replacing an entry with an earlier one moves it up.
+  pqueue_replace(q, &e3, &e6);
+  assert(pqueue_is_valid(q));
+  assert(pqueue_size(q) == 3);
+  assert(pqueue_pop(q) == &e6);
+  assert(pqueue_pop(q) == &e4);
+  assert(pqueue_pop(q) == &e5);
+  pqueue_free(q);
+}
+
 int main() {
   trivial();
   // Create an event queue.
@@ -99,6 +176,9 @@ int main() {
   pqueue_tag_element_t e2 = {.tag = {.time = USEC(2), .microstep = 0}, .pos = 0, .is_dynamic = 0};
 
   remove_from_queue(q, &e1, &e2);
+  pop_all_with_tag(16);
+  pop_all_with_tag(3);
+  replace_in_queue();
 
   pqueue_tag_free(q);
 }
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "environment.h"
+#include "reactor_common.h"
+#include "timer_group.h"
+
+// Reactions are put on the reaction queue of the environment only without workers,
+// so Tests.cmake builds this test only for the single-threaded runtime.
+
+extern environment_t _env; // Defined in src_gen_stub.c.
+
+// The runtime of reactor.c calls this code-generated function.
+void lf_create_environments(void) {}
+
+#define TIMERS 5
+
+static trigger_t timers[TIMERS];
+static reaction_t reactions[TIMERS];
+static reaction_t* reaction_lists[TIMERS];
+
+static void init_timer(int i, interval_t offset, interval_t period) {
+  reactions[i].name = "timer_group_test";
+  reactions[i].index = (index_t)i;
+  reactions[i].status = inactive;
+  reaction_lists[i] = &reactions[i];
+  timers[i].reactions = &reaction_lists[i];
+  timers[i].number_of_reactions = 1;
+  timers[i].is_timer = true;
+  timers[i].offset = offset;
+  timers[i].period = period;
+  _env.timer_triggers[i] = &timers[i];
+}
+
+static size_t count_groups(void) {
+  size_t count = 0;
+  for (timer_group_t* group = _env.timer_groups; group != NULL; group = group->next) {
+    count++;
+  }
+  return count;
+}
+
+/** Advance to the next tag on the event queue, fire its timers, and return which timers fired as a bit mask. */
+static unsigned step(void) {
+  pqueue_tag_element_t* next = pqueue_tag_peek(_env.event_q);
+  assert(next != NULL);
+  _env.current_tag = next->tag;
+  _lf_pop_events(&_env);
+  unsigned fired = 0;
+  reaction_t* reaction;
+  while ((reaction = (reaction_t*)reaction_heap_pop(&_env.reaction_q)) != NULL) {
+    assert(timers[reaction->index].status == present);
+    fired |= 1u << reaction->index;
+    reaction->status = inactive;
+    timers[reaction->index].status = absent;
+  }
+  return fired;
+}
+
+static void test_coalescing(void) {
+  environment_init(&_env, "timer_group_test", 0, 1, TIMERS, 0, 0, 0, 0, 0, 0, 0, NULL);
+  _env.current_tag = (tag_t){.time = 0, .microstep = 0};
+  _env.stop_tag = (tag_t){.time = MSEC(40), .microstep = 0};
+  init_timer(0, 0, MSEC(10));
+  init_timer(1, 0, MSEC(10));
+  init_timer(2, MSEC(20), MSEC(10)); // Joins timers 0 and 1 after its first firing.
+  init_timer(3, 0, MSEC(5));
+  init_timer(4, MSEC(3), 0); // Not periodic, so not grouped.
+
+  // Timers with offset 0 fire at the start tag.
+  assert(_lf_initialize_timers(&_env));
+  assert(reaction_heap_size(&_env.reaction_q) == 3);
+  while (reaction_heap_pop(&_env.reaction_q) != NULL)
+    ;
+  for (int i = 0; i < TIMERS; i++) {
+    reactions[i].status = inactive;
+  }
+  // One event for each of the three groups and one for timer 4.
+  assert(count_groups() == 3);
+  assert(pqueue_tag_size(_env.event_q) == 4);
+
+  assert(step() == 1u << 4);
+  assert(lf_tag_compare(_env.current_tag, (tag_t){.time = MSEC(3), .microstep = 0}) == 0);
+  assert(step() == 1u << 3);
+
+  // At 10 msec, the group of timers 0 and 1 is rescheduled for the tag at which the
+  // group of timer 2 fires first and merges into it.
+  assert(step() == (1u << 0 | 1u << 1 | 1u << 3));
+  assert(count_groups() == 2);
+  assert(pqueue_tag_size(_env.event_q) == 2);
+  assert(step() == 1u << 3);
+  assert(step() == 0x0f);
+  assert(step() == 1u << 3);
+  assert(step() == 0x0f);
+  assert(step() == 1u << 3);
+
+  // Nothing is scheduled after the stop tag.
+  assert(step() == 0x0f);
+  assert(lf_tag_compare(_env.current_tag, _env.stop_tag) == 0);
+  assert(pqueue_tag_size(_env.event_q) == 0);
+
+  environment_free(&_env);
+}
+
+int main(void) {
+  test_coalescing();
+  return 0;
+}
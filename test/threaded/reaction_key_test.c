@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "lf_types.h"
+#include "environment.h"
+#include "reaction_key.h"
+
+// More insertions than the key table has slots, which is at least 1024.
+#define REINSERTIONS 4096
+
+static self_base_t main_self = {.name = "main"};
+static self_base_t sub_self = {.name = "sub", .parent = &main_self};
+// Another instance under the same full name, as two programs' reactors would be.
+static self_base_t twin_self = {.name = "main"};
+
+static reaction_t first = {.self = &main_self, .number = 0};
+static reaction_t second = {.self = &sub_self, .number = 0};
+static reaction_t twin = {.self = &twin_self, .number = 0};
+static reaction_t late = {.self = &sub_self, .number = 1};
+
+static void keys_of_startup_reactions(void) {
+  static environment_t env;
+  static reaction_t* startup[] = {&first, &second, &twin};
+  env.startup_reactions = startup;
+  env.startup_reactions_size = 3;
+  lf_reaction_keys_init(&env, 1);
+
+  assert(first.stable_key != 0 && first.stable_key == twin.stable_key);
+  assert(second.stable_key != 0 && second.stable_key != first.stable_key);
+  assert(lf_reaction_find_by_key(second.stable_key) == &second);
+  // A key that two reactions share finds neither.
+  assert(lf_reaction_find_by_key(first.stable_key) == NULL);
+}
+
+static void reinsertions_take_no_room(void) {
+  for (int i = 0; i < REINSERTIONS; i++) {
+    assert(lf_reaction_compute_stable_key(&second) == second.stable_key);
+  }
+  assert(lf_reaction_find_by_key(second.stable_key) == &second);
+  // A reaction keyed on first use still finds a slot.
+  uint64_t key = lf_reaction_stable_key(&late);
+  assert(key != 0 && key != second.stable_key);
+  assert(lf_reaction_find_by_key(key) == &late);
+}
+
+int main(void) {
+  keys_of_startup_reactions();
+  reinsertions_take_no_room();
+  return 0;
+}
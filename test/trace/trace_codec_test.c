@@ -0,0 +1,212 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "trace_codec.h"
+
+// The default TRACE_BUFFER_CAPACITY: the records of one block.
+#define BLOCK_RECORDS 2048
+#define ENCODED_CAPACITY (BLOCK_RECORDS * TRACE_RECORD_MAX_ENCODED_SIZE)
+// Room for bytes that do not compress: LZ4 adds one byte per 255 literals and a token.
+#define COMPRESSED_CAPACITY (ENCODED_CAPACITY + ENCODED_CAPACITY / 255 + 16)
+// Bytes after the output that decompression must never touch.
+#define CANARY 64
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static trace_record_nodeps_t records[BLOCK_RECORDS];
+static trace_record_nodeps_t decoded[BLOCK_RECORDS];
+static uint8_t encoded[ENCODED_CAPACITY];
+static uint8_t compressed[COMPRESSED_CAPACITY];
+static uint8_t restored[ENCODED_CAPACITY + CANARY];
+
+static bool same_record(const trace_record_nodeps_t* a, const trace_record_nodeps_t* b) {
+  return a->event_type == b->event_type && a->pointer == b->pointer && a->src_id == b->src_id &&
+         a->dst_id == b->dst_id && a->logical_time == b->logical_time && a->microstep == b->microstep &&
+         a->physical_time == b->physical_time && a->trigger == b->trigger && a->extra_delay == b->extra_delay;
+}
+
+/**
+ * Decode a block as the trace readers do: decompress it if it is smaller than the
+ * encoded records, then decode exactly 'count' records.
+ * @return 0 if the block is intact, -1 if it is rejected.
+ */
+static int read_block(const uint8_t* stored, size_t stored_size, size_t encoded_size, size_t count) {
+  const uint8_t* input = stored;
+  if (stored_size < encoded_size) {
+    memset(restored, 0xA5, sizeof(restored));
+    int64_t size = lf_trace_decompress(stored, stored_size, restored, encoded_size);
+    for (size_t i = encoded_size; i < encoded_size + CANARY; i++) {
+      assert(restored[i] == 0xA5);
+    }
+    if (size != (int64_t)encoded_size)
+      return -1;
+    input = restored;
+  }
+  return lf_trace_decode_records(input, encoded_size, decoded, count);
+}
+
+/**
+ * Write 'count' records as a block and read them back.
+ * @return The stored size of the block.
+ */
+static size_t round_trip_records(size_t count) {
+  size_t encoded_size = lf_trace_encode_records(records, count, encoded);
+  assert(encoded_size <= count * TRACE_RECORD_MAX_ENCODED_SIZE);
+  // As the writer does: keep the compressed form only if it is smaller.
+  const uint8_t* stored = compressed;
+  size_t stored_size = encoded_size == 0 ? 0 : lf_trace_compress(encoded, encoded_size, compressed, encoded_size - 1);
+  if (stored_size == 0) {
+    stored = encoded;
+    stored_size = encoded_size;
+  }
+  assert(read_block(stored, stored_size, encoded_size, count) == 0);
+  for (size_t i = 0; i < count; i++) {
+    assert(same_record(&records[i], &decoded[i]));
+  }
+  return stored_size;
+}
+
+/** Compress and decompress 'size' bytes of 'input' with enough room for any input. */
+static void round_trip_bytes(const uint8_t* input, size_t size) {
+  size_t compressed_size = lf_trace_compress(input, size, compressed, size + size / 255 + 16);
+  assert(compressed_size > 0);
+  memset(restored, 0xA5, sizeof(restored));
+  assert(lf_trace_decompress(compressed, compressed_size, restored, size) == (int64_t)size);
+  assert(memcmp(restored, input, size) == 0);
+  assert(restored[size] == 0xA5);
+  // One byte less room is not enough.
+  if (size > 0)
+    assert(lf_trace_decompress(compressed, compressed_size, restored, size - 1) == -1);
+}
+
+static void random_records(void) {
+  for (size_t i = 0; i < BLOCK_RECORDS; i++) {
+    trace_record_nodeps_t* r = &records[i];
+    r->event_type = (int)(next_random() % 64);
+    r->pointer = (void*)(uintptr_t)next_random();
+    r->src_id = (int)next_random();
+    r->dst_id = (int)next_random();
+    r->logical_time = (int64_t)next_random();
+    r->microstep = (int64_t)next_random();
+    r->physical_time = (int64_t)next_random();
+    r->trigger = (void*)(uintptr_t)next_random();
+    r->extra_delay = (int64_t)next_random();
+  }
+  // Extremes of every field.
+  records[0].logical_time = INT64_MIN;
+  records[1].logical_time = INT64_MAX;
+  records[2].src_id = -1;
+  records[2].dst_id = (int)0x80000000u;
+  records[3].extra_delay = INT64_MIN;
+  // Random records do not compress and are stored as they are.
+  assert(round_trip_records(BLOCK_RECORDS) == lf_trace_encode_records(records, BLOCK_RECORDS, encoded));
+  round_trip_records(1);
+  round_trip_records(0);
+}
+
+static void repetitive_records(void) {
+  // As a reactor that runs periodically: the same events, a steady clock.
+  for (size_t i = 0; i < BLOCK_RECORDS; i++) {
+    trace_record_nodeps_t* r = &records[i];
+    memset(r, 0, sizeof(*r));
+    r->event_type = (int)(i % 2);
+    r->pointer = (void*)(uintptr_t)0x7ff0001000;
+    r->dst_id = 3;
+    r->logical_time = (int64_t)(i / 2) * 1000000;
+    r->physical_time = r->logical_time + 1234;
+    r->trigger = (void*)(uintptr_t)0x7ff0002000;
+  }
+  size_t encoded_size = lf_trace_encode_records(records, BLOCK_RECORDS, encoded);
+  size_t stored_size = round_trip_records(BLOCK_RECORDS);
+  assert(stored_size < encoded_size / 4);
+}
+
+static void byte_boundaries(void) {
+  static uint8_t input[70000];
+  // Sizes around the last-literals and match limits, the 15 and 15 + 255 length
+  // nibbles, and the largest match offset.
+  const size_t sizes[] = {0,  1,   4,   5,   11,  12,  13,    14,    15,    16,
+                          17, 19,  20,  269, 270, 271, 272,   65535, 65536, 65537, 70000};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t size = sizes[s];
+    for (size_t i = 0; i < size; i++) {
+      input[i] = (uint8_t)next_random();
+    }
+    round_trip_bytes(input, size);
+    memset(input, 'x', size);
+    round_trip_bytes(input, size);
+    for (size_t i = 0; i < size; i++) {
+      input[i] = (uint8_t)"abcdefg"[i % 7];
+    }
+    round_trip_bytes(input, size);
+  }
+  // A match exactly LZ_MAX_OFFSET back, and one just beyond.
+  for (size_t i = 0; i < sizeof(input); i++) {
+    input[i] = (uint8_t)next_random();
+  }
+  memcpy(input + 65535 + 100, input + 100, 64);
+  memcpy(input + 65536 + 300, input + 300, 64);
+  round_trip_bytes(input, sizeof(input));
+}
+
+static void rejects_truncated_and_corrupt(void) {
+  // Truncated encoded records, and encoded records with bytes to spare.
+  repetitive_records();
+  size_t encoded_size = lf_trace_encode_records(records, 100, encoded);
+  for (size_t size = 0; size < encoded_size; size++) {
+    assert(read_block(encoded, size, size, 100) == -1);
+  }
+  encoded[encoded_size] = 0;
+  assert(read_block(encoded, encoded_size + 1, encoded_size + 1, 100) == -1);
+  // A varint longer than 64 bits.
+  memset(encoded, 0x80, 16);
+  assert(lf_trace_decode_records(encoded, 16, decoded, 1) == -1);
+
+  // Truncated compressed blocks.
+  encoded_size = lf_trace_encode_records(records, BLOCK_RECORDS, encoded);
+  size_t stored_size = lf_trace_compress(encoded, encoded_size, compressed, encoded_size - 1);
+  assert(stored_size > 0);
+  for (size_t size = 0; size < stored_size; size++) {
+    assert(read_block(compressed, size, encoded_size, BLOCK_RECORDS) == -1);
+  }
+
+  // Hand-made corruptions of the LZ4 format.
+  uint8_t before_start[] = {0x10, 'a', 0x02, 0x00, 0x00}; // A match two bytes back after one byte.
+  assert(lf_trace_decompress(before_start, sizeof(before_start), restored, 100) == -1);
+  uint8_t zero_offset[] = {0x10, 'a', 0x00, 0x00, 0x00};
+  assert(lf_trace_decompress(zero_offset, sizeof(zero_offset), restored, 100) == -1);
+  uint8_t long_literals[] = {0xF0, 0xFF, 0xFF, 0x10, 'a'}; // 541 literals, of which one is present.
+  assert(lf_trace_decompress(long_literals, sizeof(long_literals), restored, sizeof(restored)) == -1);
+  uint8_t unterminated_length[] = {0xF0, 0xFF};
+  assert(lf_trace_decompress(unterminated_length, sizeof(unterminated_length), restored, 100) == -1);
+  uint8_t half_offset[] = {0x10, 'a', 0x01};
+  assert(lf_trace_decompress(half_offset, sizeof(half_offset), restored, 100) == -1);
+
+  // Random corruption is either rejected or decodes within bounds.
+  for (int trial = 0; trial < 2000; trial++) {
+    static uint8_t damaged[COMPRESSED_CAPACITY];
+    memcpy(damaged, compressed, stored_size);
+    for (int flips = 1 + (int)(next_random() % 4); flips > 0; flips--) {
+      damaged[next_random() % stored_size] ^= (uint8_t)(1 + next_random() % 255);
+    }
+    read_block(damaged, stored_size, encoded_size, BLOCK_RECORDS);
+  }
+}
+
+int main(void) {
+  random_records();
+  repetitive_records();
+  byte_boundaries();
+  rejects_truncated_and_corrupt();
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "lf_types.h"
+#include "tracepoint.h"
+
+static void configure(const char* events, const char* sample, const char* reactors) {
+  unsetenv("LF_TRACE_EVENTS");
+  unsetenv("LF_TRACE_SAMPLE");
+  unsetenv("LF_TRACE_REACTORS");
+  if (events != NULL)
+    setenv("LF_TRACE_EVENTS", events, 1);
+  if (sample != NULL)
+    setenv("LF_TRACE_SAMPLE", sample, 1);
+  if (reactors != NULL)
+    setenv("LF_TRACE_REACTORS", reactors, 1);
+  lf_tracing_filter_init();
+}
+
+static void test_events(void) {
+  configure(NULL, NULL, NULL);
+  for (int i = 0; i < NUM_EVENT_TYPES; i++) {
+    assert(_lf_trace_event_filter[i] == LF_TRACE_KEEP);
+  }
+  // Names as in the trace, in any case and with underscores, or numbers.
+  configure("reaction_starts,Reaction ends,7", NULL, NULL);
+  assert(_lf_trace_event_filter[reaction_starts] == LF_TRACE_KEEP);
+  assert(_lf_trace_event_filter[reaction_ends] == LF_TRACE_KEEP);
+  assert(_lf_trace_event_filter[worker_wait_ends] == LF_TRACE_KEEP);
+  assert(_lf_trace_event_filter[schedule_called] == LF_TRACE_DROP);
+  assert(_lf_trace_event_filter[receive_TAG] == LF_TRACE_DROP);
+  // Leaving out types keeps the others.
+  configure("-schedule_called,-worker-wait-STARTS,-bogus", NULL, NULL);
+  assert(_lf_trace_event_filter[schedule_called] == LF_TRACE_DROP);
+  assert(_lf_trace_event_filter[worker_wait_starts] == LF_TRACE_DROP);
+  assert(_lf_trace_event_filter[worker_wait_ends] == LF_TRACE_KEEP);
+  assert(_lf_trace_event_filter[reaction_starts] == LF_TRACE_KEEP);
+}
+
+static void test_sampling(void) {
+  configure(NULL, "reaction_starts=3,schedule_called=2", NULL);
+  assert(_lf_trace_event_filter[reaction_starts] == LF_TRACE_CHECK);
+  assert(_lf_trace_event_filter[reaction_ends] == LF_TRACE_CHECK);
+  assert(_lf_trace_event_filter[schedule_called] == LF_TRACE_CHECK);
+  assert(_lf_trace_event_filter[worker_wait_starts] == LF_TRACE_KEEP);
+  // Ends follow their starts.
+  bool expected[] = {true, false, false, true, false, false, true};
+  for (int i = 0; i < 7; i++) {
+    assert(_lf_trace_filter_admits(reaction_starts, NULL, 0) == expected[i]);
+    assert(_lf_trace_filter_admits(reaction_ends, NULL, 0) == expected[i]);
+    assert(_lf_trace_filter_admits(schedule_called, NULL, 0) == (i % 2 == 0));
+  }
+  // Intervals nest, e.g. a chain of reactions inside a reaction, and each end
+  // follows its own start. The 8th and 9th starts are skipped, the 10th is traced.
+  assert(!_lf_trace_filter_admits(reaction_starts, NULL, 0));
+  assert(!_lf_trace_filter_admits(reaction_starts, NULL, 0));
+  assert(_lf_trace_filter_admits(reaction_starts, NULL, 0));
+  assert(_lf_trace_filter_admits(reaction_ends, NULL, 0));
+  assert(!_lf_trace_filter_admits(reaction_ends, NULL, 0));
+  assert(!_lf_trace_filter_admits(reaction_ends, NULL, 0));
+  // The 11th and 12th are skipped, the 13th is traced and the 14th, nested in it, is not.
+  for (int i = 0; i < 2; i++) {
+    assert(!_lf_trace_filter_admits(reaction_starts, NULL, 0));
+    assert(!_lf_trace_filter_admits(reaction_ends, NULL, 0));
+  }
+  assert(_lf_trace_filter_admits(reaction_starts, NULL, 0));
+  assert(!_lf_trace_filter_admits(reaction_starts, NULL, 0));
+  assert(!_lf_trace_filter_admits(reaction_ends, NULL, 0));
+  assert(_lf_trace_filter_admits(reaction_ends, NULL, 0));
+  // An end without a start is not traced.
+  assert(!_lf_trace_filter_admits(reaction_ends, NULL, 0));
+  configure(NULL, "5", NULL);
+  assert(_lf_trace_event_filter[user_event] == LF_TRACE_CHECK);
+  assert(_lf_trace_event_filter[send_TAG] == LF_TRACE_CHECK);
+}
+
+static void test_reactors(void) {
+  configure(NULL, NULL, "Main.a,Main.b.1,Main.b.70");
+  assert(_lf_trace_event_filter[reaction_starts] == LF_TRACE_CHECK);
+  assert(_lf_trace_event_filter[schedule_called] == LF_TRACE_CHECK);
+  assert(_lf_trace_event_filter[worker_wait_starts] == LF_TRACE_KEEP);
+  self_base_t a = {0}, contained = {0}, bank = {0}, other = {0}, b = {0};
+  _lf_register_trace_event(&a, NULL, trace_reactor, "Main.a");
+  _lf_register_trace_event(&contained, NULL, trace_reactor, "Main.a.c");
+  _lf_register_trace_event(&bank, NULL, trace_reactor, "Main.a[1]");
+  _lf_register_trace_event(&other, NULL, trace_reactor, "Main.ab");
+  _lf_register_trace_event(&b, NULL, trace_reactor, "Main.b");
+  assert(a.trace_excluded_reactions == 0);
+  assert(contained.trace_excluded_reactions == 0);
+  assert(bank.trace_excluded_reactions == 0);
+  assert(other.trace_excluded_reactions == UINT64_MAX);
+  assert(b.trace_excluded_reactions == ~(((uint64_t)1 << 1) | ((uint64_t)1 << 63)));
+
+  assert(_lf_trace_filter_admits(reaction_starts, &a, 5));
+  assert(!_lf_trace_filter_admits(reaction_starts, &other, 0));
+  assert(!_lf_trace_filter_admits(schedule_called, &other, 0));
+  assert(_lf_trace_filter_admits(reaction_ends, &b, 1));
+  assert(!_lf_trace_filter_admits(reaction_ends, &b, 2));
+  assert(_lf_trace_filter_admits(reaction_deadline_missed, &b, 70));
+  assert(_lf_trace_filter_admits(schedule_called, &b, 0));
+}
+
+int main(void) {
+  // Registering trace objects needs the tracing module.
+  lf_tracing_global_init("trace_filter_test", NULL, 0, 1);
+  test_events();
+  test_sampling();
+  test_reactors();
+  lf_tracing_global_shutdown();
+  remove("trace_filter_test_0.lft");
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "low_level_platform.h"
+#include "trace.h"
+#include "trace_codec.h"
+#include "tracepoint.h"
+
+// Threads not created by LF, which fill the shared trace buffers concurrently.
+#define USER_THREADS 8
+// Enough records for every shared buffer to be filled and recycled many times.
+#define RECORDS_PER_THREAD 20000
+#define TRACE_FILE "trace_shared_test_0.lft"
+
+static bool seen[USER_THREADS][RECORDS_PER_THREAD];
+
+#if !defined(LF_SINGLE_THREADED)
+static void* user_thread(void* arg) {
+  int thread = (int)(intptr_t)arg;
+  assert(lf_thread_id() < 0);
+  for (int i = 0; i < RECORDS_PER_THREAD; i++) {
+    trace_record_nodeps_t record = {.event_type = user_event, .src_id = thread, .dst_id = i, .physical_time = i};
+    lf_tracing_tracepoint(-1, &record);
+  }
+  return NULL;
+}
+
+static void read_exactly(void* out, size_t size, FILE* file) { assert(fread(out, 1, size, file) == size); }
+
+/** Check that the file has each record of the user threads exactly once. */
+static void check_trace_file(void) {
+  FILE* file = fopen(TRACE_FILE, "rb");
+  assert(file != NULL);
+  trace_file_trailer_t trailer;
+  assert(fseek(file, -(long)sizeof(trailer), SEEK_END) == 0);
+  read_exactly(&trailer, sizeof(trailer), file);
+  assert(memcmp(trailer.magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH) == 0);
+
+  // No objects are registered, so the blocks follow the magic, version, start time and table size.
+  assert(fseek(file, TRACE_FILE_MAGIC_LENGTH + sizeof(uint32_t) + sizeof(int64_t) + sizeof(int), SEEK_SET) == 0);
+  size_t total = 0;
+  while (ftell(file) < trailer.index_offset) {
+    trace_block_header_t block;
+    read_exactly(&block, sizeof(block), file);
+    uint8_t* stored = (uint8_t*)malloc(block.stored_size);
+    uint8_t* encoded = (uint8_t*)malloc(block.encoded_size);
+    trace_record_nodeps_t* records = (trace_record_nodeps_t*)malloc(block.record_count * sizeof(*records));
+    assert(stored != NULL && encoded != NULL && records != NULL);
+    read_exactly(stored, block.stored_size, file);
+    const uint8_t* input = stored;
+    if (block.stored_size < block.encoded_size) {
+      assert(lf_trace_decompress(stored, block.stored_size, encoded, block.encoded_size) ==
+             (int64_t)block.encoded_size);
+      input = encoded;
+    }
+    assert(lf_trace_decode_records(input, block.encoded_size, records, block.record_count) == 0);
+    assert(block.worker == -1);
+    for (uint32_t i = 0; i < block.record_count; i++) {
+      int thread = records[i].src_id;
+      int number = records[i].dst_id;
+      assert(records[i].event_type == user_event);
+      assert(thread >= 0 && thread < USER_THREADS && number >= 0 && number < RECORDS_PER_THREAD);
+      assert(!seen[thread][number]);
+      seen[thread][number] = true;
+    }
+    total += block.record_count;
+    free(stored);
+    free(encoded);
+    free(records);
+  }
+  assert(total == (size_t)USER_THREADS * RECORDS_PER_THREAD);
+  fclose(file);
+  remove(TRACE_FILE);
+}
+#endif // !LF_SINGLE_THREADED
+
+int main(void) {
+#if !defined(LF_SINGLE_THREADED)
+  // Periodic flushes close shared buffers early while the threads are filling them.
+  setenv("LF_TRACE_FLUSH_MS", "1", 1);
+  lf_tracing_global_init("trace_shared_test", NULL, 0, 1);
+  lf_tracing_set_start_time(0);
+  lf_thread_t threads[USER_THREADS];
+  for (int i = 0; i < USER_THREADS; i++) {
+    assert(lf_thread_create(&threads[i], user_thread, (void*)(intptr_t)i) == 0);
+  }
+  for (int i = 0; i < USER_THREADS; i++) {
+    assert(lf_thread_join(threads[i], NULL) == 0);
+  }
+  lf_tracing_global_shutdown();
+  check_trace_file();
+#endif
+  return 0;
+}
@@ -0,0 +1,358 @@
+/**
+ * @file workload.c
+ * @brief Synthetic reaction graphs that exercise the runtime without a Lingua Franca program.
+ *
+ * See workload.h.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reaction_key.h"
+#include "scheduler.h"
+#include "tag.h"
+#include "workload.h"
+
+// The deadline in the index of reactions without a deadline, as the code generator assigns it.
+#define NO_DEADLINE_INDEX 0xFFFFFFFFFFFFULL
+
+//////////////////
+// Measurements. The reactions of all workers update them, so they are only touched with atomics.
+
+static interval_t* lag_samples = NULL;
+static size_t lag_capacity = 0;
+static size_t lag_count = 0;
+static interval_t* tag_latency_samples = NULL;
+static size_t tag_latency_count = 0;
+static long long reactions_executed = 0;
+static long long handlers_executed = 0;
+static long long tags_started = 0;
+static instant_t last_tag_time = NEVER;
+static instant_t last_end_time = NEVER;
+
+static uint64_t next_random(uint64_t* state) {
+  // xorshift64*.
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+/** Return a random number in [0, 1). */
+static double next_unit(uint64_t* state) { return (double)(next_random(state) >> 11) / (double)(1ULL << 53); }
+
+static interval_t sample_exec_time(const workload_exec_t* exec, uint64_t* state) {
+  switch (exec->kind) {
+  case WORKLOAD_EXEC_UNIFORM:
+    return exec->a + (interval_t)(next_unit(state) * (double)(exec->b - exec->a));
+  case WORKLOAD_EXEC_EXPONENTIAL: {
+    interval_t t = (interval_t)(-log(1.0 - next_unit(state)) * (double)exec->a);
+    return t < exec->b ? t : exec->b;
+  }
+  default:
+    return exec->a;
+  }
+}
+
+static void atomic_max(instant_t* location, instant_t value) {
+  instant_t seen = __atomic_load_n(location, __ATOMIC_RELAXED);
+  while (seen < value &&
+         !__atomic_compare_exchange_n(location, &seen, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+/** Record the start of a reaction at the given logical time. */
+static void record_start(instant_t logical, instant_t start) {
+  size_t i = __atomic_fetch_add(&lag_count, 1, __ATOMIC_RELAXED);
+  if (i < lag_capacity) {
+    lag_samples[i] = start - logical;
+  }
+  // The first reaction of a tag to get here counts the tag.
+  instant_t seen = __atomic_load_n(&last_tag_time, __ATOMIC_ACQUIRE);
+  if (seen < logical &&
+      __atomic_compare_exchange_n(&last_tag_time, &seen, logical, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    long long tag = __atomic_fetch_add(&tags_started, 1, __ATOMIC_RELAXED);
+    // The previous tag is done, so no reaction updates the end time now.
+    instant_t last_end = __atomic_load_n(&last_end_time, __ATOMIC_RELAXED);
+    if (tag > 0 && last_end != NEVER && (size_t)tag <= lag_capacity) {
+      // A tag is due when the previous one is done and physical time has reached it. In fast mode,
+      // logical time runs ahead of physical time, and only the former counts.
+      instant_t due = (logical <= start && logical > last_end) ? logical : last_end;
+      tag_latency_samples[tag - 1] = start - due;
+    }
+  }
+}
+
+static void workload_reaction(void* self) {
+  workload_node_t* node = (workload_node_t*)self;
+  instant_t logical = lf_time_logical(node->base.environment);
+  instant_t start = lf_time_physical();
+  record_start(logical, start);
+  interval_t exec = sample_exec_time(node->exec, &node->random_state);
+  instant_t end = start;
+  while (end - start < exec) {
+    end = lf_time_physical();
+  }
+  node->output_present = true;
+  __atomic_fetch_add(&reactions_executed, 1, __ATOMIC_RELAXED);
+  atomic_max(&last_end_time, end);
+}
+
+static void workload_deadline_handler(void* self) {
+  workload_node_t* node = (workload_node_t*)self;
+  // Downstream reactions still execute, as they would if the handler forwarded a default value.
+  node->output_present = true;
+  __atomic_fetch_add(&handlers_executed, 1, __ATOMIC_RELAXED);
+  atomic_max(&last_end_time, lf_time_physical());
+}
+
+//////////////////
+// Construction.
+
+workload_t* workload_build(const workload_spec_t* spec) {
+  if (spec->levels < 1 || spec->levels > WORKLOAD_MAX_LEVELS || spec->fan_out < 1 || spec->period <= 0) {
+    return NULL;
+  }
+  size_t size = 0;
+  size_t first[WORKLOAD_MAX_LEVELS + 1];
+  for (int l = 0; l < spec->levels; l++) {
+    if (spec->widths[l] < 1) {
+      return NULL;
+    }
+    first[l] = size;
+    size += (size_t)spec->widths[l];
+  }
+  first[spec->levels] = size;
+
+  workload_t* workload = (workload_t*)calloc(1, sizeof(workload_t));
+  workload_node_t* nodes = (workload_node_t*)calloc(size, sizeof(workload_node_t));
+  reaction_t** timer_reactions = (reaction_t**)calloc((size_t)spec->widths[0], sizeof(reaction_t*));
+  int* in_degree = (int*)calloc(size, sizeof(int));
+  if (workload == NULL || nodes == NULL || timer_reactions == NULL || in_degree == NULL) {
+    free(workload);
+    free(nodes);
+    free(timer_reactions);
+    free(in_degree);
+    return NULL;
+  }
+  workload->spec = *spec;
+  workload->nodes = nodes;
+  workload->size = size;
+  for (int l = 0; l < spec->levels; l++) {
+    workload->reactions_per_level[l] = (size_t)spec->widths[l];
+  }
+
+  uint64_t random_state = spec->seed != 0 ? spec->seed : 1;
+  for (int l = 0; l < spec->levels; l++) {
+    for (int i = 0; i < spec->widths[l]; i++) {
+      workload_node_t* node = &nodes[first[l] + (size_t)i];
+      node->level = l;
+      snprintf(node->name, sizeof(node->name), "r%d_%d", l, i);
+      snprintf(node->full_name, sizeof(node->full_name), "workload.%s", node->name);
+      node->base.name = node->name;
+      node->base.full_name = node->full_name;
+      node->random_state = next_random(&random_state) | 1;
+      node->high_criticality = next_unit(&random_state) < spec->high_criticality_fraction;
+      node->exec = &workload->spec.exec;
+
+      reaction_t* reaction = &node->reaction;
+      reaction->function = workload_reaction;
+      reaction->self = node;
+      reaction->name = node->full_name;
+      reaction->status = inactive;
+      reaction->deadline = NEVER;
+      if (next_unit(&random_state) < spec->deadline_fraction) {
+        reaction->deadline = spec->deadline;
+        reaction->deadline_violation_handler = workload_deadline_handler;
+      }
+      node->output_produced[0] = &node->output_present;
+      reaction->output_produced = node->output_produced;
+    }
+  }
+
+  // Successor k of reaction i is reaction (i + k) mod the width of the next level. Reactions that
+  // would get no predecessor that way get one, so that every reaction executes.
+  for (int l = 0; l + 1 < spec->levels; l++) {
+    int width = spec->widths[l];
+    int next_width = spec->widths[l + 1];
+    int fan_out = spec->fan_out < next_width ? spec->fan_out : next_width;
+    int* count = (int*)calloc((size_t)width, sizeof(int));
+    bool* covered = (bool*)calloc((size_t)next_width, sizeof(bool));
+    for (int i = 0; i < width; i++) {
+      count[i] = fan_out;
+      for (int k = 0; k < fan_out; k++) {
+        covered[(i + k) % next_width] = true;
+      }
+    }
+    for (int j = 0; j < next_width; j++) {
+      if (!covered[j]) {
+        count[j % width]++;
+      }
+    }
+    for (int i = 0; i < width; i++) {
+      workload_node_t* node = &nodes[first[l] + (size_t)i];
+      reaction_t** successors = (reaction_t**)calloc((size_t)count[i], sizeof(reaction_t*));
+      int n = 0;
+      for (int k = 0; k < fan_out; k++) {
+        successors[n++] = &nodes[first[l + 1] + (size_t)((i + k) % next_width)].reaction;
+      }
+      for (int j = i; j < next_width; j += width) {
+        if (!covered[j]) {
+          successors[n++] = &nodes[first[l + 1] + (size_t)j].reaction;
+        }
+      }
+      for (int k = 0; k < n; k++) {
+        workload_node_t* successor = (workload_node_t*)successors[k]->self;
+        in_degree[successor - nodes]++;
+        successors[k]->last_enabling_reaction = &node->reaction;
+      }
+      node->output.reactions = successors;
+      node->output.number_of_reactions = n;
+      node->output.last_tag = NEVER_TAG;
+      node->output_triggers[0] = &node->output;
+      node->triggers[0] = node->output_triggers;
+      node->triggered_sizes[0] = 1;
+      node->reaction.num_outputs = 1;
+      node->reaction.triggers = node->triggers;
+      node->reaction.triggered_sizes = node->triggered_sizes;
+    }
+    free(count);
+    free(covered);
+  }
+
+  // A reaction inherits the earliest deadline downstream, as in code-generated programs.
+  for (int l = spec->levels - 1; l >= 0; l--) {
+    for (size_t n = first[l]; n < first[l + 1]; n++) {
+      reaction_t* reaction = &nodes[n].reaction;
+      index_t deadline = reaction->deadline >= 0 ? (index_t)reaction->deadline : NO_DEADLINE_INDEX;
+      for (int k = 0; k < nodes[n].output.number_of_reactions; k++) {
+        index_t inherited = nodes[n].output.reactions[k]->index >> 16;
+        deadline = inherited < deadline ? inherited : deadline;
+      }
+      reaction->index = (deadline << 16) | (index_t)l;
+      if (in_degree[n] != 1) {
+        reaction->last_enabling_reaction = NULL;
+      }
+    }
+  }
+  free(in_degree);
+
+  for (int i = 0; i < spec->widths[0]; i++) {
+    timer_reactions[i] = &nodes[i].reaction;
+  }
+  workload->timer.reactions = timer_reactions;
+  workload->timer.number_of_reactions = spec->widths[0];
+  workload->timer.is_timer = true;
+  workload->timer.offset = 0;
+  workload->timer.period = spec->period;
+  workload->timer.last_tag = NEVER_TAG;
+  return workload;
+}
+
+void workload_attach(workload_t* workload, environment_t* env, size_t max_samples) {
+  env->timer_triggers[0] = &workload->timer;
+  for (size_t n = 0; n < workload->size; n++) {
+    workload->nodes[n].base.environment = env;
+    env->is_present_fields[n] = &workload->nodes[n].output_present;
+  }
+  sched_params_t params = {.num_reactions_per_level = workload->reactions_per_level,
+                           .num_reactions_per_level_size = (size_t)workload->spec.levels};
+  lf_sched_init(env, (size_t)env->num_workers, &params);
+  free(lag_samples);
+  free(tag_latency_samples);
+  lag_capacity = max_samples;
+  lag_samples = (interval_t*)calloc(max_samples, sizeof(interval_t));
+  tag_latency_samples = (interval_t*)calloc(max_samples, sizeof(interval_t));
+  if (lag_samples == NULL || tag_latency_samples == NULL) {
+    lag_capacity = 0;
+  }
+  lag_count = 0;
+  tag_latency_count = 0;
+  reactions_executed = 0;
+  handlers_executed = 0;
+  tags_started = 0;
+  last_tag_time = NEVER;
+  last_end_time = NEVER;
+}
+
+static int compare_intervals(const void* a, const void* b) {
+  interval_t x = *(const interval_t*)a;
+  interval_t y = *(const interval_t*)b;
+  return (x > y) - (x < y);
+}
+
+/** Return the given percentile of sorted samples. */
+static interval_t percentile(const interval_t* sorted, size_t count, double p) {
+  if (count == 0) {
+    return 0;
+  }
+  size_t i = (size_t)(p / 100.0 * (double)(count - 1) + 0.5);
+  return sorted[i < count ? i : count - 1];
+}
+
+void workload_stats(workload_stats_t* stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->reactions = __atomic_load_n(&reactions_executed, __ATOMIC_RELAXED);
+  stats->deadline_handlers = __atomic_load_n(&handlers_executed, __ATOMIC_RELAXED);
+  stats->tags = __atomic_load_n(&tags_started, __ATOMIC_RELAXED);
+
+  size_t count = __atomic_load_n(&lag_count, __ATOMIC_RELAXED);
+  count = count < lag_capacity ? count : lag_capacity;
+  qsort(lag_samples, count, sizeof(interval_t), compare_intervals);
+  stats->lag_samples = (long long)count;
+  stats->lag_p50 = percentile(lag_samples, count, 50);
+  stats->lag_p90 = percentile(lag_samples, count, 90);
+  stats->lag_p99 = percentile(lag_samples, count, 99);
+  stats->lag_p999 = percentile(lag_samples, count, 99.9);
+  stats->lag_max = count > 0 ? lag_samples[count - 1] : 0;
+
+  // The first tag has no predecessor.
+  tag_latency_count = stats->tags > 1 ? (size_t)stats->tags - 1 : 0;
+  count = tag_latency_count < lag_capacity ? tag_latency_count : lag_capacity;
+  qsort(tag_latency_samples, count, sizeof(interval_t), compare_intervals);
+  stats->tag_latency_samples = (long long)count;
+  stats->tag_latency_p50 = percentile(tag_latency_samples, count, 50);
+  stats->tag_latency_p90 = percentile(tag_latency_samples, count, 90);
+  stats->tag_latency_p99 = percentile(tag_latency_samples, count, 99);
+  stats->tag_latency_max = count > 0 ? tag_latency_samples[count - 1] : 0;
+}
+
+bool workload_write_ms_config(workload_t* workload, const char* path, long long low_criticality_budget,
+                              interval_t window) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  fprintf(file, "# Criticalities of the reactions of a synthetic workload.\n");
+  fprintf(file, "degrade_action=defer\n");
+  fprintf(file, "budget_type=reaction_count\n");
+  fprintf(file, "budget_window_ns=%lld\n", (long long)window);
+  for (size_t n = 0; n < workload->size; n++) {
+    workload_node_t* node = &workload->nodes[n];
+    uint64_t key = lf_reaction_compute_stable_key(&node->reaction);
+    // The runtime computes and registers the keys itself.
+    node->reaction.stable_key = 0;
+    if (node->high_criticality) {
+      fprintf(file, "reaction,0,%llu,high,-1,0\n", (unsigned long long)key);
+    } else {
+      fprintf(file, "reaction,0,%llu,low,%lld,1\n", (unsigned long long)key, low_criticality_budget);
+    }
+  }
+  return fclose(file) == 0;
+}
+
+void workload_free(workload_t* workload) {
+  if (workload == NULL) {
+    return;
+  }
+  for (size_t n = 0; n < workload->size; n++) {
+    free(workload->nodes[n].output.reactions);
+  }
+  free((void*)workload->timer.reactions);
+  free(workload->nodes);
+  free(workload);
+}
@@ -0,0 +1,135 @@
+/**
+ * @file workload.h
+ * @brief Synthetic reaction graphs that exercise the runtime without a Lingua Franca program.
+ *
+ * A workload is a layered graph of reactions. A periodic timer triggers every reaction of the
+ * first level, and each reaction triggers `fan_out` reactions of the next level, so the depth of
+ * the graph is the length of its longest chain. Reactions spin for a time drawn from an
+ * execution-time distribution, some have deadlines, and some are of high criticality for the
+ * master scheduler. Each reaction belongs to its own reactor, named `workload.r<level>_<i>`.
+ *
+ * The reactions record how late they start relative to the logical time (the lag) and how long
+ * the runtime takes to start a tag once the previous tag is done and the new one is due (the
+ * tag-advance latency). See workload_stats().
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "environment.h"
+#include "lf_types.h"
+
+/** The maximum depth of a workload. */
+#define WORKLOAD_MAX_LEVELS 256
+
+/** Distributions of the execution time of reactions. */
+typedef enum { WORKLOAD_EXEC_CONSTANT, WORKLOAD_EXEC_UNIFORM, WORKLOAD_EXEC_EXPONENTIAL } workload_exec_kind_t;
+
+/**
+ * @brief An execution-time distribution.
+ *
+ * Constant: always `a`. Uniform: between `a` and `b`. Exponential: mean `a`, capped at `b`.
+ */
+typedef struct workload_exec_t {
+  workload_exec_kind_t kind;
+  interval_t a;
+  interval_t b;
+} workload_exec_t;
+
+/** @brief The shape of a workload. */
+typedef struct workload_spec_t {
+  int levels;                        // Depth of the graph.
+  int widths[WORKLOAD_MAX_LEVELS];   // Number of reactions on each level.
+  int fan_out;                       // Reactions of the next level that each reaction triggers.
+  interval_t period;                 // Period of the timer that triggers the first level.
+  double deadline_fraction;          // Fraction of reactions that have a deadline.
+  interval_t deadline;               // The relative deadline of those reactions.
+  workload_exec_t exec;              // Execution time of reactions.
+  double high_criticality_fraction;  // Fraction of reactions of high criticality.
+  uint64_t seed;                     // Seed of deadlines, criticalities, and execution times.
+} workload_spec_t;
+
+/** @brief A reaction of a workload together with its reactor. */
+typedef struct workload_node_t {
+  self_base_t base; // First, because the runtime treats reaction->self as a self_base_t*.
+  reaction_t reaction;
+  int level;
+  bool high_criticality;
+  const workload_exec_t* exec;
+  bool output_present;
+  bool* output_produced[1];
+  trigger_t output;             // Lists the triggered reactions of the next level.
+  trigger_t* output_triggers[1];
+  trigger_t** triggers[1];
+  int triggered_sizes[1];
+  uint64_t random_state;        // Execution times. Only the executing worker uses it.
+  char name[32];
+  char full_name[48];
+} workload_node_t;
+
+/** @brief A workload. */
+typedef struct workload_t {
+  workload_spec_t spec;
+  workload_node_t* nodes;
+  size_t size;
+  trigger_t timer;
+  size_t reactions_per_level[WORKLOAD_MAX_LEVELS];
+} workload_t;
+
+/** @brief What the reactions of a workload measured. */
+typedef struct workload_stats_t {
+  long long reactions;           // Reaction bodies that were executed.
+  long long deadline_handlers;   // Deadline violation handlers that were executed.
+  long long tags;                // Tags at which a reaction was executed.
+  long long lag_samples;         // Number of lag samples in the percentiles.
+  interval_t lag_p50, lag_p90, lag_p99, lag_p999, lag_max;
+  long long tag_latency_samples; // Number of tag-advance latency samples in the percentiles.
+  interval_t tag_latency_p50, tag_latency_p90, tag_latency_p99, tag_latency_max;
+} workload_stats_t;
+
+/**
+ * @brief Build the workload of the given shape.
+ *
+ * The graph is a pure function of the specification.
+ * @param spec The shape of the workload.
+ * @return The workload, or NULL if the specification is invalid.
+ */
+workload_t* workload_build(const workload_spec_t* spec);
+
+/**
+ * @brief Make the workload part of an environment, initialize the scheduler, and reset the measurements.
+ *
+ * Call this from the code-generated function _lf_initialize_trigger_objects(). The
+ * environment must have been initialized with one timer and workload->size is_present fields.
+ * @param workload The workload.
+ * @param env The environment.
+ * @param max_samples The maximum number of lag samples to keep.
+ */
+void workload_attach(workload_t* workload, environment_t* env, size_t max_samples);
+
+/**
+ * @brief Return what the reactions measured since workload_attach().
+ * @param stats Where to put the measurements.
+ */
+void workload_stats(workload_stats_t* stats);
+
+/**
+ * @brief Write a master scheduler configuration that gives each reaction its criticality.
+ *
+ * Low-criticality reactions are degradable and get the given budget per window.
+ * @param workload The workload.
+ * @param path The file to write.
+ * @param low_criticality_budget The budget of low-criticality reactions, or -1 for none.
+ * @param window The budget window.
+ * @return true on success.
+ */
+bool workload_write_ms_config(workload_t* workload, const char* path, long long low_criticality_budget,
+                              interval_t window);
+
+/** @brief Free a workload. */
+void workload_free(workload_t* workload);
+
+#endif // WORKLOAD_H
@@ -0,0 +1,488 @@
+/**
+ * @file workload_bench.c
+ * @brief End-to-end benchmark of the threaded runtime on synthetic workloads.
+ *
+ * The program builds a workload (see workload.h) and executes it with lf_reactor_c_main(), the way
+ * a code-generated program would, for each combination of number of workers and master scheduler
+ * phase, `--repetitions` times. Each execution runs in a child process because the runtime keeps
+ * its state in static variables. For each execution, it reports the throughput in reactions per
+ * second of physical time, the number of tags and tags per second, the percentiles of the lag of
+ * reactions and of the tag-advance latency, and the deadline misses. The results are written as
+ * JSON to `--output` (default: stdout) and summarized on stderr.
+ *
+ * The master scheduler phases are:
+ * - disabled: LF_MS_DISABLE=1.
+ * - phase1_observe: the master scheduler only observes (LF_MS_OBSERVE_ONLY=1).
+ * - phase2_control: the master scheduler picks the reactions to execute.
+ * - phase3_mixed_criticality: in addition, low-criticality reactions are degraded
+ *   (LF_MS_DEGRADE_ENABLE=1) according to a configuration (LF_MS_CONFIG) that gives each reaction
+ *   the criticality of the workload and low-criticality reactions a budget of `--lc-budget`
+ *   reactions per `--budget-window`.
+ * - phase4_os: in addition, the master scheduler adjusts the OS scheduling of workers
+ *   (LF_MS_OS_ENABLE=1).
+ * The log of the master scheduler goes to /dev/null unless `--ms-log-dir` is given.
+ *
+ * The scheduler is the one this program is compiled with (`-DSCHEDULER=...`), so run the
+ * `workload` target to compare schedulers.
+ *
+ * Durations are numbers followed by ns, us, ms, or s. Execution-time distributions are
+ * `const:T`, `uniform:MIN:MAX`, or `exp:MEAN[:MAX]` (MAX defaults to 10 times the mean).
+ *
+ * Usage: workload_bench [--output FILE] [--levels N] [--width N | --widths N,N,...] [--fan-out N]
+ *                       [--period T] [--deadline-fraction F] [--deadline T] [--exec DIST]
+ *                       [--hc-fraction F] [--lc-budget N] [--budget-window T] [--seed N]
+ *                       [--timeout T] [--fast true|false] [--workers N,N,...] [--phases P,P,...]
+ *                       [--repetitions N] [--max-samples N] [--ms-log-dir DIR]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "environment.h"
+#include "low_level_platform.h"
+#include "reactor_common.h"
+#include "util.h"
+#include "workload.h"
+
+#define MAX_LIST 32
+
+#if SCHEDULER == SCHED_ADAPTIVE
+#define SCHEDULER_NAME "ADAPTIVE"
+#elif SCHEDULER == SCHED_GEDF_NP
+#define SCHEDULER_NAME "GEDF_NP"
+#elif SCHEDULER == SCHED_GEDF_LEVELED
+#define SCHEDULER_NAME "GEDF_LEVELED"
+#elif SCHEDULER == SCHED_NP_WORK_STEALING
+#define SCHEDULER_NAME "NP_WORK_STEALING"
+#else
+#define SCHEDULER_NAME "NP"
+#endif
+
+/** Master scheduler phases. */
+typedef enum { PHASE_DISABLED, PHASE_OBSERVE, PHASE_CONTROL, PHASE_MIXED_CRITICALITY, PHASE_OS } phase_t;
+
+static const char* phase_names[] = {"disabled", "phase1_observe", "phase2_control", "phase3_mixed_criticality",
+                                    "phase4_os"};
+
+/** Command-line options. */
+static struct {
+  const char* output;
+  workload_spec_t spec;
+  long long lc_budget;
+  interval_t budget_window;
+  interval_t timeout;
+  bool fast;
+  int workers[MAX_LIST];
+  int workers_count;
+  phase_t phases[MAX_LIST];
+  int phases_count;
+  int repetitions;
+  size_t max_samples;
+  const char* ms_log_dir;
+} options;
+
+//////////////////
+// The functions that the code generator would emit for a program.
+
+static environment_t env;
+static workload_t* workload;
+
+// Defined by the runtime and called from the generated main function.
+int lf_reactor_c_main(int argc, const char* argv[]);
+
+void lf_create_environments(void) {
+  environment_init(&env, "workload", 0, _lf_number_of_workers, 1, 0, 0, 0, (int)workload->size, 0, 0, 0, NULL);
+}
+void _lf_initialize_trigger_objects(void) { workload_attach(workload, &env, options.max_samples); }
+void lf_terminate_execution(environment_t* e) { (void)e; }
+void lf_set_default_command_line_options(void) {}
+void logical_tag_complete(tag_t tag_to_send) { (void)tag_to_send; }
+int _lf_get_environments(environment_t** envs) {
+  *envs = &env;
+  return 1;
+}
+
+//////////////////
+// Executions.
+
+/** What one execution measured. The child process sends it to the parent through a pipe. */
+typedef struct run_result_t {
+  bool ok;
+  interval_t elapsed;
+  long long deadline_misses;
+  workload_stats_t stats;
+} run_result_t;
+
+/** Set the environment variables of the master scheduler for the given phase. */
+static void set_phase_environment(phase_t phase, const char* config_path, int run) {
+  const char* variables[] = {"LF_MS_DISABLE", "LF_MS_OBSERVE_ONLY", "LF_MS_DEGRADE_ENABLE", "LF_MS_CONFIG",
+                             "LF_MS_OS_ENABLE"};
+  for (size_t i = 0; i < sizeof(variables) / sizeof(variables[0]); i++) {
+    unsetenv(variables[i]);
+  }
+  if (phase == PHASE_DISABLED) {
+    setenv("LF_MS_DISABLE", "1", 1);
+  } else if (phase == PHASE_OBSERVE) {
+    setenv("LF_MS_OBSERVE_ONLY", "1", 1);
+  }
+  if (phase >= PHASE_MIXED_CRITICALITY) {
+    setenv("LF_MS_DEGRADE_ENABLE", "1", 1);
+    setenv("LF_MS_CONFIG", config_path, 1);
+  }
+  if (phase == PHASE_OS) {
+    setenv("LF_MS_OS_ENABLE", "1", 1);
+  }
+  char log[1024];
+  if (options.ms_log_dir != NULL) {
+    snprintf(log, sizeof(log), "%s/workload_%s_%s_%d.log", options.ms_log_dir, SCHEDULER_NAME, phase_names[phase],
+             run);
+  } else {
+    snprintf(log, sizeof(log), "/dev/null");
+  }
+  setenv("LF_MS_LOG", log, 1);
+}
+
+/** Execute the workload in the child process and write the result to the given pipe. */
+static void child(int workers, int fd) {
+  // The runtime reports on stdout, which may be the JSON output.
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    exit(1);
+  }
+  char workers_arg[16];
+  char timeout_arg[32];
+  snprintf(workers_arg, sizeof(workers_arg), "%d", workers);
+  snprintf(timeout_arg, sizeof(timeout_arg), "%lld", (long long)options.timeout);
+  const char* argv[] = {"workload", "-w", workers_arg, "-o", timeout_arg, "nsec",
+                        "-f",       options.fast ? "true" : "false"};
+
+  run_result_t result;
+  memset(&result, 0, sizeof(result));
+  instant_t start = lf_time_physical();
+  result.ok = lf_reactor_c_main(sizeof(argv) / sizeof(argv[0]), argv) == 0;
+  result.elapsed = lf_time_physical() - start;
+  result.deadline_misses = (long long)__atomic_load_n(&env.deadline_misses, __ATOMIC_RELAXED);
+  workload_stats(&result.stats);
+  if (write(fd, &result, sizeof(result)) != (ssize_t)sizeof(result)) {
+    exit(1);
+  }
+  close(fd);
+  exit(0);
+}
+
+/** Execute the workload once in a child process. */
+static bool run(int workers, run_result_t* result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  fflush(NULL);
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    child(workers, fds[1]);
+  }
+  close(fds[1]);
+  ssize_t received = read(fds[0], result, sizeof(*result));
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  return received == (ssize_t)sizeof(*result) && WIFEXITED(status) && WEXITSTATUS(status) == 0 && result->ok;
+}
+
+//////////////////
+// Options.
+
+static int int_option(const char* name, const char* value, int min) {
+  char* end;
+  long result = strtol(value, &end, 10);
+  if (*end != '\0' || result < min || result > 1000000000L) {
+    lf_print_error_and_exit("Invalid value for %s: %s", name, value);
+  }
+  return (int)result;
+}
+
+static double fraction_option(const char* name, const char* value) {
+  char* end;
+  double result = strtod(value, &end);
+  if (*end != '\0' || result < 0.0 || result > 1.0) {
+    lf_print_error_and_exit("Invalid value for %s: %s", name, value);
+  }
+  return result;
+}
+
+/** Parse a duration such as 10ms. A number without units is in nanoseconds. */
+static interval_t duration_option(const char* name, const char* value) {
+  char* end;
+  double number = strtod(value, &end);
+  double scale = 1.0;
+  if (strcmp(end, "us") == 0) {
+    scale = 1e3;
+  } else if (strcmp(end, "ms") == 0) {
+    scale = 1e6;
+  } else if (strcmp(end, "s") == 0) {
+    scale = 1e9;
+  } else if (*end != '\0' && strcmp(end, "ns") != 0) {
+    lf_print_error_and_exit("Invalid duration for %s: %s", name, value);
+  }
+  if (end == value || number < 0.0) {
+    lf_print_error_and_exit("Invalid duration for %s: %s", name, value);
+  }
+  return (interval_t)(number * scale);
+}
+
+static void exec_option(const char* value) {
+  char copy[128];
+  snprintf(copy, sizeof(copy), "%s", value);
+  char* parts[3] = {NULL, NULL, NULL};
+  int count = 0;
+  for (char* part = strtok(copy, ":"); part != NULL && count < 3; part = strtok(NULL, ":")) {
+    parts[count++] = part;
+  }
+  workload_exec_t* exec = &options.spec.exec;
+  if (count == 2 && strcmp(parts[0], "const") == 0) {
+    exec->kind = WORKLOAD_EXEC_CONSTANT;
+    exec->a = duration_option("--exec", parts[1]);
+  } else if (count == 3 && strcmp(parts[0], "uniform") == 0) {
+    exec->kind = WORKLOAD_EXEC_UNIFORM;
+    exec->a = duration_option("--exec", parts[1]);
+    exec->b = duration_option("--exec", parts[2]);
+    if (exec->b < exec->a) {
+      lf_print_error_and_exit("Invalid value for --exec: %s", value);
+    }
+  } else if ((count == 2 || count == 3) && strcmp(parts[0], "exp") == 0) {
+    exec->kind = WORKLOAD_EXEC_EXPONENTIAL;
+    exec->a = duration_option("--exec", parts[1]);
+    exec->b = count == 3 ? duration_option("--exec", parts[2]) : 10 * exec->a;
+  } else {
+    lf_print_error_and_exit("Invalid value for --exec: %s", value);
+  }
+}
+
+/** Parse a comma-separated list of integers. */
+static int int_list_option(const char* name, const char* value, int* list, int min) {
+  char copy[1024];
+  snprintf(copy, sizeof(copy), "%s", value);
+  int count = 0;
+  for (char* item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+    if (count == MAX_LIST) {
+      lf_print_error_and_exit("At most %d values are supported for %s.", MAX_LIST, name);
+    }
+    list[count++] = int_option(name, item, min);
+  }
+  if (count == 0) {
+    lf_print_error_and_exit("Invalid value for %s: %s", name, value);
+  }
+  return count;
+}
+
+static void phases_option(const char* value) {
+  char copy[1024];
+  snprintf(copy, sizeof(copy), "%s", value);
+  options.phases_count = 0;
+  for (char* item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+    size_t p = 0;
+    while (p < sizeof(phase_names) / sizeof(phase_names[0]) && strcmp(item, phase_names[p]) != 0) {
+      p++;
+    }
+    if (p == sizeof(phase_names) / sizeof(phase_names[0])) {
+      lf_print_error_and_exit("Unknown phase %s.", item);
+    }
+    if (options.phases_count == MAX_LIST) {
+      lf_print_error_and_exit("At most %d phases are supported.", MAX_LIST);
+    }
+    options.phases[options.phases_count++] = (phase_t)p;
+  }
+}
+
+static void parse_options(int argc, char* argv[]) {
+  workload_spec_t* spec = &options.spec;
+  spec->levels = 4;
+  spec->fan_out = 2;
+  spec->period = MSEC(1);
+  spec->deadline_fraction = 0.25;
+  spec->deadline = USEC(500);
+  spec->exec = (workload_exec_t){WORKLOAD_EXEC_EXPONENTIAL, USEC(10), USEC(100)};
+  spec->high_criticality_fraction = 0.5;
+  spec->seed = 1;
+  int width = 8;
+  int widths[MAX_LIST];
+  int widths_count = 0;
+  options.lc_budget = 100;
+  options.budget_window = MSEC(10);
+  options.timeout = SEC(1);
+  options.workers[0] = 1;
+  options.workers[1] = 2;
+  options.workers[2] = 4;
+  options.workers_count = 3;
+  phases_option("disabled,phase1_observe,phase2_control,phase3_mixed_criticality,phase4_os");
+  options.repetitions = 3;
+  options.max_samples = 1000000;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      lf_print_error_and_exit("Missing value for %s.", argv[i]);
+    }
+    const char* name = argv[i];
+    const char* value = argv[++i];
+    if (strcmp(name, "--output") == 0) {
+      options.output = value;
+    } else if (strcmp(name, "--levels") == 0) {
+      spec->levels = int_option(name, value, 1);
+    } else if (strcmp(name, "--width") == 0) {
+      width = int_option(name, value, 1);
+    } else if (strcmp(name, "--widths") == 0) {
+      widths_count = int_list_option(name, value, widths, 1);
+    } else if (strcmp(name, "--fan-out") == 0) {
+      spec->fan_out = int_option(name, value, 1);
+    } else if (strcmp(name, "--period") == 0) {
+      spec->period = duration_option(name, value);
+    } else if (strcmp(name, "--deadline-fraction") == 0) {
+      spec->deadline_fraction = fraction_option(name, value);
+    } else if (strcmp(name, "--deadline") == 0) {
+      spec->deadline = duration_option(name, value);
+    } else if (strcmp(name, "--exec") == 0) {
+      exec_option(value);
+    } else if (strcmp(name, "--hc-fraction") == 0) {
+      spec->high_criticality_fraction = fraction_option(name, value);
+    } else if (strcmp(name, "--lc-budget") == 0) {
+      options.lc_budget = int_option(name, value, -1);
+    } else if (strcmp(name, "--budget-window") == 0) {
+      options.budget_window = duration_option(name, value);
+    } else if (strcmp(name, "--seed") == 0) {
+      spec->seed = (uint64_t)int_option(name, value, 0);
+    } else if (strcmp(name, "--timeout") == 0) {
+      options.timeout = duration_option(name, value);
+    } else if (strcmp(name, "--fast") == 0) {
+      options.fast = strcmp(value, "true") == 0;
+    } else if (strcmp(name, "--workers") == 0) {
+      options.workers_count = int_list_option(name, value, options.workers, 1);
+    } else if (strcmp(name, "--phases") == 0) {
+      phases_option(value);
+    } else if (strcmp(name, "--repetitions") == 0) {
+      options.repetitions = int_option(name, value, 1);
+    } else if (strcmp(name, "--max-samples") == 0) {
+      options.max_samples = (size_t)int_option(name, value, 1);
+    } else if (strcmp(name, "--ms-log-dir") == 0) {
+      options.ms_log_dir = value;
+    } else {
+      lf_print_error_and_exit("Unknown option %s.", name);
+    }
+  }
+
+  // Levels beyond the given widths have the last of them.
+  if (spec->levels > WORKLOAD_MAX_LEVELS) {
+    lf_print_error_and_exit("At most %d levels are supported.", WORKLOAD_MAX_LEVELS);
+  }
+  for (int l = 0; l < spec->levels; l++) {
+    spec->widths[l] = widths_count == 0 ? width : widths[l < widths_count ? l : widths_count - 1];
+  }
+}
+
+//////////////////
+// Reporting.
+
+static void print_result(FILE* out, bool first, int workers, phase_t phase, int repetition, const run_result_t* r) {
+  const workload_stats_t* s = &r->stats;
+  double seconds = (double)r->elapsed / 1e9;
+  fprintf(out, "%s\n    {\"workers\": %d, \"phase\": \"%s\", \"repetition\": %d, \"elapsed_ns\": %lld,",
+          first ? "" : ",", workers, phase_names[phase], repetition, (long long)r->elapsed);
+  fprintf(out, " \"reactions\": %lld, \"reactions_per_s\": %.1f, \"tags\": %lld, \"tags_per_s\": %.1f,", s->reactions,
+          (double)s->reactions / seconds, s->tags, (double)s->tags / seconds);
+  fprintf(out, " \"deadline_misses\": %lld, \"deadline_handlers\": %lld,", r->deadline_misses, s->deadline_handlers);
+  fprintf(out,
+          "\n     \"lag_ns\": {\"samples\": %lld, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"p99.9\": %lld, "
+          "\"max\": %lld},",
+          s->lag_samples, (long long)s->lag_p50, (long long)s->lag_p90, (long long)s->lag_p99, (long long)s->lag_p999,
+          (long long)s->lag_max);
+  fprintf(out,
+          "\n     \"tag_latency_ns\": {\"samples\": %lld, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"max\": %lld}}",
+          s->tag_latency_samples, (long long)s->tag_latency_p50, (long long)s->tag_latency_p90,
+          (long long)s->tag_latency_p99, (long long)s->tag_latency_max);
+
+  fprintf(stderr,
+          "%-24s workers %2d: %10.0f reactions/s %8lld tags %6lld misses  lag p50 %8lld p99 %8lld ns  "
+          "tag latency p50 %8lld p99 %8lld ns\n",
+          phase_names[phase], workers, (double)s->reactions / seconds, s->tags, r->deadline_misses,
+          (long long)s->lag_p50, (long long)s->lag_p99, (long long)s->tag_latency_p50, (long long)s->tag_latency_p99);
+}
+
+static void print_spec(FILE* out) {
+  const workload_spec_t* spec = &options.spec;
+  static const char* exec_names[] = {"const", "uniform", "exp"};
+  fprintf(out, "  \"workload\": {\"levels\": %d, \"widths\": [", spec->levels);
+  for (int l = 0; l < spec->levels; l++) {
+    fprintf(out, "%s%d", l == 0 ? "" : ", ", spec->widths[l]);
+  }
+  fprintf(out, "], \"reactions\": %zu, \"fan_out\": %d, \"period_ns\": %lld,", workload->size, spec->fan_out,
+          (long long)spec->period);
+  fprintf(out, " \"deadline_fraction\": %g, \"deadline_ns\": %lld,", spec->deadline_fraction,
+          (long long)spec->deadline);
+  fprintf(out, " \"exec\": {\"distribution\": \"%s\", \"a_ns\": %lld, \"b_ns\": %lld},", exec_names[spec->exec.kind],
+          (long long)spec->exec.a, (long long)spec->exec.b);
+  fprintf(out, " \"hc_fraction\": %g, \"lc_budget\": %lld, \"budget_window_ns\": %lld,",
+          spec->high_criticality_fraction, options.lc_budget, (long long)options.budget_window);
+  fprintf(out, " \"seed\": %llu, \"timeout_ns\": %lld, \"fast\": %s},\n", (unsigned long long)spec->seed,
+          (long long)options.timeout, options.fast ? "true" : "false");
+}
+
+int main(int argc, char* argv[]) {
+  parse_options(argc, argv);
+  workload = workload_build(&options.spec);
+  if (workload == NULL) {
+    lf_print_error_and_exit("Invalid workload.");
+  }
+
+  char config_path[] = "/tmp/workload_ms_config_XXXXXX";
+  int config_fd = mkstemp(config_path);
+  if (config_fd < 0) {
+    lf_print_error_and_exit("Cannot create a master scheduler configuration.");
+  }
+  close(config_fd);
+  if (!workload_write_ms_config(workload, config_path, options.lc_budget, options.budget_window)) {
+    lf_print_error_and_exit("Cannot write %s.", config_path);
+  }
+
+  FILE* out = stdout;
+  if (options.output != NULL && (out = fopen(options.output, "w")) == NULL) {
+    lf_print_error_and_exit("Cannot open %s.", options.output);
+  }
+  fprintf(out, "{\n  \"scheduler\": \"%s\",\n", SCHEDULER_NAME);
+  print_spec(out);
+  fprintf(out, "  \"results\": [");
+
+  int failures = 0;
+  int count = 0;
+  for (int w = 0; w < options.workers_count; w++) {
+    for (int p = 0; p < options.phases_count; p++) {
+      for (int repetition = 0; repetition < options.repetitions; repetition++) {
+        set_phase_environment(options.phases[p], config_path, count);
+        run_result_t result;
+        if (!run(options.workers[w], &result)) {
+          lf_print_error("Execution with %d workers in phase %s failed.", options.workers[w],
+                         phase_names[options.phases[p]]);
+          failures++;
+          continue;
+        }
+        print_result(out, count == 0, options.workers[w], options.phases[p], repetition, &result);
+        count++;
+      }
+    }
+  }
+
+  fprintf(out, "\n  ]\n}\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+  unlink(config_path);
+  workload_free(workload);
+  return failures == 0 ? 0 : 1;
+}
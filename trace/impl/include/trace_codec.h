@@ -0,0 +1,133 @@
+/**
+ * @file trace_codec.h
+ *
+ * @brief Layout and encoding of the indexed trace file format.
+ *
+ * A trace file (.lft) consists of:
+ *
+ * - The magic bytes TRACE_FILE_MAGIC and the format version (uint32_t).
+ * - The start time (int64_t), the number of objects (int) and the object
+ *   table, each entry being the object pointer, the trigger pointer, the
+ *   object type and a null-terminated description.
+ * - A sequence of blocks. Each block holds the records of one trace buffer and
+ *   starts with a trace_block_header_t. The records are encoded with
+ *   lf_trace_encode_records() and then compressed with lf_trace_compress(). If
+ *   compression does not help, the encoded bytes are stored as they are, in
+ *   which case stored_size equals encoded_size.
+ * - An index that repeats the header of each block together with its offset,
+ *   followed by a trace_file_trailer_t. The index is written when tracing stops,
+ *   so a program that crashes leaves a file without one. Such a file can still
+ *   be read block by block.
+ *
+ * Integers are stored in the byte order of the machine that wrote the trace.
+ * Files written before this format (which start directly with the start time)
+ * are recognized by the absence of the magic bytes.
+ */
+#ifndef TRACE_CODEC_H
+#define TRACE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "trace.h"
+
+/**
+ * Bytes at the start and the end of a trace file. Read as a little-endian
+ * start time, the first eight bytes would be a negative time, which the old
+ * format never contains.
+ */
+#define TRACE_FILE_MAGIC "LFTRACE\x89"
+#define TRACE_FILE_MAGIC_LENGTH 8
+
+/** Version of the format written by this runtime. */
+#define TRACE_FORMAT_VERSION 1
+
+/** Upper bound on the number of bytes of one encoded record. */
+#define TRACE_RECORD_MAX_ENCODED_SIZE (9 * 10)
+
+/**
+ * @brief Header of a block of records.
+ */
+typedef struct trace_block_header_t {
+  /** Size of the encoded records. */
+  uint32_t encoded_size;
+  /** Size of the bytes that follow the header, equal to encoded_size if they are not compressed. */
+  uint32_t stored_size;
+  /** Number of records in the block. */
+  uint32_t record_count;
+  /** The LF thread whose buffer this was, or -1 for a buffer shared by user threads. */
+  int32_t worker;
+  /** Range of the logical times of the records. */
+  int64_t min_logical_time;
+  int64_t max_logical_time;
+  /** Range of the physical times of the records. */
+  int64_t min_physical_time;
+  int64_t max_physical_time;
+} trace_block_header_t;
+
+/**
+ * @brief An entry of the index at the end of a trace file.
+ */
+typedef struct trace_index_entry_t {
+  /** Offset of the block header in the file. */
+  int64_t offset;
+  trace_block_header_t block;
+} trace_index_entry_t;
+
+/**
+ * @brief The last bytes of a trace file that has an index.
+ */
+typedef struct trace_file_trailer_t {
+  /** Offset of the first index entry in the file. */
+  int64_t index_offset;
+  /** Number of index entries. */
+  uint32_t index_size;
+  uint32_t version;
+  char magic[TRACE_FILE_MAGIC_LENGTH];
+} trace_file_trailer_t;
+
+/**
+ * @brief Encode records as variable-length integers.
+ *
+ * Times, pointers and triggers are stored as differences from the previous
+ * record, which are small because consecutive records of a thread are close
+ * in time and usually concern the same reactor. The first record of a call is
+ * encoded relative to zero, so blocks can be decoded independently.
+ *
+ * @param records The records to encode.
+ * @param count The number of records.
+ * @param out Buffer of at least count * TRACE_RECORD_MAX_ENCODED_SIZE bytes.
+ * @return The number of bytes written to out.
+ */
+size_t lf_trace_encode_records(const trace_record_nodeps_t* records, size_t count, uint8_t* out);
+
+/**
+ * @brief Decode records encoded with lf_trace_encode_records().
+ * @param in The encoded records.
+ * @param size The number of bytes in in.
+ * @param records Array into which to decode.
+ * @param count The number of records to decode.
+ * @return 0 on success or -1 if the input is malformed.
+ */
+int lf_trace_decode_records(const uint8_t* in, size_t size, trace_record_nodeps_t* records, size_t count);
+
+/**
+ * @brief Compress bytes into the LZ4 block format.
+ * @param src The bytes to compress.
+ * @param size The number of bytes.
+ * @param dst The buffer into which to compress.
+ * @param capacity The size of dst.
+ * @return The compressed size, or 0 if the result does not fit in capacity bytes.
+ */
+size_t lf_trace_compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+/**
+ * @brief Decompress bytes in the LZ4 block format.
+ * @param src The compressed bytes.
+ * @param size The number of compressed bytes.
+ * @param dst The buffer into which to decompress.
+ * @param capacity The size of dst.
+ * @return The decompressed size, or -1 if the input is malformed or does not fit in capacity bytes.
+ */
+int64_t lf_trace_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+#endif // TRACE_CODEC_H
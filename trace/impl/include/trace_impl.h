@@ -1,7 +1,26 @@
 #include "trace.h"
+#include "platform.h"
+#include "trace_codec.h"
+#include "trace_stream.h"
 
-// FIXME: Target property should specify the capacity of the trace buffer.
+/**
+ * Number of records in each trace buffer. Every LF thread has two buffers of
+ * this size. Override with the TRACE_BUFFER_CAPACITY CMake variable.
+ */
+#ifndef TRACE_BUFFER_CAPACITY
 #define TRACE_BUFFER_CAPACITY 2048
+#endif
+
+/**
+ * Default interval in milliseconds at which the writer thread has partially
+ * filled buffers written while consumers may be streaming the trace. The
+ * LF_TRACE_FLUSH_MS environment variable overrides it, with or without
+ * streaming; 0 turns periodic flushing off.
+ */
+#define TRACE_FLUSH_INTERVAL_MS 100
+
+/** Number of buffers shared by threads not created by LF (user threads). */
+#define TRACE_SHARED_BUFFERS 4
 
 /** Size of the table of trace objects. */
 #define TRACE_OBJECT_TABLE_SIZE 1024
@@ -11,6 +30,44 @@
 
 // TYPE DEFINITIONS **********************************************************
 
+/**
+ * @brief A buffer of trace records.
+ */
+typedef struct trace_buffer_t {
+  trace_record_nodeps_t* records;
+
+  /**
+   * The number of records written. A shared buffer holds TRACE_BUFFER_CAPACITY
+   * while it is being filled, or the number of claimed slots if it was closed early.
+   */
+  size_t size;
+
+  /**
+   * For a shared buffer, the generation in which it was installed (upper 32 bits)
+   * and the number of slots claimed by producers in that generation (lower 32 bits).
+   */
+  uint64_t reserved;
+
+  /** For a shared buffer, the number of claimed slots whose records are written. */
+  size_t committed;
+
+  /** True while the buffer is queued for or being written by the writer thread. */
+  bool in_flight;
+
+  /** The LF thread that owns the buffer, or -1 for a buffer shared by user threads. */
+  int worker;
+} trace_buffer_t;
+
+/**
+ * @brief The two buffers of an LF thread. The thread fills one while the other is written.
+ */
+typedef struct trace_thread_buffers_t {
+  trace_buffer_t buffers[2];
+  int active;
+  /** Set by the writer thread to have the thread hand off its partially filled buffer at its next event. */
+  bool flush_requested;
+} trace_thread_buffers_t;
+
 /**
  * @brief This struct holds all the state associated with tracing in a single environment.
  * Each environment which has tracing enabled will have such a struct on its environment struct.
@@ -18,16 +75,72 @@
  */
 typedef struct trace_t {
   /**
-   * Array of buffers into which traces are written.
-   * When a buffer becomes full, the contents is flushed to the file,
-   * which will create a significant pause in the calling thread.
+   * Buffers into which traces are written, one pair per LF thread.
+   * When a buffer becomes full, it is handed to the writer thread and
+   * the thread continues with the other buffer. The thread blocks only
+   * if the other buffer has not yet been written, i.e. if the file
+   * cannot keep up.
    */
-  trace_record_nodeps_t** _lf_trace_buffer;
-  size_t* _lf_trace_buffer_size;
+  trace_thread_buffers_t* _lf_trace_buffers;
 
-  /** The number of trace buffers allocated when tracing starts. */
+  /** The number of trace buffer pairs allocated when tracing starts. */
   size_t _lf_number_of_trace_buffers;
 
+  /**
+   * Buffers shared by user threads, which fill the current one without a lock
+   * by claiming slots with a compare-and-swap on its reserved field. The claim
+   * fails if the buffer has since been recycled into a later generation. The
+   * producer that commits the last record hands the buffer to the writer thread
+   * and installs a free one under the trace mutex.
+   */
+  trace_buffer_t _lf_trace_shared_buffers[TRACE_SHARED_BUFFERS];
+
+  /**
+   * The generation (upper 32 bits) and index (lower 32 bits) of the shared
+   * buffer being filled. Changed only under the trace mutex.
+   */
+  uint64_t _lf_trace_shared_current;
+
+  /** Buffers waiting for the writer thread, in FIFO order. Guarded by the trace mutex. */
+  trace_buffer_t** _lf_trace_queue;
+  size_t _lf_trace_queue_capacity;
+  size_t _lf_trace_queue_head;
+  size_t _lf_trace_queue_size;
+
+  /** The thread that writes full buffers to the file, or NULL to write them synchronously. */
+  lf_platform_thread_ptr_t _lf_trace_writer;
+
+  /** Signaled when a buffer is queued or the writer should stop. */
+  lf_platform_cond_ptr_t _lf_trace_buffer_ready;
+
+  /** Signaled when the writer has finished with a buffer. */
+  lf_platform_cond_ptr_t _lf_trace_buffer_written;
+
+  /** Marker that the writer thread should exit once the queue is empty. */
+  bool _lf_trace_writer_stop;
+
+  /** Interval between periodic flushes of partially filled buffers in nanoseconds, or 0 for none. */
+  int64_t _lf_trace_flush_interval_ns;
+
+  /**
+   * Scratch space for encoding and compressing a buffer into a block of the file.
+   * Only the thread that writes to the file uses it.
+   */
+  uint8_t* _lf_trace_encoded;
+  uint8_t* _lf_trace_compressed;
+
+  /** Index of the blocks written so far, written at the end of the file. */
+  trace_index_entry_t* _lf_trace_index;
+  size_t _lf_trace_index_size;
+  size_t _lf_trace_index_capacity;
+
+  /** The header as written at the start of the file, kept for stream consumers that connect later. */
+  uint8_t* _lf_trace_header;
+  size_t _lf_trace_header_size;
+
+  /** Consumers of the blocks as they are written. See trace_stream.h. */
+  trace_stream_t _lf_trace_stream;
+
   /** Marker that tracing is stopping or has stopped. */
   int _lf_trace_stop;
 
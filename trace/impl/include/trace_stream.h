@@ -0,0 +1,77 @@
+/**
+ * @file trace_stream.h
+ *
+ * @brief Streaming of trace blocks to live consumers over a Unix domain socket.
+ *
+ * If the environment variable LF_TRACE_STREAM_DIR names a directory, the
+ * tracing module listens on a socket in it named after the trace file, e.g.
+ * `Main_0.sock` for `Main_0.lft`. Any number of consumers, up to
+ * TRACE_STREAM_MAX_CONSUMERS at a time, can connect while the program runs.
+ * Each receives the header of the trace file and then every block written
+ * after it connected, in the format described in trace_codec.h. The stream
+ * has no index.
+ *
+ * Streaming never holds up the program: a consumer that cannot take a block
+ * right away misses it, and one that stops reading in the middle of a block is
+ * disconnected.
+ */
+#ifndef TRACE_STREAM_H
+#define TRACE_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "trace_codec.h"
+
+/** Maximum number of consumers connected at the same time. */
+#define TRACE_STREAM_MAX_CONSUMERS 4
+
+/** Maximum time in milliseconds to wait for a consumer to take the rest of a block. */
+#define TRACE_STREAM_TIMEOUT_MS 100
+
+/** Maximum length of the path of the socket. */
+#define TRACE_STREAM_MAX_PATH 108
+
+/**
+ * @brief The state of streaming for one trace.
+ */
+typedef struct trace_stream_t {
+  /** The listening socket, or -1 if streaming is off. */
+  int listener;
+  /** Sockets of connected consumers, -1 for unused entries. */
+  int consumers[TRACE_STREAM_MAX_CONSUMERS];
+  /** Number of blocks that consumers missed because they were not reading fast enough. */
+  uint64_t dropped;
+  char path[TRACE_STREAM_MAX_PATH];
+} trace_stream_t;
+
+/**
+ * @brief Start listening for consumers if LF_TRACE_STREAM_DIR is set.
+ * @param stream The stream state to initialize.
+ * @param name The base name of the socket, without the extension.
+ * @return true if the stream is listening.
+ */
+bool lf_trace_stream_open(trace_stream_t* stream, const char* name);
+
+/**
+ * @brief Accept consumers that are waiting to connect, if any, and send them the header.
+ * @param stream The stream state.
+ * @param header The header of the trace, as written at the start of the file.
+ * @param header_size The size of the header.
+ */
+void lf_trace_stream_accept(trace_stream_t* stream, const uint8_t* header, size_t header_size);
+
+/**
+ * @brief Send a block to every connected consumer.
+ * @param stream The stream state.
+ * @param block The header of the block.
+ * @param stored The contents of the block as stored in the file.
+ */
+void lf_trace_stream_send(trace_stream_t* stream, const trace_block_header_t* block, const uint8_t* stored);
+
+/**
+ * @brief Disconnect the consumers, stop listening and remove the socket.
+ */
+void lf_trace_stream_close(trace_stream_t* stream);
+
+#endif // TRACE_STREAM_H
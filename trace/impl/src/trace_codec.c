@@ -0,0 +1,263 @@
+/**
+ * @file trace_codec.c
+ *
+ * @brief Encoding and compression of trace records. See trace_codec.h.
+ *
+ * The compressor produces the LZ4 block format so that blocks can also be
+ * inspected with standard tools, but it is self-contained: tracing must not
+ * add a dependency to the programs that use it.
+ */
+#include <string.h>
+
+#include "trace_codec.h"
+
+/** Number of bits of the hash of four bytes used to find matches. */
+#define LZ_HASH_BITS 12
+
+/** Shortest match, which is also the number of bytes hashed. */
+#define LZ_MIN_MATCH 4
+
+/** Largest distance to a match. */
+#define LZ_MAX_OFFSET 65535
+
+/** The format requires the last five bytes to be literals and the last match to start twelve bytes before the end. */
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+
+// RECORD ENCODING ***********************************************************
+
+static uint8_t* put_varint(uint8_t* out, uint64_t value) {
+  while (value >= 0x80) {
+    *out++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (uint8_t)value;
+  return out;
+}
+
+static uint8_t* put_signed(uint8_t* out, int64_t value) {
+  // Zigzag encoding keeps small negative numbers short.
+  return put_varint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static const uint8_t* get_varint(const uint8_t* in, const uint8_t* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (in >= end)
+      return NULL;
+    uint8_t byte = *in++;
+    result |= (uint64_t)(byte & 0x7F) << shift;
+    if (byte < 0x80) {
+      *value = result;
+      return in;
+    }
+  }
+  return NULL;
+}
+
+static const uint8_t* get_signed(const uint8_t* in, const uint8_t* end, int64_t* value) {
+  uint64_t raw;
+  in = get_varint(in, end, &raw);
+  if (in != NULL)
+    *value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+  return in;
+}
+
+size_t lf_trace_encode_records(const trace_record_nodeps_t* records, size_t count, uint8_t* out) {
+  uint8_t* start = out;
+  // Differences are taken in unsigned arithmetic, which wraps instead of overflowing.
+  uint64_t pointer = 0, trigger = 0, logical_time = 0, physical_time = 0;
+  for (size_t i = 0; i < count; i++) {
+    const trace_record_nodeps_t* r = &records[i];
+    out = put_varint(out, (uint32_t)r->event_type);
+    out = put_signed(out, (int64_t)((uint64_t)(uintptr_t)r->pointer - pointer));
+    out = put_signed(out, r->src_id);
+    out = put_signed(out, r->dst_id);
+    out = put_signed(out, (int64_t)((uint64_t)r->logical_time - logical_time));
+    out = put_signed(out, r->microstep);
+    out = put_signed(out, (int64_t)((uint64_t)r->physical_time - physical_time));
+    out = put_signed(out, (int64_t)((uint64_t)(uintptr_t)r->trigger - trigger));
+    out = put_signed(out, r->extra_delay);
+    pointer = (uint64_t)(uintptr_t)r->pointer;
+    trigger = (uint64_t)(uintptr_t)r->trigger;
+    logical_time = (uint64_t)r->logical_time;
+    physical_time = (uint64_t)r->physical_time;
+  }
+  return (size_t)(out - start);
+}
+
+int lf_trace_decode_records(const uint8_t* in, size_t size, trace_record_nodeps_t* records, size_t count) {
+  const uint8_t* end = in + size;
+  uint64_t pointer = 0, trigger = 0, logical_time = 0, physical_time = 0;
+  for (size_t i = 0; i < count; i++) {
+    trace_record_nodeps_t* r = &records[i];
+    uint64_t event_type;
+    int64_t value[8];
+    in = get_varint(in, end, &event_type);
+    for (int j = 0; j < 8 && in != NULL; j++) {
+      in = get_signed(in, end, &value[j]);
+    }
+    if (in == NULL)
+      return -1;
+    pointer += (uint64_t)value[0];
+    logical_time += (uint64_t)value[3];
+    physical_time += (uint64_t)value[5];
+    trigger += (uint64_t)value[6];
+    r->event_type = (int)event_type;
+    r->pointer = (void*)(uintptr_t)pointer;
+    r->src_id = (int)value[1];
+    r->dst_id = (int)value[2];
+    r->logical_time = (int64_t)logical_time;
+    r->microstep = value[4];
+    r->physical_time = (int64_t)physical_time;
+    r->trigger = (void*)(uintptr_t)trigger;
+    r->extra_delay = value[7];
+  }
+  return in == end ? 0 : -1;
+}
+
+// COMPRESSION ***************************************************************
+
+static uint32_t read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32_t hash32(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS); }
+
+/**
+ * Write a length that did not fit in a token nibble.
+ * @return The next output position or NULL if out of room.
+ */
+static uint8_t* put_length(uint8_t* out, uint8_t* out_end, size_t length) {
+  for (; length >= 255; length -= 255) {
+    if (out >= out_end)
+      return NULL;
+    *out++ = 255;
+  }
+  if (out >= out_end)
+    return NULL;
+  *out++ = (uint8_t)length;
+  return out;
+}
+
+/**
+ * Write a sequence: literals followed by a match, or only literals if match_length is 0.
+ * @return The next output position or NULL if out of room.
+ */
+static uint8_t* put_sequence(uint8_t* out, uint8_t* out_end, const uint8_t* literals, size_t literal_length,
+                             size_t offset, size_t match_length) {
+  if (out >= out_end)
+    return NULL;
+  uint8_t* token = out++;
+  *token = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+  if (literal_length >= 15 && (out = put_length(out, out_end, literal_length - 15)) == NULL)
+    return NULL;
+  if ((size_t)(out_end - out) < literal_length)
+    return NULL;
+  memcpy(out, literals, literal_length);
+  out += literal_length;
+  if (match_length == 0)
+    return out;
+  if (out_end - out < 2)
+    return NULL;
+  *out++ = (uint8_t)offset;
+  *out++ = (uint8_t)(offset >> 8);
+  size_t extra = match_length - LZ_MIN_MATCH;
+  *token |= (uint8_t)(extra < 15 ? extra : 15);
+  if (extra >= 15)
+    out = put_length(out, out_end, extra - 15);
+  return out;
+}
+
+size_t lf_trace_compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+  uint32_t table[1 << LZ_HASH_BITS];
+  memset(table, 0xFF, sizeof(table));
+  const uint8_t* ip = src;
+  const uint8_t* anchor = src;
+  const uint8_t* end = src + size;
+  uint8_t* out = dst;
+  uint8_t* out_end = dst + capacity;
+  if (size > LZ_MATCH_LIMIT) {
+    const uint8_t* match_limit = end - LZ_MATCH_LIMIT;
+    while (ip < match_limit) {
+      uint32_t sequence = read32(ip);
+      uint32_t* slot = &table[hash32(sequence)];
+      uint32_t candidate = *slot;
+      *slot = (uint32_t)(ip - src);
+      if (candidate == UINT32_MAX || (size_t)(ip - src) - candidate > LZ_MAX_OFFSET ||
+          read32(src + candidate) != sequence) {
+        ip++;
+        continue;
+      }
+      const uint8_t* ref = src + candidate + LZ_MIN_MATCH;
+      const uint8_t* match_end = ip + LZ_MIN_MATCH;
+      while (match_end < end - LZ_LAST_LITERALS && *match_end == *ref) {
+        match_end++;
+        ref++;
+      }
+      out = put_sequence(out, out_end, anchor, (size_t)(ip - anchor), (size_t)(ip - src) - candidate,
+                         (size_t)(match_end - ip));
+      if (out == NULL)
+        return 0;
+      ip = match_end;
+      anchor = ip;
+    }
+  }
+  out = put_sequence(out, out_end, anchor, (size_t)(end - anchor), 0, 0);
+  return out == NULL ? 0 : (size_t)(out - dst);
+}
+
+int64_t lf_trace_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+  const uint8_t* ip = src;
+  const uint8_t* end = src + size;
+  uint8_t* op = dst;
+  uint8_t* out_end = dst + capacity;
+  while (ip < end) {
+    uint8_t token = *ip++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15) {
+      uint8_t byte;
+      do {
+        if (ip >= end)
+          return -1;
+        byte = *ip++;
+        literal_length += byte;
+      } while (byte == 255);
+    }
+    if ((size_t)(end - ip) < literal_length || (size_t)(out_end - op) < literal_length)
+      return -1;
+    memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    if (ip == end)
+      break; // The last sequence has no match.
+    if (end - ip < 2)
+      return -1;
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst))
+      return -1;
+    size_t match_length = token & 15;
+    if (match_length == 15) {
+      uint8_t byte;
+      do {
+        if (ip >= end)
+          return -1;
+        byte = *ip++;
+        match_length += byte;
+      } while (byte == 255);
+    }
+    match_length += LZ_MIN_MATCH;
+    if ((size_t)(out_end - op) < match_length)
+      return -1;
+    // The match may overlap the output being written, so copy byte by byte.
+    const uint8_t* match = op - offset;
+    for (size_t i = 0; i < match_length; i++) {
+      op[i] = match[i];
+    }
+    op += match_length;
+  }
+  return (int64_t)(op - dst);
+}
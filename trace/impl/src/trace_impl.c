@@ -18,6 +18,9 @@
     return -1;                                                                                                         \
   } while (0)
 
+/** Mask of the slot count in trace_buffer_t.reserved and of the index in trace_t._lf_trace_shared_current. */
+#define TRACE_SHARED_LOW_MASK 0xFFFFFFFFULL
+
 // PRIVATE DATA STRUCTURES ***************************************************
 
 static lf_platform_mutex_ptr_t trace_mutex;
@@ -38,102 +41,398 @@ static version_t version = {.build_config =
 
 // PRIVATE HELPERS ***********************************************************
 
+/**
+ * Append bytes to the trace header being built.
+ * @return The next position in the header.
+ */
+static uint8_t* put_header_bytes(uint8_t* out, const void* bytes, size_t size) {
+  memcpy(out, bytes, size);
+  return out + size;
+}
+
 /**
  * Write the trace header information.
- * See trace.h.
+ * See trace.h. The header is kept in the trace struct so that it can also be sent to stream consumers.
  * @return The number of items written to the object table or -1 for failure.
  */
 static int write_trace_header(trace_t* t) {
-  if (t->_lf_trace_file != NULL) {
-    size_t items_written = fwrite(&start_time, sizeof(int64_t), 1, t->_lf_trace_file);
-    if (items_written != 1)
-      _LF_TRACE_FAILURE(t);
-
-    // The next item in the header is the size of the
-    // _lf_trace_object_descriptions table.
-    items_written = fwrite(&t->_lf_trace_object_descriptions_size, sizeof(int), 1, t->_lf_trace_file);
-    if (items_written != 1)
-      _LF_TRACE_FAILURE(t);
-
-    // Next we write the table.
-    for (size_t i = 0; i < t->_lf_trace_object_descriptions_size; i++) {
-      // Write the pointer to the self struct.
-      items_written = fwrite(&t->_lf_trace_object_descriptions[i].pointer, sizeof(void*), 1, t->_lf_trace_file);
-      if (items_written != 1)
-        _LF_TRACE_FAILURE(t);
-
-      // Write the pointer to the trigger_t struct.
-      items_written = fwrite(&t->_lf_trace_object_descriptions[i].trigger, sizeof(void*), 1, t->_lf_trace_file);
-      if (items_written != 1)
-        _LF_TRACE_FAILURE(t);
-
-      // Write the object type.
-      items_written = fwrite(&t->_lf_trace_object_descriptions[i].type, // Write the pointer value.
-                             sizeof(_lf_trace_object_t), 1, t->_lf_trace_file);
-      if (items_written != 1)
-        _LF_TRACE_FAILURE(t);
-
-      // Write the description.
-      size_t description_size = strlen(t->_lf_trace_object_descriptions[i].description);
-      items_written = fwrite(t->_lf_trace_object_descriptions[i].description, sizeof(char),
-                             description_size + 1, // Include null terminator.
-                             t->_lf_trace_file);
-      if (items_written != description_size + 1)
-        _LF_TRACE_FAILURE(t);
-    }
+  size_t size = TRACE_FILE_MAGIC_LENGTH + sizeof(uint32_t) + sizeof(int64_t) + sizeof(int);
+  for (size_t i = 0; i < t->_lf_trace_object_descriptions_size; i++) {
+    size += 2 * sizeof(void*) + sizeof(_lf_trace_object_t) + strlen(t->_lf_trace_object_descriptions[i].description) + 1;
   }
-  return (int)t->_lf_trace_object_descriptions_size;
+  uint8_t* header = (uint8_t*)malloc(size);
+  if (header == NULL)
+    return -1;
+  uint32_t format_version = TRACE_FORMAT_VERSION;
+  int table_size = (int)t->_lf_trace_object_descriptions_size;
+  uint8_t* out = put_header_bytes(header, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH);
+  out = put_header_bytes(out, &format_version, sizeof(uint32_t));
+  out = put_header_bytes(out, &start_time, sizeof(int64_t));
+  // The next item in the header is the size of the
+  // _lf_trace_object_descriptions table.
+  out = put_header_bytes(out, &table_size, sizeof(int));
+  // Next comes the table.
+  for (size_t i = 0; i < t->_lf_trace_object_descriptions_size; i++) {
+    object_description_t* description = &t->_lf_trace_object_descriptions[i];
+    // The pointer to the self struct, the pointer to the trigger_t struct, and the object type.
+    out = put_header_bytes(out, &description->pointer, sizeof(void*));
+    out = put_header_bytes(out, &description->trigger, sizeof(void*));
+    out = put_header_bytes(out, &description->type, sizeof(_lf_trace_object_t));
+    // The description, including the null terminator.
+    out = put_header_bytes(out, description->description, strlen(description->description) + 1);
+  }
+  free(t->_lf_trace_header);
+  t->_lf_trace_header = header;
+  t->_lf_trace_header_size = size;
+  if (t->_lf_trace_file != NULL && fwrite(header, 1, size, t->_lf_trace_file) != size)
+    _LF_TRACE_FAILURE(t);
+  return table_size;
 }
 
 /**
- * @brief Flush the specified buffer to a file.
- * This assumes the caller has entered a critical section.
- * @param worker Index specifying the trace to flush.
+ * @brief Empty the specified buffer.
  */
-static void flush_trace_locked(trace_t* trace, int worker) {
-  if (trace->_lf_trace_stop == 0 && trace->_lf_trace_file != NULL && trace->_lf_trace_buffer_size[worker] > 0) {
-    // If the trace header has not been written, write it now.
-    // This is deferred to here so that user trace objects can be
-    // registered in startup reactions.
-    if (!trace->_lf_trace_header_written) {
-      if (write_trace_header(trace) < 0) {
-        lf_print_error("Failed to write trace header. Trace file will be incomplete.");
-        return;
-      }
-      trace->_lf_trace_header_written = true;
-    }
+static void clear_trace_buffer(trace_buffer_t* buffer) { buffer->size = 0; }
 
-    // Write first the length of the array.
-    size_t items_written = fwrite(&trace->_lf_trace_buffer_size[worker], sizeof(int), 1, trace->_lf_trace_file);
-    if (items_written != 1) {
-      fprintf(stderr, "WARNING: Access to trace file failed.\n");
-      fclose(trace->_lf_trace_file);
-      trace->_lf_trace_file = NULL;
-    } else {
-      // Write the contents.
-      items_written = fwrite(trace->_lf_trace_buffer[worker], sizeof(trace_record_nodeps_t),
-                             trace->_lf_trace_buffer_size[worker], trace->_lf_trace_file);
-      if (items_written != trace->_lf_trace_buffer_size[worker]) {
+/**
+ * @brief Return whether flushed buffers go anywhere: to the file or to stream consumers.
+ */
+static bool trace_has_output(trace_t* trace) {
+  return trace->_lf_trace_file != NULL || trace->_lf_trace_stream.listener >= 0;
+}
+
+/**
+ * @brief Add a block to the index that is written at the end of the file.
+ * @return false if out of memory.
+ */
+static bool index_trace_block(trace_t* trace, int64_t offset, trace_block_header_t* block) {
+  if (trace->_lf_trace_index_size == trace->_lf_trace_index_capacity) {
+    size_t capacity = trace->_lf_trace_index_capacity == 0 ? 64 : 2 * trace->_lf_trace_index_capacity;
+    trace_index_entry_t* grown =
+        (trace_index_entry_t*)realloc(trace->_lf_trace_index, capacity * sizeof(trace_index_entry_t));
+    if (grown == NULL)
+      return false;
+    trace->_lf_trace_index = grown;
+    trace->_lf_trace_index_capacity = capacity;
+  }
+  trace_index_entry_t* entry = &trace->_lf_trace_index[trace->_lf_trace_index_size++];
+  entry->offset = offset;
+  entry->block = *block;
+  return true;
+}
+
+/**
+ * @brief Write the specified buffer to the file as one block and empty it.
+ * This assumes the caller holds the trace mutex or is the writer thread,
+ * which is then the only thread accessing the file.
+ * @param trace The trace struct.
+ * @param buffer The buffer to write.
+ */
+static void write_trace_buffer(trace_t* trace, trace_buffer_t* buffer) {
+  if (trace_has_output(trace) && buffer->size > 0) {
+    trace_block_header_t block = {.record_count = (uint32_t)buffer->size,
+                                  .worker = buffer->worker,
+                                  .min_logical_time = INT64_MAX,
+                                  .max_logical_time = INT64_MIN,
+                                  .min_physical_time = INT64_MAX,
+                                  .max_physical_time = INT64_MIN};
+    for (size_t i = 0; i < buffer->size; i++) {
+      trace_record_nodeps_t* record = &buffer->records[i];
+      if (record->logical_time < block.min_logical_time)
+        block.min_logical_time = record->logical_time;
+      if (record->logical_time > block.max_logical_time)
+        block.max_logical_time = record->logical_time;
+      if (record->physical_time < block.min_physical_time)
+        block.min_physical_time = record->physical_time;
+      if (record->physical_time > block.max_physical_time)
+        block.max_physical_time = record->physical_time;
+    }
+    block.encoded_size = (uint32_t)lf_trace_encode_records(buffer->records, buffer->size, trace->_lf_trace_encoded);
+    // Keep the compressed form only if it is smaller.
+    uint8_t* stored = trace->_lf_trace_compressed;
+    block.stored_size =
+        (uint32_t)lf_trace_compress(trace->_lf_trace_encoded, block.encoded_size, stored, block.encoded_size - 1);
+    if (block.stored_size == 0) {
+      stored = trace->_lf_trace_encoded;
+      block.stored_size = block.encoded_size;
+    }
+    if (trace->_lf_trace_file != NULL) {
+      int64_t offset = (int64_t)ftell(trace->_lf_trace_file);
+      if (fwrite(&block, sizeof(trace_block_header_t), 1, trace->_lf_trace_file) != 1 ||
+          fwrite(stored, 1, block.stored_size, trace->_lf_trace_file) != block.stored_size) {
         fprintf(stderr, "WARNING: Access to trace file failed.\n");
         fclose(trace->_lf_trace_file);
         trace->_lf_trace_file = NULL;
+      } else if (!index_trace_block(trace, offset, &block)) {
+        fprintf(stderr, "WARNING: Out of memory for the trace index. The trace file will have no index.\n");
       }
     }
-    trace->_lf_trace_buffer_size[worker] = 0;
+    lf_trace_stream_accept(&trace->_lf_trace_stream, trace->_lf_trace_header, trace->_lf_trace_header_size);
+    lf_trace_stream_send(&trace->_lf_trace_stream, &block, stored);
+  }
+  clear_trace_buffer(buffer);
+}
+
+/**
+ * @brief Write the index of the blocks and the trailer that locates it.
+ * This assumes the caller holds the trace mutex and that no other thread writes to the file.
+ */
+static void write_trace_index_locked(trace_t* trace) {
+  if (trace->_lf_trace_file == NULL || !trace->_lf_trace_header_written)
+    return;
+  trace_file_trailer_t trailer = {.index_offset = (int64_t)ftell(trace->_lf_trace_file),
+                                  .index_size = (uint32_t)trace->_lf_trace_index_size,
+                                  .version = TRACE_FORMAT_VERSION};
+  memcpy(trailer.magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH);
+  if (fwrite(trace->_lf_trace_index, sizeof(trace_index_entry_t), trace->_lf_trace_index_size,
+             trace->_lf_trace_file) != trace->_lf_trace_index_size ||
+      fwrite(&trailer, sizeof(trace_file_trailer_t), 1, trace->_lf_trace_file) != 1) {
+    fprintf(stderr, "WARNING: Failed to write the trace index.\n");
+  }
+}
+
+/**
+ * @brief Write the trace header if it has not been written yet.
+ * This assumes the caller holds the trace mutex.
+ * @return true if the header is in the file.
+ */
+static bool write_trace_header_locked(trace_t* trace) {
+  // The header is deferred to the first flush so that user
+  // trace objects can be registered in startup reactions.
+  if (!trace->_lf_trace_header_written) {
+    if (write_trace_header(trace) < 0) {
+      lf_print_error("Failed to write trace header. Trace file will be incomplete.");
+      return false;
+    }
+    trace->_lf_trace_header_written = true;
   }
+  return true;
 }
 
 /**
  * @brief Flush the specified buffer to a file.
+ * This assumes the caller holds the trace mutex.
+ * @param trace The trace struct.
+ * @param buffer The buffer to flush.
+ */
+static void flush_trace_locked(trace_t* trace, trace_buffer_t* buffer) {
+  if (trace->_lf_trace_stop == 0 && trace_has_output(trace) && buffer->size > 0) {
+    if (!write_trace_header_locked(trace))
+      return;
+    write_trace_buffer(trace, buffer);
+  }
+}
+
+/**
+ * @brief Queue a full buffer for the writer thread.
+ * This assumes the caller holds the trace mutex and that the writer thread is running.
+ */
+static void queue_trace_buffer_locked(trace_t* trace, trace_buffer_t* buffer) {
+  buffer->in_flight = true;
+  size_t tail = (trace->_lf_trace_queue_head + trace->_lf_trace_queue_size) % trace->_lf_trace_queue_capacity;
+  trace->_lf_trace_queue[tail] = buffer;
+  trace->_lf_trace_queue_size++;
+  lf_platform_cond_broadcast(trace->_lf_trace_buffer_ready);
+}
+
+static void hand_off_shared_trace_buffer_locked(trace_t* t, trace_buffer_t* full);
+
+/**
+ * @brief Have the partially filled buffers written.
+ * LF threads fill their buffers without a lock, so each is asked to hand off
+ * its buffer at its next event. The shared buffer is closed to further claims
+ * if another one is free, and it is handed off once its records are written.
+ * This assumes the caller is the writer thread and holds the trace mutex.
+ */
+static void request_trace_flush_locked(trace_t* trace) {
+  for (size_t i = 0; i < trace->_lf_number_of_trace_buffers; i++) {
+    __atomic_store_n(&trace->_lf_trace_buffers[i].flush_requested, true, __ATOMIC_RELAXED);
+  }
+  // The current shared buffer changes only under the mutex.
+  uint64_t current = __atomic_load_n(&trace->_lf_trace_shared_current, __ATOMIC_RELAXED);
+  trace_buffer_t* shared = &trace->_lf_trace_shared_buffers[current & TRACE_SHARED_LOW_MASK];
+  bool other_free = false;
+  for (int i = 0; i < TRACE_SHARED_BUFFERS; i++) {
+    trace_buffer_t* candidate = &trace->_lf_trace_shared_buffers[i];
+    other_free |= candidate != shared && !candidate->in_flight;
+  }
+  if (!other_free)
+    return;
+  uint64_t reserved = __atomic_load_n(&shared->reserved, __ATOMIC_RELAXED);
+  size_t claimed;
+  do {
+    claimed = (size_t)(reserved & TRACE_SHARED_LOW_MASK);
+    if (claimed == 0 || claimed >= TRACE_BUFFER_CAPACITY)
+      return;
+  } while (!__atomic_compare_exchange_n(&shared->reserved, &reserved,
+                                        (reserved & ~TRACE_SHARED_LOW_MASK) | TRACE_BUFFER_CAPACITY, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+  // Commit the unclaimed slots at once, so that whoever commits the last record hands the buffer off.
+  shared->size = claimed;
+  if (__atomic_add_fetch(&shared->committed, TRACE_BUFFER_CAPACITY - claimed, __ATOMIC_ACQ_REL) ==
+      TRACE_BUFFER_CAPACITY) {
+    hand_off_shared_trace_buffer_locked(trace, shared);
+  }
+}
+
+/**
+ * @brief The writer thread: write queued buffers to the file until told to stop,
+ * and have partially filled buffers written every flush interval.
+ * @param arg The trace struct.
+ */
+static void* trace_writer(void* arg) {
+  trace_t* trace = (trace_t*)arg;
+  int64_t interval = trace->_lf_trace_flush_interval_ns;
+  lf_platform_mutex_lock(trace_mutex);
+  int64_t next_flush = interval > 0 ? lf_platform_clock_ns() + interval : 0;
+  while (true) {
+    if (interval > 0 && !trace->_lf_trace_writer_stop) {
+      int64_t now = lf_platform_clock_ns();
+      if (now >= next_flush) {
+        request_trace_flush_locked(trace);
+        next_flush = now + interval;
+      }
+    }
+    if (trace->_lf_trace_queue_size == 0) {
+      if (trace->_lf_trace_writer_stop)
+        break;
+      if (interval > 0) {
+        lf_platform_cond_timedwait(trace->_lf_trace_buffer_ready, next_flush);
+      } else {
+        lf_platform_cond_wait(trace->_lf_trace_buffer_ready);
+      }
+      continue;
+    }
+    trace_buffer_t* buffer = trace->_lf_trace_queue[trace->_lf_trace_queue_head];
+    trace->_lf_trace_queue_head = (trace->_lf_trace_queue_head + 1) % trace->_lf_trace_queue_capacity;
+    trace->_lf_trace_queue_size--;
+    if (write_trace_header_locked(trace)) {
+      // Only this thread touches the file while it runs, so the slow part needs no lock.
+      lf_platform_mutex_unlock(trace_mutex);
+      write_trace_buffer(trace, buffer);
+      lf_platform_mutex_lock(trace_mutex);
+    } else {
+      // Records are useless without the header.
+      clear_trace_buffer(buffer);
+    }
+    buffer->in_flight = false;
+    lf_platform_cond_broadcast(trace->_lf_trace_buffer_written);
+  }
+  lf_platform_mutex_unlock(trace_mutex);
+  return NULL;
+}
+
+/**
+ * @brief Hand the full buffer of an LF thread to the writer and return the buffer to continue with.
  * @param t The trace struct.
- * @param worker Index specifying the trace to flush.
+ * @param tid The ID of the calling thread.
  */
-static void flush_trace(trace_t* t, int worker) {
-  // To avoid having more than one worker writing to the file at the same time,
-  // enter a critical section.
+static trace_buffer_t* swap_trace_buffer(trace_t* t, int tid) {
+  trace_thread_buffers_t* pair = &t->_lf_trace_buffers[tid];
+  trace_buffer_t* full = &pair->buffers[pair->active];
   lf_platform_mutex_lock(trace_mutex);
-  flush_trace_locked(t, worker);
+  if (t->_lf_trace_writer == NULL) {
+    // No writer thread. Write the buffer in this thread.
+    flush_trace_locked(t, full);
+    clear_trace_buffer(full);
+    lf_platform_mutex_unlock(trace_mutex);
+    return full;
+  }
+  queue_trace_buffer_locked(t, full);
+  pair->active = 1 - pair->active;
+  trace_buffer_t* next = &pair->buffers[pair->active];
+  // Block only if the file has not kept up with this thread.
+  while (next->in_flight) {
+    lf_platform_cond_wait(t->_lf_trace_buffer_written);
+  }
   lf_platform_mutex_unlock(trace_mutex);
+  return next;
+}
+
+/**
+ * @brief Make the specified shared buffer the one that user threads fill, in a new generation.
+ * This assumes the caller holds the trace mutex or that no user thread traces yet.
+ * @param t The trace struct.
+ * @param index The index of the buffer, which is empty and not in flight.
+ */
+static void install_shared_trace_buffer_locked(trace_t* t, size_t index) {
+  trace_buffer_t* buffer = &t->_lf_trace_shared_buffers[index];
+  uint64_t generation = (__atomic_load_n(&t->_lf_trace_shared_current, __ATOMIC_RELAXED) >> 32) + 1;
+  buffer->size = TRACE_BUFFER_CAPACITY;
+  buffer->committed = 0;
+  __atomic_store_n(&buffer->reserved, generation << 32, __ATOMIC_RELAXED);
+  // Producers that see the new generation also see the buffer reset above.
+  __atomic_store_n(&t->_lf_trace_shared_current, (generation << 32) | index, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Replace the shared buffer whose records are all written, and wake up
+ * the user threads that wait for the replacement.
+ * This assumes the caller holds the trace mutex.
+ * @param t The trace struct.
+ * @param full The current shared buffer, which is full or was closed early.
+ */
+static void hand_off_shared_trace_buffer_locked(trace_t* t, trace_buffer_t* full) {
+  size_t index = (size_t)(full - t->_lf_trace_shared_buffers);
+  if (t->_lf_trace_writer == NULL) {
+    // No writer thread. Write the buffer in this thread and keep using it.
+    flush_trace_locked(t, full);
+    clear_trace_buffer(full);
+  } else {
+    queue_trace_buffer_locked(t, full);
+    while (true) {
+      for (index = 0; index < TRACE_SHARED_BUFFERS; index++) {
+        if (!t->_lf_trace_shared_buffers[index].in_flight)
+          break;
+      }
+      if (index < TRACE_SHARED_BUFFERS)
+        break;
+      lf_platform_cond_wait(t->_lf_trace_buffer_written);
+    }
+  }
+  install_shared_trace_buffer_locked(t, index);
+  if (t->_lf_trace_buffer_written != NULL) {
+    lf_platform_cond_broadcast(t->_lf_trace_buffer_written);
+  }
+}
+
+/**
+ * @brief Record a trace event from a thread that was not created by LF.
+ * Such threads have no buffers of their own, so they share buffers. A thread
+ * claims a slot in the current one with a compare-and-swap that also checks
+ * the generation of the buffer, so a claim never lands in a buffer that has
+ * been handed off and recycled since the thread read which one is current.
+ * Only a thread that finds the buffer full blocks, on the trace mutex, until
+ * the thread that commits the last record has installed the next buffer.
+ */
+static void tracepoint_shared(trace_t* t, trace_record_nodeps_t* tr) {
+  while (true) {
+    uint64_t current = __atomic_load_n(&t->_lf_trace_shared_current, __ATOMIC_ACQUIRE);
+    trace_buffer_t* buffer = &t->_lf_trace_shared_buffers[current & TRACE_SHARED_LOW_MASK];
+    uint64_t reserved = __atomic_load_n(&buffer->reserved, __ATOMIC_RELAXED);
+    // A different generation means that the buffer was replaced (and recycled) meanwhile.
+    while ((reserved & ~TRACE_SHARED_LOW_MASK) == (current & ~TRACE_SHARED_LOW_MASK) &&
+           (reserved & TRACE_SHARED_LOW_MASK) < TRACE_BUFFER_CAPACITY) {
+      if (__atomic_compare_exchange_n(&buffer->reserved, &reserved, reserved + 1, false, __ATOMIC_ACQUIRE,
+                                      __ATOMIC_RELAXED)) {
+        buffer->records[reserved & TRACE_SHARED_LOW_MASK] = *tr;
+        if (__atomic_add_fetch(&buffer->committed, 1, __ATOMIC_ACQ_REL) == TRACE_BUFFER_CAPACITY) {
+          // This thread committed the last record.
+          lf_platform_mutex_lock(trace_mutex);
+          hand_off_shared_trace_buffer_locked(t, buffer);
+          lf_platform_mutex_unlock(trace_mutex);
+        }
+        return;
+      }
+    }
+    // The buffer is full or closed, or it was replaced already. Wait until it is replaced.
+    lf_platform_mutex_lock(trace_mutex);
+    while (__atomic_load_n(&t->_lf_trace_shared_current, __ATOMIC_RELAXED) == current &&
+           t->_lf_trace_buffer_written != NULL) {
+      lf_platform_cond_wait(t->_lf_trace_buffer_written);
+    }
+    lf_platform_mutex_unlock(trace_mutex);
+  }
 }
 
 static void start_trace(trace_t* t, int max_num_local_threads) {
@@ -142,19 +441,68 @@ static void start_trace(trace_t* t, int max_num_local_threads) {
   // write_trace_header();
   t->_lf_trace_header_written = false;
 
-  // Allocate an array of arrays of trace records, one per worker thread plus one
-  // for the 0 thread (the main thread, or in an single-threaded program, the only
-  // thread).
+  // Allocate a pair of buffers per worker thread plus one for the 0 thread
+  // (the main thread, or in an single-threaded program, the only thread).
   t->_lf_number_of_trace_buffers = max_num_local_threads;
-  t->_lf_trace_buffer =
-      (trace_record_nodeps_t**)malloc(sizeof(trace_record_nodeps_t*) * (t->_lf_number_of_trace_buffers + 1));
-  t->_lf_trace_buffer++; // the buffer at index -1 is a fallback for user threads.
-  for (int i = -1; i < (int)t->_lf_number_of_trace_buffers; i++) {
-    t->_lf_trace_buffer[i] = (trace_record_nodeps_t*)malloc(sizeof(trace_record_nodeps_t) * TRACE_BUFFER_CAPACITY);
+  t->_lf_trace_buffers =
+      (trace_thread_buffers_t*)calloc(t->_lf_number_of_trace_buffers, sizeof(trace_thread_buffers_t));
+  for (size_t i = 0; i < t->_lf_number_of_trace_buffers; i++) {
+    for (int j = 0; j < 2; j++) {
+      t->_lf_trace_buffers[i].buffers[j].records =
+          (trace_record_nodeps_t*)malloc(sizeof(trace_record_nodeps_t) * TRACE_BUFFER_CAPACITY);
+      t->_lf_trace_buffers[i].buffers[j].worker = (int)i;
+    }
+  }
+  // Buffers shared by user threads.
+  for (int i = 0; i < TRACE_SHARED_BUFFERS; i++) {
+    t->_lf_trace_shared_buffers[i].records =
+        (trace_record_nodeps_t*)malloc(sizeof(trace_record_nodeps_t) * TRACE_BUFFER_CAPACITY);
+    t->_lf_trace_shared_buffers[i].worker = -1;
+  }
+  t->_lf_trace_shared_current = 0;
+  install_shared_trace_buffer_locked(t, 0);
+
+  // Scratch space for turning a full buffer into a block of the file.
+  t->_lf_trace_encoded = (uint8_t*)malloc(TRACE_RECORD_MAX_ENCODED_SIZE * TRACE_BUFFER_CAPACITY);
+  t->_lf_trace_compressed = (uint8_t*)malloc(TRACE_RECORD_MAX_ENCODED_SIZE * TRACE_BUFFER_CAPACITY);
+  t->_lf_trace_index = NULL;
+  t->_lf_trace_index_size = 0;
+  t->_lf_trace_index_capacity = 0;
+
+  // A thread waits for a buffer to be written only when it needs it again,
+  // so every buffer may be queued at the same time.
+  t->_lf_trace_queue_capacity = 2 * t->_lf_number_of_trace_buffers + TRACE_SHARED_BUFFERS;
+  t->_lf_trace_queue = (trace_buffer_t**)calloc(t->_lf_trace_queue_capacity, sizeof(trace_buffer_t*));
+  t->_lf_trace_queue_head = 0;
+  t->_lf_trace_queue_size = 0;
+
+  // Partially filled buffers are written periodically only if asked for, or
+  // by default when consumers may be streaming the trace.
+  int64_t flush_ms = t->_lf_trace_stream.listener >= 0 ? TRACE_FLUSH_INTERVAL_MS : 0;
+  const char* flush_setting = getenv("LF_TRACE_FLUSH_MS");
+  if (flush_setting != NULL && flush_setting[0] != '\0') {
+    char* end;
+    long long value = strtoll(flush_setting, &end, 10);
+    if (*end == '\0' && value >= 0 && value <= INT64_MAX / 1000000) {
+      flush_ms = value;
+    } else {
+      fprintf(stderr, "WARNING: Ignoring invalid LF_TRACE_FLUSH_MS value %s.\n", flush_setting);
+    }
+  }
+  t->_lf_trace_flush_interval_ns = flush_ms * 1000000LL;
+
+  // Start the writer thread. Without threads (e.g. in a single-threaded
+  // build), full buffers are written by the thread that fills them.
+  t->_lf_trace_writer_stop = false;
+  t->_lf_trace_buffer_ready = lf_platform_cond_new(trace_mutex);
+  t->_lf_trace_buffer_written = lf_platform_cond_new(trace_mutex);
+  t->_lf_trace_writer = NULL;
+  if (t->_lf_trace_buffer_ready != NULL && t->_lf_trace_buffer_written != NULL) {
+    t->_lf_trace_writer = lf_platform_thread_new(trace_writer, t);
+  }
+  if (t->_lf_trace_writer == NULL) {
+    LF_PRINT_DEBUG("No trace writer thread. Trace buffers will be written synchronously.");
   }
-  // Array of counters that track the size of each trace record (per thread).
-  t->_lf_trace_buffer_size = (size_t*)calloc(t->_lf_number_of_trace_buffers + 1, sizeof(size_t));
-  t->_lf_trace_buffer_size++;
 
   t->_lf_trace_stop = 0;
   LF_PRINT_DEBUG("Started tracing.");
@@ -174,6 +522,16 @@ static void trace_new(char* filename) {
   } else {
     LF_PRINT_DEBUG("Opened trace file %s.", trace.filename);
   }
+  // The stream socket is named after the file, without the extension.
+  char name[TRACE_MAX_FILENAME_LENGTH];
+  strncpy(name, filename, sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+  char* extension = strrchr(name, '.');
+  if (extension != NULL)
+    *extension = '\0';
+  if (lf_trace_stream_open(&trace._lf_trace_stream, name)) {
+    LF_PRINT_DEBUG("Streaming trace to %s.", trace._lf_trace_stream.path);
+  }
 }
 
 static void stop_trace_locked(trace_t* trace) {
@@ -181,13 +539,33 @@ static void stop_trace_locked(trace_t* trace) {
     // Trace was already stopped. Nothing to do.
     return;
   }
-  for (int i = -1; i < (int)trace->_lf_number_of_trace_buffers; i++) {
-    // Flush the buffer if it has data.
-    LF_PRINT_DEBUG("Trace buffer %d has %zu records.", i, trace->_lf_trace_buffer_size[i]);
-    if (trace->_lf_trace_buffer_size && trace->_lf_trace_buffer_size[i] > 0) {
-      flush_trace_locked(trace, i);
+  // Flush the partially filled buffers. The writer thread has finished.
+  for (size_t i = 0; i < trace->_lf_number_of_trace_buffers; i++) {
+    for (int j = 0; j < 2; j++) {
+      LF_PRINT_DEBUG("Trace buffer %zu.%d has %zu records.", i, j, trace->_lf_trace_buffers[i].buffers[j].size);
+      flush_trace_locked(trace, &trace->_lf_trace_buffers[i].buffers[j]);
     }
   }
+  // The shared buffer being filled has as many records as claimed slots, unless it is full or closed.
+  uint64_t current = __atomic_load_n(&trace->_lf_trace_shared_current, __ATOMIC_ACQUIRE);
+  trace_buffer_t* shared = &trace->_lf_trace_shared_buffers[current & TRACE_SHARED_LOW_MASK];
+  size_t claimed = (size_t)(__atomic_load_n(&shared->reserved, __ATOMIC_ACQUIRE) & TRACE_SHARED_LOW_MASK);
+  if (claimed < TRACE_BUFFER_CAPACITY) {
+    shared->size = claimed;
+  }
+  for (int i = 0; i < TRACE_SHARED_BUFFERS; i++) {
+    flush_trace_locked(trace, &trace->_lf_trace_shared_buffers[i]);
+  }
+  write_trace_index_locked(trace);
+  lf_trace_stream_close(&trace->_lf_trace_stream);
+  free(trace->_lf_trace_header);
+  trace->_lf_trace_header = NULL;
+  free(trace->_lf_trace_index);
+  free(trace->_lf_trace_encoded);
+  free(trace->_lf_trace_compressed);
+  trace->_lf_trace_index = NULL;
+  trace->_lf_trace_encoded = NULL;
+  trace->_lf_trace_compressed = NULL;
   trace->_lf_trace_stop = 1;
   if (trace->_lf_trace_file != NULL) {
     fclose(trace->_lf_trace_file);
@@ -197,7 +575,29 @@ static void stop_trace_locked(trace_t* trace) {
 }
 
 static void stop_trace(trace_t* trace) {
+  // Let the writer thread drain its queue and exit.
+  lf_platform_mutex_lock(trace_mutex);
+  trace->_lf_trace_writer_stop = true;
+  lf_platform_thread_ptr_t writer = trace->_lf_trace_writer;
+  if (writer != NULL) {
+    lf_platform_cond_broadcast(trace->_lf_trace_buffer_ready);
+  }
+  lf_platform_mutex_unlock(trace_mutex);
+  if (writer != NULL) {
+    lf_platform_thread_join(writer);
+  }
+
   lf_platform_mutex_lock(trace_mutex);
+  trace->_lf_trace_writer = NULL;
+  // Buffers queued after the writer exited are flushed below with the rest.
+  while (trace->_lf_trace_queue_size > 0) {
+    trace->_lf_trace_queue[trace->_lf_trace_queue_head]->in_flight = false;
+    trace->_lf_trace_queue_head = (trace->_lf_trace_queue_head + 1) % trace->_lf_trace_queue_capacity;
+    trace->_lf_trace_queue_size--;
+  }
+  if (writer != NULL) {
+    lf_platform_cond_broadcast(trace->_lf_trace_buffer_written);
+  }
   stop_trace_locked(trace);
   lf_platform_mutex_unlock(trace_mutex);
 }
@@ -221,33 +621,31 @@ void lf_tracing_register_trace_event(object_description_t description) {
 
 void lf_tracing_tracepoint(int worker, trace_record_nodeps_t* tr) {
   (void)worker;
-  // Worker argument determines which buffer to write to.
+  // The thread ID determines which buffer to write to.
   int tid = lf_thread_id();
   if (tid < 0) {
     // The current thread was created by the user. It is not managed by LF, its ID is not known,
     // and most importantly it does not count toward the limit on the total number of threads.
-    // Therefore we should fall back to using a mutex.
-    lf_platform_mutex_lock(trace_mutex);
+    // Therefore it shares buffers with other such threads.
+    tracepoint_shared(&trace, tr);
+    return;
   }
-  if (tid > (int)trace._lf_number_of_trace_buffers) {
+  if (tid >= (int)trace._lf_number_of_trace_buffers) {
     lf_print_error_and_exit("the thread id (%d) exceeds the number of trace buffers (%zu)", tid,
                             trace._lf_number_of_trace_buffers);
   }
 
-  // Flush the buffer if it is full.
-  if (trace._lf_trace_buffer_size[tid] >= TRACE_BUFFER_CAPACITY) {
-    // No more room in the buffer. Write the buffer to the file.
-    flush_trace(&trace, tid);
+  trace_thread_buffers_t* pair = &trace._lf_trace_buffers[tid];
+  trace_buffer_t* buffer = &pair->buffers[pair->active];
+  if (buffer->size >= TRACE_BUFFER_CAPACITY) {
+    // No more room in the buffer. Hand it to the writer thread.
+    buffer = swap_trace_buffer(&trace, tid);
   }
-  // The above flush_trace resets the write pointer.
-  int i = trace._lf_trace_buffer_size[tid];
-  // Write to memory buffer.
-  // Get the correct time of the event
-
-  trace._lf_trace_buffer[tid][i] = *tr;
-  trace._lf_trace_buffer_size[tid]++;
-  if (tid < 0) {
-    lf_platform_mutex_unlock(trace_mutex);
+  buffer->records[buffer->size++] = *tr;
+  if (__atomic_load_n(&pair->flush_requested, __ATOMIC_RELAXED)) {
+    // The flush interval has passed. Hand the records so far to the writer thread.
+    __atomic_store_n(&pair->flush_requested, false, __ATOMIC_RELAXED);
+    swap_trace_buffer(&trace, tid);
   }
 }
 
@@ -271,5 +669,7 @@ void lf_tracing_global_init(char* process_name, char* process_names, int fedid,
 void lf_tracing_set_start_time(int64_t time) { start_time = time; }
 void lf_tracing_global_shutdown() {
   stop_trace(&trace);
+  lf_platform_cond_free(trace._lf_trace_buffer_ready);
+  lf_platform_cond_free(trace._lf_trace_buffer_written);
   lf_platform_mutex_free(trace_mutex);
 }
@@ -0,0 +1,194 @@
+/**
+ * @file trace_stream.c
+ *
+ * @brief Streaming of trace blocks to live consumers. See trace_stream.h.
+ */
+#define _DEFAULT_SOURCE // Needed for lstat and S_ISSOCK when compiling strictly to C11
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace_stream.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#ifdef MSG_NOSIGNAL
+#define TRACE_STREAM_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+#else
+#define TRACE_STREAM_SEND_FLAGS MSG_DONTWAIT
+#endif
+
+/**
+ * Send the specified parts to a consumer without blocking the caller for more than TRACE_STREAM_TIMEOUT_MS.
+ * @param skippable Whether the parts may be skipped if the consumer cannot take any of them right away.
+ * @return 1 if sent, 0 if skipped, or -1 if the consumer must be disconnected.
+ */
+static int send_parts(int fd, struct iovec* parts, int count, bool skippable) {
+  size_t sent = 0;
+  int waited = 0;
+  while (count > 0) {
+    struct msghdr message = {.msg_iov = parts, .msg_iovlen = count};
+    ssize_t result = sendmsg(fd, &message, TRACE_STREAM_SEND_FLAGS);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        return -1;
+      if (sent == 0 && skippable)
+        return 0;
+      if (waited >= TRACE_STREAM_TIMEOUT_MS)
+        return -1;
+      // Part of the message is in the socket, so the rest must follow.
+      struct pollfd writable = {.fd = fd, .events = POLLOUT};
+      poll(&writable, 1, 10);
+      waited += 10;
+      continue;
+    }
+    sent += (size_t)result;
+    // Skip the parts that were sent completely.
+    while (count > 0 && (size_t)result >= parts->iov_len) {
+      result -= (ssize_t)parts->iov_len;
+      parts++;
+      count--;
+    }
+    if (count > 0) {
+      parts->iov_base = (char*)parts->iov_base + result;
+      parts->iov_len -= (size_t)result;
+    }
+  }
+  return 1;
+}
+
+bool lf_trace_stream_open(trace_stream_t* stream, const char* name) {
+  stream->listener = -1;
+  stream->dropped = 0;
+  for (int i = 0; i < TRACE_STREAM_MAX_CONSUMERS; i++) {
+    stream->consumers[i] = -1;
+  }
+  const char* directory = getenv("LF_TRACE_STREAM_DIR");
+  if (directory == NULL || directory[0] == '\0')
+    return false;
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  int length = snprintf(stream->path, sizeof(stream->path), "%s/%s.sock", directory, name);
+  if (length < 0 || (size_t)length >= sizeof(stream->path) || (size_t)length >= sizeof(address.sun_path)) {
+    fprintf(stderr, "WARNING: Trace stream socket path in %s is too long. No trace will be streamed.\n", directory);
+    return false;
+  }
+  memcpy(address.sun_path, stream->path, (size_t)length + 1);
+
+  // Replace a socket left behind by an earlier run, but nothing else.
+  struct stat status;
+  if (lstat(stream->path, &status) == 0 && S_ISSOCK(status.st_mode)) {
+    unlink(stream->path);
+  }
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      listen(listener, TRACE_STREAM_MAX_CONSUMERS) != 0 ||
+      fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK) != 0) {
+    fprintf(stderr, "WARNING: Failed to listen on trace stream socket %s with error code %d. No trace will be streamed.\n",
+            stream->path, errno);
+    if (listener >= 0)
+      close(listener);
+    return false;
+  }
+  stream->listener = listener;
+  return true;
+}
+
+void lf_trace_stream_accept(trace_stream_t* stream, const uint8_t* header, size_t header_size) {
+  if (stream->listener < 0)
+    return;
+  int fd;
+  while ((fd = accept(stream->listener, NULL, NULL)) >= 0) {
+    int slot = 0;
+    while (slot < TRACE_STREAM_MAX_CONSUMERS && stream->consumers[slot] >= 0) {
+      slot++;
+    }
+    if (slot == TRACE_STREAM_MAX_CONSUMERS) {
+      fprintf(stderr, "WARNING: Too many trace stream consumers. Rejecting a new one.\n");
+      close(fd);
+      continue;
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    // Room for a few blocks lets a consumer fall briefly behind without missing any.
+    int buffer_size = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    struct iovec part = {.iov_base = (void*)header, .iov_len = header_size};
+    if (send_parts(fd, &part, 1, false) < 0) {
+      close(fd);
+      continue;
+    }
+    stream->consumers[slot] = fd;
+  }
+}
+
+void lf_trace_stream_send(trace_stream_t* stream, const trace_block_header_t* block, const uint8_t* stored) {
+  for (int i = 0; i < TRACE_STREAM_MAX_CONSUMERS; i++) {
+    if (stream->consumers[i] < 0)
+      continue;
+    struct iovec parts[2] = {{.iov_base = (void*)block, .iov_len = sizeof(trace_block_header_t)},
+                             {.iov_base = (void*)stored, .iov_len = block->stored_size}};
+    int result = send_parts(stream->consumers[i], parts, 2, true);
+    if (result == 0) {
+      stream->dropped++;
+    } else if (result < 0) {
+      close(stream->consumers[i]);
+      stream->consumers[i] = -1;
+    }
+  }
+}
+
+void lf_trace_stream_close(trace_stream_t* stream) {
+  if (stream->listener < 0)
+    return;
+  for (int i = 0; i < TRACE_STREAM_MAX_CONSUMERS; i++) {
+    if (stream->consumers[i] >= 0) {
+      close(stream->consumers[i]);
+      stream->consumers[i] = -1;
+    }
+  }
+  close(stream->listener);
+  stream->listener = -1;
+  unlink(stream->path);
+  if (stream->dropped > 0) {
+    fprintf(stderr, "WARNING: Trace stream consumers missed %llu blocks.\n", (unsigned long long)stream->dropped);
+  }
+}
+
+#else // Platforms without Unix domain sockets.
+
+bool lf_trace_stream_open(trace_stream_t* stream, const char* name) {
+  (void)name;
+  stream->listener = -1;
+  if (getenv("LF_TRACE_STREAM_DIR") != NULL) {
+    fprintf(stderr, "WARNING: Trace streaming is not supported on this platform.\n");
+  }
+  return false;
+}
+
+void lf_trace_stream_accept(trace_stream_t* stream, const uint8_t* header, size_t header_size) {
+  (void)stream;
+  (void)header;
+  (void)header_size;
+}
+
+void lf_trace_stream_send(trace_stream_t* stream, const trace_block_header_t* block, const uint8_t* stored) {
+  (void)stream;
+  (void)block;
+  (void)stored;
+}
+
+void lf_trace_stream_close(trace_stream_t* stream) { (void)stream; }
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ * @file
+ *
+ * @brief Standalone program to convert a master scheduler binary event log to text.
+ *
+ * Usage: ms_log_decode <log.bin> [text_log]
+ *
+ * Records are sorted by timestamp and printed in the same
+ * `mono,LEVEL,event=... key=value` format as the text log. If a text log is
+ * given, its lines are merged in timestamp order, so the output reads like a
+ * text-only run. Binary records do not carry the ready_set listing; it is
+ * printed as `-`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "master_scheduler.h"
+#include "master_scheduler_binlog.h"
+
+typedef struct {
+  int64_t mono_ns;
+  size_t seq; // Input order, to keep the sort stable.
+  const ms_bin_record_t* record;
+  const char* text;
+} out_line_t;
+
+static const char* level_str(int level) {
+  switch (level) {
+  case MS_LEVEL_ERROR:
+    return "ERROR";
+  case MS_LEVEL_WARN:
+    return "WARN";
+  case MS_LEVEL_INFO:
+    return "INFO";
+  case MS_LEVEL_DEBUG:
+    return "DEBUG";
+  default:
+    return "UNKNOWN";
+  }
+}
+
+static void print_record(FILE* out, const ms_bin_record_t* r) {
+  fprintf(out, "%lld,%s,", (long long)r->mono_ns, level_str(r->level));
+  const unsigned long long key = (unsigned long long)r->key;
+  switch (r->event) {
+  case MS_BIN_EV_READY:
+    fprintf(out, "event=ready env=%d reaction_index=%llu logical=%lld deadline=%lld is_input=%d updated=%d", r->env_id,
+            key, (long long)r->a, (long long)r->b, r->i0, r->i1);
+    break;
+  case MS_BIN_EV_READY_DROP:
+    fprintf(out, "event=ready_drop env=%d reaction_index=%llu logical=%lld deadline=%lld is_input=%d", r->env_id, key,
+            (long long)r->a, (long long)r->b, r->i0);
+    break;
+  case MS_BIN_EV_PICK_NEXT:
+    fprintf(out,
+            "event=pick_next env=%d candidate=%llu reason=%s deadline=%lld ready_time=%lld logical=%lld "
+            "ready_count=%d ready_set=-",
+            r->env_id, key, r->i0 ? "hc_first" : "earliest_deadline", (long long)r->b, (long long)r->c,
+            (long long)r->a, r->i1);
+    break;
+  case MS_BIN_EV_PICK_OBSERVE_ONLY:
+    fprintf(out, "event=pick_next env=%d candidate=-1 reason=observe_only logical=%lld", r->env_id, (long long)r->a);
+    break;
+  case MS_BIN_EV_FALLBACK_NO_CAND:
+    fprintf(out, "event=fallback env=%d reason=no_candidate logical=%lld ready_count=%d ready_set=-", r->env_id,
+            (long long)r->a, r->i1);
+    break;
+  case MS_BIN_EV_RUNTIME_SELECTED:
+    fprintf(out, "event=runtime_selected env=%d reaction_index=%llu physical=%lld ready_found=%d", r->env_id, key,
+            (long long)r->a, r->i0);
+    break;
+  case MS_BIN_EV_SELECTED_MISSING:
+    fprintf(out, "event=runtime_selected_missing env=%d reaction_index=%llu physical=%lld", r->env_id, key,
+            (long long)r->a);
+    break;
+  case MS_BIN_EV_MISMATCH:
+    fprintf(out, "event=mismatch env=%d picked=%lld runtime=%llu", r->env_id, (long long)r->a, key);
+    break;
+  case MS_BIN_EV_MISSING_ON_END:
+    fprintf(out, "event=ready_missing_on_end env=%d reaction_index=%llu", r->env_id, key);
+    break;
+  case MS_BIN_EV_FALLBACK_NO_META:
+    fprintf(out,
+            "event=fallback env=%d reason=missing_metadata logical=%lld reaction_index=%llu ready_count=%d "
+            "ready_set=-",
+            r->env_id, (long long)r->a, key, r->i1);
+    break;
+  case MS_BIN_EV_DEGRADE_SKIP:
+    fprintf(out,
+            "event=degrade action=skip reason=pressure env=%d logical=%lld reaction_index=%llu ready_count=%d "
+            "ready_set=-",
+            r->env_id, (long long)r->a, key, r->i1);
+    break;
+  case MS_BIN_EV_DEGRADE_DBG:
+    fprintf(out, "event=degrade_dbg env=%d rid=%llu crit=%d degradable=%d pressure=%d has_hc_ready=%d ready_count=%d",
+            r->env_id, key, r->i0, r->i1, r->i2, (int)r->a, (int)r->b);
+    break;
+  case MS_BIN_EV_REPORT:
+    fprintf(out,
+            "event=report worker_id=%d reactor_id=%d reaction_id=%d logical=%lld physical=%lld lag=%lld ready_q=%d "
+            "miss=%lld",
+            r->worker_id, r->i0, r->i1, (long long)r->a, (long long)r->b, (long long)r->c, r->i2, (long long)r->key);
+    break;
+  case MS_BIN_EV_DROPPED:
+    fprintf(out, "event=binlog_dropped count=%llu", key);
+    break;
+  case MS_BIN_EV_CHAIN:
+    fprintf(out, "event=chain env=%d worker=%d first=%llu length=%d start=%lld end=%lld", r->env_id, r->worker_id, key,
+            r->i0, (long long)r->a, (long long)r->b);
+    break;
+  default:
+    fprintf(out, "event=binlog_unknown type=%u", (unsigned)r->event);
+    break;
+  }
+  fputc('\n', out);
+}
+
+static int compare_lines(const void* a, const void* b) {
+  const out_line_t* x = (const out_line_t*)a;
+  const out_line_t* y = (const out_line_t*)b;
+  if (x->mono_ns != y->mono_ns)
+    return (x->mono_ns < y->mono_ns) ? -1 : 1;
+  return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+static void* read_all(const char* path, size_t* size) {
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char* data = (char*)malloc((size_t)len + 1);
+  if (data == NULL || fread(data, 1, (size_t)len, f) != (size_t)len) {
+    fprintf(stderr, "Cannot read %s\n", path);
+    fclose(f);
+    free(data);
+    return NULL;
+  }
+  data[len] = '\0';
+  fclose(f);
+  *size = (size_t)len;
+  return data;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s <log.bin> [text_log]\n", argv[0]);
+    return 1;
+  }
+  size_t bin_size = 0;
+  char* bin = (char*)read_all(argv[1], &bin_size);
+  if (bin == NULL)
+    return 1;
+  const ms_bin_file_header_t* header = (const ms_bin_file_header_t*)bin;
+  if (bin_size < sizeof(*header) || memcmp(header->magic, MS_BIN_MAGIC, sizeof(header->magic)) != 0) {
+    fprintf(stderr, "%s is not a master scheduler binary log\n", argv[1]);
+    return 1;
+  }
+  if (header->version != MS_BIN_VERSION || header->record_size != sizeof(ms_bin_record_t)) {
+    fprintf(stderr, "Unsupported binary log version %u (record size %u)\n", header->version, header->record_size);
+    return 1;
+  }
+  const ms_bin_record_t* records = (const ms_bin_record_t*)(bin + sizeof(*header));
+  const size_t num_records = (bin_size - sizeof(*header)) / sizeof(ms_bin_record_t);
+
+  char* text = NULL;
+  size_t text_size = 0;
+  size_t num_text = 0;
+  if (argc == 3) {
+    text = (char*)read_all(argv[2], &text_size);
+    if (text == NULL)
+      return 1;
+    for (size_t i = 0; i < text_size; i++) {
+      if (text[i] == '\n')
+        num_text++;
+    }
+    num_text++;
+  }
+
+  out_line_t* lines = (out_line_t*)calloc(num_records + num_text, sizeof(out_line_t));
+  size_t count = 0;
+  for (size_t i = 0; i < num_records; i++, count++) {
+    lines[count].mono_ns = records[i].mono_ns;
+    lines[count].seq = count;
+    lines[count].record = &records[i];
+  }
+  // Text lines without a leading timestamp (e.g. "# ..." banners) keep the
+  // timestamp of the line before them.
+  int64_t last_mono = 0;
+  for (char* line = text; line != NULL && *line != '\0';) {
+    char* end = strchr(line, '\n');
+    if (end != NULL)
+      *end = '\0';
+    char* after = NULL;
+    long long mono = strtoll(line, &after, 10);
+    if (after != line && *after == ',')
+      last_mono = mono;
+    lines[count].mono_ns = last_mono;
+    lines[count].seq = count;
+    lines[count].text = line;
+    count++;
+    line = (end != NULL) ? end + 1 : NULL;
+  }
+
+  qsort(lines, count, sizeof(out_line_t), compare_lines);
+  for (size_t i = 0; i < count; i++) {
+    if (lines[i].record != NULL) {
+      print_record(stdout, lines[i].record);
+    } else {
+      printf("%s\n", lines[i].text);
+    }
+  }
+  free(lines);
+  free(text);
+  free(bin);
+  return 0;
+}
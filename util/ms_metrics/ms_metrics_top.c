@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief Sample the live metrics page of a running Lingua Franca program.
+ *
+ * The program must run with `LF_MS_METRICS=1`. Its page is
+ * `/dev/shm/lf_ms_metrics.<pid>` unless `LF_MS_METRICS_PATH` says otherwise.
+ * The page is mapped read-only and records are copied under their seqlocks,
+ * so sampling never blocks or slows the program, even at kHz rates.
+ *
+ * Usage: ms_metrics_top [-r rate_hz] [-n samples] [-c] [-R] page
+ *
+ *   -r rate_hz  Samples per second (default: 1).
+ *   -n samples  Stop after this many samples (default: until the program exits).
+ *   -c          Print CSV rows instead of a table.
+ *   -R          Include per-reaction rows in CSV output.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "master_scheduler_metrics.h"
+
+static void usage(void) {
+  fprintf(stderr, "Usage: ms_metrics_top [-r rate_hz] [-n samples] [-c] [-R] page\n");
+  exit(EXIT_FAILURE);
+}
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadline_ns) {
+  struct timespec ts = {.tv_sec = deadline_ns / 1000000000LL, .tv_nsec = deadline_ns % 1000000000LL};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+  }
+}
+
+static const ms_metrics_page_t* map_page(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ms_metrics_page_t)) {
+    fprintf(stderr, "%s is not a metrics page (size mismatch).\n", path);
+    close(fd);
+    return NULL;
+  }
+  void* mapped = mmap(NULL, sizeof(ms_metrics_page_t), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    fprintf(stderr, "Cannot map %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+  const ms_metrics_page_t* page = (const ms_metrics_page_t*)mapped;
+  if (memcmp(page->header.magic, MS_METRICS_MAGIC, sizeof(page->header.magic)) != 0 ||
+      page->header.version != MS_METRICS_VERSION || page->header.size != sizeof(ms_metrics_page_t)) {
+    fprintf(stderr, "%s is not a version %d metrics page.\n", path, MS_METRICS_VERSION);
+    munmap(mapped, sizeof(ms_metrics_page_t));
+    return NULL;
+  }
+  return page;
+}
+
+static void print_csv(const ms_metrics_page_t* page, int64_t t, int with_reactions) {
+  ms_metrics_env_t e;
+  for (int i = 0; i < MS_METRICS_MAX_ENVS; i++) {
+    if (!__atomic_load_n(&page->envs[i].active, __ATOMIC_RELAXED) || !ms_metrics_read_env(page, i, &e)) continue;
+    printf("%lld,env,%d,%lld,%u,%lld,%d,%llu,%lld\n", (long long)t, i, (long long)e.tag_time_ns, e.tag_microstep,
+           (long long)e.lag_ns, e.ready_q_len, (unsigned long long)e.deadline_misses, (long long)e.ptdv_ns);
+  }
+  ms_metrics_worker_t w;
+  for (int i = 0; i < MS_METRICS_MAX_WORKERS; i++) {
+    if (!__atomic_load_n(&page->workers[i].active, __ATOMIC_RELAXED) || !ms_metrics_read_worker(page, i, &w))
+      continue;
+    printf("%lld,worker,%d,%d,%llu,%lld,%llu\n", (long long)t, i, w.env_id, (unsigned long long)w.reactions_run,
+           (long long)w.busy_ns, (unsigned long long)w.current_reaction);
+  }
+  if (!with_reactions) return;
+  for (int i = 0; i < MS_METRICS_MAX_REACTIONS; i++) {
+    const ms_metrics_reaction_t* r = &page->reactions[i];
+    uint64_t key = __atomic_load_n(&r->key, __ATOMIC_ACQUIRE);
+    if (key == 0) continue;
+    printf("%lld,reaction,%llu,%d,%llu,%llu\n", (long long)t, (unsigned long long)key,
+           __atomic_load_n(&r->env_id, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&r->invocations, __ATOMIC_RELAXED),
+           (unsigned long long)__atomic_load_n(&r->deadline_misses, __ATOMIC_RELAXED));
+  }
+}
+
+static void print_table(const ms_metrics_page_t* page, int64_t t) {
+  printf("--- pid %lld, %.3f s since start\n", (long long)page->header.pid,
+         (double)(t - page->header.start_mono_ns) / 1e9);
+  printf("%4s %20s %6s %14s %12s %8s %10s\n", "env", "tag_ns", "ustep", "lag_ns", "ptdv_ns", "ready_q", "dl_misses");
+  ms_metrics_env_t e;
+  for (int i = 0; i < MS_METRICS_MAX_ENVS; i++) {
+    if (!__atomic_load_n(&page->envs[i].active, __ATOMIC_RELAXED) || !ms_metrics_read_env(page, i, &e)) continue;
+    printf("%4d %20lld %6u %14lld %12lld %8d %10llu\n", i, (long long)e.tag_time_ns, e.tag_microstep,
+           (long long)e.lag_ns, (long long)e.ptdv_ns, e.ready_q_len, (unsigned long long)e.deadline_misses);
+  }
+  printf("%6s %4s %12s %14s %20s\n", "worker", "env", "reactions", "busy_ns", "current");
+  ms_metrics_worker_t w;
+  for (int i = 0; i < MS_METRICS_MAX_WORKERS; i++) {
+    if (!__atomic_load_n(&page->workers[i].active, __ATOMIC_RELAXED) || !ms_metrics_read_worker(page, i, &w))
+      continue;
+    printf("%6d %4d %12llu %14lld %20llu\n", i, w.env_id, (unsigned long long)w.reactions_run, (long long)w.busy_ns,
+           (unsigned long long)w.current_reaction);
+  }
+  uint64_t dropped = __atomic_load_n(&page->header.reactions_dropped, __ATOMIC_RELAXED);
+  if (dropped > 0) {
+    printf("(%llu reaction updates not tracked: table full)\n", (unsigned long long)dropped);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  double rate_hz = 1.0;
+  long long samples = 0;
+  int csv = 0;
+  int with_reactions = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:n:cR")) != -1) {
+    switch (opt) {
+    case 'r':
+      rate_hz = atof(optarg);
+      break;
+    case 'n':
+      samples = atoll(optarg);
+      break;
+    case 'c':
+      csv = 1;
+      break;
+    case 'R':
+      with_reactions = 1;
+      break;
+    default:
+      usage();
+    }
+  }
+  if (optind != argc - 1 || rate_hz <= 0.0) usage();
+
+  const ms_metrics_page_t* page = map_page(argv[optind]);
+  if (page == NULL) return EXIT_FAILURE;
+
+  // Full buffering keeps kHz sampling from being dominated by write calls.
+  static char out_buf[1 << 16];
+  setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+  if (csv) {
+    printf("# env rows:      sample_ns,env,id,tag_ns,microstep,lag_ns,ready_q_len,deadline_misses,ptdv_ns\n");
+    printf("# worker rows:   sample_ns,worker,id,env,reactions_run,busy_ns,current_reaction\n");
+    if (with_reactions) {
+      printf("# reaction rows: sample_ns,reaction,key,env,invocations,deadline_misses\n");
+    }
+  }
+
+  const int64_t period_ns = (int64_t)(1e9 / rate_hz);
+  int64_t next = now_ns();
+  for (long long n = 0; samples == 0 || n < samples; n++) {
+    int64_t t = now_ns();
+    if (csv) {
+      print_csv(page, t, with_reactions);
+    } else {
+      print_table(page, t);
+      fflush(stdout);
+    }
+    if (!__atomic_load_n(&page->header.running, __ATOMIC_ACQUIRE)) break;
+    next += period_ns;
+    sleep_until(next);
+  }
+  fflush(stdout);
+  return EXIT_SUCCESS;
+}
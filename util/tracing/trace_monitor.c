@@ -0,0 +1,366 @@
+/**
+ * @file
+ *
+ * @brief Standalone program that reports reaction latencies of a running Lingua Franca program.
+ *
+ * The program must run with LF_TRACE_STREAM_DIR set (see trace_stream.h). This
+ * connects to its trace stream and, at every interval, prints the execution
+ * times of the reactions that ran in that interval and their lag, which is how
+ * far physical time was ahead of logical time when they started.
+ */
+#define LF_TRACE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "reactor.h"
+#include "trace.h"
+#include "trace_util.h"
+#include "trace_impl.h"
+
+#define MAX_NUM_REACTIONS 64 // Maximum number of reactions per reactor reported.
+#define MAX_NUM_WORKERS 64
+
+/** Not used by this program, but required by trace_util. */
+FILE* trace_file = NULL;
+FILE* output_file = NULL;
+FILE* summary_file = NULL;
+
+/** Socket connected to the program. */
+static int stream = -1;
+
+/** Reporting interval in milliseconds. */
+static int interval = 1000;
+
+/**
+ * Statistics of one reaction over the current interval.
+ */
+typedef struct reaction_window_t {
+  int occurrences;
+  interval_t total_exec_time;
+  interval_t min_exec_time;
+  interval_t max_exec_time;
+  interval_t total_lag;
+  interval_t max_lag;
+  int deadline_misses;
+  /** Occurrences since the monitor connected. */
+  long long total_occurrences;
+} reaction_window_t;
+
+/** Statistics indexed by object table index times MAX_NUM_REACTIONS plus reaction number. */
+static reaction_window_t* windows = NULL;
+
+/** The reaction that each worker is executing, or table_index -1 if none. */
+static struct {
+  int table_index;
+  int reaction;
+  instant_t start;
+} executing[MAX_NUM_WORKERS];
+
+/** Latest logical and physical times seen. */
+static instant_t latest_logical_time = NEVER;
+static instant_t latest_physical_time = NEVER;
+
+/** Number of records received in the current interval. */
+static long long window_records = 0;
+
+/** Buffers for a block: as received, decompressed, and decoded. */
+static uint8_t* stored = NULL;
+static size_t stored_capacity = 0;
+static uint8_t* encoded = NULL;
+static size_t encoded_capacity = 0;
+static trace_record_nodeps_t* records = NULL;
+static size_t records_capacity = 0;
+
+/**
+ * Print a usage message.
+ */
+void usage() {
+  printf("\nUsage: trace_monitor [options] socket (with .sock extension)\n\n");
+  printf("The socket is in the directory given by LF_TRACE_STREAM_DIR to the traced program.\n\n");
+  printf("\nOptions: \n\n");
+  printf("  -i, --interval [seconds]\n");
+  printf("   The time between reports. The default is 1.\n\n");
+  printf("\n\n");
+}
+
+/**
+ * Exit on data that is not a valid trace stream.
+ */
+static void stream_failure() {
+  fprintf(stderr, "ERROR: The trace stream is corrupt.\n");
+  exit(1);
+}
+
+/**
+ * Make room for the specified number of bytes in a buffer.
+ */
+static void reserve(void** buffer, size_t* capacity, size_t size) {
+  if (size <= *capacity)
+    return;
+  void* grown = realloc(*buffer, size);
+  if (grown == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+    exit(3);
+  }
+  *buffer = grown;
+  *capacity = size;
+}
+
+/**
+ * Receive exactly the specified number of bytes from the stream.
+ * @return false if the program closed the stream.
+ */
+static bool receive(void* destination, size_t size) {
+  uint8_t* position = (uint8_t*)destination;
+  while (size > 0) {
+    ssize_t received = read(stream, position, size);
+    if (received < 0 && errno == EINTR)
+      continue;
+    if (received <= 0)
+      return false;
+    position += received;
+    size -= (size_t)received;
+  }
+  return true;
+}
+
+/**
+ * Receive the header of the trace and read the object table from it.
+ */
+static void receive_header() {
+  uint8_t* header = NULL;
+  size_t capacity = 0;
+  size_t size = TRACE_FILE_MAGIC_LENGTH + sizeof(uint32_t) + sizeof(instant_t) + sizeof(int);
+  reserve((void**)&header, &capacity, size);
+  if (!receive(header, size) || memcmp(header, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH) != 0) {
+    fprintf(stderr, "ERROR: The socket is not a trace stream.\n");
+    exit(1);
+  }
+  int table_size;
+  memcpy(&table_size, header + size - sizeof(int), sizeof(int));
+  for (int i = 0; i < table_size; i++) {
+    // The pointers and the type, then the null-terminated description.
+    size_t fixed = 2 * sizeof(void*) + sizeof(_lf_trace_object_t);
+    reserve((void**)&header, &capacity, size + fixed);
+    if (!receive(header + size, fixed))
+      stream_failure();
+    size += fixed;
+    do {
+      reserve((void**)&header, &capacity, 2 * (size + 1));
+      if (!receive(header + size, 1))
+        stream_failure();
+    } while (header[size++] != '\0');
+  }
+  read_header_from_memory(header, size);
+  free(header);
+  windows = (reaction_window_t*)calloc((size_t)(object_table_size + 1) * MAX_NUM_REACTIONS, sizeof(reaction_window_t));
+  if (windows == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+    exit(3);
+  }
+  for (int i = 0; i < MAX_NUM_WORKERS; i++) {
+    executing[i].table_index = -1;
+  }
+}
+
+/**
+ * Update the statistics with one record.
+ */
+static void monitor_record(trace_record_nodeps_t* record) {
+  int worker = record->src_id;
+  int reaction = record->dst_id;
+  if (record->event_type != reaction_starts && record->event_type != reaction_ends &&
+      record->event_type != reaction_deadline_missed)
+    return;
+  int table_index;
+  if (get_object_description(record->pointer, &table_index) == NULL || reaction < 0 ||
+      reaction >= MAX_NUM_REACTIONS || worker < 0 || worker >= MAX_NUM_WORKERS)
+    return;
+  reaction_window_t* window = &windows[table_index * MAX_NUM_REACTIONS + reaction];
+  switch (record->event_type) {
+  case reaction_starts:
+    executing[worker].table_index = table_index;
+    executing[worker].reaction = reaction;
+    executing[worker].start = record->physical_time;
+    break;
+  case reaction_ends:
+    // Ignore ends whose start was sent before the monitor connected or was missed.
+    if (executing[worker].table_index == table_index && executing[worker].reaction == reaction) {
+      interval_t exec_time = record->physical_time - executing[worker].start;
+      interval_t lag = executing[worker].start - record->logical_time;
+      if (window->occurrences == 0 || exec_time < window->min_exec_time)
+        window->min_exec_time = exec_time;
+      if (window->occurrences == 0 || exec_time > window->max_exec_time)
+        window->max_exec_time = exec_time;
+      if (window->occurrences == 0 || lag > window->max_lag)
+        window->max_lag = lag;
+      window->total_exec_time += exec_time;
+      window->total_lag += lag;
+      window->occurrences++;
+      window->total_occurrences++;
+    }
+    executing[worker].table_index = -1;
+    break;
+  default:
+    window->deadline_misses++;
+    break;
+  }
+}
+
+/**
+ * Receive one block and update the statistics with its records.
+ * @return false if the program closed the stream.
+ */
+static bool monitor_block() {
+  trace_block_header_t block;
+  if (!receive(&block, sizeof(block)))
+    return false;
+  reserve((void**)&stored, &stored_capacity, block.stored_size);
+  if (!receive(stored, block.stored_size))
+    return false;
+  const uint8_t* source = stored;
+  if (block.stored_size < block.encoded_size) {
+    reserve((void**)&encoded, &encoded_capacity, block.encoded_size);
+    if (lf_trace_decompress(stored, block.stored_size, encoded, block.encoded_size) != (int64_t)block.encoded_size)
+      stream_failure();
+    source = encoded;
+  }
+  size_t records_size = sizeof(trace_record_nodeps_t) * block.record_count;
+  reserve((void**)&records, &records_capacity, records_size);
+  if (lf_trace_decode_records(source, block.encoded_size, records, block.record_count) != 0)
+    stream_failure();
+  for (uint32_t i = 0; i < block.record_count; i++) {
+    monitor_record(&records[i]);
+  }
+  window_records += block.record_count;
+  if (block.record_count > 0) {
+    if (block.max_logical_time > latest_logical_time)
+      latest_logical_time = block.max_logical_time;
+    if (block.max_physical_time > latest_physical_time)
+      latest_physical_time = block.max_physical_time;
+  }
+  return true;
+}
+
+/**
+ * Print the statistics of the interval and start a new one.
+ */
+static void report() {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  instant_t now_time = (instant_t)now.tv_sec * BILLION + now.tv_nsec;
+  printf("\n");
+  if (latest_physical_time == NEVER) {
+    printf("No records yet.\n");
+  } else {
+    // The stream is behind by the records still in the buffers of the program.
+    printf("Elapsed logical time: %.3f s. Latest record was produced %.3f s ago. %lld records in the interval.\n",
+           (double)(latest_logical_time - start_time) / BILLION, (double)(now_time - latest_physical_time) / BILLION,
+           window_records);
+  }
+  printf("%-40s %10s %10s %10s %10s %10s %10s %8s %12s\n", "Reaction", "Count", "Mean (us)", "Min (us)", "Max (us)",
+         "Lag (us)", "Max lag", "Missed", "Total count");
+  for (int i = 0; i < object_table_size; i++) {
+    for (int j = 0; j < MAX_NUM_REACTIONS; j++) {
+      reaction_window_t* window = &windows[i * MAX_NUM_REACTIONS + j];
+      if (window->occurrences == 0 && window->deadline_misses == 0)
+        continue;
+      char name[BUFFER_SIZE];
+      snprintf(name, sizeof(name), "%s.reaction_%d", object_table[i].description, j);
+      if (window->occurrences == 0) {
+        printf("%-40s %10d %10s %10s %10s %10s %10s %8d %12lld\n", name, 0, "-", "-", "-", "-", "-",
+               window->deadline_misses, window->total_occurrences);
+      } else {
+        printf("%-40s %10d %10.1f %10.1f %10.1f %10.1f %10.1f %8d %12lld\n", name, window->occurrences,
+               (double)window->total_exec_time / window->occurrences / 1000.0,
+               (double)window->min_exec_time / 1000.0, (double)window->max_exec_time / 1000.0,
+               (double)window->total_lag / window->occurrences / 1000.0, (double)window->max_lag / 1000.0,
+               window->deadline_misses, window->total_occurrences);
+      }
+      long long total_occurrences = window->total_occurrences;
+      memset(window, 0, sizeof(reaction_window_t));
+      window->total_occurrences = total_occurrences;
+    }
+  }
+  window_records = 0;
+  fflush(stdout);
+}
+
+/**
+ * Process the command-line arguments.
+ * @return The path of the socket or NULL if none was given.
+ */
+const char* process_args(int argc, const char* argv[]) {
+  const char* path = NULL;
+  int i = 1;
+  while (i < argc) {
+    const char* arg = argv[i++];
+    if (strcmp(arg, "-i") == 0 || strcmp(arg, "--interval") == 0) {
+      if (argc < i + 1) {
+        printf("-i needs a number of seconds.");
+        usage();
+        return NULL;
+      }
+      interval = (int)(atof(argv[i++]) * 1000);
+      if (interval <= 0) {
+        usage();
+        return NULL;
+      }
+    } else if (strlen(arg) > 5 && strcmp(strrchr(arg, '\0') - 5, ".sock") == 0) {
+      path = arg;
+    } else {
+      usage();
+      exit(0);
+    }
+  }
+  if (path == NULL)
+    usage();
+  return path;
+}
+
+int main(int argc, const char* argv[]) {
+  const char* path = process_args(argc, argv);
+  if (path == NULL)
+    return -1;
+
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "ERROR: Socket path %s is too long.\n", path);
+    return 1;
+  }
+  strcpy(address.sun_path, path);
+  stream = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (stream < 0 || connect(stream, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    fprintf(stderr, "ERROR: Failed to connect to %s with error code %d. Is the program running?\n", path, errno);
+    return 1;
+  }
+  // The program sends the header once it writes its first block.
+  receive_header();
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long long next_report = (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000 + interval;
+  bool open = true;
+  while (open) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long remaining = next_report - ((long long)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+    if (remaining <= 0) {
+      report();
+      next_report += interval;
+      continue;
+    }
+    struct pollfd readable = {.fd = stream, .events = POLLIN};
+    if (poll(&readable, 1, (int)remaining) > 0) {
+      open = monitor_block();
+    }
+  }
+  report();
+  printf("\nThe program closed the trace stream.\n");
+  close(stream);
+  return 0;
+}
@@ -8,7 +8,6 @@
  * To visualize the resulting file, point your chrome browser to chrome://tracing/ and the load the .json file.
  */
 #define LF_TRACE
-#define __STDC_WANT_LIB_EXT2 1 // needed for asprintf
 #include <stdio.h>
 #include <string.h>
 #include "reactor.h"
@@ -37,6 +36,8 @@ void usage() {
   printf("Options: \n");
   printf("  -p, --physical\n");
   printf("   Use only physical time, not logical time, for all horizontal axes.\n");
+  printf("  -j, --jobs [threads]\n");
+  printf("   The number of conversion threads. The default is one per processor.\n");
   printf("\n");
 }
 
@@ -46,188 +47,220 @@ int max_reaction_number = 0;
 /** Indicator to plot vs. physical time only. */
 bool physical_time_only = false;
 
+/** Number of conversion threads, or 0 for one per processor. */
+int threads = 0;
+
 /**
- * Read a trace in the trace_file and write it to the output_file in json.
- * @return The number of records read or 0 upon seeing an EOF.
+ * Maxima seen in one chunk, merged into max_thread_id and max_reaction_number in file order.
  */
-size_t read_and_write_trace() {
-  int trace_length = read_trace();
-  if (trace_length == 0)
-    return 0;
-  // Write each line.
-  for (int i = 0; i < trace_length; i++) {
-    char* reaction_name = "\"UNKNOWN\"";
+typedef struct chunk_maxima_t {
+  int max_thread_id;
+  int max_reaction_number;
+} chunk_maxima_t;
 
-    // Ignore federated trace events.
-    if (trace[i].event_type > federated)
-      continue;
+/**
+ * Write one record of a chunk in json.
+ */
+static void convert_record(trace_chunk_t* chunk, chunk_maxima_t* maxima, trace_record_t* record) {
+  // Ignore federated trace events.
+  if (record->event_type > federated)
+    return;
 
-    if (trace[i].dst_id >= 0) {
-      reaction_name = (char*)malloc(4);
-      snprintf(reaction_name, 4, "%d", trace[i].dst_id);
-    }
-    // printf("DEBUG: Reactor's self struct pointer: %p\n", trace[i].pointer);
-    int reactor_index;
-    char* reactor_name = get_object_description(trace[i].pointer, &reactor_index);
-    if (reactor_name == NULL) {
-      if (trace[i].event_type == worker_wait_starts || trace[i].event_type == worker_wait_ends) {
-        reactor_name = "WAIT";
-      } else if (trace[i].event_type == scheduler_advancing_time_starts ||
-                 trace[i].event_type == scheduler_advancing_time_starts) {
-        reactor_name = "ADVANCE TIME";
-      } else {
-        reactor_name = "NO REACTOR";
-      }
+  char reaction_number[12] = "\"UNKNOWN\"";
+  if (record->dst_id >= 0) {
+    snprintf(reaction_number, sizeof(reaction_number), "%d", record->dst_id);
+  }
+  char* reaction_name = reaction_number;
+  // printf("DEBUG: Reactor's self struct pointer: %p\n", record->pointer);
+  int reactor_index;
+  char* reactor_name = get_object_description(record->pointer, &reactor_index);
+  if (reactor_name == NULL) {
+    if (record->event_type == worker_wait_starts || record->event_type == worker_wait_ends) {
+      reactor_name = "WAIT";
+    } else if (record->event_type == scheduler_advancing_time_starts ||
+               record->event_type == scheduler_advancing_time_starts) {
+      reactor_name = "ADVANCE TIME";
+    } else {
+      reactor_name = "NO REACTOR";
     }
-    // Default name is the reactor name.
-    char* name = reactor_name;
+  }
+  // Default name is the reactor name.
+  char* name = reactor_name;
 
-    int trigger_index;
-    char* trigger_name = get_trigger_name(trace[i].trigger, &trigger_index);
-    if (trigger_name == NULL) {
-      trigger_name = "NONE";
-    }
-    // By default, the timestamp used in the trace is the elapsed
-    // physical time in microseconds.  But for schedule_called events,
-    // it will instead be the logical time at which the action or timer
-    // is to be scheduled.
-    interval_t elapsed_physical_time = (trace[i].physical_time - start_time) / 1000;
-    interval_t timestamp = elapsed_physical_time;
-    interval_t elapsed_logical_time = (trace[i].logical_time - start_time) / 1000;
+  int trigger_index;
+  char* trigger_name = get_trigger_name(record->trigger, &trigger_index);
+  if (trigger_name == NULL) {
+    trigger_name = "NONE";
+  }
+  // By default, the timestamp used in the trace is the elapsed
+  // physical time in microseconds.  But for schedule_called events,
+  // it will instead be the logical time at which the action or timer
+  // is to be scheduled.
+  interval_t elapsed_physical_time = (record->physical_time - start_time) / 1000;
+  interval_t timestamp = elapsed_physical_time;
+  interval_t elapsed_logical_time = (record->logical_time - start_time) / 1000;
 
-    if (elapsed_physical_time < 0) {
-      fprintf(stderr, "WARNING: Negative elapsed physical time %lld. Skipping trace entry.\n",
-              (long long int)elapsed_physical_time);
-      continue;
-    }
-    if (elapsed_logical_time < 0) {
-      fprintf(stderr, "WARNING: Negative elapsed logical time %lld. Skipping trace entry.\n",
-              (long long int)elapsed_logical_time);
-      continue;
-    }
+  if (elapsed_physical_time < 0) {
+    fprintf(stderr, "WARNING: Negative elapsed physical time %lld. Skipping trace entry.\n",
+            (long long int)elapsed_physical_time);
+    return;
+  }
+  if (elapsed_logical_time < 0) {
+    fprintf(stderr, "WARNING: Negative elapsed logical time %lld. Skipping trace entry.\n",
+            (long long int)elapsed_logical_time);
+    return;
+  }
 
-    // Default thread id is the worker number.
-    int thread_id = trace[i].src_id;
+  // Default thread id is the worker number.
+  int thread_id = record->src_id;
 
-    char* args;
-    asprintf(&args,
-             "{"
-             "\"reaction\": %s,"        // reaction number.
-             "\"logical time\": %lld,"  // logical time.
-             "\"physical time\": %lld," // physical time.
-             "\"microstep\": %d"        // microstep.
-             "}",
-             reaction_name, elapsed_logical_time, elapsed_physical_time, trace[i].microstep);
-    char* phase;
-    int pid;
-    switch (trace[i].event_type) {
-    case reaction_starts:
-      phase = "B";
-      pid = 0; // Process 0 will be named "Execution"
-      break;
-    case reaction_ends:
-      phase = "E";
-      pid = 0; // Process 0 will be named "Execution"
-      break;
-    case schedule_called:
-      phase = "i";
-      pid = reactor_index + 1; // One pid per reactor.
-      if (!physical_time_only) {
-        timestamp = elapsed_logical_time + trace[i].extra_delay / 1000;
-      }
-      thread_id = trigger_index;
-      name = trigger_name;
-      break;
-    case user_event:
-      pid = PID_FOR_USER_EVENT;
-      phase = "i";
-      if (!physical_time_only) {
-        timestamp = elapsed_logical_time;
-      }
-      thread_id = reactor_index;
-      break;
-    case user_value:
-      pid = PID_FOR_USER_EVENT;
-      phase = "C";
-      if (!physical_time_only) {
-        timestamp = elapsed_logical_time;
-      }
-      thread_id = reactor_index;
-      free(args);
-      asprintf(&args, "{\"value\": %lld}", trace[i].extra_delay);
-      break;
-    case worker_wait_starts:
-      pid = PID_FOR_WORKER_WAIT;
-      phase = "B";
-      break;
-    case worker_wait_ends:
-      pid = PID_FOR_WORKER_WAIT;
-      phase = "E";
-      break;
-    case scheduler_advancing_time_starts:
-      pid = PID_FOR_WORKER_ADVANCING_TIME;
-      phase = "B";
-      break;
-    case scheduler_advancing_time_ends:
-      pid = PID_FOR_WORKER_ADVANCING_TIME;
-      phase = "E";
-      break;
-    default:
-      fprintf(stderr, "WARNING: Unrecognized event type %d: %s\n", trace[i].event_type,
-              trace_event_names[trace[i].event_type]);
-      pid = PID_FOR_UNKNOWN_EVENT;
-      phase = "i";
+  char args[160];
+  snprintf(args, sizeof(args),
+           "{"
+           "\"reaction\": %s,"        // reaction number.
+           "\"logical time\": %lld,"  // logical time.
+           "\"physical time\": %lld," // physical time.
+           "\"microstep\": %d"        // microstep.
+           "}",
+           reaction_name, (long long int)elapsed_logical_time, (long long int)elapsed_physical_time,
+           (int)record->microstep);
+  char* phase;
+  int pid;
+  switch (record->event_type) {
+  case reaction_starts:
+    phase = "B";
+    pid = 0; // Process 0 will be named "Execution"
+    break;
+  case reaction_ends:
+    phase = "E";
+    pid = 0; // Process 0 will be named "Execution"
+    break;
+  case schedule_called:
+    phase = "i";
+    pid = reactor_index + 1; // One pid per reactor.
+    if (!physical_time_only) {
+      timestamp = elapsed_logical_time + record->extra_delay / 1000;
     }
-    fprintf(output_file,
-            "{"
-            "\"name\": \"%s\", " // name is the reactor or trigger name.
-            "\"cat\": \"%s\", "  // category is the type of event.
-            "\"ph\": \"%s\", "   // phase is "B" (begin), "E" (end), or "X" (complete).
-            "\"tid\": %d, "      // thread ID.
-            "\"pid\": %d, "      // process ID is required.
-            "\"ts\": %lld, "     // timestamp in microseconds
-            "\"args\": %s"       // additional arguments from above.
-            "},\n",
-            name, trace_event_names[trace[i].event_type], phase, thread_id, pid, (long long int)timestamp, args);
-    free(args);
+    thread_id = trigger_index;
+    name = trigger_name;
+    break;
+  case user_event:
+    pid = PID_FOR_USER_EVENT;
+    phase = "i";
+    if (!physical_time_only) {
+      timestamp = elapsed_logical_time;
+    }
+    thread_id = reactor_index;
+    break;
+  case user_value:
+    pid = PID_FOR_USER_EVENT;
+    phase = "C";
+    if (!physical_time_only) {
+      timestamp = elapsed_logical_time;
+    }
+    thread_id = reactor_index;
+    snprintf(args, sizeof(args), "{\"value\": %lld}", (long long int)record->extra_delay);
+    break;
+  case worker_wait_starts:
+    pid = PID_FOR_WORKER_WAIT;
+    phase = "B";
+    break;
+  case worker_wait_ends:
+    pid = PID_FOR_WORKER_WAIT;
+    phase = "E";
+    break;
+  case scheduler_advancing_time_starts:
+    pid = PID_FOR_WORKER_ADVANCING_TIME;
+    phase = "B";
+    break;
+  case scheduler_advancing_time_ends:
+    pid = PID_FOR_WORKER_ADVANCING_TIME;
+    phase = "E";
+    break;
+  default:
+    fprintf(stderr, "WARNING: Unrecognized event type %d: %s\n", record->event_type,
+            trace_event_names[record->event_type]);
+    pid = PID_FOR_UNKNOWN_EVENT;
+    phase = "i";
+  }
+  chunk_printf(chunk,
+               "{"
+               "\"name\": \"%s\", " // name is the reactor or trigger name.
+               "\"cat\": \"%s\", "  // category is the type of event.
+               "\"ph\": \"%s\", "   // phase is "B" (begin), "E" (end), or "X" (complete).
+               "\"tid\": %d, "      // thread ID.
+               "\"pid\": %d, "      // process ID is required.
+               "\"ts\": %lld, "     // timestamp in microseconds
+               "\"args\": %s"       // additional arguments from above.
+               "},\n",
+               name, trace_event_names[record->event_type], phase, thread_id, pid, (long long int)timestamp, args);
 
-    if (trace[i].src_id > max_thread_id) {
-      max_thread_id = trace[i].src_id;
+  if (record->src_id > maxima->max_thread_id) {
+    maxima->max_thread_id = record->src_id;
+  }
+  // If the event is reaction_starts and physical_time_only is not set,
+  // then also generate an instantaneous
+  // event to be shown in the reactor's section, along with timers and actions.
+  if (record->event_type == reaction_starts && !physical_time_only) {
+    phase = "i";
+    pid = reactor_index + 1;
+    char name[24];
+    snprintf(name, sizeof(name), "reaction %d", record->dst_id);
+
+    // NOTE: If the reactor has more than 1024 timers and actions, then
+    // there will be a collision of thread IDs here.
+    thread_id = 1024 + record->dst_id;
+    if (record->dst_id > maxima->max_reaction_number) {
+      maxima->max_reaction_number = record->dst_id;
     }
-    // If the event is reaction_starts and physical_time_only is not set,
-    // then also generate an instantaneous
-    // event to be shown in the reactor's section, along with timers and actions.
-    if (trace[i].event_type == reaction_starts && !physical_time_only) {
-      phase = "i";
-      pid = reactor_index + 1;
-      reaction_name = (char*)malloc(4);
-      char name[13];
-      snprintf(name, 13, "reaction %d", trace[i].dst_id);
 
-      // NOTE: If the reactor has more than 1024 timers and actions, then
-      // there will be a collision of thread IDs here.
-      thread_id = 1024 + trace[i].dst_id;
-      if (trace[i].dst_id > max_reaction_number) {
-        max_reaction_number = trace[i].dst_id;
-      }
+    chunk_printf(chunk,
+                 "{"
+                 "\"name\": \"%s\", " // name is the reactor or trigger name.
+                 "\"cat\": \"%s\", "  // category is the type of event.
+                 "\"ph\": \"%s\", "   // phase is "B" (begin), "E" (end), or "X" (complete).
+                 "\"tid\": %d, "      // thread ID.
+                 "\"pid\": %d, "      // process ID is required.
+                 "\"ts\": %lld, "     // timestamp in microseconds
+                 "\"args\": {"
+                 "\"microstep\": %d, "     // microstep.
+                 "\"physical time\": %lld" // physical time.
+                 "}},\n",
+                 name, "Reaction", phase, thread_id, pid, (long long int)elapsed_logical_time, (int)record->microstep,
+                 (long long int)elapsed_physical_time);
+  }
+}
 
-      fprintf(output_file,
-              "{"
-              "\"name\": \"%s\", " // name is the reactor or trigger name.
-              "\"cat\": \"%s\", "  // category is the type of event.
-              "\"ph\": \"%s\", "   // phase is "B" (begin), "E" (end), or "X" (complete).
-              "\"tid\": %d, "      // thread ID.
-              "\"pid\": %d, "      // process ID is required.
-              "\"ts\": %lld, "     // timestamp in microseconds
-              "\"args\": {"
-              "\"microstep\": %d, "     // microstep.
-              "\"physical time\": %lld" // physical time.
-              "}},\n",
-              name, "Reaction", phase, thread_id, pid, (long long int)elapsed_logical_time, trace[i].microstep,
-              (long long int)elapsed_physical_time);
+/**
+ * Write the records of a chunk in json. This runs concurrently with the conversion of other chunks.
+ */
+static void convert_chunk(trace_chunk_t* chunk) {
+  if (chunk->data == NULL) {
+    chunk->data = malloc(sizeof(chunk_maxima_t));
+    if (chunk->data == NULL) {
+      fprintf(stderr, "Out of memory.\n");
+      exit(3);
     }
   }
-  return trace_length;
+  chunk_maxima_t* maxima = (chunk_maxima_t*)chunk->data;
+  maxima->max_thread_id = 0;
+  maxima->max_reaction_number = 0;
+  for (int i = 0; i < chunk->length; i++) {
+    convert_record(chunk, maxima, &chunk->records[i]);
+  }
+}
+
+/**
+ * Fold the maxima of a chunk into the global ones.
+ */
+static void merge_chunk(trace_chunk_t* chunk) {
+  chunk_maxima_t* maxima = (chunk_maxima_t*)chunk->data;
+  if (maxima->max_thread_id > max_thread_id) {
+    max_thread_id = maxima->max_thread_id;
+  }
+  if (maxima->max_reaction_number > max_reaction_number) {
+    max_reaction_number = maxima->max_reaction_number;
+  }
 }
 
 /**
@@ -390,6 +423,8 @@ int main(int argc, char* argv[]) {
   for (int i = 1; i < argc; i++) {
     if (strncmp(argv[i], "-p", 2) == 0 || strncmp(argv[i], "--physical", 10) == 0) {
       physical_time_only = true;
+    } else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) && i + 1 < argc) {
+      threads = atoi(argv[++i]);
     } else if (argv[i][0] == '-') {
       usage();
       return (1);
@@ -415,8 +450,7 @@ int main(int argc, char* argv[]) {
   if (read_header() >= 0) {
     // Write the opening bracket into the json file.
     fprintf(output_file, "{ \"traceEvents\": [\n");
-    while (read_and_write_trace() != 0) {
-    };
+    convert_trace(threads, output_file, convert_chunk, merge_chunk);
     write_metadata_events(output_file);
     fprintf(output_file, "]}\n");
   }
@@ -37,6 +37,8 @@ void usage() {
   printf("   The target time to begin tracing.\n\n");
   printf("  -e, --end [time_spec] [units]\n");
   printf("   The target time to stop tracing.\n\n");
+  printf("  -j, --jobs [threads]\n");
+  printf("   The number of conversion threads. The default is one per processor.\n\n");
   printf("\n\n");
 }
 
@@ -49,6 +51,8 @@ typedef struct reaction_stats_t {
   interval_t total_exec_time;
   interval_t max_exec_time;
   interval_t min_exec_time;
+  /** In the statistics of a chunk, whether latest_start_time is known, i.e. a start or end has been seen. */
+  bool seen;
 } reaction_stats_t;
 
 /**
@@ -62,6 +66,27 @@ typedef struct summary_stats_t {
   reaction_stats_t reactions[MAX_NUM_REACTIONS];
 } summary_stats_t;
 
+/**
+ * The end of an interval (reaction execution or wait) whose start is in an earlier chunk.
+ */
+typedef struct pending_end_t {
+  int table_index;
+  int reaction;
+  instant_t time;
+} pending_end_t;
+
+/**
+ * Statistics of one chunk, computed in parallel with other chunks and then
+ * merged into the global statistics in file order.
+ */
+typedef struct chunk_stats_t {
+  summary_stats_t** stats; // Same layout as summary_stats.
+  pending_end_t* pending;
+  size_t pending_size;
+  size_t pending_capacity;
+  instant_t latest_time;
+} chunk_stats_t;
+
 /**
  * Summary stats array. This array has the same size as the
  * object table. Pointer in the array will be void if there
@@ -72,176 +97,261 @@ summary_stats_t** summary_stats;
 /** Largest timestamp seen. */
 instant_t latest_time = 0LL;
 
+/** The window of elapsed logical time to convert. */
+static instant_t trace_start_time = NEVER;
+static instant_t trace_end_time = FOREVER;
+
+/** Number of conversion threads, or 0 for one per processor. */
+static int threads = 0;
+
 /**
- * Read a trace in the trace_file and write it to the output_file as CSV.
- * @return The number of records read or 0 upon seeing an EOF.
+ * Add an interval, such as the execution time of a reaction, to statistics.
  */
-size_t read_and_write_trace(instant_t trace_start_time, instant_t trace_end_time) {
-  int trace_length = read_trace();
-  if (trace_length == 0)
-    return 0;
-  // Write each line.
-  for (int i = 0; i < trace_length; i++) {
-    // printf("DEBUG: reactor self struct pointer: %p\n", trace[i].pointer);
-    int object_instance = -1;
-    char* reactor_name = get_object_description(trace[i].pointer, &object_instance);
-    if (reactor_name == NULL) {
-      reactor_name = "NO REACTOR";
+static void add_interval(reaction_stats_t* rstats, interval_t exec_time) {
+  rstats->occurrences++;
+  rstats->total_exec_time += exec_time;
+  if (exec_time > rstats->max_exec_time || rstats->occurrences == 1) {
+    rstats->max_exec_time = exec_time;
+  }
+  // A minimum of zero is a real minimum, so the first interval is recognized by the count.
+  if (exec_time < rstats->min_exec_time || rstats->occurrences == 1) {
+    rstats->min_exec_time = exec_time;
+  }
+}
+
+/**
+ * Record the start or end of an interval in the statistics of a chunk.
+ * An end whose start is in an earlier chunk is matched when the chunk is merged.
+ */
+static void record_interval(chunk_stats_t* local, int table_index, int reaction, bool is_start, instant_t time) {
+  reaction_stats_t* rstats = &local->stats[table_index]->reactions[reaction];
+  if (is_start) {
+    rstats->latest_start_time = time;
+  } else if (rstats->seen) {
+    add_interval(rstats, time - rstats->latest_start_time);
+    rstats->latest_start_time = 0LL;
+  } else {
+    if (local->pending_size == local->pending_capacity) {
+      local->pending_capacity = local->pending_capacity == 0 ? 64 : 2 * local->pending_capacity;
+      local->pending = (pending_end_t*)realloc(local->pending, local->pending_capacity * sizeof(pending_end_t));
+      if (local->pending == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(3);
+      }
     }
-    int trigger_instance = -1;
-    char* trigger_name = get_trigger_name(trace[i].trigger, &trigger_instance);
-    if (trigger_name == NULL) {
-      trigger_name = "NO TRIGGER";
+    local->pending[local->pending_size++] = (pending_end_t){table_index, reaction, time};
+  }
+  rstats->seen = true;
+}
+
+/**
+ * Write one record of a chunk as CSV and add it to the statistics of the chunk.
+ */
+static void convert_record(trace_chunk_t* chunk, chunk_stats_t* local, trace_record_t* record) {
+  if ((record->logical_time - start_time) < trace_start_time || (record->logical_time - start_time) >= trace_end_time) {
+    // Out of scope.
+    return;
+  }
+  // printf("DEBUG: reactor self struct pointer: %p\n", record->pointer);
+  int object_instance = -1;
+  char* reactor_name = get_object_description(record->pointer, &object_instance);
+  if (reactor_name == NULL) {
+    reactor_name = "NO REACTOR";
+  }
+  int trigger_instance = -1;
+  char* trigger_name = get_trigger_name(record->trigger, &trigger_instance);
+  if (trigger_name == NULL) {
+    trigger_name = "NO TRIGGER";
+  }
+  chunk_printf(chunk, "%s, %s, %d, %d, " PRINTF_TIME ", %d, " PRINTF_TIME ", %s, " PRINTF_TIME "\n",
+               trace_event_names[record->event_type], reactor_name, record->src_id, record->dst_id,
+               record->logical_time - start_time, record->microstep, record->physical_time - start_time, trigger_name,
+               record->extra_delay);
+  // Update summary statistics.
+  summary_stats_t** stats_table = local->stats;
+  if (record->physical_time > local->latest_time) {
+    local->latest_time = record->physical_time;
+  }
+  if (object_instance >= 0 && stats_table[NUM_EVENT_TYPES + object_instance] == NULL) {
+    stats_table[NUM_EVENT_TYPES + object_instance] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+  }
+  if (trigger_instance >= 0 && stats_table[NUM_EVENT_TYPES + trigger_instance] == NULL) {
+    stats_table[NUM_EVENT_TYPES + trigger_instance] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+  }
+
+  summary_stats_t* stats = NULL;
+  reaction_stats_t* rstats;
+  int index;
+
+  // Count of event type.
+  if (stats_table[record->event_type] == NULL) {
+    stats_table[record->event_type] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+  }
+  stats_table[record->event_type]->event_type = record->event_type;
+  stats_table[record->event_type]->description = trace_event_names[record->event_type];
+  stats_table[record->event_type]->occurrences++;
+
+  switch (record->event_type) {
+  case reaction_starts:
+  case reaction_ends:
+    // This code relies on the mutual exclusion of reactions in a reactor
+    // and the ordering of reaction_starts and reaction_ends events.
+    if (record->dst_id >= MAX_NUM_REACTIONS) {
+      fprintf(stderr, "WARNING: Too many reactions. Not all will be shown in summary file.\n");
+      return;
     }
-    if ((trace[i].logical_time - start_time) >= trace_start_time &&
-        (trace[i].logical_time - start_time) < trace_end_time) {
-      fprintf(output_file, "%s, %s, %d, %d, " PRINTF_TIME ", %d, " PRINTF_TIME ", %s, " PRINTF_TIME "\n",
-              trace_event_names[trace[i].event_type], reactor_name, trace[i].src_id, trace[i].dst_id,
-              trace[i].logical_time - start_time, trace[i].microstep, trace[i].physical_time - start_time, trigger_name,
-              trace[i].extra_delay);
-      // Update summary statistics.
-      if (trace[i].physical_time > latest_time) {
-        latest_time = trace[i].physical_time;
-      }
-      if (object_instance >= 0 && summary_stats[NUM_EVENT_TYPES + object_instance] == NULL) {
-        summary_stats[NUM_EVENT_TYPES + object_instance] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
-      }
-      if (trigger_instance >= 0 && summary_stats[NUM_EVENT_TYPES + trigger_instance] == NULL) {
-        summary_stats[NUM_EVENT_TYPES + trigger_instance] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
-      }
+    stats = stats_table[NUM_EVENT_TYPES + object_instance];
+    stats->description = reactor_name;
+    if (record->dst_id >= stats->num_reactions_seen) {
+      stats->num_reactions_seen = record->dst_id + 1;
+    }
+    record_interval(local, NUM_EVENT_TYPES + object_instance, record->dst_id, record->event_type == reaction_starts,
+                    record->physical_time);
+    break;
+  case schedule_called:
+    if (trigger_instance < 0) {
+      // No trigger. Do not report.
+      return;
+    }
+    stats = stats_table[NUM_EVENT_TYPES + trigger_instance];
+    stats->description = trigger_name;
+    break;
+  case user_event:
+    // Although these are not exec times and not reactions,
+    // commandeer the first entry in the reactions array to track values.
+    stats = stats_table[NUM_EVENT_TYPES + object_instance];
+    stats->description = reactor_name;
+    break;
+  case user_value:
+    // Although these are not exec times and not reactions,
+    // commandeer the first entry in the reactions array to track values.
+    stats = stats_table[NUM_EVENT_TYPES + object_instance];
+    stats->description = reactor_name;
+    rstats = &stats->reactions[0];
+    // User values are stored in the "extra_delay" field, which is an interval_t.
+    add_interval(rstats, record->extra_delay);
+    break;
+  case worker_wait_starts:
+  case worker_wait_ends:
+  case scheduler_advancing_time_starts:
+  case scheduler_advancing_time_ends:
+    // Use the reactions array to store data.
+    // There will be two entries per worker, one for waits on the
+    // reaction queue and one for waits while advancing time.
+    index = record->src_id * 2;
+    // Even numbered indices are used for waits on reaction queue.
+    // Odd numbered indices for waits for time advancement.
+    if (record->event_type == scheduler_advancing_time_starts || record->event_type == scheduler_advancing_time_ends) {
+      index++;
+    }
+    if (object_table_size + index >= table_size) {
+      fprintf(stderr, "WARNING: Too many workers. Not all will be shown in summary file.\n");
+      return;
+    }
+    stats = stats_table[NUM_EVENT_TYPES + object_table_size + index];
+    if (stats == NULL) {
+      stats = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+      stats_table[NUM_EVENT_TYPES + object_table_size + index] = stats;
+    }
+    // num_reactions_seen here will be used to store the number of
+    // entries in the reactions array, which is twice the number of workers.
+    if (index >= stats->num_reactions_seen) {
+      stats->num_reactions_seen = index;
+    }
+    record_interval(local, NUM_EVENT_TYPES + object_table_size + index, index,
+                    record->event_type == worker_wait_starts || record->event_type == scheduler_advancing_time_starts,
+                    record->physical_time);
+    break;
+  default:
+    // No special summary statistics for the rest.
+    break;
+  }
+  // Common stats across event types.
+  if (stats != NULL) {
+    stats->occurrences++;
+    stats->event_type = record->event_type;
+  }
+}
 
-      summary_stats_t* stats = NULL;
-      interval_t exec_time;
-      reaction_stats_t* rstats;
-      int index;
+/**
+ * Write the records of a chunk as CSV and collect statistics of the chunk.
+ * This runs concurrently with the conversion of other chunks.
+ */
+static void convert_chunk(trace_chunk_t* chunk) {
+  chunk_stats_t* local = (chunk_stats_t*)chunk->data;
+  if (local == NULL) {
+    local = (chunk_stats_t*)calloc(1, sizeof(chunk_stats_t));
+    if (local == NULL || (local->stats = (summary_stats_t**)calloc(table_size, sizeof(summary_stats_t*))) == NULL) {
+      fprintf(stderr, "Out of memory.\n");
+      exit(3);
+    }
+    chunk->data = local;
+  }
+  for (int i = 0; i < chunk->length; i++) {
+    convert_record(chunk, local, &chunk->records[i]);
+  }
+}
 
-      // Count of event type.
-      if (summary_stats[trace[i].event_type] == NULL) {
-        summary_stats[trace[i].event_type] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
-      }
-      summary_stats[trace[i].event_type]->event_type = trace[i].event_type;
-      summary_stats[trace[i].event_type]->description = trace_event_names[trace[i].event_type];
-      summary_stats[trace[i].event_type]->occurrences++;
-
-      switch (trace[i].event_type) {
-      case reaction_starts:
-      case reaction_ends:
-        // This code relies on the mutual exclusion of reactions in a reactor
-        // and the ordering of reaction_starts and reaction_ends events.
-        if (trace[i].dst_id >= MAX_NUM_REACTIONS) {
-          fprintf(stderr, "WARNING: Too many reactions. Not all will be shown in summary file.\n");
-          continue;
-        }
-        stats = summary_stats[NUM_EVENT_TYPES + object_instance];
-        stats->description = reactor_name;
-        if (trace[i].dst_id >= stats->num_reactions_seen) {
-          stats->num_reactions_seen = trace[i].dst_id + 1;
-        }
-        rstats = &stats->reactions[trace[i].dst_id];
-        if (trace[i].event_type == reaction_starts) {
-          rstats->latest_start_time = trace[i].physical_time;
-        } else {
-          rstats->occurrences++;
-          exec_time = trace[i].physical_time - rstats->latest_start_time;
-          rstats->latest_start_time = 0LL;
-          rstats->total_exec_time += exec_time;
-          if (exec_time > rstats->max_exec_time) {
-            rstats->max_exec_time = exec_time;
-          }
-          if (exec_time < rstats->min_exec_time || rstats->min_exec_time == 0LL) {
-            rstats->min_exec_time = exec_time;
-          }
-        }
-        break;
-      case schedule_called:
-        if (trigger_instance < 0) {
-          // No trigger. Do not report.
-          continue;
-        }
-        stats = summary_stats[NUM_EVENT_TYPES + trigger_instance];
-        stats->description = trigger_name;
-        break;
-      case user_event:
-        // Although these are not exec times and not reactions,
-        // commandeer the first entry in the reactions array to track values.
-        stats = summary_stats[NUM_EVENT_TYPES + object_instance];
-        stats->description = reactor_name;
-        break;
-      case user_value:
-        // Although these are not exec times and not reactions,
-        // commandeer the first entry in the reactions array to track values.
-        stats = summary_stats[NUM_EVENT_TYPES + object_instance];
-        stats->description = reactor_name;
-        rstats = &stats->reactions[0];
-        rstats->occurrences++;
-        // User values are stored in the "extra_delay" field, which is an interval_t.
-        interval_t value = trace[i].extra_delay;
-        rstats->total_exec_time += value;
-        if (value > rstats->max_exec_time) {
-          rstats->max_exec_time = value;
-        }
-        if (value < rstats->min_exec_time || rstats->min_exec_time == 0LL) {
-          rstats->min_exec_time = value;
-        }
-        break;
-      case worker_wait_starts:
-      case worker_wait_ends:
-      case scheduler_advancing_time_starts:
-      case scheduler_advancing_time_ends:
-        // Use the reactions array to store data.
-        // There will be two entries per worker, one for waits on the
-        // reaction queue and one for waits while advancing time.
-        index = trace[i].src_id * 2;
-        // Even numbered indices are used for waits on reaction queue.
-        // Odd numbered indices for waits for time advancement.
-        if (trace[i].event_type == scheduler_advancing_time_starts ||
-            trace[i].event_type == scheduler_advancing_time_ends) {
-          index++;
-        }
-        if (object_table_size + index >= table_size) {
-          fprintf(stderr, "WARNING: Too many workers. Not all will be shown in summary file.\n");
-          continue;
-        }
-        stats = summary_stats[NUM_EVENT_TYPES + object_table_size + index];
-        if (stats == NULL) {
-          stats = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
-          summary_stats[NUM_EVENT_TYPES + object_table_size + index] = stats;
-        }
-        // num_reactions_seen here will be used to store the number of
-        // entries in the reactions array, which is twice the number of workers.
-        if (index >= stats->num_reactions_seen) {
-          stats->num_reactions_seen = index;
+/**
+ * Merge the statistics of a chunk into the global statistics and clear them.
+ * Chunks are merged in file order, so that the end of an interval in one
+ * chunk is matched with its start in an earlier one.
+ */
+static void merge_chunk(trace_chunk_t* chunk) {
+  chunk_stats_t* local = (chunk_stats_t*)chunk->data;
+  if (local->latest_time > latest_time) {
+    latest_time = local->latest_time;
+  }
+  for (size_t i = 0; i < local->pending_size; i++) {
+    pending_end_t* end = &local->pending[i];
+    if (summary_stats[end->table_index] == NULL) {
+      summary_stats[end->table_index] = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+    }
+    reaction_stats_t* rstats = &summary_stats[end->table_index]->reactions[end->reaction];
+    add_interval(rstats, end->time - rstats->latest_start_time);
+    rstats->latest_start_time = 0LL;
+  }
+  local->pending_size = 0;
+  local->latest_time = 0LL;
+  for (int i = 0; i < table_size; i++) {
+    summary_stats_t* from = local->stats[i];
+    if (from == NULL)
+      continue;
+    local->stats[i] = NULL;
+    summary_stats_t* to = summary_stats[i];
+    if (to == NULL) {
+      to = (summary_stats_t*)calloc(1, sizeof(summary_stats_t));
+      summary_stats[i] = to;
+    }
+    if (from->description != NULL) {
+      to->description = from->description;
+    }
+    if (from->occurrences > 0) {
+      to->event_type = from->event_type;
+    }
+    to->occurrences += from->occurrences;
+    if (from->num_reactions_seen > to->num_reactions_seen) {
+      to->num_reactions_seen = from->num_reactions_seen;
+    }
+    for (int j = 0; j < MAX_NUM_REACTIONS; j++) {
+      reaction_stats_t* rfrom = &from->reactions[j];
+      reaction_stats_t* rto = &to->reactions[j];
+      if (rfrom->occurrences > 0) {
+        if (rfrom->max_exec_time > rto->max_exec_time || rto->occurrences == 0) {
+          rto->max_exec_time = rfrom->max_exec_time;
         }
-        rstats = &stats->reactions[index];
-        if (trace[i].event_type == worker_wait_starts || trace[i].event_type == scheduler_advancing_time_starts) {
-          rstats->latest_start_time = trace[i].physical_time;
-        } else {
-          rstats->occurrences++;
-          exec_time = trace[i].physical_time - rstats->latest_start_time;
-          rstats->latest_start_time = 0LL;
-          rstats->total_exec_time += exec_time;
-          if (exec_time > rstats->max_exec_time) {
-            rstats->max_exec_time = exec_time;
-          }
-          if (exec_time < rstats->min_exec_time || rstats->min_exec_time == 0LL) {
-            rstats->min_exec_time = exec_time;
-          }
+        if (rfrom->min_exec_time < rto->min_exec_time || rto->occurrences == 0) {
+          rto->min_exec_time = rfrom->min_exec_time;
         }
-        break;
-      default:
-        // No special summary statistics for the rest.
-        break;
+        rto->occurrences += rfrom->occurrences;
+        rto->total_exec_time += rfrom->total_exec_time;
       }
-      // Common stats across event types.
-      if (stats != NULL) {
-        stats->occurrences++;
-        stats->event_type = trace[i].event_type;
+      if (rfrom->seen) {
+        rto->latest_start_time = rfrom->latest_start_time;
       }
-    } else {
-      // Out of scope.
     }
+    free(from);
   }
-  return trace_length;
 }
 
 /**
@@ -410,6 +520,13 @@ int process_args(int argc, const char* argv[], char** root, instant_t* start_tim
         usage();
         return -1;
       }
+    } else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0) {
+      if (argc < i + 1) {
+        printf("-j needs a number of threads.");
+        usage();
+        return -1;
+      }
+      threads = atoi(argv[i++]);
     } else if (strcmp(arg, "-e") == 0) {
       if (argc < i + 2) {
         printf("-e needs time value and unit.");
@@ -432,8 +549,6 @@ int process_args(int argc, const char* argv[], char** root, instant_t* start_tim
 }
 
 int main(int argc, const char* argv[]) {
-  instant_t trace_start_time = NEVER;
-  instant_t trace_end_time = FOREVER;
   char* root;
 
   if (process_args(argc, argv, &root, &trace_start_time, &trace_end_time) != 0) {
@@ -466,8 +581,12 @@ int main(int argc, const char* argv[]) {
     // Write a header line into the CSV file.
     fprintf(output_file, "Event, Reactor, Source, Destination, Elapsed Logical Time, Microstep, Elapsed Physical Time, "
                          "Trigger, Extra Delay\n");
-    while (read_and_write_trace(trace_start_time, trace_end_time) != 0) {
-    };
+    // Go straight to the blocks that may hold records in the requested window.
+    if (trace_start_time != NEVER || trace_end_time != FOREVER) {
+      seek_trace(trace_start_time == NEVER ? NEVER : start_time + trace_start_time,
+                 trace_end_time == FOREVER ? FOREVER : start_time + trace_end_time, TRACE_ANY_WORKER);
+    }
+    convert_trace(threads, output_file, convert_chunk, merge_chunk);
 
     write_summary_file();
 
@@ -6,30 +6,63 @@
  */
 #define LF_TRACE
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "reactor.h"
 #include "trace.h"
 #include "trace_util.h"
 #include "trace_impl.h"
+#include "trace_codec.h"
 
-/** Buffer for reading object descriptions. Size limit is BUFFER_SIZE bytes. */
-char buffer[BUFFER_SIZE];
-
-/** Buffer for reading trace records. */
-trace_record_t trace[TRACE_BUFFER_CAPACITY];
+/** Records of the chunk most recently read by read_trace(). */
+trace_record_t* trace = NULL;
 
 /** The start time read from the trace file. */
 instant_t start_time;
 
+/** The trace file mapped into memory, and the position of the next chunk to locate. */
+static const uint8_t* trace_data = NULL;
+static size_t trace_data_size = 0;
+static size_t trace_position = 0;
+
+/** Whether the file has the indexed format described in trace_codec.h rather than the old one. */
+static bool indexed_format = false;
+
+/** Offset of the first block in the file. */
+static size_t blocks_offset = 0;
+
+/** The index at the end of the file, or NULL if the file has none. */
+static trace_index_entry_t* block_index = NULL;
+static size_t block_index_size = 0;
+
+/** Position in the index of the next block to consider. */
+static size_t next_block = 0;
+
+/** The window set by seek_trace(). */
+static instant_t window_from = NEVER;
+static instant_t window_to = FOREVER;
+static int window_worker = TRACE_ANY_WORKER;
+
 /** Name of the top-level reactor (first entry in symbol table). */
 char* top_level = NULL;
 
 /** Table of pointers to the self struct of a reactor. */
-// FIXME: Replace with hash table implementation.
 object_description_t* object_table;
 int object_table_size = 0;
 
+/**
+ * Hash tables from object pointers and trigger pointers to positions in the
+ * object table plus one, so that 0 marks an empty slot. Their size is a power of two.
+ */
+static int* object_hash = NULL;
+static int* trigger_hash = NULL;
+static size_t hash_mask = 0;
+
 typedef struct open_file_t open_file_t;
 typedef struct open_file_t {
   FILE* file;
@@ -100,6 +133,79 @@ FILE* open_file(const char* path, const char* mode) {
   return result;
 }
 
+
+/**
+ * Make the buffer pointed to hold at least the specified number of bytes.
+ * Exit if out of memory.
+ */
+static void reserve(void** buffer, size_t* capacity, size_t size) {
+  if (size > *capacity) {
+    size_t grown_capacity = *capacity * 2 > size ? *capacity * 2 : size;
+    void* grown = realloc(*buffer, grown_capacity);
+    if (grown == NULL) {
+      fprintf(stderr, "ERROR: Cannot allocate a buffer of %zu bytes.\n", grown_capacity);
+      exit(4);
+    }
+    *buffer = grown;
+    *capacity = grown_capacity;
+  }
+}
+
+static size_t hash_pointer(void* pointer) { return (size_t)(((uint64_t)(uintptr_t)pointer >> 3) * 0x9E3779B97F4A7C15ull); }
+
+/**
+ * Add the entry at the specified position of the object table to a hash table
+ * unless an earlier entry has the same key.
+ */
+static void hash_insert(int* table, void* key, int position, bool triggers) {
+  for (size_t slot = hash_pointer(key) & hash_mask;; slot = (slot + 1) & hash_mask) {
+    if (table[slot] == 0) {
+      table[slot] = position + 1;
+      return;
+    }
+    object_description_t* entry = &object_table[table[slot] - 1];
+    if ((triggers ? entry->trigger : entry->pointer) == key)
+      return;
+  }
+}
+
+/**
+ * Return the position in the object table of the first entry with the specified key, or -1.
+ */
+static int hash_find(int* table, void* key, bool triggers) {
+  if (table == NULL)
+    return -1;
+  for (size_t slot = hash_pointer(key) & hash_mask; table[slot] != 0; slot = (slot + 1) & hash_mask) {
+    object_description_t* entry = &object_table[table[slot] - 1];
+    if ((triggers ? entry->trigger : entry->pointer) == key)
+      return table[slot] - 1;
+  }
+  return -1;
+}
+
+/**
+ * Build the hash tables used by get_object_description() and get_trigger_name().
+ */
+static void build_object_hash() {
+  size_t size = 16;
+  while (size < 2 * (size_t)object_table_size) {
+    size *= 2;
+  }
+  hash_mask = size - 1;
+  object_hash = (int*)calloc(size, sizeof(int));
+  trigger_hash = (int*)calloc(size, sizeof(int));
+  if (object_hash == NULL || trigger_hash == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+    exit(3);
+  }
+  for (int i = 0; i < object_table_size; i++) {
+    hash_insert(object_hash, object_table[i].pointer, i, false);
+    if (object_table[i].type == trace_trigger) {
+      hash_insert(trigger_hash, object_table[i].trigger, i, true);
+    }
+  }
+}
+
 /**
  * Get the description of the object pointed to by the specified pointer.
  * For example, this can be the name of a reactor (pointer points to
@@ -112,19 +218,11 @@ FILE* open_file(const char* path, const char* mode) {
  * @param index An optional pointer into which to write the index.
  */
 char* get_object_description(void* pointer, int* index) {
-  // FIXME: Replace with a hash table implementation.
-  for (int i = 0; i < object_table_size; i++) {
-    if (object_table[i].pointer == pointer) {
-      if (index != NULL) {
-        *index = i;
-      }
-      return object_table[i].description;
-    }
-  }
+  int position = hash_find(object_hash, pointer, false);
   if (index != NULL) {
-    *index = 0;
+    *index = position < 0 ? 0 : position;
   }
-  return NULL;
+  return position < 0 ? NULL : object_table[position].description;
 }
 
 /**
@@ -137,19 +235,11 @@ char* get_object_description(void* pointer, int* index) {
  * @param index An optional pointer into which to write the index.
  */
 char* get_trigger_name(void* trigger, int* index) {
-  // FIXME: Replace with a hash table implementation.
-  for (int i = 0; i < object_table_size; i++) {
-    if (object_table[i].trigger == trigger && object_table[i].type == trace_trigger) {
-      if (index != NULL) {
-        *index = i;
-      }
-      return object_table[i].description;
-    }
-  }
+  int position = hash_find(trigger_hash, trigger, true);
   if (index != NULL) {
-    *index = 0;
+    *index = position < 0 ? 0 : position;
   }
-  return NULL;
+  return position < 0 ? NULL : object_table[position].description;
 }
 
 /**
@@ -174,23 +264,99 @@ void print_table() {
   printf("-------\n");
 }
 
-size_t read_header() {
-  // Read the start time.
-  int items_read = fread(&start_time, sizeof(instant_t), 1, trace_file);
-  if (items_read != 1)
+/**
+ * Map the trace file into memory. If the file cannot be mapped, read it into memory instead.
+ */
+static void map_trace_file() {
+  struct stat status;
+  int fd = fileno(trace_file);
+  if (fstat(fd, &status) != 0 || status.st_size == 0)
+    _LF_TRACE_FAILURE(trace_file);
+  trace_data_size = (size_t)status.st_size;
+  void* mapped = mmap(NULL, trace_data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapped == MAP_FAILED) {
+    mapped = malloc(trace_data_size);
+    if (mapped == NULL || fread(mapped, 1, trace_data_size, trace_file) != trace_data_size)
+      _LF_TRACE_FAILURE(trace_file);
+  }
+  trace_data = (const uint8_t*)mapped;
+  trace_position = 0;
+}
+
+/**
+ * Copy the specified number of bytes at the current position of the trace file and advance the position.
+ * @return false if the file is too short.
+ */
+static bool read_bytes(void* destination, size_t size) {
+  if (trace_data_size - trace_position < size)
+    return false;
+  memcpy(destination, trace_data + trace_position, size);
+  trace_position += size;
+  return true;
+}
+
+/**
+ * Read the index at the end of a file in the indexed format, if there is one.
+ */
+static void read_index() {
+  trace_file_trailer_t trailer;
+  if (trace_data_size - blocks_offset >= sizeof(trailer)) {
+    memcpy(&trailer, trace_data + trace_data_size - sizeof(trailer), sizeof(trailer));
+    size_t index_bytes = sizeof(trace_index_entry_t) * trailer.index_size;
+    if (memcmp(trailer.magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH) == 0 &&
+        trailer.index_offset >= (int64_t)blocks_offset &&
+        (size_t)trailer.index_offset + index_bytes + sizeof(trailer) == trace_data_size) {
+      // The index is not necessarily aligned in the file, so copy it.
+      block_index = (trace_index_entry_t*)malloc(index_bytes + 1);
+      if (block_index == NULL) {
+        fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
+        exit(3);
+      }
+      memcpy(block_index, trace_data + trailer.index_offset, index_bytes);
+      block_index_size = trailer.index_size;
+      printf("The trace has %zu blocks.\n", block_index_size);
+      return;
+    }
+  }
+  printf("The trace has no index, probably because the program did not terminate normally.\n");
+}
+
+/**
+ * Parse the header at the start of the trace data.
+ * @param indexed_file Whether the data is a whole file, which may end with an index.
+ */
+static size_t parse_header(bool indexed_file) {
+  // Files in the indexed format start with magic bytes. Older files start with the start time.
+  char magic[TRACE_FILE_MAGIC_LENGTH];
+  if (!read_bytes(magic, sizeof(magic)))
     _LF_TRACE_FAILURE(trace_file);
+  indexed_format = memcmp(magic, TRACE_FILE_MAGIC, TRACE_FILE_MAGIC_LENGTH) == 0;
+  if (indexed_format) {
+    uint32_t version;
+    if (!read_bytes(&version, sizeof(uint32_t)))
+      _LF_TRACE_FAILURE(trace_file);
+    if (version > TRACE_FORMAT_VERSION) {
+      fprintf(stderr, "ERROR: Trace file has format version %u. This tool reads up to version %d.\n", version,
+              TRACE_FORMAT_VERSION);
+      exit(4);
+    }
+    // Read the start time.
+    if (!read_bytes(&start_time, sizeof(instant_t)))
+      _LF_TRACE_FAILURE(trace_file);
+  } else {
+    memcpy(&start_time, magic, sizeof(instant_t));
+  }
 
   printf("Start time is %lld.\n", (long long int)start_time);
 
   // Read the table mapping pointers to descriptions.
   // First read its length.
-  items_read = fread(&object_table_size, sizeof(int), 1, trace_file);
-  if (items_read != 1)
+  if (!read_bytes(&object_table_size, sizeof(int)) || object_table_size < 0)
     _LF_TRACE_FAILURE(trace_file);
 
   printf("There are %d objects traced.\n", object_table_size);
 
-  object_table = calloc(object_table_size, sizeof(trace_record_t));
+  object_table = calloc(object_table_size + 1, sizeof(object_description_t));
   if (object_table == NULL) {
     fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
     return -1;
@@ -198,72 +364,333 @@ size_t read_header() {
 
   // Next, read each table entry.
   for (int i = 0; i < object_table_size; i++) {
-    void* reactor;
-    items_read = fread(&reactor, sizeof(void*), 1, trace_file);
-    if (items_read != 1)
+    if (!read_bytes(&object_table[i].pointer, sizeof(void*)))
       _LF_TRACE_FAILURE(trace_file);
-    object_table[i].pointer = reactor;
-
-    void* trigger;
-    items_read = fread(&trigger, sizeof(trigger_t*), 1, trace_file);
-    if (items_read != 1)
+    if (!read_bytes(&object_table[i].trigger, sizeof(trigger_t*)))
       _LF_TRACE_FAILURE(trace_file);
-    object_table[i].trigger = trigger;
-
     // Next, read the type.
-    _lf_trace_object_t trace_type;
-    items_read = fread(&trace_type, sizeof(_lf_trace_object_t), 1, trace_file);
-    if (items_read != 1)
+    if (!read_bytes(&object_table[i].type, sizeof(_lf_trace_object_t)))
       _LF_TRACE_FAILURE(trace_file);
-    object_table[i].type = trace_type;
 
-    // Next, read the string description into the buffer.
-    int description_length = 0;
-    char character;
-    items_read = fread(&character, sizeof(char), 1, trace_file);
-    if (items_read != 1)
+    // Next, the null-terminated description, of which at most BUFFER_SIZE - 1 characters are kept.
+    const char* description = (const char*)trace_data + trace_position;
+    size_t description_length = strnlen(description, trace_data_size - trace_position);
+    if (description_length == trace_data_size - trace_position)
       _LF_TRACE_FAILURE(trace_file);
-    while (character != 0 && description_length < BUFFER_SIZE - 1) {
-      buffer[description_length++] = character;
-      items_read = fread(&character, sizeof(char), 1, trace_file);
-      if (items_read != 1)
-        _LF_TRACE_FAILURE(trace_file);
+    trace_position += description_length + 1;
+    if (description_length > BUFFER_SIZE - 1) {
+      description_length = BUFFER_SIZE - 1;
     }
-    // Terminate with null.
-    buffer[description_length++] = 0;
-
-    // Allocate memory to store the description.
-    object_table[i].description = malloc(description_length);
-    strcpy(object_table[i].description, buffer);
+    object_table[i].description = malloc(description_length + 1);
+    memcpy(object_table[i].description, description, description_length);
+    object_table[i].description[description_length] = 0;
 
     if (top_level == NULL) {
       top_level = object_table[i].description;
     }
   }
+  build_object_hash();
   print_table();
+  if (indexed_format && indexed_file) {
+    blocks_offset = trace_position;
+    read_index();
+  }
   return object_table_size;
 }
 
+size_t read_header() {
+  map_trace_file();
+  return parse_header(true);
+}
+
+size_t read_header_from_memory(const uint8_t* data, size_t size) {
+  trace_data = data;
+  trace_data_size = size;
+  trace_position = 0;
+  return parse_header(false);
+}
+
+int seek_trace(instant_t from, instant_t to, int worker) {
+  if (!indexed_format)
+    return -1;
+  window_from = from;
+  window_to = to;
+  window_worker = worker;
+  next_block = 0;
+  trace_position = blocks_offset;
+  return 0;
+}
+
+/**
+ * Return whether the specified block may hold records in the window set by seek_trace().
+ */
+static bool block_in_window(trace_block_header_t* block) {
+  return (window_worker == TRACE_ANY_WORKER || block->worker == window_worker) &&
+         block->max_logical_time >= window_from && block->min_logical_time < window_to;
+}
+
+/**
+ * Find the next chunk of the file (in the window, for the indexed format) without decoding it.
+ * @return false if there are no more chunks.
+ */
+static bool locate_chunk(trace_chunk_t* chunk) {
+  if (!indexed_format) {
+    // In the old format, a chunk is an int giving its length followed by the records.
+    if (trace_position == trace_data_size)
+      return false;
+    int trace_length;
+    if (!read_bytes(&trace_length, sizeof(int))) {
+      fprintf(stderr, "Failed to read trace length.\n");
+      exit(3);
+    }
+    if (trace_length < 0) {
+      fprintf(stderr, "ERROR: Trace length %d is negative. File is garbled.\n", trace_length);
+      exit(4);
+    }
+    size_t size = sizeof(trace_record_t) * (size_t)trace_length;
+    if (trace_data_size - trace_position < size) {
+      fprintf(stderr, "Failed to read trace of length %d.\n", trace_length);
+      exit(5);
+    }
+    chunk->source = trace_data + trace_position;
+    chunk->block.record_count = (uint32_t)trace_length;
+    trace_position += size;
+    return trace_length > 0;
+  }
+  trace_block_header_t block;
+  size_t offset;
+  while (true) {
+    if (block_index != NULL) {
+      // Go straight to the next block in the window.
+      while (next_block < block_index_size && !block_in_window(&block_index[next_block].block)) {
+        next_block++;
+      }
+      if (next_block == block_index_size)
+        return false;
+      trace_index_entry_t* entry = &block_index[next_block++];
+      block = entry->block;
+      offset = (size_t)entry->offset + sizeof(trace_block_header_t);
+      if (entry->offset < (int64_t)blocks_offset || offset > trace_data_size ||
+          trace_data_size - offset < block.stored_size) {
+        fprintf(stderr, "ERROR: Trace index is invalid. File is garbled.\n");
+        exit(4);
+      }
+      break;
+    }
+    // Without an index, visit the blocks in turn, skipping the contents of those outside the window.
+    if (trace_position == trace_data_size)
+      return false;
+    if (!read_bytes(&block, sizeof(trace_block_header_t)) || trace_data_size - trace_position < block.stored_size) {
+      fprintf(stderr, "WARNING: The last block of the trace is incomplete and is ignored.\n");
+      trace_position = trace_data_size;
+      return false;
+    }
+    offset = trace_position;
+    trace_position += block.stored_size;
+    if (block_in_window(&block))
+      break;
+  }
+  if (block.record_count == 0 || block.record_count > INT32_MAX / TRACE_RECORD_MAX_ENCODED_SIZE ||
+      block.encoded_size > (size_t)block.record_count * TRACE_RECORD_MAX_ENCODED_SIZE ||
+      block.stored_size > block.encoded_size) {
+    fprintf(stderr, "ERROR: Trace block header is invalid. File is garbled.\n");
+    exit(4);
+  }
+  chunk->source = trace_data + offset;
+  chunk->block = block;
+  return true;
+}
+
+/**
+ * Decode the records of a located chunk into its records array.
+ * This uses only buffers of the chunk, so chunks can be decoded concurrently.
+ */
+static void decode_chunk(trace_chunk_t* chunk) {
+  int length = (int)chunk->block.record_count;
+  reserve((void**)&chunk->records, &chunk->records_capacity, sizeof(trace_record_t) * length);
+  chunk->length = length;
+  if (!indexed_format) {
+    memcpy(chunk->records, chunk->source, sizeof(trace_record_t) * length);
+    return;
+  }
+  const uint8_t* encoded = chunk->source;
+  if (chunk->block.stored_size < chunk->block.encoded_size) {
+    reserve((void**)&chunk->encoded, &chunk->encoded_capacity, chunk->block.encoded_size);
+    if (lf_trace_decompress(chunk->source, chunk->block.stored_size, chunk->encoded, chunk->block.encoded_size) !=
+        chunk->block.encoded_size) {
+      fprintf(stderr, "ERROR: Trace block cannot be decompressed. File is garbled.\n");
+      exit(4);
+    }
+    encoded = chunk->encoded;
+  }
+  reserve((void**)&chunk->decoded, &chunk->decoded_capacity, sizeof(trace_record_nodeps_t) * length);
+  if (lf_trace_decode_records(encoded, chunk->block.encoded_size, chunk->decoded, length) != 0) {
+    fprintf(stderr, "ERROR: Trace block cannot be decoded. File is garbled.\n");
+    exit(4);
+  }
+  for (int i = 0; i < length; i++) {
+    trace_record_nodeps_t* record = &chunk->decoded[i];
+    trace_record_t* result = &chunk->records[i];
+    result->event_type = (trace_event_t)record->event_type;
+    result->pointer = record->pointer;
+    result->src_id = record->src_id;
+    result->dst_id = record->dst_id;
+    result->logical_time = record->logical_time;
+    result->microstep = record->microstep;
+    result->physical_time = record->physical_time;
+    result->trigger = record->trigger;
+    result->extra_delay = record->extra_delay;
+  }
+}
+
 int read_trace() {
-  // Read first the int giving the length of the trace.
-  int trace_length;
-  int items_read = fread(&trace_length, sizeof(int), 1, trace_file);
-  if (items_read != 1) {
-    if (feof(trace_file))
-      return 0;
-    fprintf(stderr, "Failed to read trace length.\n");
+  static trace_chunk_t chunk;
+  if (!locate_chunk(&chunk))
+    return 0;
+  decode_chunk(&chunk);
+  trace = chunk.records;
+  return chunk.length;
+}
+
+void chunk_printf(trace_chunk_t* chunk, const char* format, ...) {
+  if (chunk->text_capacity == 0) {
+    reserve((void**)&chunk->text, &chunk->text_capacity, 4096);
+  }
+  while (true) {
+    size_t available = chunk->text_capacity - chunk->text_length;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(chunk->text + chunk->text_length, available, format, args);
+    va_end(args);
+    if (length < 0)
+      return;
+    if ((size_t)length < available) {
+      chunk->text_length += length;
+      return;
+    }
+    reserve((void**)&chunk->text, &chunk->text_capacity, chunk->text_length + length + 1);
+  }
+}
+
+/**
+ * State shared by the threads of convert_trace(). Chunks go through a ring of
+ * slots: the main thread locates them, any thread converts them, and the main
+ * thread merges them in file order, after which the slot is reused.
+ */
+typedef struct converter_t {
+  pthread_mutex_t mutex;
+  /** Broadcast whenever a chunk is located or converted, or when there are no more chunks. */
+  pthread_cond_t changed;
+  trace_chunk_t* slots;
+  bool* converted;
+  size_t capacity;
+  /** Numbers of chunks located, handed to a thread for conversion, and merged. */
+  size_t located;
+  size_t converting;
+  size_t merged;
+  bool finished;
+  void (*convert)(trace_chunk_t*);
+} converter_t;
+
+static void* converter_thread(void* arg) {
+  converter_t* converter = (converter_t*)arg;
+  pthread_mutex_lock(&converter->mutex);
+  while (true) {
+    while (converter->converting == converter->located && !converter->finished) {
+      pthread_cond_wait(&converter->changed, &converter->mutex);
+    }
+    if (converter->converting == converter->located)
+      break;
+    size_t slot = converter->converting++ % converter->capacity;
+    pthread_mutex_unlock(&converter->mutex);
+    trace_chunk_t* chunk = &converter->slots[slot];
+    decode_chunk(chunk);
+    chunk->text_length = 0;
+    converter->convert(chunk);
+    pthread_mutex_lock(&converter->mutex);
+    converter->converted[slot] = true;
+    pthread_cond_broadcast(&converter->changed);
+  }
+  pthread_mutex_unlock(&converter->mutex);
+  return NULL;
+}
+
+size_t convert_trace(int threads, FILE* output, void (*convert)(trace_chunk_t*), void (*merge)(trace_chunk_t*)) {
+  if (threads <= 0) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = processors > 0 ? (int)processors : 1;
+  }
+  converter_t converter = {.capacity = 4 * (size_t)threads, .convert = convert};
+  converter.slots = (trace_chunk_t*)calloc(converter.capacity, sizeof(trace_chunk_t));
+  converter.converted = (bool*)calloc(converter.capacity, sizeof(bool));
+  pthread_t* workers = (pthread_t*)calloc(threads, sizeof(pthread_t));
+  if (converter.slots == NULL || converter.converted == NULL || workers == NULL) {
+    fprintf(stderr, "ERROR: Memory allocation failure %d.\n", errno);
     exit(3);
   }
-  if (trace_length > TRACE_BUFFER_CAPACITY) {
-    fprintf(stderr, "ERROR: Trace length %d exceeds capacity. File is garbled.\n", trace_length);
-    exit(4);
+  pthread_mutex_init(&converter.mutex, NULL);
+  pthread_cond_init(&converter.changed, NULL);
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&workers[i], NULL, converter_thread, &converter) != 0) {
+      fprintf(stderr, "ERROR: Failed to create a conversion thread.\n");
+      exit(3);
+    }
   }
-  // printf("DEBUG: Trace of length %d being converted.\n", trace_length);
 
-  items_read = fread(&trace, sizeof(trace_record_t), trace_length, trace_file);
-  if (items_read != trace_length) {
-    fprintf(stderr, "Failed to read trace of length %d.\n", trace_length);
-    exit(5);
+  size_t records = 0;
+  while (true) {
+    // Keep the threads supplied with chunks. Only this thread changes located, merged and finished.
+    while (!converter.finished && converter.located - converter.merged < converter.capacity) {
+      size_t number = converter.located;
+      trace_chunk_t* chunk = &converter.slots[number % converter.capacity];
+      bool found = locate_chunk(chunk);
+      chunk->number = number;
+      pthread_mutex_lock(&converter.mutex);
+      if (found) {
+        converter.converted[number % converter.capacity] = false;
+        converter.located++;
+      } else {
+        converter.finished = true;
+      }
+      pthread_cond_broadcast(&converter.changed);
+      pthread_mutex_unlock(&converter.mutex);
+    }
+    if (converter.merged == converter.located)
+      break;
+    // Merge the oldest chunk once it is converted.
+    size_t slot = converter.merged % converter.capacity;
+    pthread_mutex_lock(&converter.mutex);
+    while (!converter.converted[slot]) {
+      pthread_cond_wait(&converter.changed, &converter.mutex);
+    }
+    pthread_mutex_unlock(&converter.mutex);
+    trace_chunk_t* chunk = &converter.slots[slot];
+    if (merge != NULL) {
+      merge(chunk);
+    }
+    if (output != NULL && chunk->text_length > 0 &&
+        fwrite(chunk->text, 1, chunk->text_length, output) != chunk->text_length) {
+      fprintf(stderr, "ERROR: Failed to write the output file.\n");
+      exit(5);
+    }
+    records += chunk->length;
+    converter.merged++;
+  }
+
+  for (int i = 0; i < threads; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  for (size_t i = 0; i < converter.capacity; i++) {
+    free(converter.slots[i].records);
+    free(converter.slots[i].text);
+    free(converter.slots[i].encoded);
+    free(converter.slots[i].decoded);
+    free(converter.slots[i].data);
   }
-  return trace_length;
+  pthread_cond_destroy(&converter.changed);
+  pthread_mutex_destroy(&converter.mutex);
+  free(converter.slots);
+  free(converter.converted);
+  free(workers);
+  return records;
 }
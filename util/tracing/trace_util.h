@@ -9,6 +9,7 @@
 #define LF_TRACE
 #include "reactor.h"
 #include "trace.h"
+#include "trace_codec.h"
 
 /*
  * String description of event types.
@@ -33,8 +34,8 @@ extern const char* trace_event_names[];
  */
 #define BUFFER_SIZE 1024
 
-/* Buffer for reading trace records. */
-extern trace_record_t trace[];
+/* Records of the chunk most recently read by read_trace(). */
+extern trace_record_t* trace;
 
 /* File containing the trace binary data. */
 extern FILE* trace_file;
@@ -126,14 +127,111 @@ void print_table();
  * @brief Read header information.
  * @ingroup Tracing
  *
+ * This maps the trace_file into memory. Records are then read from the mapping.
+ *
  * @return The number of objects in the object table or -1 for failure.
  */
 size_t read_header();
 
+/**
+ * @brief Read header information from memory rather than from the trace_file.
+ * @ingroup Tracing
+ *
+ * This is for headers received from a trace stream (see trace_stream.h), which have no index.
+ *
+ * @param data The header.
+ * @param size The size of the header.
+ * @return The number of objects in the object table.
+ */
+size_t read_header_from_memory(const uint8_t* data, size_t size);
+
 /**
  * @brief Read the trace from the trace_file and put it in the trace global variable.
  * @ingroup Tracing
  *
+ * Each call reads one chunk of records, which for a file in the indexed format
+ * is one block. After seek_trace(), only blocks that may hold records in the
+ * window are read. They can also hold records outside it.
+ *
  * @return The number of trace records read or 0 upon seeing an EOF.
  */
 int read_trace();
+
+/**
+ * @brief Value of the worker argument of seek_trace() that selects all threads.
+ * @ingroup Tracing
+ */
+#define TRACE_ANY_WORKER (-2)
+
+/**
+ * @brief Restrict subsequent calls to read_trace() to a window and start over from the first block.
+ * @ingroup Tracing
+ *
+ * If the file has an index, read_trace() jumps from one block in the window to
+ * the next. Otherwise it reads the block headers in turn but skips the contents
+ * of blocks outside the window.
+ *
+ * @param from The earliest logical time (not elapsed) of interest.
+ * @param to The logical time (not elapsed) from which records are not of interest.
+ * @param worker The LF thread of interest, -1 for threads not created by LF, or TRACE_ANY_WORKER.
+ * @return 0 on success or -1 if the file has the old format, in which case read_trace() reads all records.
+ */
+int seek_trace(instant_t from, instant_t to, int worker);
+
+/**
+ * @brief A chunk of the trace being converted by convert_trace().
+ * @ingroup Tracing
+ */
+typedef struct trace_chunk_t {
+  /** Position of the chunk in the file, counting from 0. */
+  size_t number;
+
+  /** The records of the chunk. */
+  trace_record_t* records;
+  int length;
+
+  /** Output produced by the conversion of the chunk. Append to it with chunk_printf(). */
+  char* text;
+  size_t text_length;
+
+  /**
+   * Data of the converter, for example partial statistics, for the merge function.
+   * Chunk structs are reused, so this is kept from an earlier chunk. It is freed with free() at the end.
+   */
+  void* data;
+
+  // The rest is private to trace_util.c.
+  const uint8_t* source;
+  trace_block_header_t block;
+  size_t records_capacity;
+  size_t text_capacity;
+  uint8_t* encoded;
+  size_t encoded_capacity;
+  trace_record_nodeps_t* decoded;
+  size_t decoded_capacity;
+} trace_chunk_t;
+
+/**
+ * @brief Append formatted text to the output of a chunk.
+ * @ingroup Tracing
+ */
+void chunk_printf(trace_chunk_t* chunk, const char* format, ...);
+
+/**
+ * @brief Convert the rest of the trace chunk by chunk on several threads.
+ * @ingroup Tracing
+ *
+ * The convert function is called concurrently on different chunks, in no
+ * particular order. It may read the object table and call the lookup functions
+ * above, but it must keep everything else it produces in the chunk. The merge
+ * function, if not NULL, is then called on the chunks one at a time and in file
+ * order, after which the text of the chunk is written to the output.
+ * Like read_trace(), this honors the window set by seek_trace().
+ *
+ * @param threads The number of conversion threads, or 0 for one per processor.
+ * @param output The file to write the text of the chunks to, or NULL to discard it.
+ * @param convert The function that converts a chunk.
+ * @param merge The function that folds the results of a chunk into global results, or NULL.
+ * @return The number of records converted.
+ */
+size_t convert_trace(int threads, FILE* output, void (*convert)(trace_chunk_t*), void (*merge)(trace_chunk_t*));